@@ -110,6 +110,8 @@ int main()
 	// create a simple seal who can dive into the sea
 	auto seal = createTexturedLightedObj(texShader, "seal.obj", "seal.png", simpleMaterial);
 	seal->setGlobalTransform(getTranslationMatrix(0.66, 1.6, 1.36) * getScaleMatrix(0.05f));
+	// the seal swims far away from the camera: use simplified meshes when it gets small
+	seal->buildLevelsOfDetail();
 	seal->addLocalTransformKeyframe(getTranslationMatrix(0.66, 1.6, 1.36), 0);
 	seal->addLocalTransformKeyframe(getTranslationMatrix(0.66, 1.6, 1.36), 1);
 
@@ -153,6 +155,8 @@ int main()
 	camera.addGlobalTransformKeyframe(lookAtModel(glm::vec3(-0, 0.6, 17.3), glm::vec3(0.5, 0.29, 16.3), forward), 6);
 
 	addCubeMap(viewer, "skybox");
+	// the ocean image only changes 10 times per second: load it then
+	int shownImage = -1;
 	while (viewer.isRunning())
 	{
 		viewer.handleEvent();
@@ -160,10 +164,14 @@ int main()
 
 		// render the gif located in the ocean folder. Displaying the 20 images in one second
 		int imageNumber = static_cast<int>(viewer.getTime() / 2 * 20) % 20;
-		waterPlane->setImage(TEXTURE_PATH + "ocean/" + std::to_string(imageNumber) + ".png");
+		if (imageNumber != shownImage) {
+			shownImage = imageNumber;
+			waterPlane->setImage(TEXTURE_PATH + "ocean/" + std::to_string(imageNumber) + ".png");
+		}
 
 		viewer.draw();
 		viewer.display();
 	}
+	MeshRenderable::reportTriangleStatistics();
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -199,6 +199,9 @@ int main() {
 	viewer.setKeyboardSpeed(8);
 	viewer.setSimulationTime(0);
 
+	// the ocean image only changes 10 times per second: load it then
+	int shownImage = -1;
+
 	// this scene is for the penguin beeing ejected from the boat and landing on the ice
 	while( viewer.isRunning()) {
 		viewer.handleEvent();
@@ -206,7 +209,10 @@ int main() {
 		
 		// render the gif located in the ocean folder. Displaying the 20 images in one second
 		int imageNumber = static_cast<int>(viewer.getTime()/2 * 20) % 20;
-		waterPlane->setImage(TEXTURE_PATH + "ocean/"+std::to_string(imageNumber)+".png");
+		if (imageNumber != shownImage) {
+			shownImage = imageNumber;
+			waterPlane->setImage(TEXTURE_PATH + "ocean/"+std::to_string(imageNumber)+".png");
+		}
 
 		viewer.draw();
 		viewer.display();
@@ -5,6 +5,8 @@
 #include <texturing/TexturedCubeRenderable.hpp>
 #include <texturing/TexturedMeshRenderable.hpp>
 #include <texturing/TexturedLightedMeshRenderable.hpp>
+#include <texturing/InstancedMeshRenderable.hpp>
+#include <texturing/ImpostorRenderable.hpp>
 #include <texturing/MultiTexturedCubeRenderable.hpp>
 #include <texturing/MipMapCubeRenderable.hpp>
 #include <texturing/BillBoardPlaneRenderable.hpp>
@@ -84,6 +86,8 @@ int main() {
 	/*SHADERS*/
 	ShaderProgramPtr flatShader = addShader(viewer, "flat");
 	ShaderProgramPtr texShader = addShader(viewer, "texture");
+	ShaderProgramPtr instancedTexShader = addShader(viewer, "instancedTextureVertex", "textureFragment");
+	ShaderProgramPtr impostorShader = addShader(viewer, "impostor");
 	ShaderProgramPtr wavesShader = addShader(viewer, "waves");
 	ShaderProgramPtr nonRigidShader = addShader(viewer, "nonRigid");
 
@@ -182,12 +186,15 @@ int main() {
 
 	// use a list of vec3 to render all of the trees
 	std::vector<glm::vec3> treePos = {glm::vec3(2.6,5,-14), glm::vec3(1.6,5,5.7), glm::vec3(-3.8,6,-3.8), glm::vec3(-2,6,-7.4), glm::vec3(9.4,2,14), glm::vec3(13,4,-14), glm::vec3(-6.7,6.7,-14), glm::vec3(-2,3.4,13), glm::vec3(-15.5,7.6,-3.7), glm::vec3(23.7,5,5), glm::vec3(11.3,5,-0.6)};
+	// all the trees share the same mesh, they are drawn in a single instanced call
+	// the trees farther than 25 units from the camera are drawn as impostors
+	auto sapins = std::make_shared<InstancedMeshRenderable>(instancedTexShader, MESHES_PATH + "sapin.obj", simpleMaterial, TEXTURE_PATH + "sapin.png");
+	auto sapinImpostors = std::make_shared<ImpostorRenderable>(impostorShader, sapins, 25);
 	for (int i = 0; i < treePos.size(); i++) {
-		/* code */
-		auto sapin = createTexturedLightedObj(texShader, "sapin.obj", "sapin.png", simpleMaterial);
-		sapin -> setGlobalTransform(getTranslationMatrix(treePos[i]) * getScaleMatrix(1));
-		viewer.addRenderable(sapin);
+		sapinImpostors -> addInstance(getTranslationMatrix(treePos[i]) * getScaleMatrix(1));
 	}
+	viewer.addRenderable(sapins);
+	viewer.addRenderable(sapinImpostors);
 
 	auto mapPlane = std::make_shared<TexturedPlaneRenderable>(texShader, TEXTURE_PATH + "map.jpg");
 	mapPlane->setGlobalTransform(getTranslationMatrix(8,6,-5) * getRotationMatrix(degToRad(30), glm::vec3(0,1,0)) * getScaleMatrix(1, 0.7, 1));
@@ -234,6 +241,9 @@ int main() {
 	viewer.setKeyboardSpeed(8);
 	viewer.setSimulationTime(0);
 
+	// the ocean image only changes 10 times per second: load it then
+	int shownImage = -1;
+
 	// this scene uses a custom flag renderable to display a texture on a list of springs
 	while( viewer.isRunning()) {
 		viewer.handleEvent();
@@ -241,7 +251,10 @@ int main() {
 
 		// render the gif located in the ocean folder. Displaying the 20 images in one second
 		int imageNumber = static_cast<int>(viewer.getTime()/2 * 20) % 20;
-		waterPlane->setImage(TEXTURE_PATH + "ocean/"+std::to_string(imageNumber)+".png");
+		if (imageNumber != shownImage) {
+			shownImage = imageNumber;
+			waterPlane->setImage(TEXTURE_PATH + "ocean/"+std::to_string(imageNumber)+".png");
+		}
 
 		viewer.draw();
 		viewer.display();
@@ -270,8 +283,7 @@ void createFlag(Viewer& viewer, DynamicSystemPtr& system, DynamicSystemRenderabl
 
     for (const ParticlePtr & particle : flag->getParticles())
         system->addParticle(particle);
-    for (const ForceFieldPtr & force_field : flag->getSprings())
-        system->addForceField(force_field);
+    system->addForceField(flag->getSpringNetwork());
 
     //Add it to the system as a force field
     ConstantForceFieldPtr gravityForceField = std::make_shared<ConstantForceField>(system->getParticles(), DynamicSystem::gravity);
@@ -274,8 +274,7 @@ void createFlag(Viewer& viewer, DynamicSystemPtr& system, DynamicSystemRenderabl
 
     for (const ParticlePtr & particle : flag->getParticles())
         system->addParticle(particle);
-    for (const ForceFieldPtr & force_field : flag->getSprings())
-        system->addForceField(force_field);
+    system->addForceField(flag->getSpringNetwork());
 
     //Add it to the system as a force field
     ConstantForceFieldPtr gravityForceField = std::make_shared<ConstantForceField>(system->getParticles(), DynamicSystem::gravity);
@@ -5,6 +5,8 @@
 #include <texturing/TexturedCubeRenderable.hpp>
 #include <texturing/TexturedMeshRenderable.hpp>
 #include <texturing/TexturedLightedMeshRenderable.hpp>
+#include <texturing/InstancedMeshRenderable.hpp>
+#include <texturing/StaticBatchRenderable.hpp>
 #include <texturing/MultiTexturedCubeRenderable.hpp>
 #include <texturing/MipMapCubeRenderable.hpp>
 #include <texturing/BillBoardPlaneRenderable.hpp>
@@ -29,6 +31,7 @@
 #include <dynamics/SpringForceFieldRenderable.hpp>
 #include <dynamics/SpringListRenderable.hpp>
 #include <dynamics/ControlledForceFieldRenderable.hpp>
+#include <dynamics/SnowfallRenderable.hpp>
 #include <texturing/FlagRenderable.hpp>
 
 const std::string MESHES_PATH = "../../sfmlGraphicsPipeline/meshes/";
@@ -84,6 +87,7 @@ int main() {
 	/*SHADERS*/
 	ShaderProgramPtr flatShader = addShader(viewer, "flat");
 	ShaderProgramPtr texShader = addShader(viewer, "texture");
+	ShaderProgramPtr instancedTexShader = addShader(viewer, "instancedTextureVertex", "textureFragment");
 
 	//Add a 3D frame to the viewer
 	//Add a 3D frame to the viewer
@@ -198,24 +202,29 @@ int main() {
 
 	// same usage of vector for tree pos
 	std::vector<glm::vec3> treePos = {glm::vec3(2.6,5,-14), glm::vec3(1.6,5,5.7), glm::vec3(-3.8,6,-3.8), glm::vec3(-2,6,-7.4), glm::vec3(9.4,2,14), glm::vec3(13,4,-14), glm::vec3(-6.7,6.7,-14), glm::vec3(-2,3.4,13), glm::vec3(-15.5,7.6,-3.7), glm::vec3(23.7,5,5), glm::vec3(2,5.5,-4)};
+	auto sapins = std::make_shared<InstancedMeshRenderable>(instancedTexShader, MESHES_PATH + "sapin.obj", simpleMaterial, TEXTURE_PATH + "sapin.png");
 	for (int i = 0; i < treePos.size(); i++) {
-		auto sapins = createTexturedLightedObj(texShader, "sapin.obj", "sapin.png", simpleMaterial);
-		sapins -> setGlobalTransform(getTranslationMatrix(treePos[i]) * getScaleMatrix(1));
-		viewer.addRenderable(sapins);
+		sapins -> addInstance(getTranslationMatrix(treePos[i]) * getScaleMatrix(1));
 	}
+	viewer.addRenderable(sapins);
 
 	HierarchicalRenderable::addChild(penguin, right_arm_penguin);
 	HierarchicalRenderable::addChild(penguin, left_arm_penguin);
 
 	/*ADD RENDERABLES*/
 	viewer.addRenderable(penguin);
-	viewer.addRenderable(snowPlatform);
-	viewer.addRenderable(snow);
-	viewer.addRenderable(snowHills);
 	viewer.addRenderable(mapPlane);
-	viewer.addRenderable(house);
-	viewer.addRenderable(raft);
-	viewer.addRenderable(axe);
+
+	// the scenery never moves: merge it into a few batches (the snow shares one)
+	auto staticBatches = StaticBatchRenderable::freeze({snowPlatform, snow, snowHills, house, raft, axe});
+	for (auto batch : staticBatches)
+		viewer.addRenderable(batch);
+
+	// snowfall simulated on the GPU, around the camera
+	ShaderProgramPtr snowfallShader = addShader(viewer, "snowfall");
+	auto snowfall = std::make_shared<SnowfallRenderable>(snowfallShader, 1000000);
+	snowfall->setVolume(glm::vec3(30, 15, 30));
+	viewer.addRenderable(snowfall);
 
 	createFlag(viewer, system, systemRenderable);
     system->setDt(8e-4);
@@ -263,8 +272,7 @@ void createFlag(Viewer& viewer, DynamicSystemPtr& system, DynamicSystemRenderabl
 
     for (const ParticlePtr & particle : flag->getParticles())
         system->addParticle(particle);
-    for (const ForceFieldPtr & force_field : flag->getSprings())
-        system->addForceField(force_field);
+    system->addForceField(flag->getSpringNetwork());
 
     //Add it to the system as a force field
     ConstantForceFieldPtr gravityForceField = std::make_shared<ConstantForceField>(system->getParticles(), DynamicSystem::gravity);
@@ -5,6 +5,7 @@
 #include <texturing/TexturedCubeRenderable.hpp>
 #include <texturing/TexturedMeshRenderable.hpp>
 #include <texturing/TexturedLightedMeshRenderable.hpp>
+#include <texturing/InstancedMeshRenderable.hpp>
 #include <texturing/MultiTexturedCubeRenderable.hpp>
 #include <texturing/MipMapCubeRenderable.hpp>
 #include <texturing/BillBoardPlaneRenderable.hpp>
@@ -84,6 +85,7 @@ int main() {
 	/*SHADERS*/
 	ShaderProgramPtr flatShader = addShader(viewer, "flat");
 	ShaderProgramPtr texShader = addShader(viewer, "texture");
+	ShaderProgramPtr instancedTexShader = addShader(viewer, "instancedTextureVertex", "textureFragment");
 	ShaderProgramPtr wavesShader = addShader(viewer, "waves");
 	ShaderProgramPtr nonRigidShader = addShader(viewer, "nonRigid");
 
@@ -215,18 +217,18 @@ int main() {
 	waterPlane->setWrapOption(2);
 
 	std::vector<glm::vec3> treePos = {glm::vec3(2.6,5,-14), glm::vec3(1.6,5,5.7), glm::vec3(-3.8,6,-3.8), glm::vec3(-2,6,-7.4), glm::vec3(9.4,2,14), glm::vec3(13,4,-14), glm::vec3(-6.7,6.7,-14), glm::vec3(-2,3.4,13), glm::vec3(-15.5,7.6,-3.7), glm::vec3(23.7,5,5), glm::vec3(2,5.5,-4)};
+	auto sapins = std::make_shared<InstancedMeshRenderable>(instancedTexShader, MESHES_PATH + "sapin.obj", simpleMaterial, TEXTURE_PATH + "sapin.png");
 	for (int i = 0; i < treePos.size(); i++) {
-		auto sapins = createTexturedLightedObj(texShader, "sapin.obj", "sapin.png", simpleMaterial);
-		sapins -> setGlobalTransform(getTranslationMatrix(treePos[i]) * getScaleMatrix(1));
-		viewer.addRenderable(sapins);
+		sapins -> addInstance(getTranslationMatrix(treePos[i]) * getScaleMatrix(1));
 	}
+	viewer.addRenderable(sapins);
 
 	std::vector<glm::vec3> icePos = {glm::vec3(-2.9,2,-45), glm::vec3(5.8,1, -60), glm::vec3(11.2, 4, -69), glm::vec3(22, 2.5, -49)};
+	auto icebergs = std::make_shared<InstancedMeshRenderable>(instancedTexShader, MESHES_PATH + "ice_pic.obj", iceMaterial, TEXTURE_PATH + "iceberg.png");
 	for (int i = 0; i < icePos.size(); i++) {
-		auto iceberg = createTexturedLightedObj(texShader, "ice_pic.obj", "iceberg.png", iceMaterial);
-		iceberg->setGlobalTransform(getTranslationMatrix(icePos[i]) * getScaleMatrix(7) * getRotationMatrix(M_PI, glm::vec3(1,0,0)));
-		viewer.addRenderable(iceberg);
+		icebergs->addInstance(getTranslationMatrix(icePos[i]) * getScaleMatrix(7) * getRotationMatrix(M_PI, glm::vec3(1,0,0)));
 	}
+	viewer.addRenderable(icebergs);
 
 	// the flag is beeing render by the main function. Because of the usage of the hierarchical raft
 	auto flag = createFlag(viewer, system, systemRenderable);
@@ -263,12 +265,17 @@ int main() {
 	viewer.setKeyboardSpeed(8);
 	viewer.setSimulationTime(0);
 
+	// the ocean image only changes 10 times per second: load it then
+	int shownImage = -1;
 	while( viewer.isRunning()) {
 		viewer.handleEvent();
 		viewer.animate();
 
 		int imageNumber = static_cast<int>(viewer.getTime()/2 * 20) % 20;
-		waterPlane->setImage(TEXTURE_PATH + "ocean/"+std::to_string(imageNumber)+".png");
+		if (imageNumber != shownImage) {
+			shownImage = imageNumber;
+			waterPlane->setImage(TEXTURE_PATH + "ocean/"+std::to_string(imageNumber)+".png");
+		}
 
 		viewer.draw();
 		viewer.display();
@@ -296,8 +303,7 @@ std::shared_ptr<FlagRenderable> createFlag(Viewer& viewer, DynamicSystemPtr& sys
 
     for (const ParticlePtr & particle : flag->getParticles())
         system->addParticle(particle);
-    for (const ForceFieldPtr & force_field : flag->getSprings())
-        system->addForceField(force_field);
+    system->addForceField(flag->getSpringNetwork());
 
     //Add it to the system as a force field
     ConstantForceFieldPtr gravityForceField = std::make_shared<ConstantForceField>(system->getParticles(), DynamicSystem::gravity);
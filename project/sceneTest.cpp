@@ -9,6 +9,7 @@
 #include <texturing/MipMapCubeRenderable.hpp>
 #include <texturing/BillBoardPlaneRenderable.hpp>
 #include <texturing/FlagRenderable.hpp>
+#include <texturing/GPUClothRenderable.hpp>
 #include <lighting/DirectionalLightRenderable.hpp>
 #include <lighting/PointLightRenderable.hpp>
 #include <lighting/SpotLightRenderable.hpp>
@@ -22,6 +23,7 @@
 #include <dynamics/ConstantForceField.hpp>
 #include <dynamics/SpringForceField.hpp>
 #include <dynamics/EulerExplicitSolver.hpp>
+#include <dynamics/ImplicitEulerSolver.hpp>
 
 #include <dynamics/ParticleRenderable.hpp>
 #include <dynamics/ParticleListRenderable.hpp>
@@ -95,7 +97,8 @@ int main()
 	viewer.addRenderable(frame);
 
 	DynamicSystemPtr system = std::make_shared<DynamicSystem>();
-    EulerExplicitSolverPtr solver = std::make_shared<EulerExplicitSolver>();
+    //The stiff springs of the flag need an implicit solver to use large time steps
+    ImplicitEulerSolverPtr solver = std::make_shared<ImplicitEulerSolver>();
     system->setSolver(solver);
     system->setDt(0.01);
 
@@ -161,7 +164,7 @@ int main()
 
 	/*CAMERA*/
 	Camera &camera = viewer.getCamera();
-    system->setDt(8e-4);
+    system->setDt(1e-2);
 
 	setCameraPosition(viewer, glm::mat4({0.996051, -0.0265845, 0.0847113, -0, 1.86265e-09, 0.95412, 0.299426, -0, -0.0887847, -0.298244, 0.950352, -0, -0.117174, -0.429864, -1.66233, 1}));
 	viewer.setKeyboardSpeed(6);
@@ -186,8 +189,8 @@ void createFlag(Viewer& viewer, DynamicSystemPtr& system, DynamicSystemRenderabl
                                                                     "../../sfmlGraphicsPipeline/shaders/simpleTextureFragment.glsl");
     ShaderProgramPtr flatShader = std::make_shared<ShaderProgram>(  "../../sfmlGraphicsPipeline/shaders/flatVertex.glsl",
                                                                     "../../sfmlGraphicsPipeline/shaders/flatFragment.glsl");
-    ShaderProgramPtr instancedShader = std::make_shared<ShaderProgram>(  "../../sfmlGraphicsPipeline/shaders/instancedVertex.glsl",
-                                                                    "../../sfmlGraphicsPipeline/shaders/instancedFragment.glsl");
+    ShaderProgramPtr instancedShader = std::make_shared<ShaderProgram>(  "../../sfmlGraphicsPipeline/shaders/sphereImpostorVertex.glsl",
+                                                                    "../../sfmlGraphicsPipeline/shaders/sphereImpostorFragment.glsl");
     viewer.addShaderProgram( flatShader );
     viewer.addShaderProgram( instancedShader );
     viewer.addShaderProgram( textureShader );
@@ -198,8 +201,7 @@ void createFlag(Viewer& viewer, DynamicSystemPtr& system, DynamicSystemRenderabl
 
     for (const ParticlePtr & particle : flag->getParticles())
         system->addParticle(particle);
-    for (const ForceFieldPtr & force_field : flag->getSprings())
-        system->addForceField(force_field);
+    system->addForceField(flag->getSpringNetwork());
 
     //Add it to the system as a force field
     ConstantForceFieldPtr gravityForceField = std::make_shared<ConstantForceField>(system->getParticles(), DynamicSystem::gravity);
@@ -215,13 +217,25 @@ void createFlag(Viewer& viewer, DynamicSystemPtr& system, DynamicSystemRenderabl
 	flag->setGlobalTransform(getRotationMatrix(M_PI/2, glm::vec3(1,0,0)));
 
 	 //Create a springListRenderable to efficiently visualize the springs of the system
-    SpringListRenderablePtr springsRenderable = std::make_shared<SpringListRenderable>(flatShader, flag->getSprings());
+    SpringListRenderablePtr springsRenderable = std::make_shared<SpringListRenderable>(flatShader, flag->getSpringNetwork());
     HierarchicalRenderable::addChild( systemRenderable, springsRenderable );
 
     //Create a particleListRenderable to efficiently visualize the particles of the system
     ParticleListRenderablePtr particleListRenderable = std::make_shared<ParticleListRenderable>( instancedShader, flag->getParticles());
+    particleListRenderable->setImpostorMode(true);
     HierarchicalRenderable::addChild(systemRenderable, particleListRenderable);
 
     viewer.addRenderable(flag);
+
+    //The same flag simulated on the GPU, with a much finer resolution
+    if (GPUClothRenderable::isSupported())
+    {
+        auto gpuFlag = std::make_shared<GPUClothRenderable>(textureShader,
+            1.5f, 1.0, 300, 200, 10e3, 1, texture_path);
+        gpuFlag->setWind(glm::vec3(0.0, 2.0, 10.0));
+        gpuFlag->setAirDamping(dampingCoefficient);
+        gpuFlag->setGlobalTransform(getTranslationMatrix(0, 2, 0) * getRotationMatrix(M_PI/2, glm::vec3(1,0,0)));
+        viewer.addRenderable(gpuFlag);
+    }
     viewer.stopAnimation();
 }
\ No newline at end of file
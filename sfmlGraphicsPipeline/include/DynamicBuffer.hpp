@@ -0,0 +1,97 @@
+#ifndef DYNAMIC_BUFFER_HPP
+#define DYNAMIC_BUFFER_HPP
+
+/**@file
+ * @brief Define a ring buffer for vertex data that changes at each frame.
+ */
+
+#include <vector>
+#include <memory>
+#include <GL/glew.h>
+
+/**@brief Ring buffer for vertex data rewritten at each frame.
+ *
+ * Renderables whose geometry changes at each frame (flags, springs, particles)
+ * should not reallocate their buffers with glBufferData at each draw. Instead,
+ * they sub-allocate memory from this buffer with allocate(), write their data
+ * at the returned address and read it from bufferId() at the returned offset.
+ *
+ * The buffer is divided into frameCount regions, one per frame. A fence is
+ * inserted at the end of each frame: a region is only written again once the
+ * GPU has finished drawing the frame that used it, so writers never wait for
+ * the GPU nor reallocate memory.
+ *
+ * When the context supports GL_ARB_buffer_storage (OpenGL 4.4), the buffer is
+ * persistently and coherently mapped: the returned address is GPU memory.
+ * Otherwise the data is written in a copy on the CPU, and flush() sends it
+ * with glBufferSubData to a region the GPU does not read.
+ *
+ * The Viewer owns one such buffer, see Viewer::getDynamicBuffer(). Allocations
+ * are only valid until the end of the frame.
+ */
+class DynamicBuffer
+{
+public:
+    /**@brief A block of memory in the ring buffer. */
+    struct Allocation
+    {
+        void* data; /*!< Address to write the data to. */
+        size_t offset; /*!< Offset of the block in the buffer, in bytes. */
+        size_t size; /*!< Size of the block, in bytes. */
+    };
+
+    /**@brief Create and map the buffer.
+     *
+     * @param frameSize The number of bytes that can be allocated per frame.
+     * The buffer grows if a frame needs more.
+     * @param frameCount The number of frames the GPU may lag behind the CPU.
+     */
+    DynamicBuffer(size_t frameSize = 4 << 20, unsigned int frameCount = 3);
+    ~DynamicBuffer();
+
+    /**@brief Start to allocate memory in the region of the next frame.
+     *
+     * Wait, if needed, for the GPU to finish the frame that used this region.
+     */
+    void beginFrame();
+
+    /**@brief Insert a fence after the commands of the current frame. */
+    void endFrame();
+
+    /**@brief Allocate a block of memory for the current frame.
+     * @param size The number of bytes to allocate.
+     * @param alignment The alignment of the block offset, in bytes.
+     * @return The allocated block.
+     */
+    Allocation allocate(size_t size, size_t alignment = 16);
+
+    /**@brief Make the data written in a block visible to the GPU.
+     *
+     * Does nothing with a persistently mapped buffer.
+     * @param allocation A block allocated during the current frame.
+     */
+    void flush(const Allocation& allocation);
+
+    unsigned int bufferId() const;
+    bool isPersistent() const;
+
+private:
+    void create(size_t frameSize);
+    void destroy();
+    void wait(GLsync fence);
+
+    unsigned int m_buffer;
+    char* m_mapped; // persistently mapped buffer, or m_staging
+    std::vector< char > m_staging; // copy of the buffer, without buffer storage
+    bool m_persistent;
+
+    size_t m_frameSize;
+    unsigned int m_frameCount;
+    unsigned int m_frame; // region of the current frame
+    size_t m_head; // next free byte in the buffer
+    std::vector< GLsync > m_fences; // one per region
+};
+
+typedef std::shared_ptr<DynamicBuffer> DynamicBufferPtr;
+
+#endif // DYNAMIC_BUFFER_HPP
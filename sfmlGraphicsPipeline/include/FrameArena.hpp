@@ -0,0 +1,185 @@
+#ifndef FRAME_ARENA_HPP
+#define FRAME_ARENA_HPP
+
+/**@file
+ * @brief Define a linear allocator for data that only lives during a frame.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**@brief Linear (bump) allocator for transient data.
+ *
+ * Render and simulation code creates many short lived objects at each frame:
+ * uniform names, collisions, temporary arrays... Allocating them on the heap
+ * costs a malloc and a free each. A frame arena instead hands out consecutive
+ * blocks of a big chunk of memory, and frees everything at once when reset()
+ * is called, at the end of the frame. Memory allocated from an arena must not
+ * be used after the next reset.
+ *
+ * When a frame needs more memory than the arena holds, a new chunk is
+ * allocated. At the next reset, all chunks are merged into one big enough for
+ * the whole frame: after a few frames, the arena does not allocate anymore.
+ *
+ * An arena is not thread safe. Each thread has its own arena, returned by
+ * local(), and resetAll() resets the arenas of all threads. The Viewer calls
+ * resetAll() after each frame is displayed.
+ *
+ * ArenaAllocator allows to store standard containers in an arena.
+ */
+class FrameArena
+{
+public:
+    /**@brief Create an arena.
+     * @param capacity The initial size of the arena, in bytes.
+     */
+    explicit FrameArena(size_t capacity = 1 << 16);
+    ~FrameArena();
+
+    /**@brief Allocate a block of memory, valid until the next reset.
+     * @param size The size of the block, in bytes.
+     * @param alignment The alignment of the block, a power of two.
+     * @return The address of the block.
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /**@brief Free all the blocks allocated since the last reset. */
+    void reset();
+
+    /**@brief Number of bytes allocated since the last reset. */
+    size_t used() const;
+    /**@brief Number of bytes the arena can hold without allocating memory. */
+    size_t capacity() const;
+
+    /**@brief Get the arena of the calling thread. */
+    static FrameArena& local();
+
+    /**@brief Reset the arenas of all threads.
+     *
+     * Must not be called while another thread uses its arena.
+     */
+    static void resetAll();
+
+private:
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    struct Chunk
+    {
+        char* data;
+        size_t size;
+    };
+
+    void add_chunk(size_t size);
+
+    std::vector< Chunk > m_chunks; // the last chunk is the current one
+    size_t m_offset; // first free byte of the current chunk
+    size_t m_used; // bytes allocated in the previous chunks and the current one
+};
+
+/**@brief Standard allocator storing its elements in a frame arena.
+ *
+ * Deallocation does nothing: the memory is freed when the arena is reset.
+ * For instance, a vector whose memory comes from the arena of the thread:
+ * \code
+ * std::vector< int, ArenaAllocator<int> > values( ArenaAllocator<int>( FrameArena::local() ) );
+ * \endcode
+ */
+template< typename T >
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    template< typename U > struct rebind { typedef ArenaAllocator<U> other; };
+
+    ArenaAllocator() : m_arena(&FrameArena::local()) {}
+    explicit ArenaAllocator(FrameArena& arena) : m_arena(&arena) {}
+    template< typename U >
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena()) {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t)
+    {}
+
+    template< typename U, typename... Args >
+    void construct(U* p, Args&&... args)
+    {
+        ::new((void*)p) U(std::forward<Args>(args)...);
+    }
+
+    template< typename U >
+    void destroy(U* p)
+    {
+        p->~U();
+    }
+
+    size_t max_size() const
+    {
+        return size_t(-1) / sizeof(T);
+    }
+
+    FrameArena* arena() const
+    {
+        return m_arena;
+    }
+
+private:
+    FrameArena* m_arena;
+};
+
+template< typename T, typename U >
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena() == b.arena();
+}
+
+template< typename T, typename U >
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena() != b.arena();
+}
+
+/**@brief A string stored in a frame arena. */
+typedef std::basic_string< char, std::char_traits<char>, ArenaAllocator<char> > ArenaString;
+
+/**@brief A vector stored in a frame arena. */
+template< typename T >
+using ArenaVector = std::vector< T, ArenaAllocator<T> >;
+
+/**@brief Create a shared object in the arena of the calling thread.
+ *
+ * The object and its reference count are allocated in the arena: the last
+ * pointer to it must be released before the arena is reset.
+ */
+template< typename T, typename... Args >
+std::shared_ptr<T> make_frame_shared(Args&&... args)
+{
+    return std::allocate_shared<T>(ArenaAllocator<T>(FrameArena::local()), std::forward<Args>(args)...);
+}
+
+#ifdef COUNT_ALLOCATIONS
+/**@brief Number of heap allocations made by the program so far.
+ *
+ * Only available when the library is built with COUNT_ALLOCATIONS: the
+ * global operator new is then replaced to count the allocations, and the
+ * Viewer warns about each frame that still allocates memory on the heap
+ * after the first 120 frames.
+ */
+size_t heapAllocationCount();
+#endif
+
+#endif // FRAME_ARENA_HPP
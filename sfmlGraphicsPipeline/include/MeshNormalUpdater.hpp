@@ -0,0 +1,87 @@
+#ifndef MESH_NORMAL_UPDATER_HPP
+#define MESH_NORMAL_UPDATER_HPP
+/**@file
+ *@brief Recompute the normals of a deforming triangle mesh.*/
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+
+/**@brief Recompute the vertex normals of a triangle mesh whose vertices move.
+ *
+ * The connectivity of the mesh is fixed: the faces adjacent to each vertex are
+ * computed once, at construction, and stored contiguously. The normal of a
+ * vertex is the normalized sum of the normals of its adjacent faces, weighted by
+ * their areas.
+ *
+ * Moved vertices are marked with setDirty(). update() then only recomputes the
+ * normals of the faces adjacent to these vertices, and the normals of the
+ * vertices of these faces. Both passes are parallel: a face normal is written
+ * by a single thread, and each vertex gathers the normals of its faces, so no
+ * synchronization is needed.
+ *
+ * The normals are written in an array provided by the caller, which can be a
+ * mapped buffer: only the normals of the affected vertices are written.
+ */
+class MeshNormalUpdater
+{
+public:
+    /**@brief Build the vertex to face adjacency of a mesh.
+     *
+     * @param indices The vertex indices of the triangles. If empty, the vertices
+     * are taken three by three, as in a non-indexed mesh.
+     * @param vertexCount The number of vertices of the mesh.
+     */
+    MeshNormalUpdater(const std::vector<unsigned int>& indices, size_t vertexCount);
+
+    /**@brief Mark a vertex as moved since the last update. */
+    void setDirty(unsigned int vertex);
+    /**@brief Mark several vertices as moved since the last update. */
+    void setDirty(const std::vector<unsigned int>& vertices);
+    /**@brief Mark all the vertices as moved, for instance when all the normals
+     * must be written in a new buffer. */
+    void setAllDirty();
+    bool isDirty() const;
+
+    /**@brief Recompute the normals affected by the dirty vertices.
+     *
+     * Nothing is marked dirty once this returns.
+     * @param positions The positions of the vertices.
+     * @param normals The array where the normals of the affected vertices are
+     * written, of size vertexCount(). Other normals are not touched.
+     * @return The number of normals written.
+     */
+    size_t update(const glm::vec3* positions, glm::vec3* normals);
+
+    /**@brief Get the range of vertices written by the last update.
+     *
+     * @param first The first vertex written.
+     * @param last One past the last vertex written, equal to first if none was.
+     */
+    void getUpdatedRange(size_t& first, size_t& last) const;
+
+    size_t vertexCount() const;
+    size_t faceCount() const;
+
+private:
+    void collect_affected();
+
+    std::vector<glm::uvec3> m_faces;
+    std::vector<unsigned int> m_firstFace; // faces of vertex v: m_vertexFaces[m_firstFace[v]..m_firstFace[v+1]]
+    std::vector<unsigned int> m_vertexFaces;
+    std::vector<glm::vec3> m_faceNormals; // not normalized, of length twice the area
+
+    bool m_allDirty;
+    std::vector<unsigned int> m_dirtyVertices;
+    std::vector<unsigned int> m_affectedFaces;
+    std::vector<unsigned int> m_affectedVertices;
+    // Stamps of the last update that collected a vertex or a face, to avoid
+    // clearing flags at each update
+    std::vector<unsigned int> m_vertexStamps;
+    std::vector<unsigned int> m_faceStamps;
+    unsigned int m_stamp;
+    size_t m_first, m_last;
+};
+
+typedef std::shared_ptr<MeshNormalUpdater> MeshNormalUpdaterPtr;
+
+#endif //MESH_NORMAL_UPDATER_HPP
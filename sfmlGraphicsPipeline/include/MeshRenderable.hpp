@@ -2,6 +2,7 @@
 #define MESH_RENDERABLE_HPP
 
 #include "KeyframedHierarchicalRenderable.hpp"
+#include "MeshNormalUpdater.hpp"
 
 #include <string>
 #include <vector>
@@ -37,6 +38,56 @@ class MeshRenderable : public KeyframedHierarchicalRenderable
         void update_indices_buffer();
         virtual void update_all_buffers();
 
+        /**@brief Recompute the normals after all the vertices moved.
+         *
+         * Update m_normals from m_positions, with area-weighted face normals,
+         * and write them in the normal buffer. The adjacency of the mesh is
+         * computed on the first call: the indices must not change afterwards.
+         */
+        void recompute_normals();
+        /**@brief Recompute the normals after some vertices moved.
+         *
+         * Only the normals around the moved vertices are recomputed, and only
+         * the range of the normal buffer that holds them is written.
+         * @param moved_vertices The vertices moved since the last recomputation.
+         */
+        void recompute_normals(const std::vector< unsigned int > & moved_vertices);
+
+        const std::vector< glm::vec3 > & positions() const;
+        const std::vector< glm::vec3 > & normals() const;
+        const std::vector< unsigned int > & indices() const;
+        bool isIndexed() const;
+
+        /**@brief Build the levels of detail of the mesh.
+         *
+         * Simplified versions of the mesh are computed with simplify_mesh() (see
+         * MeshSimplifier.hpp). They share the vertex buffers of the mesh and only
+         * have their own indices. At each draw, a level is chosen from the size of
+         * the mesh on the screen. This should be done once, after the mesh is loaded.
+         *
+         * @param levelCount The maximal number of levels, original mesh included.
+         * @param ratio The ratio of triangles between two consecutive levels.
+         */
+        void buildLevelsOfDetail(unsigned int levelCount = 4, float ratio = 0.5f);
+
+        /**@brief Set the screen size below which the first simplified level is used.
+         *
+         * The size is the projected diameter of the bounding sphere of the mesh
+         * divided by the height of the screen. Each next level is used below half
+         * the size of the previous one.
+         * @param threshold The screen size threshold of the first simplified level.
+         */
+        void setLevelOfDetailThreshold(float threshold);
+        size_t levelOfDetailCount() const;
+        unsigned int currentLevelOfDetail() const;
+
+        /**@brief Log the triangles drawn since the last report.
+         *
+         * Compare the triangles drawn by all the meshes with the triangles they
+         * would have drawn without levels of detail, then reset the counters.
+         */
+        static void reportTriangleStatistics();
+
     protected:
         void do_draw();
         MeshRenderable(ShaderProgramPtr program, bool indexed);
@@ -55,10 +106,45 @@ class MeshRenderable : public KeyframedHierarchicalRenderable
         unsigned int m_nBuffer;
         unsigned int m_iBuffer;
 
+        // Number of copies drawn by do_draw(). Values other than 1 switch to
+        // glDraw*Instanced, the per-instance attributes being set by subclasses.
+        GLsizei m_instanceCount;
+
+        // Buffer and offset in bytes of the positions read by do_draw(). A zero
+        // buffer reads m_pBuffer. Subclasses whose positions change at each frame
+        // write them in the viewer's DynamicBuffer instead of m_pBuffer.
+        unsigned int m_positionBuffer;
+        size_t m_positionOffset;
+        // Byte stride of the positions in m_positionBuffer, 0 if they are packed
+        GLsizei m_positionStride;
+        // Buffer, offset in bytes and byte stride of the normals read by do_draw().
+        // A zero buffer reads m_nBuffer. Positions and normals simulated on the
+        // GPU are read directly from their storage buffers, which hold vec4.
+        unsigned int m_normalBuffer;
+        size_t m_normalOffset;
+        GLsizei m_normalStride;
+
+        // Normals of the deforming mesh, created by the first recompute_normals()
+        MeshNormalUpdaterPtr m_normalUpdater;
+
+        // Levels of detail, stored one after the other in m_lodBuffer
+        unsigned int m_lodBuffer;
+        std::vector< size_t > m_lodOffsets;
+        std::vector< size_t > m_lodCounts;
+        unsigned int m_lod;
+        float m_lodThreshold;
+        glm::vec3 m_boundingCenter;
+        float m_boundingRadius;
+
     private:
         void gen_buffers();
         void update_buffers();
         void set_random_colors();
+        void select_level_of_detail();
+        void write_normals();
+
+        static unsigned long long s_fullTriangles;
+        static unsigned long long s_drawnTriangles;
 
 
 };
@@ -0,0 +1,47 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+/**@file
+ *@brief Mesh simplification functions.
+ *
+ * Build levels of detail of an indexed triangle mesh with the quadric error
+ * metric of Garland and Heckbert ("Surface Simplification Using Quadric Error
+ * Metrics", 1997).*/
+#include <vector>
+#include <glm/glm.hpp>
+
+/**@brief Build simplified versions of an indexed triangle mesh.
+ *
+ * The mesh is simplified by successive half-edge collapses: a vertex is merged
+ * into one of its neighbours, chosen to minimize the quadric error. As no vertex
+ * is created nor moved, all levels share the vertex attributes (positions, normals,
+ * texture coordinates) of the original mesh: only the indices differ.
+ *
+ * Seams are preserved. An OBJ file gives several vertices to a position where the
+ * normal or the texture coordinates are discontinuous: such a position only moves
+ * along its seam, all its vertices together, and seams and borders are weighted
+ * so that they keep their shape. Vertices with the same position and texture
+ * coordinates and close normals are not considered as a seam: simplified levels
+ * use one of them.
+ *
+ * @param positions The vertex positions.
+ * @param normals The vertex normals, can be empty.
+ * @param texcoords The vertex texture coordinates, can be empty.
+ * @param indices The vertex indices of the triangles.
+ * @param levels The simplified levels, levels[0] being a copy of indices. Level i
+ * has about ratio^i times the number of triangles of the original mesh, unless
+ * the simplification is stopped by locked vertices or flipping triangles. Levels
+ * that could not be simplified further than the previous one are not added.
+ * @param levelCount The maximal number of levels, original mesh included.
+ * @param ratio The ratio of triangles between two consecutive levels.
+ */
+void simplify_mesh(
+        const std::vector<glm::vec3>& positions,
+        const std::vector<glm::vec3>& normals,
+        const std::vector<glm::vec2>& texcoords,
+        const std::vector<unsigned int>& indices,
+        std::vector< std::vector<unsigned int> >& levels,
+        unsigned int levelCount = 4,
+        float ratio = 0.5f
+        );
+
+#endif //MESH_SIMPLIFIER_HPP
@@ -11,6 +11,7 @@
 # include <string>
 # include <memory>
 # include <unordered_map>
+# include <vector>
 
 /**@brief Assembly of the graphics pipeline programmable steps.
  *
@@ -52,6 +53,35 @@ public:
    */
   ShaderProgram(const std::string& vertex_file_path, const std::string& fragment_file_path );
 
+  /**@brief Construct a transform feedback shader program.
+   *
+   * Shader program made of a vertex shader only. Its outputs are not
+   * rasterized but written to buffers bound to GL_TRANSFORM_FEEDBACK_BUFFER
+   * (see glBeginTransformFeedback()), which allows to update vertex data on
+   * the GPU without reading it back. Draw with GL_RASTERIZER_DISCARD enabled.
+   *
+   * If the shader is invalid or describes an invalid program, this is
+   * initialized to the null shader program.
+   *
+   * @param vertex_file_path Path to the vertex shader file.
+   * @param feedback_varyings Names of the vertex shader outputs to capture, in
+   * the order they are interleaved in the feedback buffer.
+   */
+  ShaderProgram(const std::string& vertex_file_path, const std::vector< std::string >& feedback_varyings );
+
+  /**@brief Construct a compute shader program.
+   *
+   * Shader program made of a compute shader only, run with glDispatchCompute()
+   * outside of the graphics pipeline. Compute shaders need OpenGL 4.3 or the
+   * ARB_compute_shader extension: check it before building such a program.
+   *
+   * If the shader is invalid or describes an invalid program, this is
+   * initialized to the null shader program.
+   *
+   * @param compute_file_path Path to the compute shader file.
+   */
+  explicit ShaderProgram(const std::string& compute_file_path );
+
   /** @brief Destruction
    *
    * Instance destruction.
@@ -65,10 +95,19 @@ public:
    * this shader program would be valid. Otherwise, this remains unchanged.
    *
    * @param vertex_file_path Path to the vertex shader file
-   * @param fragment_file_path Path to the fragment shader file.
+   * @param fragment_file_path Path to the fragment shader file, or an empty
+   * string for a transform feedback program.
    */
   void load(const std::string& vertex_file_path, const std::string& fragment_file_path );
 
+  /**@brief Load a new compute shader from a source file.
+   *
+   * Same as load(), for a compute shader program.
+   *
+   * @param compute_file_path Path to the compute shader file.
+   */
+  void loadCompute(const std::string& compute_file_path );
+
   /** @brief Reload the shader sources
    *
    * Reload existing shader sources into this shader program. This is useful
@@ -106,6 +145,15 @@ public:
    */
   int getUniformLocation( const std::string& name ) const;
 
+  /**@brief Get the location of a uniform thanks to its name.
+   *
+   * Same as above, without building a temporary string for each call: names
+   * longer than the small string buffer would allocate memory at each frame.
+   * @param name The uniform name, as it appear in the shader sources
+   * @return The uniform location, null_location if there is no uniform with such name in this program
+   */
+  int getUniformLocation( const char* name ) const;
+
   /**@brief Get the location of an attribute thanks to its name.
    *
    * Return the location of an attribute (a program input seen in the vertex
@@ -117,6 +165,12 @@ public:
    */
   int getAttributeLocation( const std::string& name ) const;
 
+  /**@brief Get the location of an attribute thanks to its name, without building a temporary string.
+   * @param name The attribute name as it appear in the vertex shader source
+   * @return The attribute location, null_location if there is no attribute with such name in this program
+   */
+  int getAttributeLocation( const char* name ) const;
+
 
   /**@brief Get the identifier of this shader program.
    *
@@ -149,6 +203,8 @@ private:
   std::unordered_map< std::string, int > m_attributes;
   std::string m_vertexFilename;
   std::string m_fragmentFilename;
+  std::string m_computeFilename;
+  std::vector< std::string > m_feedbackVaryings;
 };
 
 typedef std::shared_ptr<ShaderProgram> ShaderProgramPtr; /*!< Typedef for a smart pointer of ShaderProgram */
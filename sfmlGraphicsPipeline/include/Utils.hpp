@@ -22,6 +22,7 @@
 #endif
 #include "dynamics/Particle.hpp"
 #include "dynamics/SpringForceField.hpp"
+#include "dynamics/SpringNetworkForceField.hpp"
 
 // float32 version
 #ifndef M_PIf
@@ -183,6 +184,21 @@ std::vector<T> arange(T start, T stop, T step = 1) {
     return values;
 }
 
+/**@brief Build a fabric of particles connected by springs.
+ *
+ * The particles form a grid of horizontal_resolution x vertical_resolution, each one
+ * being connected to its 8 neighbours by the springs of a single network force field.
+ */
+void getFabric(float width, float height, int horizontal_resolution, int vertical_resolution,
+    std::vector<ParticlePtr> & particles,
+    SpringNetworkForceFieldPtr & springs,
+    std::vector<glm::vec3> & positions,
+    std::vector<glm::uvec3> & indices,
+    std::vector<glm::vec2> & tcoords,
+    float stiffness,
+    float spring_damping);
+
+/**@brief Build a fabric with one spring force field per spring. */
 void getFabric(float width, float height, int horizontal_resolution, int vertical_resolution,
     std::vector<ParticlePtr> & particles,
     std::vector<SpringForceFieldPtr> & springs,
@@ -13,6 +13,7 @@
 #include "lighting/Light.hpp"
 //#include "TextEngine.hpp"
 #include "FPSCounter.hpp"
+#include "DynamicBuffer.hpp"
 
 #include <unordered_set>
 #include <set>
@@ -144,6 +145,13 @@ public:
      * Access to the camera used to render the scene in the viewer.
      * @return A reference to the viewer's camera. */
     Camera& getCamera();
+
+    /**@brief Get the ring buffer for per-frame vertex data.
+     *
+     * Renderables whose geometry changes at each frame allocate their vertex
+     * data from this buffer in their do_draw(), see DynamicBuffer.
+     * @return A reference to the viewer's dynamic buffer. */
+    DynamicBuffer& getDynamicBuffer();
     void setKeyboardSpeed(float speed);
     void setSimulationTime(float time);
 
@@ -206,6 +214,21 @@ public:
      */
     void resetAnimation();
 
+    /** \brief Move the animation to a given time.
+     *
+     * The time is clamped to the start of the animation, and wrapped in the
+     * animation loop if any.
+     * \param time The new animation time.
+     */
+    void seekAnimation(float time);
+
+    /** \brief Check if the animation time was moved.
+     *
+     * \return True if the animation was reset or moved by seekAnimation() since
+     * the renderables were last animated.
+     */
+    bool isSeeking() const;
+
     /** \brief Set an animation loop.
      *
      * Activate or deactivate the loop on the animation. If animationLoop is set
@@ -289,6 +312,7 @@ private:
 
 
     std::unordered_set< ShaderProgramPtr > m_programs;
+    DynamicBufferPtr m_dynamicBuffer; /*!< Ring buffer for vertex data rewritten at each frame. */
 
     //TextEngine m_tengine; /*!< Engine to display textual information. */
     //TimePoint m_modeInformationTextDisappearanceTime; /*!< Duration of appearance for textual information in seconds. */
@@ -297,6 +321,7 @@ private:
     bool m_applicationRunning; /*!< Boolean that runs the main animation loop. Always true except when closing the application. */
     bool m_animationLoop; /*!< True if the animation loops after a given duration, \ref m_loopDuration. */
     bool m_animationIsStarted; /*!< True if the animation is running. False otherwise. */
+    bool m_seeking; /*!< True if the animation time was moved since the last animation update. */
     float m_loopDuration; /*!< Duration of the animation loop in seconds. */
     float m_simulationTime; /*!< Current simulation time in the animation loop. */
     float m_initSimulationTime;
@@ -0,0 +1,74 @@
+#ifndef BLOCK_SPARSE_MATRIX_HPP
+#define BLOCK_SPARSE_MATRIX_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/**@brief Sparse square matrix made of 3x3 blocks.
+ *
+ * The block (i,j) couples the particles of slots i and j of a ParticleStore,
+ * so that this matrix can store the Jacobian of the forces of a dynamic
+ * system. The matrix is assembled block by block with addBlock(), possibly
+ * several times at the same position: the blocks are summed. compress() then
+ * sorts the off-diagonal blocks by row (compressed sparse row storage), and
+ * the matrix can be multiplied by vectors, in parallel over the rows.
+ *
+ * The arrays are reused from one assembly to the next: once they are large
+ * enough, assembling a matrix of the same structure does not allocate.
+ */
+class BlockSparseMatrix
+{
+public:
+    BlockSparseMatrix();
+    ~BlockSparseMatrix();
+
+    /**@brief Empty the matrix and set its size.
+     * @param size Number of block rows and block columns.
+     */
+    void reset(size_t size);
+
+    /**@brief Add a block to the matrix.
+     *
+     * Must not be called by several threads at the same time, nor after compress().
+     * @param row Block row.
+     * @param column Block column.
+     * @param block The block added to the block (row,column).
+     */
+    void addBlock(unsigned int row, unsigned int column, const glm::mat3& block);
+
+    /**@brief Sort the blocks by row, before multiplications. */
+    void compress();
+
+    /**@brief Number of block rows and block columns. */
+    size_t size() const;
+
+    /**@brief Access to a diagonal block. */
+    const glm::mat3& diagonal(size_t row) const;
+
+    /**@brief Add the product of this matrix by a vector to another one.
+     *
+     * Compute y += scale * A * x.
+     * @param scale Scale of the product.
+     * @param x A vector of size() entries.
+     * @param y A vector of size() entries, different from x.
+     */
+    void multiplyAdd(float scale, const glm::vec3* x, glm::vec3* y) const;
+
+private:
+    struct Entry
+    {
+        unsigned int row;
+        unsigned int column;
+        glm::mat3 block;
+    };
+
+    std::vector<glm::mat3> m_diagonal;
+    std::vector<Entry> m_entries;
+
+    // Off-diagonal blocks of row i: m_blocks[m_rowStart[i]] to m_blocks[m_rowStart[i+1]-1]
+    std::vector<unsigned int> m_rowStart;
+    std::vector<unsigned int> m_columns;
+    std::vector<glm::mat3> m_blocks;
+};
+
+#endif //BLOCK_SPARSE_MATRIX_HPP
@@ -0,0 +1,96 @@
+#ifndef CLOTH_SELF_COLLISION_HPP
+#define CLOTH_SELF_COLLISION_HPP
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.hpp"
+#include "SpringNetworkForceField.hpp"
+
+/**@brief Keep the particles of a cloth apart from each other.
+ *
+ * The springs of a cloth do not prevent it from going through itself when it
+ * folds. This stage keeps the particles of a cloth at least at a thickness
+ * from each other, except for topological neighbors: the particles connected
+ * by a spring, and the particles closer than the thickness in the rest shape,
+ * taken when the stage is created.
+ *
+ * The particles are sorted into a spatial hash whose cells are twice as large
+ * as the thickness, by default the smallest rest length of the springs: the
+ * close particles of a particle are in the 8 cells around the corner of its
+ * cell closest to it. Each particle then computes its own correction from all
+ * its close particles, in parallel: it moves by its share of each overlap,
+ * weighted by the inverse masses, and the average of these moves is applied
+ * (Jacobi iteration). The relative velocities toward each other are removed as
+ * well. The cost is O(n) per step.
+ */
+class ClothSelfCollision
+{
+public:
+    /**@brief Build the self-collision of a cloth.
+     *
+     * @param cloth The springs of the cloth, at rest.
+     */
+    ClothSelfCollision(SpringNetworkForceFieldPtr cloth);
+    ~ClothSelfCollision();
+
+    /**@brief Set the smallest distance between two particles of the cloth.
+     *
+     * @param thickness The thickness, 0 (the default) to use the smallest rest
+     * length of the springs.
+     */
+    void setThickness(float thickness);
+    float getThickness() const;
+
+    /**@brief Set the number of Jacobi iterations per step, 1 by default. */
+    void setIterations(unsigned int iterations);
+    unsigned int getIterations() const;
+
+    /**@brief Separate the particles of the cloth closer than the thickness.
+     *
+     * Fixed and sleeping particles are not moved, detached ones are ignored.
+     * @param store The store of the particles.
+     * @return False if the particles of the cloth are not in this store.
+     */
+    bool solve(ParticleStore& store);
+
+    /**@brief The number of particles moved apart during the last iteration. */
+    size_t contactCount() const;
+
+private:
+    void build_neighbors();
+    void sort_particles(const ParticleStore& store, float cellSize);
+
+    SpringNetworkForceFieldPtr m_cloth;
+    float m_thickness;
+    unsigned int m_iterations;
+    size_t m_contactCount;
+
+    // Shape of the cloth when the stage was created
+    std::vector<glm::vec3> m_restPositions;
+
+    // Particles connected by a spring (CSR), rebuilt when springs are added
+    size_t m_builtSprings;
+    std::vector<unsigned int> m_firstNeighbor;
+    std::vector<unsigned int> m_neighbors;
+
+    // Spatial hash, see SpatialHashBroadphase
+    std::vector<unsigned int> m_slots; // slot of each particle
+    std::vector<glm::ivec3> m_cells;
+    std::vector<unsigned int> m_keys;
+    std::vector<unsigned int> m_bucketStart;
+    std::vector<unsigned int> m_next;
+    std::vector<unsigned int> m_sorted; // particles sorted by bucket
+    std::vector<glm::ivec3> m_sortedCells;
+    std::vector<glm::vec4> m_sortedPositions; // positions and inverse masses, 0 for particles that do not move
+    std::vector<glm::vec3> m_sortedVelocities;
+
+    // Corrections of the positions and velocities of each particle
+    std::vector<glm::vec3> m_positionCorrections;
+    std::vector<glm::vec3> m_velocityCorrections;
+};
+
+typedef std::shared_ptr<ClothSelfCollision> ClothSelfCollisionPtr;
+
+#endif //CLOTH_SELF_COLLISION_HPP
@@ -45,12 +45,16 @@ class ConstantForceField : public ForceField
         /**@brief Set the force applied to all influenced particles.
          *
          * Set the force applied to all particles influenced by this force field.
+         * The sleeping particles are not woken up: call DynamicSystem::wakeUp()
+         * after changing the force of a field of a running system.
          * @param force The new force.
          */
         void setForce(const glm::vec3& force);
 
     private:
         void do_addForce();
+        bool do_addForce(const ParticleStore& store, glm::vec3* forces) const;
+        bool do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const;
         std::vector<ParticlePtr> m_particles;
         glm::vec3 m_force;
 };
@@ -0,0 +1,105 @@
+#ifndef CONTACT_LIST_HPP
+#define CONTACT_LIST_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.hpp"
+#include "SpatialHashBroadphase.hpp"
+#include "MeshCollider.hpp"
+#include "../Plane.hpp"
+
+/**@brief Contact between a particle and a plane obstacle. */
+struct ParticlePlaneContact
+{
+    unsigned int particle; /*!< Slot of the particle in the store. */
+    unsigned int plane; /*!< Index of the plane obstacle. */
+    glm::vec3 normal; /*!< Normal of the plane, pointing to the side of the particle. */
+    float depth; /*!< Interpenetration distance. */
+};
+
+/**@brief Contact between a particle and a mesh obstacle. */
+struct ParticleMeshContact
+{
+    unsigned int particle; /*!< Slot of the particle in the store. */
+    unsigned int mesh; /*!< Index of the mesh obstacle. */
+    glm::vec3 normal; /*!< Direction to push the particle out of the mesh. */
+    float depth; /*!< Interpenetration distance. */
+};
+
+/**@brief Contact between two particles. */
+struct ParticleParticleContact
+{
+    unsigned int particle1; /*!< Slot of the first particle in the store. */
+    unsigned int particle2; /*!< Slot of the second particle in the store. */
+    glm::vec3 normal; /*!< Unit vector from the second particle to the first one. */
+    float depth; /*!< Interpenetration distance. */
+};
+
+/**@brief Contacts detected during a simulation step.
+ *
+ * Unlike Collision objects, contacts are plain structures stored by type in
+ * arrays. The arrays are reused from one step to the next, so that detecting
+ * and solving collisions does not allocate memory once they are large enough.
+ * Each type of contact is solved by its own loop over the ParticleStore,
+ * without virtual calls.
+ */
+class ContactList
+{
+public:
+    ContactList();
+    ~ContactList();
+
+    /**@brief Remove all the contacts, keeping the memory of the arrays. */
+    void clear();
+
+    /**@brief Reserve memory for a number of contacts of each type. */
+    void reserve(size_t planeContacts, size_t particleContacts);
+
+    /**@brief Detect the contacts between the particles and plane obstacles.
+     *
+     * Fixed and detached particles are ignored.
+     * @param store The particles.
+     * @param planes The plane obstacles.
+     */
+    void detectPlaneContacts(const ParticleStore& store, const std::vector< PlanePtr >& planes);
+
+    /**@brief Detect the contacts between the particles and mesh obstacles.
+     *
+     * The particles are queried in parallel against the hierarchy of each
+     * mesh. Fixed, detached and sleeping particles are ignored.
+     * @param store The particles.
+     * @param meshes The mesh obstacles.
+     */
+    void detectMeshContacts(const ParticleStore& store, const std::vector< MeshColliderPtr >& meshes);
+
+    /**@brief Add the contacts of overlapping pairs of particles.
+     * @param store The particles.
+     * @param pairs Overlapping pairs, see SpatialHashBroadphase::findPairs().
+     */
+    void addParticleContacts(const ParticleStore& store, const std::vector< SpatialHashBroadphase::Pair >& pairs);
+
+    /**@brief Solve the contacts.
+     *
+     * Separate the particles and reflect their velocities. The contacts between
+     * particles are solved first, then the contacts with the planes and the meshes.
+     * The normal and depth of a contact between particles are computed again
+     * from the current positions, and the pairs already separated are skipped.
+     * @param store The particles.
+     * @param restitution The restitution coefficient of the collisions.
+     */
+    void solve(ParticleStore& store, float restitution) const;
+
+    const std::vector< ParticlePlaneContact > & planeContacts() const;
+    const std::vector< ParticleParticleContact > & particleContacts() const;
+    const std::vector< ParticleMeshContact > & meshContacts() const;
+
+private:
+    std::vector< ParticlePlaneContact > m_planeContacts;
+    std::vector< ParticleMeshContact > m_meshContacts;
+    // Mesh contacts found by each thread
+    std::vector< std::vector< ParticleMeshContact > > m_threadMeshContacts;
+    std::vector< ParticleParticleContact > m_particleContacts;
+};
+
+#endif //CONTACT_LIST_HPP
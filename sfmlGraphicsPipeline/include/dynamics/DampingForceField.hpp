@@ -51,6 +51,10 @@ class DampingForceField : public ForceField
 
     private:
         void do_addForce();
+        bool do_addForce(const ParticleStore& store, glm::vec3* forces) const;
+        bool do_addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const;
+        float do_addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const;
+        bool do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const;
         std::vector<ParticlePtr> m_particles;
         float m_damping;
 };
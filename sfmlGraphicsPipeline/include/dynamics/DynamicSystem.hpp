@@ -3,19 +3,23 @@
 
 #include <vector>
 
-#include "Collision.hpp"
+#include "ClothSelfCollision.hpp"
+#include "ContactList.hpp"
 #include "ForceField.hpp"
+#include "MortonOrder.hpp"
 #include "Particle.hpp"
+#include "ParticleStore.hpp"
+#include "SpatialHashBroadphase.hpp"
+#include "SimulationIslands.hpp"
 #include "Solver.hpp"
 #include "../Plane.hpp"
 
 /**@brief A dynamic system.
  *
  * This class represents a dynamic system made of particles, force fields and
- * fixed planes obstacles and that handle collisions. If you want to, you can
- * replace fixed planes obstacles by triangle obstacles: you will be able to
- * model more kind of obstacles. However, this would require a spatial optimization
- * that is out of the scope of these practical lessons.
+ * obstacles and that handle collisions. The obstacles are either infinite
+ * planes, or triangle meshes sorted into a bounding volume hierarchy (see
+ * MeshCollider).
  */
 class DynamicSystem
 {
@@ -28,6 +32,36 @@ private:
    */
     std::vector<ParticlePtr> m_particles;
 
+  /**@brief The state of the particles of this system.
+   *
+   * The particles added to this system are attached to this store: their
+   * state is kept in contiguous arrays, that the solver integrates at once.
+   */
+    ParticleStore m_store;
+
+  /**@brief The broadphase finding the colliding pairs of particles.
+   *
+   * It works on the slots of m_store: the slot i of the store holds the
+   * particle m_particles[i], unless this particle was moved to another system.
+   */
+    SpatialHashBroadphase m_broadphase;
+    std::vector<SpatialHashBroadphase::Pair> m_pairs;
+
+    /**@brief The islands of independent particles of this system.
+     *
+     * The force fields local to an island are evaluated as a task of their
+     * own, and the islands at rest are put to sleep.
+     */
+    SimulationIslands m_islands;
+
+    /**@brief The spatial reordering of the slots, see setReorderInterval(). */
+    MortonOrder m_mortonOrder;
+    unsigned int m_reorderInterval;
+    unsigned int m_stepsSinceReorder;
+    std::vector<unsigned int> m_order;
+    /**@brief The previous slot of each slot since the last takeReordering(), empty if none. */
+    std::vector<unsigned int> m_reordering;
+
     /**@brief The set of force fields influencing particles of this system.
      *
      * The force fields that influence the particles of this system.
@@ -40,6 +74,18 @@ private:
      */
     std::vector<PlanePtr> m_planeObstacles;
 
+    /**@brief The set of triangle mesh obstacles.
+     *
+     * Moving meshes are updated with MeshCollider::setTransform().
+     */
+    std::vector<MeshColliderPtr> m_meshObstacles;
+
+    /**@brief The self-collisions of the cloths of this system.
+     *
+     * They are solved at each step, even if the collision detection is off.
+     */
+    std::vector<ClothSelfCollisionPtr> m_selfCollisions;
+
     /**@brief The solver of the dynamic system.
      *
      * Solver of the dynamic system: update the particles positions and
@@ -56,13 +102,38 @@ private:
      */
     float m_dt;
 
-    /**@brief The set of collision events detected during a simulation step.
+    /**@brief Adaptive time step settings, see setAdaptiveTimeStep(). */
+    bool m_adaptiveTimeStep;
+    float m_minDt;
+    float m_maxDt;
+    float m_courantNumber;
+    float m_maxStrain;
+    /**@brief True if m_dt was chosen for the current state. */
+    bool m_timeStepChosen;
+    /**@brief Bounds of the stiffness and damping of the slots, see ForceField::addStabilityBounds(). */
+    ParticleStore::Array<float> m_stiffnessBounds;
+    ParticleStore::Array<float> m_dampingBounds;
+    /**@brief Steps taken since the time steps were last logged. */
+    unsigned int m_logSteps;
+    float m_logTime;
+    float m_logMinDt;
+    float m_logMaxDt;
+
+    /**@brief The set of contacts detected during a simulation step.
      *
-     * Set of collision events between dynamic components during a simulation
-     * step. Those events would be resolved by updating velocities and positions
+     * Set of contacts between dynamic components during a simulation
+     * step. Those contacts would be resolved by updating velocities and positions
      * of dynamic objects to avoid inter-penetration.
      */
-    std::vector<CollisionPtr> m_collisions;
+    ContactList m_contacts;
+
+    /**@brief Force buffers of the threads evaluating the force fields.
+     *
+     * See accumulateForces(). The first thread uses the forces of m_store.
+     */
+    std::vector< ParticleStore::Array<glm::vec3> > m_threadForces;
+    /**@brief Force fields that each thread could not evaluate in its buffer. */
+    std::vector< std::vector<int> > m_threadFallbacks;
 
     /**@brief A flag to activate/desactivate collision detection.
      *
@@ -85,7 +156,9 @@ public:
 
     /**@brief Add a particle to the system.
      *
-     * Add a particle to this dynamic system.
+     * Add a particle to this dynamic system. A particle is added once: it is
+     * rejected if it was added before, even if it was attached to another
+     * system since then.
      * @param p The particle to add to this system.
      */
     void addParticle(ParticlePtr p);
@@ -102,6 +175,18 @@ public:
      * @param planeObstacle The plane to add to this system.
      */
     void addPlaneObstacle(PlanePtr planeObstacle);
+    /**@brief Add a triangle mesh obstacle to the system.
+     *
+     * If collisions are activated, the mesh will repel particles.
+     * @param meshObstacle The mesh to add to this system.
+     */
+    void addMeshObstacle(MeshColliderPtr meshObstacle);
+    /**@brief Prevent a cloth of the system from going through itself.
+     *
+     * The self-collision is optional: a cloth without one folds through itself.
+     * @param selfCollision The self-collision of a cloth whose particles are in this system.
+     */
+    void addSelfCollision(ClothSelfCollisionPtr selfCollision);
 
     /**@brief Access to the solver used to resolve the dynamic system.
      *
@@ -135,6 +220,47 @@ public:
      * @return The set of particles of this system.
      */
     const std::vector<ParticlePtr>& getParticles() const;
+
+    /**@brief Access to the store holding the state of the particles.
+     *
+     * @return The store of this system.
+     */
+    ParticleStore& getParticleStore();
+    /**@brief Access to the islands of independent particles of this system.
+     *
+     * Use it to deactivate the islands or to tune when they fall asleep.
+     * @return The islands of this system.
+     */
+    SimulationIslands& getIslands();
+    /**@brief Wake all the particles up.
+     *
+     * Sleeping particles do not react to changes made outside of the
+     * simulation: call it after moving particles, or changing a force field
+     * or the springs of a network.
+     */
+    void wakeUp();
+
+    /**@brief Reorder the slots of the store periodically.
+     *
+     * After a while, particles close in space sit far apart in the store and
+     * the loops over neighbors read memory at random. Every given number of
+     * steps, the particles are sorted along a Z-order curve (see MortonOrder)
+     * before the step. The particles, the solver and the islands follow their
+     * slots; the other holders of slots must call takeReordering().
+     * @param steps The number of steps between two reorderings, 0 (the default) to never reorder.
+     */
+    void setReorderInterval(unsigned int steps);
+    unsigned int getReorderInterval() const;
+    /**@brief Sort the slots of the store along a Z-order curve now. */
+    void reorderParticles();
+    /**@brief Get how the slots were reordered since the last call.
+     *
+     * @param order The previous slot of each slot, see ParticleStore::permute().
+     * The slots added since the last call keep their index.
+     * @return False if the slots were not reordered.
+     */
+    bool takeReordering(std::vector<unsigned int>& order);
+
     /**@brief Set the particles of this system.
      *
      * Define a new set of particles for this dynamic system.
@@ -190,6 +316,50 @@ public:
      */
     void setDt(float dt);
 
+    /**@brief Activate/deactivate the adaptive time step.
+     *
+     * In adaptive mode, the time step is chosen before each simulation step,
+     * from the current state, as the largest one in the bounds (see
+     * setTimeStepBounds()) that satisfies two limits:
+     * \li a stability limit: an explicit solver must follow the fastest
+     * oscillation of the stiff force fields (see ForceField::addStabilityBounds()
+     * and Solver::isUnconditionallyStable()), scaled by the Courant number;
+     * \li a deformation limit: no spring may change its length by more than a
+     * fraction of its rest length during a step (see setMaxStrainPerStep()),
+     * so that fast motions, like a flag snapping in a gust, get small steps
+     * while calm moments get large ones.
+     * The time step grows by at most 50% from one step to the next. The chosen
+     * time steps are logged every simulated second. getDt() returns the time
+     * step of the next simulation step.
+     * @param onOff True to activate the adaptive time step.
+     */
+    void setAdaptiveTimeStep(bool onOff);
+    bool getAdaptiveTimeStep() const;
+
+    /**@brief Set the bounds of the adaptive time step.
+     * @param minDt The smallest time step, even if the limits ask for less.
+     * @param maxDt The largest time step.
+     */
+    void setTimeStepBounds(float minDt, float maxDt);
+
+    /**@brief Set the fraction of the stability limit used by the adaptive time step.
+     * @param courantNumber The safety factor, in ]0,1].
+     */
+    void setCourantNumber(float courantNumber);
+
+    /**@brief Set the largest relative change of length of a spring during a step.
+     * @param maxStrain The largest strain per step of the adaptive time step.
+     */
+    void setMaxStrainPerStep(float maxStrain);
+
+    /**@brief Choose the time step of the next simulation step.
+     *
+     * In adaptive mode, compute the time step from the current state, once
+     * per simulation step. Otherwise, do nothing.
+     * @return The time step of the next simulation step.
+     */
+    float updateTimeStep();
+
     /**@brief Clear the dynamic system.
      *
      * Clear the system, i.e. empty the particles, force fields and plane obstacles.
@@ -197,6 +367,16 @@ public:
     void clear();
 
 private:
+    /**@brief Compute the forces of all the force fields.
+     *
+     * The force fields local to an awake island are evaluated first, with an
+     * OpenMP task per island: the islands write the forces of different slots.
+     * The shared force fields are then evaluated in parallel. Each thread adds
+     * the forces to its own buffer, and the buffers are summed in parallel.
+     */
+    void accumulateForces();
+    /**@brief Log the time steps chosen during the last simulated second. */
+    void logTimeStep();
     void detectCollisions();
     void solveCollisions();
 };
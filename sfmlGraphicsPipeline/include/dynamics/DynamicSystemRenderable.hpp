@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "DynamicSystem.hpp"
+#include "SimulationCheckpoints.hpp"
 //#include "../HierarchicalCylinderRenderable.hpp"
 #include "../HierarchicalRenderable.hpp"
 
@@ -36,20 +37,63 @@ public:
      */
     void setDynamicSystem(const DynamicSystemPtr &system);
 
+    /**@brief Set the maximal number of simulation steps per frame.
+     *
+     * When a frame takes longer than this number of steps of the system, the
+     * remaining time is dropped: the simulation slows down instead of taking
+     * always more steps to catch up, which would make the next frames even
+     * longer.
+     * @param steps The maximal number of steps per frame, at least 1.
+     */
+    void setMaxStepsPerFrame(unsigned int steps);
+    unsigned int getMaxStepsPerFrame() const;
+
+    /**@brief Enable or disable the interpolation of the rendered positions.
+     *
+     * When enabled, the particles are drawn between the last two states of the
+     * system, see ParticleStore::interpolatePositions(). The drawing lags one
+     * step behind the simulation, but stays smooth when steps are less
+     * frequent than frames.
+     * @param onOff True to interpolate the rendered positions.
+     */
+    void setInterpolation(bool onOff);
+    bool getInterpolation() const;
+
+    /**@brief Set the simulated time between two checkpoints.
+     *
+     * The state of the system is captured at this interval. When the time of
+     * the animation jumps (the animation is reset, loops, or is moved by
+     * Viewer::seekAnimation()), the latest checkpoint before the new time is restored
+     * and only the remaining time is simulated, instead of the whole animation.
+     * @param interval The time between two checkpoints, 0 to disable them.
+     */
+    void setCheckpointInterval(float interval);
+    float getCheckpointInterval() const;
+    /**@brief Access to the checkpoints, for instance to save them to a file. */
+    SimulationCheckpoints& getCheckpoints();
+
 protected:
     void do_draw();
     /**@brief Update the dynamic system.
      *
      * This function will update the managed dynamic system, i.e. compute the
-     * new positions and velocities of the particles. This update will be
-     * actually done only if the last time the system was updated was more
-     * than m_sytem->m_dt ago. This allows us to update the dynamic system
-     * at the specified time interval.
+     * new positions and velocities of the particles. The time elapsed since
+     * the last frame is accumulated, and consumed by as many steps of
+     * m_system->updateTimeStep() as it contains (up to the maximal number of
+     * steps per frame). The remainder is kept for the next frame, so the
+     * simulation runs at the same speed whatever the frame rate.
      */
     void do_animate( float time );
 
 private:
 
+    /**@brief Compute a simulation step, and capture a checkpoint when it is time to. */
+    void step();
+    /**@brief Move the simulation to a time, from the best checkpoint.
+     * @param time The animation time to reach.
+     */
+    void seek(float time);
+
     /**@brief Handle key pressed.
      *
      * If the key A is pressed, the collision detected is toggled.
@@ -77,6 +121,23 @@ private:
      * keep updating the dynamic system at the specified time interval.
      */
     float m_lastUpdateTime;
+    /**@brief Simulated time not consumed yet by a step.
+     *
+     * Always less than m_system->getDt() after an update.
+     */
+    float m_accumulator;
+    unsigned int m_maxStepsPerFrame;
+    bool m_interpolation;
+    /**@brief Animation time of the current state of the dynamic system.
+     *
+     * It lags behind m_lastUpdateTime by m_accumulator, plus the time dropped
+     * when frames took too long.
+     */
+    float m_stateTime;
+    bool m_started;
+    SimulationCheckpoints m_checkpoints;
+    float m_checkpointInterval;
+    std::vector<unsigned int> m_reordering;
 };
 
 typedef std::shared_ptr<DynamicSystemRenderable> DynamicSystemRenderablePtr;
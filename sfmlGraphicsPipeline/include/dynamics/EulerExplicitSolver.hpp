@@ -14,6 +14,7 @@ public:
     ~EulerExplicitSolver();
 private:
     void do_solve(const float& dt, std::vector<ParticlePtr>& particles);
+    void do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles);
 };
 
 typedef std::shared_ptr<EulerExplicitSolver> EulerExplicitSolverPtr;
@@ -2,6 +2,12 @@
 #define FORCE_FIELD_HPP
 
 #include <memory>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+class ParticleStore;
+class BlockSparseMatrix;
 
 /**@brief Force field interface.
  *
@@ -19,6 +25,59 @@ public:
    * Add a force to the particles influenced by this force field.
    */
   void addForce();
+
+  /**@brief Add a force to particles, in a force buffer.
+   *
+   * Add the forces of this field to a buffer indexed by the slots of a store,
+   * instead of the forces of the particles. Several fields can then be
+   * evaluated at the same time by different threads, each one with its own
+   * buffer. This method must only read the store.
+   * @param store The store holding the state of the particles.
+   * @param forces The force buffer, one force per slot of the store.
+   * @return False if the field cannot use a force buffer: addForce() must
+   * be called instead.
+   */
+  bool addForce(const ParticleStore& store, glm::vec3* forces) const;
+
+  /**@brief Add the Jacobians of the forces of this field.
+   *
+   * Add the derivatives of the forces with respect to the positions and to
+   * the velocities of the particles, for implicit solvers. The blocks are
+   * indexed by the slots of the store.
+   * @param store The store holding the state of the particles.
+   * @param dfdx The Jacobian of the forces with respect to the positions.
+   * @param dfdv The Jacobian of the forces with respect to the velocities.
+   * @return False if the field has no Jacobians: its forces are then
+   * integrated explicitly.
+   */
+  bool addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const;
+
+  /**@brief Add the bounds used to choose an adaptive time step.
+   *
+   * Add to stiffness[i] (resp. damping[i]) a bound of the sum of the absolute
+   * stiffnesses (resp. dampings) of the row of the slot i in the Jacobian of
+   * the forces. By Gershgorin's theorem, they bound the fastest oscillation an
+   * explicit solver has to follow. Also return how fast the field deforms.
+   * @param store The store holding the state of the particles.
+   * @param stiffness The stiffness bounds, one per slot of the store.
+   * @param damping The damping bounds, one per slot of the store.
+   * @return The largest strain rate of the field (the relative change of
+   * length of its springs per second), or 0 if it has no rest shape.
+   */
+  float addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const;
+
+  /**@brief Add the pairs of slots coupled by this field.
+   *
+   * Two slots are coupled when the force of this field on one of them depends
+   * on the state of the other. A field acting on each particle independently
+   * adds the pair (i,i) for each slot i it acts on. The dynamic system groups
+   * the coupled particles into islands, see SimulationIslands.
+   * @param store The store holding the state of the particles.
+   * @param couplings The pairs of slots, to which the ones of this field are appended.
+   * @return False if the couplings of the field are not known: it is then
+   * assumed to couple all the particles of the store.
+   */
+  bool addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const;
 private:
   /**@brief Add force implementation.
    *
@@ -26,6 +85,26 @@ private:
    * This should be implemented in derived classes.
    */
   virtual void do_addForce() = 0;
+  /**@brief Add force implementation, in a force buffer.
+   *
+   * By default, force buffers are not supported and false is returned.
+   */
+  virtual bool do_addForce(const ParticleStore& store, glm::vec3* forces) const;
+  /**@brief Add Jacobians implementation.
+   *
+   * By default, the field has no Jacobians and false is returned.
+   */
+  virtual bool do_addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const;
+  /**@brief Add stability bounds implementation.
+   *
+   * By default, the field does not limit the time step and 0 is returned.
+   */
+  virtual float do_addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const;
+  /**@brief Add couplings implementation.
+   *
+   * By default, the couplings are not known and false is returned.
+   */
+  virtual bool do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const;
 };
 
 typedef std::shared_ptr<ForceField> ForceFieldPtr;
@@ -0,0 +1,70 @@
+#ifndef IMPLICIT_EULER_SOLVER_HPP
+#define IMPLICIT_EULER_SOLVER_HPP
+
+#include "Solver.hpp"
+#include "BlockSparseMatrix.hpp"
+
+/**@brief Implicit (backward) Euler solver.
+ *
+ * Implicit Euler dynamic system solver, in the style of Baraff and Witkin
+ * (Large steps in cloth simulation, 1998). The forces are linearized around
+ * the current state, and the velocity change dv of a step solves:
+ * (M - dt * df/dv - dt^2 * df/dx) dv = dt * (f + dt * df/dx * v).
+ *
+ * The Jacobians are assembled from the force fields into block sparse
+ * matrices (see ForceField::addJacobians()), and the system is solved by a
+ * conjugate gradient preconditioned by the inverse of the diagonal blocks.
+ * Fixed particles are removed from the system by filtering the conjugate
+ * gradient vectors. Force fields without Jacobians are integrated explicitly.
+ *
+ * Stiff springs remain stable with time steps much larger than those of the
+ * EulerExplicitSolver, at the cost of some numerical damping.
+ */
+class ImplicitEulerSolver : public Solver
+{
+public:
+    /**@brief Build an implicit Euler solver.
+     *
+     * @param maxIterations Maximum number of conjugate gradient iterations per step.
+     * @param tolerance Relative residual at which the conjugate gradient stops.
+     */
+    ImplicitEulerSolver(int maxIterations = 100, float tolerance = 1e-4);
+    ~ImplicitEulerSolver();
+
+    int getMaxIterations() const;
+    void setMaxIterations(int maxIterations);
+    float getTolerance() const;
+    void setTolerance(float tolerance);
+
+    /**@brief Number of conjugate gradient iterations of the last step. */
+    int getLastIterationCount() const;
+
+private:
+    void do_solve(const float& dt, std::vector<ParticlePtr>& particles);
+    void do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles);
+    void do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles,
+                  const std::vector<ForceFieldPtr>& forceFields);
+    bool do_isUnconditionallyStable(const ForceField& forceField) const;
+
+    /**@brief Compute y = (M - dt * df/dv - dt^2 * df/dx) x, filtered. */
+    void multiply(float dt, const glm::vec3* x, glm::vec3* y) const;
+    /**@brief Set to zero the entries of the particles that do not move. */
+    void filter(glm::vec3* x) const;
+
+    int m_maxIterations;
+    float m_tolerance;
+    int m_lastIterationCount;
+
+    BlockSparseMatrix m_dfdx;
+    BlockSparseMatrix m_dfdv;
+
+    // Work vectors, reused from one step to the next
+    std::vector<float> m_masses;
+    std::vector<unsigned char> m_moving;
+    std::vector<glm::mat3> m_preconditioner;
+    std::vector<glm::vec3> m_dv, m_r, m_z, m_p, m_q;
+};
+
+typedef std::shared_ptr<ImplicitEulerSolver> ImplicitEulerSolverPtr;
+
+#endif //IMPLICIT_EULER_SOLVER_HPP
@@ -0,0 +1,113 @@
+#ifndef MESH_COLLIDER_HPP
+#define MESH_COLLIDER_HPP
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+class MeshRenderable;
+
+/**@brief A triangle mesh obstacle for the particles of a dynamic system.
+ *
+ * Testing each particle against each triangle is out of question for large
+ * meshes. The triangles are sorted once into a bounding volume hierarchy
+ * (BVH), built top-down with the surface area heuristic (SAH): each node is
+ * split where the expected cost of the queries is the lowest, estimated with
+ * 16 bins along the largest axis. The nodes are stored in a flat array of 32
+ * bytes per node, two children being consecutive, and the triangles of a leaf
+ * are contiguous: a query walks through compact memory instead of pointers.
+ *
+ * The triangles are given in the space of the mesh, and a transform moves
+ * them into the space of the particles. When the transform of a rigid mesh
+ * changes, the triangles are transformed and the bounds of the nodes are
+ * refitted, bottom-up, without rebuilding the hierarchy. A static mesh is
+ * never refitted.
+ *
+ * The front of a triangle is the side where its vertices are counterclockwise.
+ * A particle whose center is behind the closest triangle is pushed to the
+ * front: closed meshes and terrains then push back particles that went too
+ * far, as long as their center is closer than their radius. Two-sided meshes
+ * push particles to the side of their center instead.
+ */
+class MeshCollider
+{
+public:
+    /**@brief Build the hierarchy of the triangles of a mesh.
+     *
+     * @param mesh The mesh, whose positions and indices are copied.
+     * @param transform The transform from the space of the mesh to the space
+     * of the particles.
+     */
+    MeshCollider(const MeshRenderable& mesh, const glm::mat4& transform = glm::mat4(1.0));
+
+    /**@brief Build the hierarchy of triangles.
+     *
+     * @param positions The vertices of the mesh.
+     * @param indices The vertex indices of the triangles. If empty, the
+     * vertices are taken three by three.
+     * @param transform The transform from the space of the mesh to the space
+     * of the particles.
+     */
+    MeshCollider(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+                 const glm::mat4& transform = glm::mat4(1.0));
+    ~MeshCollider();
+
+    /**@brief Move the mesh.
+     *
+     * The triangles are transformed and the hierarchy is refitted, if the
+     * transform changed. The transform should be rigid, possibly scaled: a
+     * deformation makes the hierarchy less efficient, but still correct.
+     * @param transform The transform from the space of the mesh to the space
+     * of the particles.
+     */
+    void setTransform(const glm::mat4& transform);
+    const glm::mat4& getTransform() const;
+
+    void setTwoSided(bool twoSided);
+    bool isTwoSided() const;
+
+    /**@brief Find the closest point of the mesh to a sphere.
+     *
+     * @param center The center of the sphere.
+     * @param radius The radius of the sphere.
+     * @param normal The direction to push the sphere out of the mesh.
+     * @param depth The distance to push the sphere out of the mesh.
+     * @return False if the sphere does not touch the mesh.
+     */
+    bool collide(const glm::vec3& center, float radius, glm::vec3& normal, float& depth) const;
+
+    /**@brief Get the bounds of the mesh, in the space of the particles. */
+    void getBounds(glm::vec3& min, glm::vec3& max) const;
+
+    size_t triangleCount() const;
+    size_t nodeCount() const;
+
+private:
+    /**@brief A node of the hierarchy, of 32 bytes.
+     *
+     * A leaf holds count triangles from the index first. An inner node has
+     * a count of 0, and its children are the nodes first and first+1.
+     */
+    struct Node
+    {
+        glm::vec3 min;
+        unsigned int first;
+        glm::vec3 max;
+        unsigned int count;
+    };
+
+    void build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+    void refit();
+
+    std::vector<Node> m_nodes;
+    // Vertices of the triangles, three by three in the order of the leaves,
+    // in the space of the mesh and in the space of the particles
+    std::vector<glm::vec3> m_localVertices;
+    std::vector<glm::vec3> m_vertices;
+    glm::mat4 m_transform;
+    bool m_twoSided;
+};
+
+typedef std::shared_ptr<MeshCollider> MeshColliderPtr;
+
+#endif //MESH_COLLIDER_HPP
@@ -0,0 +1,52 @@
+#ifndef MORTON_ORDER_HPP
+#define MORTON_ORDER_HPP
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.hpp"
+
+/**@brief Order the slots of a store along a Z-order curve.
+ *
+ * Particles are attached in the order they were created, and they move: after
+ * a while, particles close in space sit far apart in the store, and the loops
+ * over neighbors (springs, contacts, broadphase) read memory at random. The
+ * space is divided into a grid of 1024³ cells over the bounding box of the
+ * particles, or larger cells if requested. Each particle gets the Morton code
+ * of its cell, which interleaves the bits of the cell coordinates: sorting by
+ * code puts close cells close to each other in memory. The codes are sorted
+ * with a parallel least significant digit radix sort, 8 bits per pass.
+ *
+ * Detached slots are moved to the end. The sort is stable: the particles of a
+ * cell keep their relative order.
+ */
+class MortonOrder
+{
+public:
+    MortonOrder();
+    ~MortonOrder();
+
+    /**@brief Set the minimal size of the cells of the grid.
+     *
+     * @param size The minimal cell size, 0 (the default) to use the bounding box only.
+     */
+    void setCellSize(float size);
+    float getCellSize() const;
+
+    /**@brief Compute the new order of the slots of a store.
+     *
+     * @param store The particles.
+     * @param order The previous slot of each new slot, see ParticleStore::permute().
+     */
+    void sort(const ParticleStore& store, std::vector< unsigned int >& order);
+
+private:
+    float m_cellSize;
+
+    std::vector< uint32_t > m_keys, m_sortedKeys;
+    std::vector< unsigned int > m_sortedOrder;
+    std::vector< unsigned int > m_histograms; // per thread and digit
+};
+
+#endif //MORTON_ORDER_HPP
@@ -5,6 +5,8 @@
 #include <memory>
 #include <glm/glm.hpp>
 
+class ParticleStore;
+
 /**@brief Represent a particle as a moving ball.
  *
  * This class is used to model particles in a dynamic system.
@@ -12,6 +14,10 @@
  * a position. This ball is affected by forces that will change
  * both its position and its velocity. This ball can be fixed,
  * making its position constant and its velocity null.
+ *
+ * Once added to a DynamicSystem, the state of the particle lives in the
+ * ParticleStore of the system: the particle is then a handle to its slot in
+ * the store, and the accessors below read and write the store.
  */
 class Particle
 {
@@ -40,6 +46,15 @@ public:
    * @return The particle's position.
    */
   const glm::vec3& getPosition() const;
+  /**@brief Access to the position to draw this particle at.
+   *
+   * Renderables should use this position rather than getPosition(): when the
+   * store of the particle interpolates the positions between two simulation
+   * steps, it returns the interpolated position (see
+   * ParticleStore::interpolatePositions()). Otherwise, it is the position.
+   * @return The particle's position to render.
+   */
+  const glm::vec3& getRenderPosition() const;
   /**@brief Access to this particle's velocity.
    *
    * Get the velocity of this particle.
@@ -70,6 +85,13 @@ public:
    * @return True if the particle is fixed.
    */
   bool isFixed() const;
+  /**@brief Check if this particle is sleeping.
+   *
+   * A particle attached to a store sleeps with its island, see
+   * SimulationIslands. Solvers leave sleeping particles in place.
+   * @return True if the particle is sleeping, false if it is not in a store.
+   */
+  bool isSleeping() const;
 
   /**@brief Set the particle's position.
    *
@@ -130,7 +152,29 @@ public:
    */
   void restart();
 
+  /**@brief Access to the store holding the state of this particle.
+   *
+   * @return The store, or nullptr if the particle holds its own state.
+   */
+  ParticleStore* getStore() const;
+  /**@brief Access to the slot of this particle in its store. */
+  size_t getStoreIndex() const;
+
 private:
+  Particle(const Particle&) = delete;
+  Particle& operator=(const Particle&) = delete;
+
+  friend class ParticleStore;
+
+  /**@brief The store holding the state of this particle.
+   *
+   * While it is set, the position, velocity, force, radius and fixed flag
+   * below are not used: the store holds their current values.
+   */
+  ParticleStore* m_store;
+  /**@brief The slot of this particle in m_store. */
+  size_t m_index;
+
   /**@brief The initial particle's position.
    *
    * The initial position of this particle, stored to be set at restart.
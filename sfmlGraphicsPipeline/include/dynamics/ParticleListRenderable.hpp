@@ -32,17 +32,29 @@ public:
     
     void update_all_buffers();
 
+    /**@brief Draw the particles as ray-cast impostors.
+     *
+     * Instead of a tessellated sphere, each particle is drawn as a single quad
+     * facing the camera, and the fragment shader intersects the view ray with
+     * the sphere to compute its depth and normal. The shader program should
+     * then be an impostor shader, such as sphereImpostorVertex.glsl.
+     * @param impostors True to draw impostors, false to draw spheres.
+     */
+    void setImpostorMode(bool impostors);
+
 
 protected:
     void do_draw();
 
 private:
 
+    void draw_impostors();
     void genbuffers();
     void update_positions_buffer();
     void update_colors_buffer();
     void update_normals_buffer();
     void update_indices_buffer();
+    void update_quad_buffer();
     void update_instances_data_buffer();
 
     std::vector< glm::vec3 > m_positions;
@@ -54,7 +66,10 @@ private:
     unsigned int m_cBuffer;
     unsigned int m_nBuffer;
     unsigned int m_iBuffer;
-    unsigned int m_idBuffer; // instance data
+    unsigned int m_idBuffer; // instance data, in the viewer's dynamic buffer
+    size_t m_idOffset;
+    unsigned int m_qBuffer; // quad corners, in impostor mode
+    bool m_impostors;
 
     std::vector< ParticlePtr > m_particles;
 };
@@ -0,0 +1,220 @@
+#ifndef PARTICLE_STORE_HPP
+#define PARTICLE_STORE_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Particle;
+
+/**@brief Standard allocator returning memory aligned for SIMD loads.
+ *
+ * The default alignment of 32 bytes suits AVX registers.
+ */
+template< typename T, size_t Alignment = 32 >
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    template< typename U > struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() {}
+    template< typename U >
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n)
+    {
+        // Keep the address returned by malloc just before the aligned block
+        void* block = std::malloc(n * sizeof(T) + Alignment + sizeof(void*));
+        if (!block)
+            throw std::bad_alloc();
+        uintptr_t start = reinterpret_cast<uintptr_t>(block) + sizeof(void*);
+        void* aligned = reinterpret_cast<void*>((start + Alignment - 1) / Alignment * Alignment);
+        static_cast<void**>(aligned)[-1] = block;
+        return static_cast<T*>(aligned);
+    }
+
+    void deallocate(T* p, size_t)
+    {
+        if (p)
+            std::free(reinterpret_cast<void**>(p)[-1]);
+    }
+
+    template< typename U, typename... Args >
+    void construct(U* p, Args&&... args)
+    {
+        ::new((void*)p) U(std::forward<Args>(args)...);
+    }
+
+    template< typename U >
+    void destroy(U* p)
+    {
+        p->~U();
+    }
+
+    size_t max_size() const
+    {
+        return size_t(-1) / sizeof(T);
+    }
+};
+
+template< typename T, typename U, size_t A >
+bool operator==(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return true; }
+template< typename T, typename U, size_t A >
+bool operator!=(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return false; }
+
+/**@brief Contiguous storage of the particles of a dynamic system.
+ *
+ * A std::vector<ParticlePtr> scatters the particles in the heap: integrating
+ * them jumps from one allocation to the next and goes through their getters
+ * and setters. This store keeps each attribute of the particles in its own
+ * aligned array (a structure of arrays): positions, velocities, forces,
+ * inverse masses, radii and flags. The integrators then run simple loops over
+ * these arrays, that the compiler vectorizes.
+ *
+ * A Particle added to a DynamicSystem is attached to the store of the system:
+ * its state moves into the arrays and the Particle becomes a handle to its
+ * slot. The Particle API keeps working as before. When the particle is
+ * detached (the system is cleared or destroyed), its state moves back into
+ * the Particle. When a particle is destroyed, its slot is flagged as detached
+ * and is ignored by the integrators.
+ *
+ * Detached slots are not reused: the solvers, force fields and checkpoints
+ * refer to the particles by slot, and a new particle in an old slot would
+ * inherit their state. The store grows with each attached particle until it
+ * is cleared, see detachedCount().
+ */
+class ParticleStore
+{
+public:
+    template< typename T >
+    using Array = std::vector< T, AlignedAllocator<T> >;
+
+    /**@brief Flags of the particles. */
+    enum Flag
+    {
+        FIXED = 1, /*!< The particle does not move. */
+        DETACHED = 2, /*!< The slot does not hold a particle anymore. */
+        SLEEPING = 4 /*!< The particle belongs to a sleeping island, see SimulationIslands. */
+    };
+
+    ParticleStore();
+    ~ParticleStore();
+
+    /**@brief Move the state of a particle into the store.
+     *
+     * The particle is detached first from its previous store, if any.
+     * @param particle The particle, which becomes a handle to its slot.
+     */
+    void attach(Particle& particle);
+
+    /**@brief Move the state of a particle back into it.
+     * @param particle A particle attached to this store.
+     */
+    void detach(Particle& particle);
+
+    /**@brief Detach all the particles and empty the store. */
+    void clear();
+
+    /**@brief Number of slots, including the detached ones. */
+    size_t size() const;
+    /**@brief Number of detached slots. */
+    size_t detachedCount() const;
+    /**@brief Version of the slots, unique among all the stores.
+     *
+     * It changes when particles are attached, detached or moved to other
+     * slots: slot indices cached with a version stay valid until it changes.
+     */
+    unsigned long long slotVersion() const;
+
+    /**@brief Move the particles to other slots.
+     *
+     * All the arrays are permuted and the attached particles are updated to
+     * their new slot. The slots held elsewhere, by solvers or force fields,
+     * must be remapped by their owner.
+     * @param order The previous slot of each new slot: a permutation of 0..size()-1.
+     */
+    void permute(const std::vector< unsigned int >& order);
+
+    /**@brief Set the forces of all the particles to zero. */
+    void clearForces();
+
+    /**@brief Integrate the particles with a (semi-implicit) explicit Euler step.
+     *
+     * Fixed and detached particles are not moved.
+     * @param dt The time step.
+     */
+    void integrateExplicitEuler(float dt);
+
+    /**@brief Save the current positions as the state before the next step.
+     *
+     * See interpolatePositions().
+     */
+    void savePreviousPositions();
+
+    /**@brief Compute the positions to render between the last two states.
+     *
+     * When the simulation runs at a fixed time step, a frame is usually drawn
+     * between two steps. The positions drawn are then interpolated between the
+     * positions saved by savePreviousPositions() and the current ones, so that
+     * the motion looks smooth even if the steps are less frequent than frames.
+     * Until stopInterpolation() is called, renderPositions() returns them.
+     * @param alpha The interpolation factor, from 0 (previous state) to 1 (current state).
+     */
+    void interpolatePositions(float alpha);
+
+    /**@brief Render the current positions again. */
+    void stopInterpolation();
+
+    /**@brief The positions to render: interpolated positions, or the current positions. */
+    const Array< glm::vec3 > & renderPositions() const { return m_interpolating ? m_renderPositions : m_positions; }
+
+    Array< glm::vec3 > & positions() { return m_positions; }
+    Array< glm::vec3 > & velocities() { return m_velocities; }
+    Array< glm::vec3 > & forces() { return m_forces; }
+    Array< float > & inverseMasses() { return m_inverseMasses; }
+    Array< float > & radii() { return m_radii; }
+    Array< unsigned char > & flags() { return m_flags; }
+    const Array< glm::vec3 > & positions() const { return m_positions; }
+    const Array< glm::vec3 > & velocities() const { return m_velocities; }
+    const Array< glm::vec3 > & forces() const { return m_forces; }
+    const Array< float > & inverseMasses() const { return m_inverseMasses; }
+    const Array< float > & radii() const { return m_radii; }
+    const Array< unsigned char > & flags() const { return m_flags; }
+
+private:
+    ParticleStore(const ParticleStore&) = delete;
+    ParticleStore& operator=(const ParticleStore&) = delete;
+
+    friend class Particle;
+    void release(size_t index);
+
+    Array< glm::vec3 > m_positions;
+    Array< glm::vec3 > m_velocities;
+    Array< glm::vec3 > m_forces;
+    Array< float > m_inverseMasses;
+    Array< float > m_radii;
+    Array< unsigned char > m_flags;
+    std::vector< Particle* > m_handles; // nullptr for detached slots
+    size_t m_detachedCount;
+    unsigned long long m_slotVersion;
+
+    Array< glm::vec3 > m_previousPositions;
+    Array< glm::vec3 > m_renderPositions;
+    bool m_interpolating;
+};
+
+typedef std::shared_ptr<ParticleStore> ParticleStorePtr;
+
+#endif //PARTICLE_STORE_HPP
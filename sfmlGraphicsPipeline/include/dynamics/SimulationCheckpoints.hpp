@@ -0,0 +1,128 @@
+#ifndef SIMULATION_CHECKPOINTS_HPP
+#define SIMULATION_CHECKPOINTS_HPP
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+class DynamicSystem;
+
+/**@brief Snapshots of the state of a dynamic system along its timeline.
+ *
+ * Seeking to a time of a simulation would otherwise replay it from the start.
+ * Instead, the state of the system is captured at regular times, and seeking
+ * restores the latest snapshot before the target time: only the remaining
+ * time has to be simulated again.
+ *
+ * A snapshot holds the arrays of the ParticleStore of the system (positions,
+ * velocities and flags) and its time step. To keep them compact, a snapshot
+ * only stores the bits that changed since the previous one (XOR of the raw
+ * floats), reordered so that the bytes of the same rank of all the floats are
+ * contiguous: sign and exponent bytes barely change between two snapshots, and
+ * their long runs of zeros are run-length encoded. Every keyframeInterval
+ * snapshots, a full snapshot starts a new chain, so restoring a snapshot
+ * decodes at most keyframeInterval of them.
+ *
+ * Snapshots are kept in a ring buffer: when it is full, the oldest chain is
+ * dropped. They can also be saved to and loaded from a file, to skip the
+ * simulation of a long animation when the application restarts.
+ */
+class SimulationCheckpoints
+{
+public:
+    /**@brief Create an empty set of checkpoints.
+     *
+     * @param capacity The maximal number of snapshots kept.
+     * @param keyframeInterval The number of snapshots of a chain, starting with a full one.
+     */
+    SimulationCheckpoints(size_t capacity = 256, unsigned int keyframeInterval = 8);
+
+    /**@brief Capture the state of a system.
+     *
+     * Snapshots are ordered by time: the ones after this time are discarded
+     * first. Nothing is done if a snapshot was already captured at this time.
+     * @param time The simulated time of the state.
+     * @param system The dynamic system.
+     */
+    void capture(float time, DynamicSystem& system);
+
+    /**@brief Restore the latest snapshot at or before a given time.
+     *
+     * The store of the system must have the same number of slots as when the
+     * snapshot was captured.
+     * @param time The target time.
+     * @param system The dynamic system to restore.
+     * @param checkpointTime The time of the restored snapshot.
+     * @return False if no snapshot could be restored.
+     */
+    bool restore(float time, DynamicSystem& system, float& checkpointTime) const;
+
+    /**@brief Discard the snapshots after a given time.
+     *
+     * To call when the simulation diverges from the captured timeline, for
+     * instance after a user interaction.
+     * @param time The time after which the snapshots are discarded.
+     */
+    void discardAfter(float time);
+    void clear();
+
+    /**@brief Follow the particles moved to other slots, see ParticleStore::permute().
+     *
+     * The snapshots of as many slots as the permutation are decoded, permuted
+     * and encoded again.
+     * @param order The previous slot of each new slot.
+     */
+    void permute(const std::vector<unsigned int>& order);
+
+    size_t size() const;
+    /**@brief Get the time of the latest snapshot, or a negative time if there is none. */
+    float latestTime() const;
+    /**@brief Get the time of the latest snapshot at or before a given time, or a negative time if there is none. */
+    float latestTimeBefore(float time) const;
+    /**@brief Get the number of bytes used by the encoded snapshots. */
+    size_t memoryUsage() const;
+
+    /**@brief Save the snapshots in a binary file.
+     * @return False if the file could not be written.
+     */
+    bool save(const std::string& filename) const;
+    /**@brief Replace the snapshots by the ones of a file written by save().
+     * @return False if the file could not be read, or if a snapshot does not
+     * decode to the words of its particles. The snapshots are then unchanged.
+     */
+    bool load(const std::string& filename);
+
+private:
+    struct Checkpoint
+    {
+        float time;
+        float dt;
+        bool keyframe;
+        uint32_t slotCount;
+        std::vector<unsigned char> data; // encoded words
+    };
+
+    /**@brief Decode the words of a snapshot, from the keyframe of its chain. */
+    void decode(size_t index, std::vector<uint32_t>& words) const;
+
+    static void encode_words(const std::vector<uint32_t>& words, std::vector<unsigned char>& data);
+    /**@brief Decode the words encoded by encode_words().
+     * @return False if the data is truncated or is not a whole number of words.
+     */
+    static bool decode_words(const std::vector<unsigned char>& data, std::vector<uint32_t>& words);
+
+    std::deque<Checkpoint> m_checkpoints;
+    size_t m_capacity;
+    unsigned int m_keyframeInterval;
+    // Decoded words of the latest snapshot, the reference of the next one
+    std::vector<uint32_t> m_latest;
+    // Work buffers
+    std::vector<uint32_t> m_words;
+    mutable std::vector<uint32_t> m_delta;
+};
+
+typedef std::shared_ptr<SimulationCheckpoints> SimulationCheckpointsPtr;
+
+#endif //SIMULATION_CHECKPOINTS_HPP
@@ -0,0 +1,136 @@
+#ifndef SIMULATION_ISLANDS_HPP
+#define SIMULATION_ISLANDS_HPP
+
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ForceField.hpp"
+#include "ParticleStore.hpp"
+
+/**@brief Independent groups of particles of a dynamic system.
+ *
+ * A dynamic system often holds objects that never interact: a flag, a cloth
+ * and loose particles. An island is a set of particles coupled by force
+ * fields (see ForceField::addCouplings()): the springs of a cloth make one
+ * island, each loose particle is an island of its own. They are the connected
+ * components of the couplings, found with a union-find, and are only rebuilt
+ * when the force fields or the particles of the system change.
+ *
+ * A force field whose couplings stay in one island is local to this island.
+ * The local fields of different islands write the forces of different slots,
+ * so the dynamic system evaluates each island as an independent task (see
+ * islandForceFields()); the fields shared by several islands, like gravity,
+ * are evaluated as before.
+ *
+ * An island whose particles barely moved for a while falls asleep: its slots
+ * are flagged ParticleStore::SLEEPING, the solvers and the broadphase ignore
+ * them as if they were fixed, and its local force fields are not evaluated.
+ * Islands in contact sleep and wake up together: an island hit by an awake
+ * one wakes up at the end of the step. User interactions must wake all the
+ * islands up, see wakeUp().
+ */
+class SimulationIslands
+{
+public:
+    typedef std::pair<unsigned int, unsigned int> Pair;
+
+    SimulationIslands();
+    ~SimulationIslands();
+
+    /**@brief Activate/deactivate the islands.
+     *
+     * When deactivated, all the particles are awake and all the force fields
+     * are shared.
+     * @param onOff True to activate the islands.
+     */
+    void setEnabled(bool onOff);
+    bool isEnabled() const;
+
+    /**@brief Set when an island falls asleep.
+     *
+     * @param speed The largest speed of the particles of a quiet island, in
+     * units per second. It is measured from the displacement during a step, so
+     * that particles resting on an obstacle count as quiet.
+     * @param delay The time an island must stay quiet before it falls asleep.
+     */
+    void setSleepThreshold(float speed, float delay);
+
+    /**@brief Group the particles into islands before a simulation step.
+     *
+     * The islands are rebuilt if the force fields or the slots of the store
+     * changed since the last call, or after invalidate().
+     * @param store The store of the system.
+     * @param forceFields The force fields of the system.
+     */
+    void update(ParticleStore& store, const std::vector<ForceFieldPtr>& forceFields);
+
+    /**@brief Put the quiet islands to sleep after a simulation step.
+     *
+     * @param store The store of the system.
+     * @param contacts The pairs of slots in contact during the step.
+     * @param dt The time step of the step.
+     */
+    void updateSleep(ParticleStore& store, const std::vector<Pair>& contacts, float dt);
+
+    /**@brief Wake all the islands up, and rebuild them at the next update. */
+    void wakeUp(ParticleStore& store);
+    /**@brief Rebuild the islands at the next update, e.g. after springs were added to a field. */
+    void invalidate();
+    /**@brief Follow the particles moved to other slots, see ParticleStore::permute().
+     *
+     * The islands and their sleep are kept, unlike after invalidate().
+     * @param order The previous slot of each new slot.
+     */
+    void permute(const std::vector<unsigned int>& order);
+
+    size_t islandCount() const;
+    size_t sleepingIslandCount() const;
+
+    /**@brief The awake islands that have local force fields. */
+    const std::vector<unsigned int>& activeIslands() const;
+    /**@brief The indices of the local force fields of each island. */
+    const std::vector< std::vector<unsigned int> >& islandForceFields() const;
+    /**@brief The indices of the force fields shared by several islands, and acting on at least an awake particle. */
+    const std::vector<unsigned int>& sharedForceFields() const;
+
+private:
+    void rebuild(ParticleStore& store, const std::vector<ForceFieldPtr>& forceFields);
+    void setSleeping(ParticleStore& store, unsigned int island, bool sleeping);
+
+    bool m_enabled;
+    bool m_dirty;
+    float m_sleepSpeed;
+    float m_sleepDelay;
+
+    // State the islands were built from
+    std::vector<const ForceField*> m_builtFields;
+    size_t m_builtSlots;
+
+    // Island of each slot, -1 for detached slots, and slots of each island (CSR)
+    std::vector<int> m_slotIsland;
+    std::vector<unsigned int> m_firstSlot;
+    std::vector<unsigned int> m_islandSlots;
+
+    // Force fields: island of each field, -1 if shared, and the islands a shared field acts on (CSR)
+    std::vector<int> m_fieldIsland;
+    std::vector<unsigned int> m_firstFieldIsland;
+    std::vector<unsigned int> m_fieldIslands;
+    std::vector< std::vector<unsigned int> > m_islandFields;
+    std::vector<unsigned int> m_activeIslands;
+    std::vector<unsigned int> m_sharedFields;
+
+    // Sleep: time each island has been quiet, and whether it sleeps
+    std::vector<float> m_quietTime;
+    std::vector<unsigned char> m_sleeping;
+    size_t m_sleepingCount;
+    ParticleStore::Array<glm::vec3> m_startPositions;
+    std::vector<float> m_displacements;
+    std::vector<unsigned char> m_quietGroups;
+
+    // Union-find work arrays
+    std::vector<unsigned int> m_parents;
+    std::vector< Pair > m_couplings;
+};
+
+#endif //SIMULATION_ISLANDS_HPP
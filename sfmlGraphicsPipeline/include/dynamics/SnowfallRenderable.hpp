@@ -0,0 +1,87 @@
+# ifndef SNOWFALL_RENDERABLE_HPP
+# define SNOWFALL_RENDERABLE_HPP
+
+#include "../Renderable.hpp"
+
+#include <glm/glm.hpp>
+
+/**@brief Snowfall simulated and rendered on the GPU.
+ *
+ * Unlike a DynamicSystem, the flakes are not Particle objects: their state
+ * lives in two vertex buffers on the GPU, and never comes back to the CPU.
+ * At each animation step, a transform feedback shader (snowfallUpdateVertex.glsl)
+ * reads one buffer and writes the next state in the other one:
+ * \li flakes fall at their own speed, pushed by the wind and a turbulence;
+ * \li the snow fills a box that follows the camera: flakes leaving the box
+ * horizontally wrap to the opposite side;
+ * \li flakes that reach the ground, the bottom of the box or the end of their
+ * life are killed and emitted again at the top of the box.
+ *
+ * The flakes are then drawn as point sprites in a single draw call, with the
+ * shader program given at construction (see snowfallVertex.glsl).
+ */
+class SnowfallRenderable : public Renderable
+{
+public:
+    ~SnowfallRenderable();
+
+    /**@brief Allocate the flakes on the GPU.
+     *
+     * @param program The shader program used to render the flakes.
+     * @param flakeCount The maximal number of flakes.
+     */
+    SnowfallRenderable(ShaderProgramPtr program, unsigned int flakeCount);
+
+    /**@brief Set the half dimensions of the box of snow around the camera. */
+    void setVolume(const glm::vec3& halfExtent);
+    void setGroundHeight(float height);
+    /**@brief Set the mean falling speed of the flakes, in units per second. */
+    void setFallSpeed(float speed);
+    void setWind(const glm::vec3& wind);
+    /**@brief Set the amplitude of the swirling motion of the flakes, in units per second. */
+    void setTurbulence(float turbulence);
+    /**@brief Set the diameter of the flakes, in world units. */
+    void setFlakeSize(float size);
+    void setColor(const glm::vec4& color);
+
+    /**@brief Set the number of flakes emitted per second.
+     *
+     * With a rate of zero (the default), all the flakes are emitted at once,
+     * anywhere in the box. Otherwise, the snowfall starts from the top of the
+     * box and thickens until all the flakes are emitted.
+     */
+    void setEmissionRate(float rate);
+
+    unsigned int flakeCount() const;
+    unsigned int emittedCount() const;
+
+protected:
+    void do_draw();
+    void do_animate(float time);
+
+private:
+    void bind_state_attributes(const ShaderProgram& program, unsigned int buffer);
+    void unbind_state_attributes(const ShaderProgram& program);
+
+    ShaderProgramPtr m_updateProgram;
+    unsigned int m_stateBuffers[2];
+    unsigned int m_current; // index of the buffer holding the current state
+
+    unsigned int m_flakeCount;
+    float m_emitted; // fractional, to emit less than one flake per step
+    float m_lastUpdateTime;
+    unsigned int m_step;
+
+    glm::vec3 m_halfExtent;
+    float m_groundHeight;
+    float m_fallSpeed;
+    glm::vec3 m_wind;
+    float m_turbulence;
+    float m_flakeSize;
+    glm::vec4 m_color;
+    float m_emissionRate;
+};
+
+typedef std::shared_ptr<SnowfallRenderable> SnowfallRenderablePtr;
+
+# endif
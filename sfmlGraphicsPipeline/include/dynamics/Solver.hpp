@@ -4,6 +4,8 @@
 #include <memory>
 #include <vector>
 #include "Particle.hpp"
+#include "ParticleStore.hpp"
+#include "ForceField.hpp"
 
 /**@brief Dynamic system solver interface.
  *
@@ -21,6 +23,48 @@ public:
    * @param particles The collection of particles.
    */
   void solve( const float& dt, std::vector<ParticlePtr>& particles );
+  /**@brief Solve the dynamic system of particles stored in a ParticleStore.
+   *
+   * Solve the dynamic system for a specified time step, directly on the
+   * arrays of the store.
+   * @param dt The time step for the integration.
+   * @param store The store holding the state of the particles.
+   * @param particles The collection of particles, handles to the store.
+   */
+  void solve( const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles );
+  /**@brief Solve the dynamic system of particles, knowing its force fields.
+   *
+   * The forces of the store must already be computed. Implicit solvers also
+   * need the force fields, to get the Jacobians of their forces.
+   * @param dt The time step for the integration.
+   * @param store The store holding the state of the particles.
+   * @param particles The collection of particles, handles to the store.
+   * @param forceFields The force fields applied to the particles.
+   */
+  void solve( const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles,
+              const std::vector<ForceFieldPtr>& forceFields );
+  /**@brief Check if this solver replaces a force field by its own model.
+   *
+   * The forces of such a field are not accumulated before solve(): the solver
+   * handles them itself, for instance as constraints.
+   * @param forceField A force field of the dynamic system.
+   * @return True if the forces of this field must not be accumulated.
+   */
+  bool convertsForceField( const ForceField& forceField ) const;
+  /**@brief Check if this solver is stable whatever the stiffness of a force field.
+   *
+   * The stiffness of such a field does not limit the adaptive time step of a
+   * dynamic system, see DynamicSystem::setAdaptiveTimeStep().
+   * @param forceField A force field of the dynamic system.
+   * @return True if any time step integrates this field stably.
+   */
+  bool isUnconditionallyStable( const ForceField& forceField ) const;
+  /**@brief Forget the slots of the store kept by this solver.
+   *
+   * To call when the particles of the store moved to other slots, see
+   * ParticleStore::permute().
+   */
+  void invalidateSlots();
 private:
   /**@brief Solve implementation.
    *
@@ -30,6 +74,40 @@ private:
    * @param particles The collection of particles.
    */
   virtual void do_solve(const float& dt, std::vector<ParticlePtr>& particles) = 0;
+  /**@brief Solve implementation on a store.
+   *
+   * Derived classes should override it with loops over the arrays of the
+   * store. By default, the particles are solved through their handles.
+   * @param dt The time step for the integration.
+   * @param store The store holding the state of the particles.
+   * @param particles The collection of particles, handles to the store.
+   */
+  virtual void do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles);
+  /**@brief Solve implementation knowing the force fields.
+   *
+   * By default, the force fields are ignored and the store is solved.
+   * @param dt The time step for the integration.
+   * @param store The store holding the state of the particles.
+   * @param particles The collection of particles, handles to the store.
+   * @param forceFields The force fields applied to the particles.
+   */
+  virtual void do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles,
+                        const std::vector<ForceFieldPtr>& forceFields);
+  /**@brief Force field conversion implementation.
+   *
+   * By default, no force field is converted.
+   */
+  virtual bool do_convertsForceField( const ForceField& forceField ) const;
+  /**@brief Unconditional stability implementation.
+   *
+   * By default, the solver is explicit and false is returned.
+   */
+  virtual bool do_isUnconditionallyStable( const ForceField& forceField ) const;
+  /**@brief Slot invalidation implementation.
+   *
+   * By default, the solver keeps no slot and nothing is done.
+   */
+  virtual void do_invalidateSlots();
 };
 
 typedef std::shared_ptr<Solver> SolverPtr;
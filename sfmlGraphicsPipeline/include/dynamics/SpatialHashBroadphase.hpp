@@ -0,0 +1,64 @@
+#ifndef SPATIAL_HASH_BROADPHASE_HPP
+#define SPATIAL_HASH_BROADPHASE_HPP
+
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.hpp"
+
+/**@brief Find the colliding pairs of particles with a spatial hash.
+ *
+ * Testing every pair of particles costs O(n²). Instead, the particles are
+ * sorted into a uniform grid whose cells are at least as large as the largest
+ * particle diameter: two particles can only overlap if their cells are
+ * neighbors. The grid is not stored: the cells are hashed into a table of
+ * about twice as many buckets as particles, and a counting sort groups the
+ * particles by bucket at each step. Each particle is then tested against the
+ * particles of its cell and of half of the 26 cells around it, so that each
+ * pair is tested once.
+ *
+ * The cells and the queries are computed in parallel with OpenMP. The pairs
+ * are returned in the same order for the same number of threads.
+ */
+class SpatialHashBroadphase
+{
+public:
+    /**@brief A pair of slots in a ParticleStore, the first one being the smallest. */
+    typedef std::pair< unsigned int, unsigned int > Pair;
+
+    SpatialHashBroadphase();
+    ~SpatialHashBroadphase();
+
+    /**@brief Set the minimal size of the cells of the grid.
+     *
+     * The cells are always at least as large as the largest particle diameter.
+     * A larger size can help when most particles are far apart.
+     * @param size The minimal cell size, 0 (the default) to only use the diameter.
+     */
+    void setCellSize(float size);
+    float getCellSize() const;
+
+    /**@brief Find the pairs of particles whose spheres overlap.
+     *
+     * Detached slots and pairs of particles that do not move (fixed or
+     * sleeping) are ignored.
+     * @param store The particles.
+     * @param pairs The overlapping pairs, replacing the previous content.
+     */
+    void findPairs(const ParticleStore& store, std::vector< Pair >& pairs);
+
+private:
+    float m_cellSize;
+
+    std::vector< glm::ivec3 > m_cells; // cell of each slot
+    std::vector< unsigned int > m_keys; // bucket of each slot
+    std::vector< unsigned int > m_bucketStart; // first sorted entry of each bucket
+    std::vector< unsigned int > m_next; // next free sorted entry of each bucket
+    std::vector< unsigned int > m_sorted; // slots sorted by bucket
+    std::vector< glm::ivec3 > m_sortedCells; // cells, in sorted order
+    std::vector< glm::vec4 > m_sortedSpheres; // positions and radii, in sorted order
+    std::vector< std::vector< Pair > > m_threadPairs; // pairs found by each thread
+};
+
+#endif //SPATIAL_HASH_BROADPHASE_HPP
@@ -38,6 +38,36 @@ class SpringForceField : public ForceField
          */
         ParticlePtr getParticle2() const;
 
+        float getStiffness() const;
+        float getEquilibriumLength() const;
+        float getDamping() const;
+
+        /**@brief Add the Jacobians of a damped spring between two slots of a store.
+         *
+         * The transverse stiffness is clamped to zero for compressed springs,
+         * which keeps the Jacobian negative semi-definite.
+         * @param i1 Slot of the first particle.
+         * @param i2 Slot of the second particle.
+         * @param displacement Position of the first particle minus position of the second one.
+         * @param stiffness Spring stiffness.
+         * @param equilibriumLength Equilibrium length.
+         * @param damping Damping factor.
+         * @param dfdx The Jacobian of the forces with respect to the positions.
+         * @param dfdv The Jacobian of the forces with respect to the velocities.
+         */
+        static void addSpringJacobians(unsigned int i1, unsigned int i2, const glm::vec3& displacement,
+                float stiffness, float equilibriumLength, float damping,
+                BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv);
+
+        /**@brief Add the stability bounds of a damped spring between two slots of a store.
+         *
+         * See ForceField::addStabilityBounds().
+         * @return The strain rate of the spring.
+         */
+        static float addSpringStabilityBounds(unsigned int i1, unsigned int i2, const ParticleStore& store,
+                float stiffness, float equilibriumLength, float damping,
+                float* stiffnessBounds, float* dampingBounds);
+
     private:
         /**@brief Add the force of this spring to the two particles.
          *
@@ -45,6 +75,10 @@ class SpringForceField : public ForceField
          * and add them to the particles.
          */
         void do_addForce();
+        bool do_addForce(const ParticleStore& store, glm::vec3* forces) const;
+        bool do_addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const;
+        float do_addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const;
+        bool do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const;
 
 
         const ParticlePtr m_p1, m_p2;
@@ -3,6 +3,7 @@
 
 #include "../MeshRenderable.hpp"
 #include "../dynamics/SpringForceField.hpp"
+#include "../dynamics/SpringNetworkForceField.hpp"
 #include <list>
 #include <vector>
 
@@ -25,14 +26,21 @@ public:
      * the springs we want to render.
      */
     SpringListRenderable( ShaderProgramPtr program, const std::vector<SpringForceFieldPtr>& springForceFields );
+    /**@brief Build a renderable to render the springs of a spring network.
+     *
+     * @param program The shader program used to render the springs.
+     * @param springNetwork The spring network we want to render.
+     */
+    SpringListRenderable( ShaderProgramPtr program, const SpringNetworkForceFieldPtr& springNetwork );
 
 protected:
     void do_draw();
 
 private:
-    void update_spring_positions();
+    void init_spring_geometry();
 
-    std::vector<SpringForceFieldPtr> m_springForceFields;
+    // The two end points of each spring
+    std::vector<ParticlePtr> m_endpoints;
 };
 
 typedef std::shared_ptr<SpringListRenderable> SpringListRenderablePtr;
@@ -0,0 +1,115 @@
+#ifndef SPRING_NETWORK_FORCE_FIELD_HPP
+#define SPRING_NETWORK_FORCE_FIELD_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ForceField.hpp"
+#include "Particle.hpp"
+#include "SpringForceField.hpp"
+
+/**@brief Implement all the springs of a cloth or a soft body in a single force field.
+ *
+ * A SpringForceField per spring means an object, a virtual call and
+ * pointer-chasing getters for each spring. This force field instead keeps the
+ * springs in flat arrays: end points, rest lengths, stiffnesses and dampings.
+ * The forces are computed in two loops:
+ * \li a loop over the springs computes the force of each spring, without
+ * writing to the particles;
+ * \li a loop over the particles sums the forces of their springs, found with
+ * a compressed sparse row (CSR) adjacency built when the springs change.
+ *
+ * Both loops write disjoint elements, so large networks split them across the
+ * OpenMP threads. A cloth is a single force field: without this, it would be
+ * evaluated by one thread. Called from a thread of an active parallel region,
+ * the loops run on that thread only.
+ *
+ * Per-spring force fields are only created on demand, see createSpringForceFields().
+ */
+class SpringNetworkForceField : public ForceField
+{
+    public:
+        /**@brief Build a spring network without springs.
+         *
+         * @param particles The particles the springs can connect. The springs
+         * refer to them by their index in this vector.
+         */
+        SpringNetworkForceField(const std::vector<ParticlePtr>& particles);
+        ~SpringNetworkForceField();
+
+        /**@brief Add a spring between two particles.
+         *
+         * @param particle1 Index of the first particle.
+         * @param particle2 Index of the second particle.
+         * @param stiffness Spring stiffness.
+         * @param equilibriumLength Equilibrium length.
+         * @param damping Damping factor.
+         * @return The index of the spring.
+         */
+        size_t addSpring(unsigned int particle1, unsigned int particle2,
+                float stiffness, float equilibriumLength, float damping);
+
+        /**@brief Add a spring at rest, its equilibrium length being the current distance between the particles. */
+        size_t addSpring(unsigned int particle1, unsigned int particle2,
+                float stiffness, float damping);
+
+        /**@brief Reserve memory for a number of springs. */
+        void reserve(size_t springCount);
+
+        size_t springCount() const;
+        const std::vector<ParticlePtr>& getParticles() const;
+        const std::vector<unsigned int>& getEndpoints1() const;
+        const std::vector<unsigned int>& getEndpoints2() const;
+        const std::vector<float>& getStiffnesses() const;
+        const std::vector<float>& getEquilibriumLengths() const;
+        const std::vector<float>& getDampings() const;
+
+        /**@brief Create a spring force field for each spring of the network.
+         *
+         * The created force fields are independent from the network: adding
+         * both to a dynamic system would apply the springs twice.
+         */
+        std::vector<SpringForceFieldPtr> createSpringForceFields() const;
+
+    private:
+        void do_addForce();
+        bool do_addForce(const ParticleStore& store, glm::vec3* forces) const;
+        bool do_addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const;
+        float do_addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const;
+        bool do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const;
+
+        bool update_slots(const ParticleStore& store) const;
+        void build_adjacency() const;
+        void compute_spring_forces() const;
+        glm::vec3 particle_force(unsigned int particle) const;
+
+        std::vector<ParticlePtr> m_particles;
+
+        std::vector<unsigned int> m_endpoints1;
+        std::vector<unsigned int> m_endpoints2;
+        std::vector<float> m_equilibriumLengths;
+        std::vector<float> m_stiffnesses;
+        std::vector<float> m_dampings;
+
+        // CSR adjacency: the springs of particle i are m_adjacency[m_firstSpring[i]]
+        // to m_adjacency[m_firstSpring[i+1]-1], stored as 2*spring+(1 if i is the
+        // second end point)
+        mutable std::vector<unsigned int> m_firstSpring;
+        mutable std::vector<unsigned int> m_adjacency;
+        mutable bool m_adjacencyDirty;
+
+        // Slot of each particle in m_slotStore, valid while the slot version
+        // of the store is m_slotVersion
+        mutable std::vector<unsigned int> m_slots;
+        mutable const ParticleStore* m_slotStore;
+        mutable unsigned long long m_slotVersion;
+
+        // Scratch arrays of the evaluation
+        mutable std::vector<glm::vec3> m_positions;
+        mutable std::vector<glm::vec3> m_velocities;
+        mutable std::vector<glm::vec3> m_springForces;
+};
+
+typedef std::shared_ptr<SpringNetworkForceField> SpringNetworkForceFieldPtr;
+
+#endif // SPRING_NETWORK_FORCE_FIELD_HPP
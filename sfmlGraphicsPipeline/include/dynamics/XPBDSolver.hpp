@@ -0,0 +1,134 @@
+#ifndef XPBD_SOLVER_HPP
+#define XPBD_SOLVER_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Solver.hpp"
+#include "SpatialHashBroadphase.hpp"
+#include "../Plane.hpp"
+
+/**@brief Extended position based dynamics (XPBD) solver.
+ *
+ * Instead of integrating the forces of the springs, this solver predicts the
+ * positions of the particles from the other forces (gravity, wind, damping...),
+ * then projects them on constraints with a fixed number of iterations
+ * (Macklin et al., XPBD: position-based simulation of compliant constrained
+ * dynamics, 2016). The velocities are deduced from the position changes.
+ * A step is stable whatever the time step and the stiffness: a stiffer or a
+ * larger system only converges less within the iteration budget.
+ *
+ * The supported constraints are:
+ * \li distance constraints, with a compliance (the inverse of a stiffness)
+ * and a damping. The SpringForceField and SpringNetworkForceField of the
+ * dynamic system are automatically converted into distance constraints;
+ * \li bending constraints between the opposite vertices of adjacent triangles,
+ * which are distance constraints with their own compliance;
+ * \li collision constraints with the plane obstacles of this solver, and
+ * between the particles if particle collisions are enabled.
+ *
+ * The distance constraints are colored so that no two constraints of the same
+ * color share a particle: each color is projected in parallel with OpenMP,
+ * the colors one after the other (Gauss-Seidel iterations).
+ */
+class XPBDSolver : public Solver
+{
+public:
+    /**@brief Build a XPBD solver.
+     *
+     * @param iterations Number of constraint projections per substep.
+     * @param substeps Number of substeps per time step.
+     */
+    XPBDSolver(int iterations = 10, int substeps = 1);
+    ~XPBDSolver();
+
+    int getIterations() const;
+    void setIterations(int iterations);
+    int getSubsteps() const;
+    void setSubsteps(int substeps);
+
+    /**@brief Add a distance constraint between two particles.
+     *
+     * The rest length is the current distance between the particles.
+     * @param p1 The first particle.
+     * @param p2 The second particle.
+     * @param compliance Inverse of the stiffness, 0 for an inextensible constraint.
+     * @param damping Damping factor, as the one of a spring.
+     */
+    void addDistanceConstraint(ParticlePtr p1, ParticlePtr p2, float compliance, float damping = 0.0f);
+
+    /**@brief Add the bending constraints of a triangle mesh.
+     *
+     * A constraint keeps the distance between the opposite vertices of each
+     * pair of triangles sharing an edge, which resists the folding of the edge.
+     * @param particles The particles of the mesh.
+     * @param triangles The triangles, as indices in particles.
+     * @param compliance Inverse of the bending stiffness.
+     */
+    void addBendingConstraints(const std::vector<ParticlePtr>& particles,
+                               const std::vector<glm::uvec3>& triangles, float compliance);
+
+    /**@brief Add a plane obstacle, that the particles cannot cross. */
+    void addPlaneObstacle(PlanePtr plane);
+
+    /**@brief Set if the particles collide with each other. */
+    void setParticleCollisions(bool onOff);
+    bool getParticleCollisions() const;
+
+    /**@brief Remove the constraints and the plane obstacles added to this solver. */
+    void clear();
+
+    /**@brief Number of colors of the distance constraints projected in parallel. */
+    size_t getColorCount() const;
+
+private:
+    void do_solve(const float& dt, std::vector<ParticlePtr>& particles);
+    void do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles);
+    void do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles,
+                  const std::vector<ForceFieldPtr>& forceFields);
+    bool do_convertsForceField(const ForceField& forceField) const;
+    bool do_isUnconditionallyStable(const ForceField& forceField) const;
+    void do_invalidateSlots();
+
+    /**@brief Build the constraints of the store slots, then color them. */
+    void build_constraints(const ParticleStore& store, const std::vector<ForceFieldPtr>& forceFields);
+    void color_constraints(size_t slotCount);
+    void project_distance_constraint(size_t c, float h, glm::vec3* x, const float* w);
+    void project_collisions(glm::vec3* x, const float* w, const float* radii);
+
+    struct UserConstraint
+    {
+        ParticlePtr p1, p2;
+        float restLength, compliance, damping;
+    };
+
+    int m_iterations;
+    int m_substeps;
+    bool m_particleCollisions;
+
+    std::vector<UserConstraint> m_userConstraints;
+    std::vector<PlanePtr> m_planeObstacles;
+
+    // Signature of the converted force fields, to rebuild the constraints when they change
+    std::vector<const ForceField*> m_convertedFields;
+    std::vector<const ForceField*> m_candidateFields; // signature of the current step
+    size_t m_convertedSpringCount;
+    size_t m_builtSlotCount;
+    bool m_dirty;
+
+    // Distance constraints on store slots, sorted by color. The constraints
+    // from m_colorStart[getColorCount()] on are projected by a single thread
+    std::vector<unsigned int> m_slots1, m_slots2;
+    std::vector<float> m_restLengths, m_compliances, m_dampings, m_lambdas;
+    std::vector<unsigned int> m_colorStart;
+
+    // State of a step
+    std::vector<glm::vec3> m_previous;
+    std::vector<float> m_inverseMasses;
+    std::vector<SpatialHashBroadphase::Pair> m_pairs;
+    SpatialHashBroadphase m_broadphase;
+};
+
+typedef std::shared_ptr<XPBDSolver> XPBDSolverPtr;
+
+#endif //XPBD_SOLVER_HPP
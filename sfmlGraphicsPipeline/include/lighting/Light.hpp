@@ -8,10 +8,12 @@
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtx/io.hpp>
 #include <cctype>
+#include <cstdio>
 #include "../Utils.hpp"
 #include "./../../include/gl_helper.hpp"
 
 #include "./../../include/ShaderProgram.hpp"
+#include "./../../include/FrameArena.hpp"
 #include "./../../include/KeyframedHierarchicalRenderable.hpp"
 #include <iostream>
 
@@ -66,21 +68,26 @@ class Light : public KeyframedHierarchicalRenderable
         if (program == nullptr || lights.empty())
             return false;
 
+        // Uniform names only live during this call: build them in the frame arena
         bool success = true;
         LightPtr first = lights[0];
-        std::string light_name = first->lightName();
-        std::string type_name = light_name;
-        type_name[0] = std::toupper(type_name[0]);
-        int location = program->getUniformLocation("numberOf" + type_name);
+        const char* light_name = first->lightName();
+        ArenaString count_name("numberOf");
+        count_name += light_name;
+        count_name[8] = std::toupper(count_name[8]);
+        int location = program->getUniformLocation(count_name.c_str());
         
         if(location!=ShaderProgram::null_location){
             glcheck(glUniform1i(location, (int)lights.size()));
         } else { success = false; }
         
         for(size_t i=0; i<lights.size(); ++i){
-            std::string name_with_index = first->lightName() + "[" + std::to_string(i) + "]";
+            char index[24];
+            std::snprintf(index, sizeof(index), "[%u]", static_cast<unsigned int>(i));
+            ArenaString name_with_index(light_name);
+            name_with_index += index;
             LightPtr light = lights[i];
-            success &= light->sendToGPU(program, name_with_index);
+            success &= light->sendToGPU(program, name_with_index.c_str());
         }
         return success;
     }
@@ -135,7 +142,7 @@ class Light : public KeyframedHierarchicalRenderable
     *
     * @return The name of the light in the shader.
     */
-    virtual std::string lightName() const =0;
+    virtual const char* lightName() const =0;
     
     protected:
     void do_animate(float time){
@@ -143,7 +150,7 @@ class Light : public KeyframedHierarchicalRenderable
         updateModelMatrix();
     }
 
-    virtual bool sendToGPU(const ShaderProgramPtr& program, const std::string & identifier)const =0;
+    virtual bool sendToGPU(const ShaderProgramPtr& program, const char* identifier)const =0;
     
     private:
     void do_draw()
@@ -222,8 +229,8 @@ class DirectionalLight : public Light
      *
      * @return The name of the light in the shader.
      */
-    std::string lightName() const { return "directionalLight"; }
-    bool sendToGPU(const ShaderProgramPtr& program, const std::string & identifier) const;
+    const char* lightName() const { return "directionalLight"; }
+    bool sendToGPU(const ShaderProgramPtr& program, const char* identifier) const;
 
     glm::vec3 m_direction;  /*!< The direction of the light. */
 };
@@ -330,12 +337,12 @@ class PointLight : public Light
         for (size_t i=0u;i<3;++i)
             m_position[i] = model[3][i];
     }
-    bool sendToGPU(const ShaderProgramPtr& program, const std::string & identifier) const;
+    bool sendToGPU(const ShaderProgramPtr& program, const char* identifier) const;
 
     glm::vec3 m_position;   /*!< The position of the light. */
 
     private:
-    std::string lightName() const { return "pointLight"; }
+    const char* lightName() const { return "pointLight"; }
     
     float m_constant;       /*!< Coefficient of constant attenuation of the light. */
     float m_linear;         /*!< Coefficient of linear attenuation of the light with respect to the distance to the light position. */
@@ -454,8 +461,8 @@ class SpotLight : public PointLight
      *
      * @return The name of the light in the shader.
      */
-    std::string lightName() const { return "spotLight"; }
-    bool sendToGPU(const ShaderProgramPtr& program, const std::string & identifier) const;
+    const char* lightName() const { return "spotLight"; }
+    bool sendToGPU(const ShaderProgramPtr& program, const char* identifier) const;
     glm::vec3 m_spotDirection; /*!< The direction of the spot. */
     float m_innerCutOff;    /*!< The cosinus of the inner cutoff angle that specifies the spotlight's inner radius. Everything inside this angle is fully lit by the spotlight. */
     float m_outerCutOff;    /*!< The cosinus of the outer cutoff angle that specifies the spotlight's outer radius. Everything outside this angle is not lit by the spotlight. */
@@ -0,0 +1,109 @@
+#ifndef BILLBOARD_BATCH_HPP
+#define BILLBOARD_BATCH_HPP
+
+#include "./../Renderable.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+/**@brief Render many camera facing billboards in a single draw call.
+ *
+ * Unlike BillBoardPlaneRenderable, which owns a texture, vertex buffers and a
+ * draw call per billboard, all the billboards of a batch share one quad and one
+ * texture array. Each billboard only owns a record in a per-instance vertex
+ * buffer (position, size, layer of the texture array and color tint), and the
+ * quad is expanded in the vertex shader. The whole batch is rendered with one
+ * glDrawArraysInstanced.
+ *
+ * Billboards can be edited one by one through the identifiers returned by
+ * addBillboard(), only the modified range is sent again to the GPU. When most
+ * billboards change every frame (particles for example), streamBillboards()
+ * replaces the whole set at once.
+ *
+ * This renderable expects a shader with the vPosition (vec2), instancePosition
+ * (vec3), instanceSize (vec2), instanceLayer (float) and instanceTint (vec4)
+ * attributes, such as billboardBatchVertex.glsl.
+ */
+class BillboardBatch : public Renderable
+{
+    public:
+        /**@brief Per-billboard record, as it is stored in the instance buffer. */
+        struct Billboard
+        {
+            glm::vec3 position; // center, in the local frame of the batch
+            glm::vec2 size; // world dimensions
+            float layer; // layer of the texture array
+            glm::vec4 tint; // color multiplied to the texture
+        };
+
+        ~BillboardBatch();
+
+        /**@brief Build a batch without any billboard.
+         *
+         * All images are stored as layers of one texture array, in the given
+         * order. They should have the same dimensions: other images are
+         * resampled to the dimensions of the first one.
+         *
+         * @param program The shader program used to render the billboards.
+         * @param texture_filenames The images of the layers of the texture array.
+         */
+        BillboardBatch(ShaderProgramPtr program, const std::vector< std::string > & texture_filenames);
+
+        /**@brief Add a billboard.
+         * @return An identifier of the billboard, valid until it is removed.
+         */
+        unsigned int addBillboard(const glm::vec3 & position, const glm::vec2 & size,
+                                  unsigned int layer = 0, const glm::vec4 & tint = glm::vec4(1.0));
+
+        /**@brief Remove a billboard.
+         *
+         * The last billboard takes the place of the removed one in the instance
+         * buffer, identifiers of other billboards remain valid.
+         * @return False if no billboard has this identifier.
+         */
+        bool removeBillboard(unsigned int id);
+
+        void setBillboardPosition(unsigned int id, const glm::vec3 & position);
+        void setBillboardSize(unsigned int id, const glm::vec2 & size);
+        void setBillboardLayer(unsigned int id, unsigned int layer);
+        void setBillboardTint(unsigned int id, const glm::vec4 & tint);
+
+        /**@brief Replace all the billboards.
+         *
+         * Identifiers of previous billboards become invalid, the new billboards
+         * have no identifier. The instance buffer is orphaned before the upload,
+         * so the driver does not wait for the previous frame to be drawn.
+         * @param billboards The new billboards.
+         */
+        void streamBillboards(const std::vector< Billboard > & billboards);
+
+        size_t billboardCount() const;
+        size_t layerCount() const;
+        void clearBillboards();
+
+    protected:
+        void do_draw();
+
+    private:
+        size_t slotOf(unsigned int id) const;
+        void markDirty(size_t slot);
+        void update_instances_buffer();
+
+        std::vector< Billboard > m_billboards;
+        std::vector< unsigned int > m_slotIds; // billboard identifier of each slot
+        std::unordered_map< unsigned int, size_t > m_idSlots; // slot of each billboard identifier
+        unsigned int m_nextId;
+        size_t m_layerCount;
+
+        unsigned int m_qBuffer; // quad corners
+        unsigned int m_instanceBuffer;
+        unsigned int m_texId;
+        size_t m_bufferCapacity; // number of billboards allocated on the GPU
+        size_t m_dirtyBegin, m_dirtyEnd; // slots to send again to the GPU
+};
+
+typedef std::shared_ptr<BillboardBatch> BillboardBatchPtr;
+
+#endif
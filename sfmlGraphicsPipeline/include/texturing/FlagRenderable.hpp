@@ -5,6 +5,8 @@
 #include <vector>
 #include <string>
 #include "dynamics/SpringForceField.hpp"
+#include "dynamics/SpringNetworkForceField.hpp"
+#include "dynamics/ClothSelfCollision.hpp"
 
 class FlagRenderable : public TexturedMeshRenderable
 {
@@ -17,11 +19,22 @@ public:
 
     void do_draw();
     std::vector<ParticlePtr> & getParticles();
+    /**@brief Access to the spring network of the flag, to add it to a dynamic system. */
+    SpringNetworkForceFieldPtr getSpringNetwork();
+    /**@brief Access to one spring force field per spring, created on the first call.
+     *
+     * These springs duplicate the spring network: add only one of them to a dynamic system.
+     */
     const std::vector<SpringForceFieldPtr> & getSprings();
+    /**@brief Access to the self-collision of the flag, to add it to a dynamic system. */
+    ClothSelfCollisionPtr getSelfCollision();
 
 private:
     std::vector<ParticlePtr> m_particles;
+    SpringNetworkForceFieldPtr m_springNetwork;
     std::vector<SpringForceFieldPtr> m_springs;
+    ClothSelfCollisionPtr m_selfCollision;
+    std::vector<unsigned int> m_movedVertices;
 };
 
 #endif // FLAGRENDERABLE_H
@@ -0,0 +1,114 @@
+#ifndef GPU_CLOTH_RENDERABLE_HPP
+#define GPU_CLOTH_RENDERABLE_HPP
+
+#include "TexturedMeshRenderable.hpp"
+#include <string>
+#include <glm/glm.hpp>
+
+/**@brief Flag simulated with compute shaders and rendered from the same buffers.
+ *
+ * Unlike a FlagRenderable, whose particles live in a DynamicSystem on the CPU,
+ * the state of this cloth lives in shader storage buffers on the GPU and never
+ * comes back to the CPU. The vertex stage reads the positions and normals
+ * directly from these buffers: no data is transferred at each frame, and the
+ * flag scales to hundreds of thousands of vertices.
+ *
+ * The particles form a grid with the same layout as getFabric(): each one is
+ * connected to its 8 neighbors, and to the particles two steps away along the
+ * width and the height for bending. The connectivity is implicit in the grid,
+ * so there is no spring buffer. Each substep runs:
+ * \li clothPredictCompute.glsl, which integrates the gravity, the wind, the air
+ * damping (and the spring forces in SPRINGS mode) and predicts the positions;
+ * \li in XPBD mode, clothConstraintCompute.glsl a fixed number of times: each
+ * run is a Jacobi iteration over the distance constraints between neighbors;
+ * \li clothFinishCompute.glsl, which deduces the velocities from the
+ * displacements and computes the normals.
+ * Positions and multipliers are ping-ponged between two buffers, so that an
+ * invocation never reads what another one writes.
+ *
+ * Compute shaders need OpenGL 4.3: check isSupported() and fall back to a
+ * FlagRenderable otherwise.
+ */
+class GPUClothRenderable : public TexturedMeshRenderable
+{
+public:
+    /**@brief Integration of the cloth. */
+    enum Mode
+    {
+        SPRINGS, /*!< Damped springs, integrated explicitly: needs many substeps. */
+        XPBD /*!< Distance constraints with the compliance of the springs. */
+    };
+
+    /**@brief Check if compute shaders and shader storage buffers are available. */
+    static bool isSupported();
+
+    ~GPUClothRenderable();
+    /**@brief Build a flag on the GPU.
+     *
+     * The parameters are the ones of a FlagRenderable. The first and last
+     * columns of the flag are fixed.
+     * @param program The shader program used to render the flag.
+     * @param width Width of the flag.
+     * @param height Height of the flag.
+     * @param horizontal_resolution Number of particles along the width.
+     * @param vertical_resolution Number of particles along the height.
+     * @param stiffness Stiffness of the springs between neighbors.
+     * @param damping Damping of the springs between neighbors.
+     * @param texture_filename Texture of the flag.
+     */
+    GPUClothRenderable(ShaderProgramPtr program,
+        float width, float height,
+        int horizontal_resolution, int vertical_resolution,
+        float stiffness, float damping, const std::string & texture_filename);
+
+    void setMode(Mode mode);
+    Mode getMode() const;
+    /**@brief Set the number of substeps per animation step. */
+    void setSubsteps(int substeps);
+    /**@brief Set the number of constraint iterations per substep, in XPBD mode. */
+    void setIterations(int iterations);
+    /**@brief Set the scale of the Jacobi updates, in ]0,1]. Lower is more robust but converges slower. */
+    void setRelaxation(float relaxation);
+    void setBendingStiffness(float stiffness);
+    void setGravity(const glm::vec3& gravity);
+    /**@brief Set the wind, as a force applied to each particle. */
+    void setWind(const glm::vec3& wind);
+    /**@brief Set the air damping, as the one of a DampingForceField. */
+    void setAirDamping(float damping);
+
+    size_t particleCount() const;
+
+protected:
+    void do_draw();
+    void do_animate(float time);
+
+private:
+    void dispatch(ShaderProgram& program);
+
+    enum Buffer { POSITIONS_A, POSITIONS_B, PREVIOUS, VELOCITIES, NORMALS, LAMBDAS_A, LAMBDAS_B, BUFFER_COUNT };
+    unsigned int m_buffers[BUFFER_COUNT];
+    unsigned int m_current; // index of the buffer holding the current positions (POSITIONS_A or POSITIONS_B)
+
+    ShaderProgramPtr m_predictProgram;
+    ShaderProgramPtr m_constraintProgram;
+    ShaderProgramPtr m_finishProgram;
+
+    glm::ivec2 m_resolution;
+    glm::vec2 m_spacing;
+    float m_lastUpdateTime;
+
+    Mode m_mode;
+    int m_substeps;
+    int m_iterations;
+    float m_relaxation;
+    float m_stiffness;
+    float m_damping;
+    float m_bendingStiffness;
+    glm::vec3 m_gravity;
+    glm::vec3 m_wind;
+    float m_airDamping;
+};
+
+typedef std::shared_ptr<GPUClothRenderable> GPUClothRenderablePtr;
+
+#endif // GPU_CLOTH_RENDERABLE_HPP
@@ -0,0 +1,102 @@
+#ifndef IMPOSTOR_RENDERABLE_HPP
+#define IMPOSTOR_RENDERABLE_HPP
+
+#include "./../HierarchicalRenderable.hpp"
+#include "./../texturing/InstancedMeshRenderable.hpp"
+#include "./../FrameArena.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+/**@brief Replace distant copies of a mesh by camera facing impostors.
+ *
+ * At construction, the mesh of an InstancedMeshRenderable is rendered offscreen
+ * from many directions around it. The views are stored in two atlases, one for
+ * the color and one for the normal (in object space), indexed by an octahedral
+ * mapping of the view direction.
+ *
+ * Instances are then added to this renderable rather than to the instanced mesh.
+ * Instances closer to the camera than a distance threshold are forwarded to the
+ * instanced mesh and drawn with their full geometry. Farther instances are drawn
+ * by this renderable as textured quads (4 vertices each) in a single instanced
+ * call, blending the 4 baked views closest to the current view direction.
+ *
+ * Both this renderable and the instanced mesh should be added to the viewer.
+ * The impostor shader (see impostorVertex.glsl) only handles directional lights.
+ */
+class ImpostorRenderable : public HierarchicalRenderable
+{
+    public:
+        ~ImpostorRenderable();
+
+        /**@brief Bake the impostor atlases of a mesh.
+         *
+         * @param program The shader program used to render the impostors.
+         * @param meshes The instanced mesh to bake, which also draws the near instances.
+         * @param distance The distance to the camera beyond which an instance uses its impostor.
+         * @param viewsPerSide The atlases hold viewsPerSide * viewsPerSide views.
+         * @param viewResolution The resolution in pixels of a view.
+         */
+        ImpostorRenderable(ShaderProgramPtr program,
+                           InstancedMeshRenderablePtr meshes,
+                           float distance,
+                           unsigned int viewsPerSide = 8,
+                           unsigned int viewResolution = 128);
+
+        /**@brief Add an instance, drawn as a mesh or as an impostor.
+         * @param transform The model matrix of the instance.
+         * @return An identifier of the instance, valid until it is removed.
+         */
+        unsigned int addInstance(const glm::mat4 & transform);
+        bool removeInstance(unsigned int id);
+        void setInstanceTransform(unsigned int id, const glm::mat4 & transform);
+
+        void setDistance(float distance);
+        size_t instanceCount() const;
+        /**@brief Number of instances drawn as impostors during the last draw. */
+        size_t impostorCount() const;
+
+    protected:
+        void do_draw();
+
+    private:
+        struct Instance
+        {
+            glm::mat4 transform;
+            glm::vec4 sphere; // world center and radius of the bounding sphere
+            glm::mat3 rotation; // world to object rotation
+            bool far;
+            unsigned int nearId; // identifier in the instanced mesh, if not far
+        };
+
+        // Per impostor record, as it is stored in the instance buffer
+        struct ImpostorData
+        {
+            glm::vec4 sphere;
+            glm::mat3 rotation;
+        };
+
+        void bake(unsigned int viewsPerSide, unsigned int viewResolution);
+        void update_instance(Instance & instance, const glm::mat4 & transform);
+        void update_partition(ArenaVector< ImpostorData > & impostors);
+
+        InstancedMeshRenderablePtr m_meshes;
+        float m_distance;
+        unsigned int m_viewsPerSide;
+        glm::vec3 m_boundingCenter;
+        float m_boundingRadius;
+
+        std::unordered_map< unsigned int, Instance > m_instances;
+        unsigned int m_nextId;
+        size_t m_impostorCount; // far instances at the last frame
+
+        unsigned int m_colorTexId;
+        unsigned int m_normalTexId;
+        unsigned int m_qBuffer; // quad corners
+        unsigned int m_idBuffer; // instance data
+};
+
+typedef std::shared_ptr<ImpostorRenderable> ImpostorRenderablePtr;
+
+#endif
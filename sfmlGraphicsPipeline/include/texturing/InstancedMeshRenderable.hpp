@@ -0,0 +1,108 @@
+#ifndef INSTANCED_MESH_RENDERABLE_HPP
+#define INSTANCED_MESH_RENDERABLE_HPP
+
+#include "./../texturing/TexturedLightedMeshRenderable.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+/**@brief Render many copies of one textured and lighted mesh in a single draw call.
+ *
+ * The mesh, its texture and its material are shared by every instance. Each
+ * instance only owns a transformation and a color tint, stored in a per-instance
+ * vertex buffer (see glVertexAttribDivisor). The whole set is rendered with one
+ * glDrawElementsInstanced, no matter how many instances there are.
+ *
+ * The renderable global/local transforms still apply on top of the instance
+ * transforms, so a whole group can be moved at once.
+ *
+ * This renderable expects a shader with the instanceModel (mat4), instanceNIT (mat3)
+ * and instanceColor (vec4) attributes, such as instancedTextureVertex.glsl.
+ */
+class InstancedMeshRenderable : public TexturedLightedMeshRenderable
+{
+    public:
+        ~InstancedMeshRenderable();
+
+        /**@brief Build an instanced renderable without any instance.
+         *
+         * @param program The shader program used to render the instances.
+         * @param mesh_filename The obj file of the shared mesh.
+         * @param material The material shared by all instances.
+         * @param texture_filename The texture shared by all instances.
+         */
+        InstancedMeshRenderable(ShaderProgramPtr program,
+                                const std::string & mesh_filename,
+                                const MaterialPtr & material,
+                                const std::string & texture_filename);
+
+        /**@brief Add an instance.
+         *
+         * @param transform The model matrix of the new instance.
+         * @param color The color multiplied to the textured color of the instance.
+         * @return An identifier of the instance, valid until it is removed.
+         */
+        unsigned int addInstance(const glm::mat4 & transform, const glm::vec4 & color = glm::vec4(1.0));
+
+        /**@brief Remove an instance.
+         *
+         * The last instance takes the place of the removed one in the instance
+         * buffer, identifiers of other instances remain valid.
+         * @param id The identifier returned by addInstance().
+         * @return False if no instance has this identifier.
+         */
+        bool removeInstance(unsigned int id);
+
+        /**@brief Change the transformation of an instance.
+         * @param id The identifier returned by addInstance().
+         * @param transform The new model matrix of the instance.
+         */
+        void setInstanceTransform(unsigned int id, const glm::mat4 & transform);
+
+        /**@brief Change the color tint of an instance.
+         * @param id The identifier returned by addInstance().
+         * @param color The new color of the instance.
+         */
+        void setInstanceColor(unsigned int id, const glm::vec4 & color);
+
+        const glm::mat4 & getInstanceTransform(unsigned int id) const;
+        const glm::vec4 & getInstanceColor(unsigned int id) const;
+        bool hasInstance(unsigned int id) const;
+        size_t instanceCount() const;
+        void clearInstances();
+
+    protected:
+        void do_draw();
+
+    private:
+        /**@brief Per-instance record, as it is stored in the instance buffer.
+         *
+         * The normal inverse transpose matrix is computed here once per update
+         * instead of once per vertex in the shader.
+         */
+        struct InstanceData
+        {
+            glm::mat4 model;
+            glm::mat3 nit;
+            glm::vec4 color;
+        };
+
+        size_t slotOf(unsigned int id) const;
+        void markDirty(size_t slot);
+        void update_instances_buffer();
+
+        std::vector< InstanceData > m_instances;
+        std::vector< unsigned int > m_slotIds; // instance identifier of each slot
+        std::unordered_map< unsigned int, size_t > m_idSlots; // slot of each instance identifier
+        unsigned int m_nextId;
+
+        unsigned int m_instanceBuffer;
+        size_t m_bufferCapacity; // number of instances allocated on the GPU
+        size_t m_dirtyBegin, m_dirtyEnd; // slots to send again to the GPU
+};
+
+typedef std::shared_ptr<InstancedMeshRenderable> InstancedMeshRenderablePtr;
+
+#endif
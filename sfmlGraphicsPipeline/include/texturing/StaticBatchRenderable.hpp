@@ -0,0 +1,120 @@
+#ifndef STATIC_BATCH_RENDERABLE_HPP
+#define STATIC_BATCH_RENDERABLE_HPP
+
+#include "./../HierarchicalRenderable.hpp"
+#include "./../texturing/TexturedLightedMeshRenderable.hpp"
+#include "./../lighting/Material.hpp"
+
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include <SFML/Graphics/Image.hpp>
+
+class StaticBatchRenderable;
+typedef std::shared_ptr<StaticBatchRenderable> StaticBatchRenderablePtr;
+
+/**@brief Static scenery merged in a few draw calls.
+ *
+ * Scenery that never moves once placed (hills, icebergs, houses, ...) does not
+ * need one draw call, one model matrix and one NIT per object. This renderable
+ * is built once, at scene construction, from textured lighted meshes sharing a
+ * shader program, a material and a texture: their vertices are transformed to
+ * world space and merged into a single vertex/index buffer.
+ *
+ * The triangles are sorted into cubic chunks of a regular grid. Each chunk knows
+ * its bounding box, so that chunks outside the camera frustum are skipped and
+ * neighbouring visible chunks are drawn with a single call.
+ *
+ * The frozen renderables are kept as metadata: pick() returns the original
+ * renderable hit by a ray.
+ *
+ * Use freeze() rather than the constructor, it sorts the renderables into
+ * compatible batches. The frozen renderables should not be added to the viewer.
+ */
+class StaticBatchRenderable : public HierarchicalRenderable
+{
+    public:
+        ~StaticBatchRenderable();
+
+        /**@brief Merge static renderables into batches.
+         *
+         * Renderables are grouped by shader program, material, texture and
+         * wrap option, each group giving one batch. Their current transformations
+         * are baked into the batches: later transformations of the renderables
+         * (or of their parents) have no effect. Their children are not merged.
+         *
+         * @param renderables The static renderables to merge.
+         * @param chunkSize The edge length of the culling chunks, in world units.
+         * @return The batches to add to the viewer.
+         */
+        static std::vector< StaticBatchRenderablePtr > freeze(
+            const std::vector< TexturedLightedMeshRenderablePtr > & renderables,
+            float chunkSize = 30.0f);
+
+        /**@brief Merge renderables known to be compatible into a single batch.
+         *
+         * @param program The shader program of all the renderables.
+         * @param material The material of all the renderables.
+         * @param image The texture of all the renderables.
+         * @param wrapOption The wrap option of all the renderables (see TexturedMeshRenderable::setWrapOption()).
+         * @param renderables The renderables to merge.
+         * @param chunkSize The edge length of the culling chunks, in world units.
+         */
+        StaticBatchRenderable(ShaderProgramPtr program,
+                              const MaterialPtr & material,
+                              const sf::Image & image,
+                              unsigned int wrapOption,
+                              const std::vector< TexturedLightedMeshRenderablePtr > & renderables,
+                              float chunkSize);
+
+        /**@brief Find the frozen renderable hit first by a ray.
+         *
+         * @param origin The origin of the ray, in world space.
+         * @param direction The direction of the ray, in world space.
+         * @param distance Set to the distance along the ray (in direction units) of the hit, if any.
+         * @return The renderable hit, nullptr if the ray misses all of them.
+         */
+        TexturedLightedMeshRenderablePtr pick(const glm::vec3 & origin, const glm::vec3 & direction, float & distance) const;
+
+        const std::vector< TexturedLightedMeshRenderablePtr > & getSources() const;
+        size_t chunkCount() const;
+        /**@brief Number of draw calls issued by the last draw, after culling. */
+        size_t lastDrawCallCount() const;
+        void setCulling(bool culling);
+
+    protected:
+        void do_draw();
+
+    private:
+        struct Chunk
+        {
+            unsigned int firstIndex;
+            unsigned int indexCount;
+            glm::vec3 aabbMin, aabbMax;
+        };
+
+        void gen_buffers();
+        void update_buffers();
+        void update_texture(unsigned int wrapOption);
+
+        std::vector< glm::vec3 > m_positions;
+        std::vector< glm::vec3 > m_normals;
+        std::vector< glm::vec2 > m_tcoords;
+        std::vector< unsigned int > m_indices;
+        std::vector< unsigned int > m_triangleSources; // index of the source of each triangle
+        std::vector< Chunk > m_chunks;
+        std::vector< TexturedLightedMeshRenderablePtr > m_sources;
+
+        MaterialPtr m_material;
+        sf::Image m_image;
+        bool m_culling;
+        size_t m_lastDrawCallCount;
+
+        unsigned int m_pBuffer;
+        unsigned int m_nBuffer;
+        unsigned int m_tBuffer;
+        unsigned int m_iBuffer;
+        unsigned int m_texId;
+};
+
+#endif
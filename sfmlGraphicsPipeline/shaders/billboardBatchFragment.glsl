@@ -0,0 +1,18 @@
+#version 400
+
+uniform sampler2DArray texSampler;
+
+in vec3 surfel_texCoord;
+in vec4 surfel_color;
+
+// Resulting color of the fragment shader
+out vec4 outColor;
+
+void main()
+{
+    // Billboards are not lighted: the tint gives their final color
+    outColor = surfel_color * texture(texSampler, surfel_texCoord);
+
+    if(outColor.a < 0.5)
+      discard;
+}
@@ -0,0 +1,30 @@
+#version 400
+//uniforms
+uniform mat4 projMat, viewMat, modelMat;
+
+//attributes
+in vec2 vPosition; // corner of the shared quad, in [-0.5,0.5]^2
+
+// Per-billboard attributes (glVertexAttribDivisor set to 1)
+in vec3 instancePosition;
+in vec2 instanceSize;
+in float instanceLayer;
+in vec4 instanceTint;
+
+// All coordinates are in camera space
+out vec3 surfel_texCoord; // the third coordinate is the layer of the texture array
+out vec4 surfel_color;
+
+void main()
+{
+  // The quad is expanded in camera space, so that it always faces the camera
+  vec3 surfel_position =
+    vec3( viewMat * modelMat * vec4( instancePosition, 1.0 ) ) +
+    vec3( instanceSize * vPosition, 0 );
+
+  surfel_color = instanceTint;
+  surfel_texCoord = vec3( vec2(0.5,0.5) + vPosition, instanceLayer );
+
+  // Define the fragment position on the screen
+  gl_Position = projMat*vec4(surfel_position, 1.0 );
+}
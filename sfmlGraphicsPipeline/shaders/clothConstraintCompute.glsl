@@ -0,0 +1,84 @@
+#version 430
+
+// Constraint pass of a GPUClothRenderable substep, in XPBD mode: one Jacobi
+// iteration over the distance constraints between neighbors. Each particle
+// gathers the corrections of its own constraints, so that no two invocations
+// write the same particle. The Lagrange multiplier of a constraint is stored by
+// its first particle (the one the neighbor offset starts from), in the 6 slots
+// of this particle; both particles compute the same update from the input
+// buffers, and only the first one writes it.
+
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) readonly buffer PositionsIn { vec4 positionsIn[]; }; // xyz: position, w: inverse mass
+layout(std430, binding = 1) writeonly buffer PositionsOut { vec4 positionsOut[]; };
+layout(std430, binding = 2) readonly buffer Previous { vec4 previous[]; };
+layout(std430, binding = 5) readonly buffer LambdasIn { float lambdasIn[]; };
+layout(std430, binding = 6) writeonly buffer LambdasOut { float lambdasOut[]; };
+
+uniform uint particleCount;
+uniform ivec2 resolution;
+uniform vec2 spacing;
+uniform float dt;
+uniform float compliance;
+uniform float damping;
+uniform float bendingCompliance;
+uniform float relaxation; // scale of the Jacobi updates, below 1 to converge
+
+const int NEIGHBOR_COUNT = 12;
+const ivec2 neighbors[NEIGHBOR_COUNT] = ivec2[](
+    ivec2(1, 0), ivec2(0, 1), ivec2(1, 1), ivec2(1, -1), ivec2(2, 0), ivec2(0, 2),
+    ivec2(-1, 0), ivec2(0, -1), ivec2(-1, -1), ivec2(-1, 1), ivec2(-2, 0), ivec2(0, -2));
+
+void main()
+{
+    uint p = gl_GlobalInvocationID.x;
+    if (p >= particleCount)
+        return;
+
+    vec4 x = positionsIn[p];
+    float w = x.w;
+    ivec2 ij = ivec2(int(p) / resolution.y, int(p) % resolution.y);
+    vec3 correction = vec3(0.0);
+
+    for (int k = 0; k < NEIGHBOR_COUNT; ++k)
+    {
+        bool forward = k < 6;
+        ivec2 n = ij + neighbors[k];
+        bool valid = all(greaterThanEqual(n, ivec2(0))) && all(lessThan(n, resolution));
+        uint q = valid ? uint(n.x * resolution.y + n.y) : p;
+        uint lambdaSlot = forward ? 6*p + k : 6*q + (k - 6);
+        if (!valid)
+        {
+            if (forward)
+                lambdasOut[lambdaSlot] = 0.0;
+            continue;
+        }
+
+        vec4 y = positionsIn[q];
+        float lambda = lambdasIn[lambdaSlot];
+        float wSum = w + y.w;
+        vec3 d = x.xyz - y.xyz;
+        float len = length(d);
+        if (wSum == 0.0 || len <= 1e-7)
+        {
+            if (forward)
+                lambdasOut[lambdaSlot] = lambda;
+            continue;
+        }
+        vec3 dir = d / len;
+
+        bool bending = (k % 6) >= 4;
+        float rest = length(vec2(neighbors[k]) * spacing);
+        float alpha = (bending ? bendingCompliance : compliance) / (dt * dt);
+        float gamma = bending ? 0.0 : compliance * damping / dt;
+        float speed = dot(dir, (x.xyz - previous[p].xyz) - (y.xyz - previous[q].xyz));
+
+        float dLambda = relaxation * (-(len - rest) - alpha * lambda - gamma * speed) / ((1.0 + gamma) * wSum + alpha);
+        correction += w * dLambda * dir;
+        if (forward)
+            lambdasOut[lambdaSlot] = lambda + dLambda;
+    }
+
+    positionsOut[p] = vec4(x.xyz + correction, w);
+}
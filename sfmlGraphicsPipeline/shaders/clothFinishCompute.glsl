@@ -0,0 +1,41 @@
+#version 430
+
+// Last pass of a GPUClothRenderable substep: deduce the velocities from the
+// displacements, and compute the normals of the vertices from the positions of
+// their neighbors on the grid.
+
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) readonly buffer Positions { vec4 positions[]; }; // xyz: position, w: inverse mass
+layout(std430, binding = 2) readonly buffer Previous { vec4 previous[]; };
+layout(std430, binding = 3) writeonly buffer Velocities { vec4 velocities[]; };
+layout(std430, binding = 4) writeonly buffer Normals { vec4 normals[]; };
+
+uniform uint particleCount;
+uniform ivec2 resolution;
+uniform float dt;
+
+vec3 position(int i, int j)
+{
+    i = clamp(i, 0, resolution.x - 1);
+    j = clamp(j, 0, resolution.y - 1);
+    return positions[i * resolution.y + j].xyz;
+}
+
+void main()
+{
+    uint p = gl_GlobalInvocationID.x;
+    if (p >= particleCount)
+        return;
+
+    vec4 x = positions[p];
+    velocities[p] = vec4(x.w == 0.0 ? vec3(0.0) : (x.xyz - previous[p].xyz) / dt, 0.0);
+
+    // Central differences along the width and the height, one-sided on the borders
+    int i = int(p) / resolution.y, j = int(p) % resolution.y;
+    vec3 du = position(i + 1, j) - position(i - 1, j);
+    vec3 dv = position(i, j + 1) - position(i, j - 1);
+    vec3 n = cross(du, dv);
+    float len = length(n);
+    normals[p] = vec4(len > 0.0 ? n / len : vec3(0.0, 0.0, 1.0), 0.0);
+}
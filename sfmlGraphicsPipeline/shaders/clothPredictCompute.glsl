@@ -0,0 +1,84 @@
+#version 430
+
+// First pass of a GPUClothRenderable substep: integrate the velocities with the
+// external forces (and the spring forces in spring mode), then predict the
+// positions. The velocities are not written here: the finish pass deduces them
+// from the displacements, so that neighbors can read them safely.
+
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) readonly buffer PositionsIn { vec4 positionsIn[]; }; // xyz: position, w: inverse mass
+layout(std430, binding = 1) writeonly buffer PositionsOut { vec4 positionsOut[]; };
+layout(std430, binding = 2) writeonly buffer Previous { vec4 previous[]; };
+layout(std430, binding = 3) readonly buffer Velocities { vec4 velocities[]; };
+layout(std430, binding = 5) writeonly buffer LambdasIn { float lambdasIn[]; };
+layout(std430, binding = 6) writeonly buffer LambdasOut { float lambdasOut[]; };
+
+uniform uint particleCount;
+uniform ivec2 resolution; // particles along the width and the height
+uniform vec2 spacing; // rest distance between neighbors along the width and the height
+uniform float dt;
+uniform vec3 gravity; // acceleration
+uniform vec3 wind; // force
+uniform float airDamping;
+uniform bool springForces;
+uniform float stiffness;
+uniform float damping;
+uniform float bendingStiffness;
+
+// Neighbors of a particle: the 8 closest ones (stretch and shear), and the
+// ones two particles away along the width and the height (bending)
+const int NEIGHBOR_COUNT = 12;
+const ivec2 neighbors[NEIGHBOR_COUNT] = ivec2[](
+    ivec2(1, 0), ivec2(0, 1), ivec2(1, 1), ivec2(1, -1), ivec2(2, 0), ivec2(0, 2),
+    ivec2(-1, 0), ivec2(0, -1), ivec2(-1, -1), ivec2(-1, 1), ivec2(-2, 0), ivec2(0, -2));
+
+void main()
+{
+    uint p = gl_GlobalInvocationID.x;
+    if (p >= particleCount)
+        return;
+
+    // Lagrange multipliers of the constraints of this particle start at zero
+    for (int k = 0; k < 6; ++k)
+    {
+        lambdasIn[6*p + k] = 0.0;
+        lambdasOut[6*p + k] = 0.0;
+    }
+
+    vec4 x = positionsIn[p];
+    previous[p] = x;
+    float w = x.w;
+    if (w == 0.0)
+    {
+        positionsOut[p] = x;
+        return;
+    }
+
+    vec3 v = velocities[p].xyz;
+    vec3 force = wind - airDamping * v;
+    if (springForces)
+    {
+        ivec2 ij = ivec2(int(p) / resolution.y, int(p) % resolution.y);
+        for (int k = 0; k < NEIGHBOR_COUNT; ++k)
+        {
+            ivec2 n = ij + neighbors[k];
+            if (any(lessThan(n, ivec2(0))) || any(greaterThanEqual(n, resolution)))
+                continue;
+            uint q = uint(n.x * resolution.y + n.y);
+            vec3 d = x.xyz - positionsIn[q].xyz;
+            float len = length(d);
+            if (len <= 1e-7)
+                continue;
+            vec3 dir = d / len;
+            bool bending = (k % 6) >= 4;
+            float rest = length(vec2(neighbors[k]) * spacing);
+            float k_s = bending ? bendingStiffness : stiffness;
+            float k_d = bending ? 0.0 : damping;
+            force += (-k_s * (len - rest) - k_d * dot(v - velocities[q].xyz, dir)) * dir;
+        }
+    }
+
+    v += dt * (gravity + w * force);
+    positionsOut[p] = vec4(x.xyz + dt * v, w);
+}
@@ -0,0 +1,17 @@
+#version 400
+
+uniform sampler2D texSampler;
+
+in vec3 surfel_normal;
+in vec2 surfel_texCoord;
+
+// Color and normal atlases of the impostor
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outNormal;
+
+void main()
+{
+    outColor = vec4(texture(texSampler, surfel_texCoord).rgb, 1.0);
+    // Remap the normal from [-1,1] to [0,1], alpha marks covered pixels
+    outNormal = vec4(0.5*normalize(surfel_normal)+0.5, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 400
+
+uniform mat4 projMat, viewMat;
+
+// Attributes, in object space
+in vec3 vPosition;
+in vec3 vNormal;
+in vec2 vTexCoord;
+
+out vec3 surfel_normal;
+out vec2 surfel_texCoord;
+
+void main()
+{
+    // The normal is kept in object space, the impostor shader rotates it
+    surfel_normal = vNormal;
+    surfel_texCoord = vTexCoord;
+    gl_Position = projMat*viewMat*vec4(vPosition,1.0f);
+}
@@ -0,0 +1,86 @@
+#version 400
+
+struct Material
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+struct DirectionalLight
+{
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform Material material;
+
+#define MAX_NR_DIRECTIONAL_LIGHTS 10
+uniform int numberOfDirectionalLight = 0;
+uniform DirectionalLight directionalLight[MAX_NR_DIRECTIONAL_LIGHTS];
+
+// Atlases baked by ImpostorRenderable
+uniform sampler2D colorSampler;
+uniform sampler2D normalSampler;
+uniform float viewsPerSide;
+
+in vec2 view_coords[4];
+flat in vec2 view_cells[4];
+flat in vec4 view_weights;
+flat in mat3 normalMatrix;
+
+in vec3 surfel_position;
+in vec3 cameraPosition;
+
+out vec4 outColor;
+
+//Phong illumination model for a directional light
+vec3 computeDirectionalLight(DirectionalLight light, vec3 surfel_normal, vec3 surfel_to_camera)
+{
+    vec3 surfel_to_light = -light.direction;
+
+    // Diffuse shading
+    float diffuse_factor = max(dot(surfel_normal, surfel_to_light), 0.0);
+
+    // Specular shading
+    vec3 reflect_direction = reflect(-surfel_to_light, surfel_normal);
+    float specular_dot = clamp(dot(surfel_to_camera, reflect_direction), 0, 1);
+    float specular_factor = pow(specular_dot, material.shininess);
+
+    // Combine results
+    vec3 ambient  =                   light.ambient  * material.ambient ;
+    vec3 diffuse  = diffuse_factor  * light.diffuse  * material.diffuse ;
+    vec3 specular = specular_factor * light.specular * material.specular;
+
+    return (ambient + diffuse + specular);
+}
+
+void main()
+{
+    vec4 color = vec4(0.0);
+    vec3 normal = vec3(0.0);
+    for (int k = 0; k < 4; ++k)
+    {
+        vec2 uv = (view_cells[k] + clamp(view_coords[k] * 0.5 + 0.5, 0.0, 1.0)) / viewsPerSide;
+        vec4 c = texture(colorSampler, uv);
+        vec4 n = texture(normalSampler, uv);
+        color += view_weights[k] * vec4(c.rgb * c.a, c.a);
+        normal += view_weights[k] * n.a * (n.rgb * 2.0 - 1.0);
+    }
+    if (color.a < 0.5)
+        discard;
+
+    vec3 surfel_normal = normalize(normalMatrix * normal);
+    vec3 surfel_to_camera = normalize(cameraPosition - surfel_position);
+
+    int clampedNumberOfDirectionalLight = max(0, min(numberOfDirectionalLight, MAX_NR_DIRECTIONAL_LIGHTS));
+    vec3 tmpColor = vec3(0.0, 0.0, 0.0);
+    for(int i=0; i<clampedNumberOfDirectionalLight; ++i)
+        tmpColor += computeDirectionalLight(directionalLight[i], surfel_normal, surfel_to_camera);
+
+    outColor = vec4(color.rgb / color.a * tmpColor, 1.0);
+}
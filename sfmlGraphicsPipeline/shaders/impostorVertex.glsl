@@ -0,0 +1,94 @@
+#version 400
+
+uniform mat4 projMat, viewMat, modelMat;
+
+// Number of views per side of the atlases
+uniform float viewsPerSide;
+
+// Corner of the quad, in [-1,1]^2
+in vec2 vPosition;
+
+// Per-instance attributes (glVertexAttribDivisor set to 1).
+// The bounding sphere is in world space, the rotation goes from world to object space.
+in vec4 instanceSphere;
+in mat3 instanceRotation;
+
+// Coordinates of the quad corner in the 4 nearest baked views, in [-1,1]^2
+out vec2 view_coords[4];
+// Atlas cells of the 4 nearest views and their blending weights
+flat out vec2 view_cells[4];
+flat out vec4 view_weights;
+// Object to world transform of the normals
+flat out mat3 normalMatrix;
+
+out vec3 surfel_position;
+out vec3 cameraPosition;
+
+// Octahedral mapping between a direction and [-1,1]^2, the upper hemisphere (y > 0)
+// being the inner diamond. Must match oct_decode() in ImpostorRenderable.cpp.
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 octEncode(vec3 v)
+{
+    v /= abs(v.x) + abs(v.y) + abs(v.z);
+    vec2 o = v.xz;
+    if (v.y < 0.0)
+        o = (1.0 - abs(o.yx)) * signNotZero(o);
+    return o;
+}
+
+vec3 octDecode(vec2 o)
+{
+    vec3 v = vec3(o.x, 1.0 - abs(o.x) - abs(o.y), o.y);
+    if (v.y < 0.0)
+        v.xz = (1.0 - abs(v.zx)) * signNotZero(v.xz);
+    return normalize(v);
+}
+
+// Basis of the view looking at the object from the direction dir
+void viewBasis(vec3 dir, out vec3 right, out vec3 up)
+{
+    vec3 up0 = abs(dir.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    right = normalize(cross(up0, dir));
+    up = cross(dir, right);
+}
+
+void main()
+{
+    mat3 toObject = instanceRotation * inverse(mat3(modelMat));
+    mat3 toWorld = inverse(toObject);
+    normalMatrix = transpose(toObject);
+
+    // Compute the position of the camera in world space
+    cameraPosition = - vec3( viewMat[3] ) * mat3( viewMat );
+
+    vec3 center = vec3(modelMat * vec4(instanceSphere.xyz, 1.0));
+    vec3 dir = normalize(toObject * (cameraPosition - center));
+
+    // The quad faces the camera
+    vec3 right, up;
+    viewBasis(dir, right, up);
+    vec3 local = vPosition.x * right + vPosition.y * up;
+    surfel_position = center + instanceSphere.w * normalize(toWorld * right) * vPosition.x
+                             + instanceSphere.w * normalize(toWorld * up) * vPosition.y;
+
+    // Bilinear blending of the 4 cells around the view direction
+    vec2 grid = (octEncode(dir) * 0.5 + 0.5) * viewsPerSide - 0.5;
+    vec2 base = floor(grid);
+    vec2 f = grid - base;
+    view_weights = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    vec2 offsets[4] = vec2[4](vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(1, 1));
+    for (int k = 0; k < 4; ++k)
+    {
+        vec2 cell = clamp(base + offsets[k], vec2(0.0), vec2(viewsPerSide - 1.0));
+        vec3 viewRight, viewUp;
+        viewBasis(octDecode((cell + 0.5) / viewsPerSide * 2.0 - 1.0), viewRight, viewUp);
+        view_cells[k] = cell;
+        view_coords[k] = vec2(dot(local, viewRight), dot(local, viewUp));
+    }
+
+    gl_Position = projMat*viewMat*vec4(surfel_position,1.0f);
+}
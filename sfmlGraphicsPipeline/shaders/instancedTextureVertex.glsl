@@ -0,0 +1,41 @@
+#version 400
+
+uniform mat4 projMat, viewMat, modelMat;
+
+// Normal inverse transpose matrix of modelMat, shared by all instances.
+uniform mat3 NIT = mat3(1.0);
+
+// Attributes
+in vec2 vTexCoord;
+in vec3 vPosition;
+in vec4 vColor;
+in vec3 vNormal;
+
+// Per-instance attributes (glVertexAttribDivisor set to 1).
+// The normal inverse transpose matrix of each instance is computed on the CPU.
+in mat4 instanceModel;
+in mat3 instanceNIT;
+in vec4 instanceColor;
+
+// Surfel: a SURFace ELement. All coordinates are in world space
+out vec2 surfel_texCoord;
+out vec3 surfel_position;
+out vec3 surfel_normal;
+out vec4 surfel_color;
+
+out vec3 cameraPosition;
+
+void main()
+{
+    // All attributes are in world space
+    surfel_position = vec3(modelMat*instanceModel*vec4(vPosition,1.0f));
+    surfel_normal = normalize( NIT * instanceNIT * vNormal);
+    surfel_color  = instanceColor;
+    surfel_texCoord = vTexCoord;
+
+    // Compute the position of the camera in world space
+    cameraPosition = - vec3( viewMat[3] ) * mat3( viewMat );
+
+    // Define the fragment position on the screen
+    gl_Position = projMat*viewMat*vec4(surfel_position,1.0f);
+}
@@ -0,0 +1,19 @@
+#version 400
+
+uniform vec4 snowColor;
+
+in float surfel_fade;
+
+out vec4 outColor;
+
+void main()
+{
+    // Round flakes: discard the corners of the point sprite
+    vec2 p = 2.0 * gl_PointCoord - 1.0;
+    float r2 = dot(p, p);
+    if (r2 > 1.0 || surfel_fade <= 0.0)
+        discard;
+
+    // Brighter in the center
+    outColor = vec4(snowColor.rgb * (1.0 - 0.3 * r2) * mix(0.6, 1.0, surfel_fade), snowColor.a);
+}
@@ -0,0 +1,87 @@
+#version 400
+
+// Transform feedback shader of SnowfallRenderable: compute the next state of
+// a flake. There is no fragment stage, outPosition and outParams are captured.
+
+uniform float dt;
+uniform float time;
+uniform uint seed; // changes at each step
+
+uniform vec3 cameraPosition;
+uniform vec3 halfExtent; // half dimensions of the box of snow around the camera
+uniform float groundHeight;
+uniform float fallSpeed;
+uniform vec3 wind;
+uniform float turbulence;
+uniform bool fillVolume; // flakes never emitted appear anywhere in the box
+
+// Current state of the flake
+in vec4 vPosition; // xyz: position, w: age (negative if never emitted)
+in vec4 vParams; // x: speed factor, y: size factor, z: phase, w: lifetime
+
+// Next state of the flake
+out vec4 outPosition;
+out vec4 outParams;
+
+// Integer hash (PCG), to draw random numbers without any state
+uint pcg(uint v)
+{
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Random number in [0,1[
+float random(inout uint state)
+{
+    state = pcg(state);
+    return float(state) / 4294967296.0;
+}
+
+vec3 emit(bool anywhere)
+{
+    uint state = pcg(uint(gl_VertexID) ^ pcg(seed));
+    vec3 p = cameraPosition + halfExtent * (2.0 * vec3(random(state), random(state), random(state)) - 1.0);
+    if (!anywhere)
+        p.y = cameraPosition.y + halfExtent.y * (1.0 - 0.05 * random(state));
+    p.y = max(p.y, groundHeight);
+    return p;
+}
+
+void main()
+{
+    vec3 position = vPosition.xyz;
+    float age = vPosition.w;
+    outParams = vParams;
+
+    // Emission of a flake never emitted
+    if (age < 0.0)
+    {
+        outPosition = vec4(emit(fillVolume), 0.0);
+        return;
+    }
+
+    // Integration: the flakes fall at their terminal speed, there is no acceleration
+    vec3 swirl = vec3(sin(1.3 * time + vParams.z + 0.5 * position.y),
+                      0.3 * sin(2.1 * time + 2.0 * vParams.z),
+                      cos(1.7 * time + vParams.z + 0.5 * position.x));
+    vec3 velocity = vec3(0.0, -fallSpeed * vParams.x, 0.0) + wind + turbulence * swirl;
+    position += dt * velocity;
+    age += dt;
+
+    // Camera relative wrapping: the box of snow follows the camera
+    vec3 local = position - cameraPosition;
+    local.xz = mod(local.xz + halfExtent.xz, 2.0 * halfExtent.xz) - halfExtent.xz;
+    if (local.y > halfExtent.y)
+        local.y -= 2.0 * halfExtent.y;
+    position = cameraPosition + local;
+
+    // Killing: the flake is emitted again at the top of the box
+    if (age > vParams.w || position.y < groundHeight || local.y < -halfExtent.y)
+    {
+        position = emit(false);
+        age = 0.0;
+    }
+
+    outPosition = vec4(position, age);
+}
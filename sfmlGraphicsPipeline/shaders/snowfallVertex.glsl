@@ -0,0 +1,28 @@
+#version 400
+
+uniform mat4 projMat, viewMat;
+
+uniform float pointScale; // size in pixels of one world unit at unit distance
+uniform float flakeSize; // diameter of the flakes, in world units
+
+// State of the flake, written by snowfallUpdateVertex.glsl
+in vec4 vPosition; // xyz: position, w: age (negative if never emitted)
+in vec4 vParams; // x: speed factor, y: size factor, z: phase, w: lifetime
+
+out float surfel_fade;
+
+void main()
+{
+    vec4 position = viewMat * vec4(vPosition.xyz, 1.0);
+    gl_Position = projMat * position;
+
+    // Flakes not emitted yet are discarded by the clipping
+    if (vPosition.w < 0.0)
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+
+    // Perspective size of the point sprite, at least one pixel
+    gl_PointSize = max(1.0, pointScale * flakeSize * vParams.y / max(-position.z, 1e-3));
+
+    // Flakes appear and disappear smoothly with their age
+    surfel_fade = clamp(vPosition.w, 0.0, 1.0) * clamp(vParams.w - vPosition.w, 0.0, 1.0);
+}
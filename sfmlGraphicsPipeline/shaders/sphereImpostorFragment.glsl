@@ -0,0 +1,37 @@
+#version 400
+
+uniform mat4 projMat;
+
+in vec3 surfel_position;
+flat in vec3 sphere_center;
+flat in float sphere_radius;
+flat in mat3 normalToModel;
+
+out vec4 fragmentColor;
+
+// Same color map as getColor() in Utils.cpp, from blue (-1) to red (1)
+vec3 getColor(float factor)
+{
+    float hue = 240.0 * (1.0 - clamp(0.5 * (factor + 1.0), 0.0, 1.0)) / 60.0;
+    vec3 rgb = clamp(abs(mod(hue + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);
+    return rgb;
+}
+
+void main()
+{
+    // Intersection of the view ray with the sphere, the camera being the origin
+    vec3 ray = normalize(surfel_position);
+    float b = dot(ray, sphere_center);
+    float h = b * b - dot(sphere_center, sphere_center) + sphere_radius * sphere_radius;
+    if (h < 0.0)
+        discard;
+    vec3 hit = (b - sqrt(h)) * ray;
+    vec3 normal = (hit - sphere_center) / sphere_radius;
+
+    // Depth of the sphere surface, instead of the depth of the quad
+    vec4 clip = projMat * vec4(hit, 1.0);
+    gl_FragDepth = 0.5 * (gl_DepthRange.diff * clip.z / clip.w + gl_DepthRange.near + gl_DepthRange.far);
+
+    // Vertices of the tessellated sphere are colored by their x coordinate
+    fragmentColor = vec4(getColor(normalize(normalToModel * normal).x), 1.0);
+}
@@ -0,0 +1,35 @@
+#version 400
+
+uniform mat4 projMat, viewMat, modelMat;
+
+in vec2 vPosition; // corner of the quad, in [-1,1]^2
+in vec4 instanceData; // center and radius of the sphere
+
+// All coordinates are in camera space
+out vec3 surfel_position; // point of the quad
+flat out vec3 sphere_center;
+flat out float sphere_radius;
+// Camera to model space rotation, to color the sphere as the tessellated one
+flat out mat3 normalToModel;
+
+void main()
+{
+    mat4 modelView = viewMat * modelMat;
+    sphere_center = vec3(modelView * vec4(instanceData.xyz, 1.0));
+    sphere_radius = instanceData.w * length(vec3(modelView[0]));
+    normalToModel = inverse(mat3(modelView)) * length(vec3(modelView[0]));
+
+    // The quad is orthogonal to the ray from the camera to the center. Its
+    // size is the section of the cone tangent to the sphere, so that the
+    // quad covers exactly the sphere on the screen.
+    float distance = length(sphere_center);
+    vec3 dir = - sphere_center / distance;
+    vec3 up0 = abs(dir.y) > 0.999 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(up0, dir));
+    vec3 up = cross(dir, right);
+    // The camera is inside the sphere: nothing is drawn
+    float size = distance > sphere_radius ? sphere_radius * distance / sqrt(distance * distance - sphere_radius * sphere_radius) : 0.0;
+
+    surfel_position = sphere_center + size * (vPosition.x * right + vPosition.y * up);
+    gl_Position = projMat * vec4(surfel_position, 1.0);
+}
@@ -178,5 +178,6 @@ void main()
         tmpColor += computeSpotLight(spotLight[i], surfel_to_camera);
 
     vec4 textureColor = texture(texSampler, surfel_texCoord);
-    outColor = textureColor*vec4(tmpColor,1.0);
+    // surfel_color is the tint of the vertex or of the instance, white by default
+    outColor = surfel_color*textureColor*vec4(tmpColor,1.0);
 }
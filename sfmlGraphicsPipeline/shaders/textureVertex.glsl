@@ -11,7 +11,7 @@ uniform mat3 NIT = mat3(1.0);
 // Attributes
 in vec2 vTexCoord;
 in vec3 vPosition;
-in vec4 vColor;   // Currently not used. You can use it to replace or combine with the diffuse component of the material
+in vec4 vColor;   // Tint multiplied with the texture color, white to keep the texture as is
 in vec3 vNormal;
 
 // Surfel: a SURFace ELement. All coordinates are in world space
@@ -0,0 +1,143 @@
+#include "./../include/DynamicBuffer.hpp"
+#include "./../include/gl_helper.hpp"
+#include "./../include/log.hpp"
+
+#include <algorithm>
+
+static const GLbitfield persistent_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+DynamicBuffer::DynamicBuffer(size_t frameSize, unsigned int frameCount) :
+    m_buffer(0), m_mapped(nullptr),
+    m_persistent(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage),
+    m_frameSize(0), m_frameCount(std::max(frameCount, 1u)), m_frame(0), m_head(0)
+{
+    create(frameSize);
+    LOG(info, "dynamic buffer of " << m_frameCount << "x" << m_frameSize << " bytes"
+        << (m_persistent ? ", persistently mapped" : ", without buffer storage"));
+}
+
+DynamicBuffer::~DynamicBuffer()
+{
+    destroy();
+}
+
+void DynamicBuffer::create(size_t frameSize)
+{
+    m_frameSize = frameSize;
+    m_fences.assign(m_frameCount, nullptr);
+    size_t size = m_frameSize * m_frameCount;
+
+    glcheck(glGenBuffers(1, &m_buffer));
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_buffer));
+    if (m_persistent)
+    {
+        glcheck(glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, persistent_flags));
+        glcheck(m_mapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, persistent_flags)));
+    }
+    else
+    {
+        glcheck(glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW));
+        m_staging.resize(size);
+        m_mapped = m_staging.data();
+    }
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void DynamicBuffer::destroy()
+{
+    for (GLsync & fence : m_fences)
+    {
+        if (fence)
+        {
+            glcheck(glDeleteSync(fence));
+        }
+        fence = nullptr;
+    }
+    if (m_persistent && m_mapped)
+    {
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_buffer));
+        glcheck(glUnmapBuffer(GL_ARRAY_BUFFER));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    }
+    glcheck(glDeleteBuffers(1, &m_buffer));
+    m_buffer = 0;
+    m_mapped = nullptr;
+}
+
+void DynamicBuffer::wait(GLsync fence)
+{
+    GLenum status = GL_TIMEOUT_EXPIRED;
+    while (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED && status != GL_WAIT_FAILED)
+    {
+        glcheck(status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000));
+    }
+    if (status == GL_WAIT_FAILED)
+    {
+        LOG(error, "failed to wait for a frame of the dynamic buffer");
+    }
+}
+
+void DynamicBuffer::beginFrame()
+{
+    GLsync & fence = m_fences[m_frame];
+    if (fence)
+    {
+        wait(fence);
+        glcheck(glDeleteSync(fence));
+        fence = nullptr;
+    }
+    m_head = m_frame * m_frameSize;
+}
+
+void DynamicBuffer::endFrame()
+{
+    glcheck(m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    m_frame = (m_frame + 1) % m_frameCount;
+}
+
+DynamicBuffer::Allocation DynamicBuffer::allocate(size_t size, size_t alignment)
+{
+    size_t offset = (m_head + alignment - 1) / alignment * alignment;
+    if (offset + size > (m_frame + 1) * m_frameSize)
+    {
+        // The frame needs more memory: wait for all frames and start again
+        // with a bigger buffer. Draw calls already issued keep the old one.
+        size_t used = offset - m_frame * m_frameSize;
+        LOG(warning, "dynamic buffer frame of " << m_frameSize << " bytes is full, it grows");
+        for (GLsync fence : m_fences)
+        {
+            if (fence)
+                wait(fence);
+        }
+        destroy();
+        create(std::max(2 * m_frameSize, 2 * (used + size + alignment)));
+        m_frame = 0;
+        offset = 0;
+    }
+    m_head = offset + size;
+
+    Allocation allocation;
+    allocation.data = m_mapped + offset;
+    allocation.offset = offset;
+    allocation.size = size;
+    return allocation;
+}
+
+void DynamicBuffer::flush(const Allocation& allocation)
+{
+    if (m_persistent || allocation.size == 0)
+        return;
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_buffer));
+    glcheck(glBufferSubData(GL_ARRAY_BUFFER, allocation.offset, allocation.size, m_mapped + allocation.offset));
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+unsigned int DynamicBuffer::bufferId() const
+{
+    return m_buffer;
+}
+
+bool DynamicBuffer::isPersistent() const
+{
+    return m_persistent;
+}
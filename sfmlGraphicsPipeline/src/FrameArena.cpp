@@ -0,0 +1,148 @@
+#include "./../include/FrameArena.hpp"
+#include "./../include/log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+// Registry of the arenas of all threads, for resetAll()
+static std::mutex g_arenasMutex;
+static std::vector< FrameArena* > g_arenas;
+
+namespace
+{
+// Register the arena of a thread for its whole lifetime
+struct ThreadArena
+{
+    FrameArena arena;
+
+    ThreadArena()
+    {
+        std::lock_guard< std::mutex > lock(g_arenasMutex);
+        g_arenas.push_back(&arena);
+    }
+
+    ~ThreadArena()
+    {
+        std::lock_guard< std::mutex > lock(g_arenasMutex);
+        g_arenas.erase(std::remove(g_arenas.begin(), g_arenas.end(), &arena), g_arenas.end());
+    }
+};
+}
+
+FrameArena::FrameArena(size_t capacity) :
+    m_offset(0), m_used(0)
+{
+    add_chunk(std::max(capacity, size_t(64)));
+}
+
+FrameArena::~FrameArena()
+{
+    for (Chunk & chunk : m_chunks)
+        std::free(chunk.data);
+}
+
+void FrameArena::add_chunk(size_t size)
+{
+    Chunk chunk;
+    chunk.data = static_cast<char*>(std::malloc(size));
+    chunk.size = size;
+    if (!chunk.data)
+    {
+        LOG(fatal, "frame arena failed to allocate " << size << " bytes");
+        throw std::bad_alloc();
+    }
+    m_chunks.push_back(chunk);
+    m_offset = 0;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    Chunk & chunk = m_chunks.back();
+    size_t offset = (reinterpret_cast<size_t>(chunk.data) + m_offset + alignment - 1) / alignment * alignment
+        - reinterpret_cast<size_t>(chunk.data);
+    if (offset + size > chunk.size)
+    {
+        // Keep the previous chunks: their blocks are still in use
+        add_chunk(std::max(2 * chunk.size, size + alignment));
+        return allocate(size, alignment);
+    }
+    m_used += offset + size - m_offset;
+    m_offset = offset + size;
+    return m_chunks.back().data + offset;
+}
+
+void FrameArena::reset()
+{
+    if (m_chunks.size() > 1)
+    {
+        // Replace all the chunks by a single one, large enough for this frame
+        size_t size = capacity();
+        for (Chunk & chunk : m_chunks)
+            std::free(chunk.data);
+        m_chunks.clear();
+        add_chunk(size);
+    }
+    m_offset = 0;
+    m_used = 0;
+}
+
+size_t FrameArena::used() const
+{
+    return m_used;
+}
+
+size_t FrameArena::capacity() const
+{
+    size_t size = 0;
+    for (const Chunk & chunk : m_chunks)
+        size += chunk.size;
+    return size;
+}
+
+FrameArena& FrameArena::local()
+{
+    static thread_local ThreadArena threadArena;
+    return threadArena.arena;
+}
+
+void FrameArena::resetAll()
+{
+    std::lock_guard< std::mutex > lock(g_arenasMutex);
+    for (FrameArena* arena : g_arenas)
+        arena->reset();
+}
+
+#ifdef COUNT_ALLOCATIONS
+static std::atomic< size_t > g_heapAllocations(0);
+
+size_t heapAllocationCount()
+{
+    return g_heapAllocations.load();
+}
+
+void* operator new(size_t size)
+{
+    ++g_heapAllocations;
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+#endif
@@ -0,0 +1,196 @@
+#include "./../include/MeshNormalUpdater.hpp"
+#include "./../include/log.hpp"
+
+#include <algorithm>
+
+MeshNormalUpdater::MeshNormalUpdater(const std::vector<unsigned int>& indices, size_t vertexCount) :
+    m_allDirty(true), m_stamp(0), m_first(0), m_last(0)
+{
+    size_t indexCount = indices.empty() ? vertexCount : indices.size();
+    if (indexCount % 3 != 0)
+        LOG(warning, "the mesh has " << indexCount << " indices, which is not a multiple of 3: the last ones are ignored");
+
+    m_faces.reserve(indexCount / 3);
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        glm::uvec3 face = indices.empty() ? glm::uvec3(i, i + 1, i + 2) : glm::uvec3(indices[i], indices[i + 1], indices[i + 2]);
+        if (face.x >= vertexCount || face.y >= vertexCount || face.z >= vertexCount)
+        {
+            LOG(warning, "the face " << m_faces.size() << " has an invalid vertex index: it is ignored");
+            continue;
+        }
+        m_faces.push_back(face);
+    }
+
+    // Faces adjacent to each vertex, sorted by vertex with a counting sort
+    m_firstFace.assign(vertexCount + 1, 0);
+    for (const glm::uvec3& face : m_faces)
+        for (int k = 0; k < 3; ++k)
+            ++m_firstFace[face[k] + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        m_firstFace[v + 1] += m_firstFace[v];
+    m_vertexFaces.resize(m_firstFace[vertexCount]);
+    std::vector<unsigned int> next(m_firstFace.begin(), m_firstFace.end() - 1);
+    for (size_t f = 0; f < m_faces.size(); ++f)
+        for (int k = 0; k < 3; ++k)
+            m_vertexFaces[next[m_faces[f][k]]++] = f;
+
+    m_faceNormals.resize(m_faces.size(), glm::vec3(0.0f));
+    m_vertexStamps.resize(vertexCount, 0);
+    m_faceStamps.resize(m_faces.size(), 0);
+}
+
+void MeshNormalUpdater::setDirty(unsigned int vertex)
+{
+    if (vertex < vertexCount())
+        m_dirtyVertices.push_back(vertex);
+}
+
+void MeshNormalUpdater::setDirty(const std::vector<unsigned int>& vertices)
+{
+    for (unsigned int vertex : vertices)
+        setDirty(vertex);
+}
+
+void MeshNormalUpdater::setAllDirty()
+{
+    m_allDirty = true;
+}
+
+bool MeshNormalUpdater::isDirty() const
+{
+    return m_allDirty || !m_dirtyVertices.empty();
+}
+
+size_t MeshNormalUpdater::vertexCount() const
+{
+    return m_firstFace.size() - 1;
+}
+
+size_t MeshNormalUpdater::faceCount() const
+{
+    return m_faces.size();
+}
+
+void MeshNormalUpdater::getUpdatedRange(size_t& first, size_t& last) const
+{
+    first = m_first;
+    last = m_last;
+}
+
+void MeshNormalUpdater::collect_affected()
+{
+    if (++m_stamp == 0)
+    {
+        std::fill(m_vertexStamps.begin(), m_vertexStamps.end(), 0);
+        std::fill(m_faceStamps.begin(), m_faceStamps.end(), 0);
+        m_stamp = 1;
+    }
+
+    // The faces of a moved vertex change, and so do the normals of all their vertices
+    m_affectedFaces.clear();
+    m_affectedVertices.clear();
+    for (unsigned int vertex : m_dirtyVertices)
+    {
+        for (unsigned int i = m_firstFace[vertex]; i < m_firstFace[vertex + 1]; ++i)
+        {
+            unsigned int f = m_vertexFaces[i];
+            if (m_faceStamps[f] == m_stamp)
+                continue;
+            m_faceStamps[f] = m_stamp;
+            m_affectedFaces.push_back(f);
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = m_faces[f][k];
+                if (m_vertexStamps[v] != m_stamp)
+                {
+                    m_vertexStamps[v] = m_stamp;
+                    m_affectedVertices.push_back(v);
+                }
+            }
+        }
+        // A vertex without faces gets a null normal
+        if (m_vertexStamps[vertex] != m_stamp)
+        {
+            m_vertexStamps[vertex] = m_stamp;
+            m_affectedVertices.push_back(vertex);
+        }
+    }
+    // Write the normals in the order of the buffer
+    std::sort(m_affectedVertices.begin(), m_affectedVertices.end());
+}
+
+static inline glm::vec3 vertex_normal(const glm::vec3* faceNormals, const unsigned int* faces, unsigned int begin, unsigned int end)
+{
+    glm::vec3 sum(0.0f);
+    for (unsigned int i = begin; i < end; ++i)
+        sum += faceNormals[faces[i]];
+    float length = glm::length(sum);
+    return length > 0.0f ? sum / length : glm::vec3(0.0f);
+}
+
+size_t MeshNormalUpdater::update(const glm::vec3* positions, glm::vec3* normals)
+{
+    const glm::uvec3* faces = m_faces.data();
+    glm::vec3* faceNormals = m_faceNormals.data();
+    const unsigned int* firstFace = m_firstFace.data();
+    const unsigned int* vertexFaces = m_vertexFaces.data();
+    size_t written = 0;
+
+    if (m_allDirty)
+    {
+        // Contiguous passes over all the faces and vertices
+        const int faceCount = m_faces.size();
+        const int vertices = vertexCount();
+        #pragma omp parallel
+        {
+            #pragma omp for simd schedule(static)
+            for (int f = 0; f < faceCount; ++f)
+            {
+                const glm::vec3 a = positions[faces[f].x];
+                faceNormals[f] = glm::cross(positions[faces[f].y] - a, positions[faces[f].z] - a);
+            }
+            #pragma omp for schedule(static)
+            for (int v = 0; v < vertices; ++v)
+                normals[v] = vertex_normal(faceNormals, vertexFaces, firstFace[v], firstFace[v + 1]);
+        }
+        written = vertices;
+        m_first = 0;
+        m_last = vertices;
+    }
+    else if (!m_dirtyVertices.empty())
+    {
+        collect_affected();
+        const unsigned int* affectedFaces = m_affectedFaces.data();
+        const unsigned int* affectedVertices = m_affectedVertices.data();
+        const int faceCount = m_affectedFaces.size();
+        const int vertices = m_affectedVertices.size();
+        #pragma omp parallel if (vertices > 1024)
+        {
+            #pragma omp for simd schedule(static)
+            for (int i = 0; i < faceCount; ++i)
+            {
+                const glm::uvec3 face = faces[affectedFaces[i]];
+                const glm::vec3 a = positions[face.x];
+                faceNormals[affectedFaces[i]] = glm::cross(positions[face.y] - a, positions[face.z] - a);
+            }
+            #pragma omp for schedule(static)
+            for (int i = 0; i < vertices; ++i)
+            {
+                unsigned int v = affectedVertices[i];
+                normals[v] = vertex_normal(faceNormals, vertexFaces, firstFace[v], firstFace[v + 1]);
+            }
+        }
+        written = vertices;
+        m_first = vertices ? m_affectedVertices.front() : 0;
+        m_last = vertices ? m_affectedVertices.back() + 1 : 0;
+    }
+    else
+    {
+        m_first = m_last = 0;
+    }
+
+    m_allDirty = false;
+    m_dirtyVertices.clear();
+    return written;
+}
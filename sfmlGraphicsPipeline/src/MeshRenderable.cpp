@@ -3,15 +3,25 @@
 #include "./../include/log.hpp"
 #include "./../include/Io.hpp"
 #include "./../include/Utils.hpp"
+#include "./../include/MeshSimplifier.hpp"
+#include "./../include/Viewer.hpp"
 
 
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
 
+// Relative margin around the level of detail thresholds, to avoid popping
+// when the size of a mesh on the screen oscillates around a threshold.
+static const float lod_hysteresis = 0.15f;
+
+unsigned long long MeshRenderable::s_fullTriangles = 0;
+unsigned long long MeshRenderable::s_drawnTriangles = 0;
 
 MeshRenderable::MeshRenderable(ShaderProgramPtr program,
                                const std::string & mesh_filename) :
-    KeyframedHierarchicalRenderable(program),
-    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_mode(GL_TRIANGLES), m_indexed(true)
+    KeyframedHierarchicalRenderable(program), m_mode(GL_TRIANGLES), m_indexed(true),
+    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_instanceCount(1), m_positionBuffer(0), m_positionOffset(0), m_positionStride(0), m_normalBuffer(0), m_normalOffset(0), m_normalStride(0), m_lodBuffer(0), m_lod(0), m_lodThreshold(0.25f)
 {
     // TODO: 
     // use read_obj from Io.hpp to populate m_positions, m_indices, m_normals and m_tcoords
@@ -24,8 +34,8 @@ MeshRenderable::MeshRenderable(ShaderProgramPtr program,
 MeshRenderable::MeshRenderable(ShaderProgramPtr program,
                                const std::string & mesh_filename,
                                const glm::vec4 &colors) :
-    KeyframedHierarchicalRenderable(program),
-    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_mode(GL_TRIANGLES), m_indexed(true)
+    KeyframedHierarchicalRenderable(program), m_mode(GL_TRIANGLES), m_indexed(true),
+    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_instanceCount(1), m_positionBuffer(0), m_positionOffset(0), m_positionStride(0), m_normalBuffer(0), m_normalOffset(0), m_normalStride(0), m_lodBuffer(0), m_lod(0), m_lodThreshold(0.25f)
 {
     // TODO: 
     // use read_obj from Io.hpp to populate m_positions, m_indices, m_normals and m_tcoords
@@ -46,9 +56,9 @@ MeshRenderable::MeshRenderable(ShaderProgramPtr program,
                                const std::vector< unsigned int > & indices, 
                                const std::vector< glm::vec3 > & normals,
                                const std::vector< glm::vec4 > & colors) :
-    KeyframedHierarchicalRenderable(program),
-    m_positions(positions), m_indices(indices), m_normals(normals), m_colors(colors),
-    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_mode(GL_TRIANGLES), m_indexed(true)
+    KeyframedHierarchicalRenderable(program), m_mode(GL_TRIANGLES),
+    m_positions(positions), m_normals(normals), m_colors(colors), m_indices(indices), m_indexed(true),
+    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_instanceCount(1), m_positionBuffer(0), m_positionOffset(0), m_positionStride(0), m_normalBuffer(0), m_normalOffset(0), m_normalStride(0), m_lodBuffer(0), m_lod(0), m_lodThreshold(0.25f)
 {
     set_random_colors();
     gen_buffers();
@@ -59,9 +69,9 @@ MeshRenderable::MeshRenderable(ShaderProgramPtr program,
                                const std::vector< glm::vec3 > & positions,
                                const std::vector< glm::vec3 > & normals,
                                const std::vector< glm::vec4 > & colors) :
-    KeyframedHierarchicalRenderable(program),
-    m_positions(positions), m_normals(normals), m_colors(colors),
-    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_mode(GL_TRIANGLES), m_indexed(false)
+    KeyframedHierarchicalRenderable(program), m_mode(GL_TRIANGLES),
+    m_positions(positions), m_normals(normals), m_colors(colors), m_indexed(false),
+    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_instanceCount(1), m_positionBuffer(0), m_positionOffset(0), m_positionStride(0), m_normalBuffer(0), m_normalOffset(0), m_normalStride(0), m_lodBuffer(0), m_lod(0), m_lodThreshold(0.25f)
 {
     set_random_colors();
     gen_buffers();
@@ -69,8 +79,8 @@ MeshRenderable::MeshRenderable(ShaderProgramPtr program,
 }
 
 MeshRenderable::MeshRenderable(ShaderProgramPtr program, bool indexed) :
-    KeyframedHierarchicalRenderable(program), m_indexed(indexed),
-    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_mode(GL_TRIANGLES)
+    KeyframedHierarchicalRenderable(program), m_mode(GL_TRIANGLES), m_indexed(indexed),
+    m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_instanceCount(1), m_positionBuffer(0), m_positionOffset(0), m_positionStride(0), m_normalBuffer(0), m_normalOffset(0), m_normalStride(0), m_lodBuffer(0), m_lod(0), m_lodThreshold(0.25f)
 {
     gen_buffers();
 }
@@ -114,6 +124,61 @@ void MeshRenderable::update_indices_buffer(){
     glcheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size()*sizeof(unsigned int), m_indices.data(), GL_STATIC_DRAW));
 }
 
+void MeshRenderable::recompute_normals()
+{
+    if (m_normalUpdater)
+        m_normalUpdater->setAllDirty();
+    write_normals();
+}
+
+void MeshRenderable::recompute_normals(const std::vector< unsigned int > & moved_vertices)
+{
+    if (m_normalUpdater)
+        m_normalUpdater->setDirty(moved_vertices);
+    write_normals();
+}
+
+void MeshRenderable::write_normals()
+{
+    if (m_mode != GL_TRIANGLES)
+    {
+        LOG(warning, "normals are only recomputed for triangle meshes");
+        return;
+    }
+    if (!m_normalUpdater)
+        m_normalUpdater = std::make_shared<MeshNormalUpdater>(m_indexed ? m_indices : std::vector< unsigned int >(), m_positions.size());
+
+    // The buffer is reallocated if the mesh had no normals yet
+    if (m_normals.size() != m_positions.size())
+    {
+        m_normals.resize(m_positions.size());
+        m_normalUpdater->setAllDirty();
+        m_normalUpdater->update(m_positions.data(), m_normals.data());
+        update_normals_buffer();
+        return;
+    }
+
+    size_t first, last;
+    if (!m_normalUpdater->update(m_positions.data(), m_normals.data()))
+        return;
+    m_normalUpdater->getUpdatedRange(first, last);
+
+    // Only the range holding the recomputed normals is mapped and written
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_nBuffer));
+    void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, first * sizeof(glm::vec3), (last - first) * sizeof(glm::vec3),
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (mapped)
+    {
+        std::copy(m_normals.begin() + first, m_normals.begin() + last, static_cast<glm::vec3*>(mapped));
+        glcheck(glUnmapBuffer(GL_ARRAY_BUFFER));
+    }
+    else
+    {
+        glcheck(glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::vec3), (last - first) * sizeof(glm::vec3), m_normals.data() + first));
+    }
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
 void MeshRenderable::do_draw()
 {
     
@@ -129,8 +194,8 @@ void MeshRenderable::do_draw()
     if(positionLocation != ShaderProgram::null_location)
     {
         glcheck(glEnableVertexAttribArray(positionLocation));
-        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_pBuffer));
-        glcheck(glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_positionBuffer ? m_positionBuffer : m_pBuffer));
+        glcheck(glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, m_positionStride, (void*)m_positionOffset));
     }
 
     if(colorLocation != ShaderProgram::null_location)
@@ -143,8 +208,8 @@ void MeshRenderable::do_draw()
     if(normalLocation != ShaderProgram::null_location)
     {
         glcheck(glEnableVertexAttribArray(normalLocation));
-        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_nBuffer));
-        glcheck(glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_normalBuffer ? m_normalBuffer : m_nBuffer));
+        glcheck(glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, m_normalStride, (void*)m_normalOffset));
     }
 
     if( nitLocation != ShaderProgram::null_location )
@@ -153,12 +218,40 @@ void MeshRenderable::do_draw()
         glm::value_ptr(glm::transpose(glm::inverse(glm::mat3(getModelMatrix()))))));
     }
 
-    //Draw triangles elements
+    //Draw triangles elements, instanced if a subclass asked for several copies
     if (m_indexed){
-        glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iBuffer));
-        glcheck(glDrawElements(m_mode, m_indices.size(), GL_UNSIGNED_INT, (void*)0));
+        size_t offset = 0, count = m_indices.size();
+        if (m_lodOffsets.empty())
+        {
+            glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iBuffer));
+        }
+        else
+        {
+            select_level_of_detail();
+            offset = m_lodOffsets[m_lod];
+            count = m_lodCounts[m_lod];
+            glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_lodBuffer));
+        }
+        s_fullTriangles += m_indices.size() / 3 * m_instanceCount;
+        s_drawnTriangles += count / 3 * m_instanceCount;
+
+        if (m_instanceCount == 1)
+        {
+            glcheck(glDrawElements(m_mode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(unsigned int))));
+        }
+        else
+        {
+            glcheck(glDrawElementsInstanced(m_mode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(unsigned int)), m_instanceCount));
+        }
     }else{
-        glcheck(glDrawArrays(m_mode,0, m_positions.size()));
+        if (m_instanceCount == 1)
+        {
+            glcheck(glDrawArrays(m_mode,0, m_positions.size()));
+        }
+        else
+        {
+            glcheck(glDrawArraysInstanced(m_mode, 0, m_positions.size(), m_instanceCount));
+        }
     }
 
     if(positionLocation != ShaderProgram::null_location)
@@ -177,6 +270,121 @@ void MeshRenderable::do_draw()
     }
 }
 
+const std::vector< glm::vec3 > & MeshRenderable::positions() const
+{
+    return m_positions;
+}
+
+const std::vector< glm::vec3 > & MeshRenderable::normals() const
+{
+    return m_normals;
+}
+
+const std::vector< unsigned int > & MeshRenderable::indices() const
+{
+    return m_indices;
+}
+
+bool MeshRenderable::isIndexed() const
+{
+    return m_indexed;
+}
+
+void MeshRenderable::buildLevelsOfDetail(unsigned int levelCount, float ratio)
+{
+    if (!m_indexed || m_mode != GL_TRIANGLES)
+    {
+        LOG(warning, "levels of detail are only built for indexed triangle meshes");
+        return;
+    }
+
+    std::vector< std::vector<unsigned int> > levels;
+    simplify_mesh(m_positions, m_normals, m_tcoords, m_indices, levels, levelCount, ratio);
+
+    // All levels go in a single element buffer
+    std::vector<unsigned int> all;
+    m_lodOffsets.clear();
+    m_lodCounts.clear();
+    for (const std::vector<unsigned int> & level : levels)
+    {
+        m_lodOffsets.push_back(all.size());
+        m_lodCounts.push_back(level.size());
+        all.insert(all.end(), level.begin(), level.end());
+    }
+    if (!m_lodBuffer)
+    {
+        glcheck(glGenBuffers(1, &m_lodBuffer));
+    }
+    glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_lodBuffer));
+    glcheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, all.size()*sizeof(unsigned int), all.data(), GL_STATIC_DRAW));
+    glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+
+    // Bounding sphere used to estimate the size of the mesh on the screen
+    glm::vec3 aabbMin(m_positions.empty() ? glm::vec3(0) : m_positions[0]), aabbMax(aabbMin);
+    for (const glm::vec3 & p : m_positions)
+    {
+        aabbMin = glm::min(aabbMin, p);
+        aabbMax = glm::max(aabbMax, p);
+    }
+    m_boundingCenter = 0.5f * (aabbMin + aabbMax);
+    m_boundingRadius = 0.0f;
+    for (const glm::vec3 & p : m_positions)
+        m_boundingRadius = std::max(m_boundingRadius, glm::length(p - m_boundingCenter));
+    m_lod = 0;
+
+    std::string counts;
+    for (size_t count : m_lodCounts)
+        counts += " " + std::to_string(count / 3);
+    LOG(info, "levels of detail built, triangles per level:" << counts);
+}
+
+void MeshRenderable::select_level_of_detail()
+{
+    if (!m_viewer)
+        return;
+
+    // Projected diameter of the bounding sphere relative to the screen height
+    const Camera & camera = m_viewer->getCamera();
+    const glm::mat4 & model = getModelMatrix();
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    glm::vec3 center = glm::vec3(model * glm::vec4(m_boundingCenter, 1.0f));
+    float distance = std::max(glm::length(center - camera.getPosition()), camera.znear());
+    float size = m_boundingRadius * scale / (distance * std::tan(0.5f * camera.fov()));
+
+    // Level i (i > 0) is used below m_lodThreshold / 2^(i-1), with a margin
+    // on both sides of the thresholds
+    unsigned int levels = m_lodOffsets.size();
+    while (m_lod + 1 < levels && size < m_lodThreshold * std::pow(0.5f, (float)m_lod) * (1.0f - lod_hysteresis))
+        ++m_lod;
+    while (m_lod > 0 && size > m_lodThreshold * std::pow(0.5f, (float)(m_lod - 1)) * (1.0f + lod_hysteresis))
+        --m_lod;
+}
+
+void MeshRenderable::setLevelOfDetailThreshold(float threshold)
+{
+    m_lodThreshold = threshold;
+}
+
+size_t MeshRenderable::levelOfDetailCount() const
+{
+    return m_lodOffsets.size();
+}
+
+unsigned int MeshRenderable::currentLevelOfDetail() const
+{
+    return m_lod;
+}
+
+void MeshRenderable::reportTriangleStatistics()
+{
+    if (s_fullTriangles == 0)
+        return;
+    LOG(info, "levels of detail drew " << s_drawnTriangles << " triangles instead of " << s_fullTriangles
+        << " (" << 100.0 * (s_fullTriangles - s_drawnTriangles) / s_fullTriangles << "% saved)");
+    s_fullTriangles = 0;
+    s_drawnTriangles = 0;
+}
+
 void MeshRenderable::set_random_colors(){
     if (m_colors.empty()){
         m_colors.resize( m_positions.size() );
@@ -191,6 +399,7 @@ MeshRenderable::~MeshRenderable()
     glcheck(glDeleteBuffers(1, &m_cBuffer));
     glcheck(glDeleteBuffers(1, &m_nBuffer));
     glcheck(glDeleteBuffers(1, &m_iBuffer));
+    glcheck(glDeleteBuffers(1, &m_lodBuffer));
 }
 /*
 #include "./../include/MeshRenderable.hpp"
@@ -0,0 +1,424 @@
+#include "./../include/MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <queue>
+#include <tuple>
+
+// Weight of the planes added along borders and seams, relative to the planes of the faces
+static const double border_weight = 1000.0;
+
+// Normals of vertices at the same position closer than this (about 20 degrees) do not make a seam
+static const float soft_normal_cosine = 0.94f;
+
+// A collapse merges the vertex "from" into the vertex "to". The versions are
+// those of both vertices when the cost was computed: the collapse is outdated
+// if one of them changed since.
+struct Collapse
+{
+    double cost;
+    unsigned int from, to;
+    unsigned int fromVersion, toVersion;
+    bool operator<(const Collapse& other) const { return cost > other.cost; }
+};
+
+static glm::dmat4 plane_quadric(const glm::dvec3& normal, double d)
+{
+    glm::dvec4 p(normal, d);
+    return glm::outerProduct(p, p);
+}
+
+static double quadric_error(const glm::dmat4& q, const glm::vec3& position)
+{
+    glm::dvec4 v(glm::dvec3(position), 1.0);
+    return glm::dot(v, q * v);
+}
+
+namespace {
+
+// The topology is handled on positions rather than on vertices: an OBJ file
+// gives several vertices (copies) to a position on a normal or texture seam.
+// Collapsing a position moves each of its copies to a copy of the target in
+// the same texture chart, so seams stay closed.
+class Simplifier
+{
+public:
+    Simplifier(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices) :
+        m_positions(positions),
+        m_positionOf(positions.size(), 0),
+        m_aliveTriangles(0)
+    {
+        // Weld vertices sharing a position
+        std::map< std::tuple<float, float, float>, unsigned int > ids;
+        std::vector<bool> used(positions.size(), false);
+        for (unsigned int v : indices)
+            used[v] = true;
+        for (unsigned int v = 0; v < positions.size(); ++v)
+        {
+            if (!used[v])
+                continue;
+            auto key = std::make_tuple(positions[v].x, positions[v].y, positions[v].z);
+            auto it = ids.find(key);
+            if (it == ids.end())
+            {
+                it = ids.insert(std::make_pair(key, (unsigned int)m_copies.size())).first;
+                m_copies.push_back(std::vector<unsigned int>());
+            }
+            m_positionOf[v] = it->second;
+            m_copies[it->second].push_back(v);
+        }
+
+        size_t count = m_copies.size();
+        m_quadrics.assign(count, glm::dmat4(0.0));
+        m_positionTriangles.resize(count);
+        m_version.assign(count, 0);
+        m_locked.assign(count, false);
+        m_border.assign(count, false);
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            unsigned int t = m_triangles.size();
+            m_triangles.push_back(glm::uvec3(indices[i], indices[i+1], indices[i+2]));
+            m_alive.push_back(true);
+            for (int k = 0; k < 3; ++k)
+                m_positionTriangles[m_positionOf[indices[i+k]]].push_back(t);
+        }
+        m_aliveTriangles = m_triangles.size();
+
+        compute_quadrics();
+        for (unsigned int p = 0; p < count; ++p)
+            push_collapses(p);
+    }
+
+    size_t aliveTriangles() const { return m_aliveTriangles; }
+
+    // Collapse positions until there are at most target triangles.
+    // Returns false if no valid collapse remains.
+    bool simplify(size_t target)
+    {
+        while (m_aliveTriangles > target)
+        {
+            if (m_queue.empty())
+                return false;
+            Collapse c = m_queue.top();
+            m_queue.pop();
+            if (m_version[c.from] != c.fromVersion || m_version[c.to] != c.toVersion)
+                continue;
+            std::vector< std::pair<unsigned int, unsigned int> > targets;
+            if (!is_valid(c.from, c.to, targets))
+                continue;
+            collapse(c.from, c.to, targets);
+        }
+        return true;
+    }
+
+    void get_indices(std::vector<unsigned int>& indices) const
+    {
+        indices.clear();
+        for (size_t t = 0; t < m_triangles.size(); ++t)
+        {
+            if (!m_alive[t])
+                continue;
+            indices.push_back(m_triangles[t].x);
+            indices.push_back(m_triangles[t].y);
+            indices.push_back(m_triangles[t].z);
+        }
+    }
+
+private:
+    const glm::vec3& position(unsigned int p) const
+    {
+        return m_positions[m_copies[p][0]];
+    }
+
+    bool has_position(const glm::uvec3& tri, unsigned int p) const
+    {
+        return m_positionOf[tri.x] == p || m_positionOf[tri.y] == p || m_positionOf[tri.z] == p;
+    }
+
+    // Number of alive triangles using the edge between the vertices a and b
+    size_t edge_triangles(unsigned int a, unsigned int b) const
+    {
+        size_t count = 0;
+        for (unsigned int t : m_positionTriangles[m_positionOf[a]])
+        {
+            const glm::uvec3& tri = m_triangles[t];
+            if (m_alive[t] && (tri.x == a || tri.y == a || tri.z == a) && (tri.x == b || tri.y == b || tri.z == b))
+                ++count;
+        }
+        return count;
+    }
+
+    void compute_quadrics()
+    {
+        std::map< std::pair<unsigned int, unsigned int>, std::vector<unsigned int> > edges;
+        for (unsigned int t = 0; t < m_triangles.size(); ++t)
+        {
+            const glm::uvec3& tri = m_triangles[t];
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int i = tri[k], j = tri[(k+1)%3];
+                edges[std::make_pair(std::min(i, j), std::max(i, j))].push_back(t);
+            }
+            glm::dvec3 a(m_positions[tri.x]), b(m_positions[tri.y]), c(m_positions[tri.z]);
+            glm::dvec3 n = glm::cross(b - a, c - a);
+            double area = glm::length(n);
+            if (area == 0.0)
+                continue;
+            n /= area;
+            // Area weighted plane of the face
+            glm::dmat4 q = 0.5 * area * plane_quadric(n, -glm::dot(n, a));
+            for (int k = 0; k < 3; ++k)
+                m_quadrics[m_positionOf[tri[k]]] += q;
+        }
+
+        // Edges with a single face are on the border of the mesh or on a seam:
+        // add a plane orthogonal to the face to keep them in place.
+        std::vector<unsigned int> borderEdges(m_copies.size(), 0);
+        for (const auto& e : edges)
+        {
+            if (e.second.size() != 1)
+                continue;
+            unsigned int pa = m_positionOf[e.first.first], pb = m_positionOf[e.first.second];
+            m_border[pa] = m_border[pb] = true;
+            ++borderEdges[pa];
+            ++borderEdges[pb];
+
+            const glm::uvec3& tri = m_triangles[e.second[0]];
+            glm::dvec3 a(m_positions[e.first.first]), b(m_positions[e.first.second]);
+            glm::dvec3 n = glm::cross(glm::dvec3(m_positions[tri.y]) - glm::dvec3(m_positions[tri.x]),
+                                      glm::dvec3(m_positions[tri.z]) - glm::dvec3(m_positions[tri.x]));
+            glm::dvec3 borderNormal = glm::cross(b - a, n);
+            double length = glm::length(borderNormal);
+            if (length == 0.0)
+                continue;
+            borderNormal /= length;
+            glm::dmat4 q = border_weight * glm::dot(b - a, b - a) * plane_quadric(borderNormal, -glm::dot(borderNormal, a));
+            m_quadrics[pa] += q;
+            m_quadrics[pb] += q;
+        }
+
+        // Corners where more than two seams or borders meet do not move
+        for (size_t p = 0; p < m_copies.size(); ++p)
+            m_locked[p] = m_copies[p].size() > 2 || borderEdges[p] > 2 * m_copies[p].size();
+    }
+
+    void neighbours(unsigned int p, std::vector<unsigned int>& result) const
+    {
+        result.clear();
+        for (unsigned int t : m_positionTriangles[p])
+        {
+            if (!m_alive[t])
+                continue;
+            for (int k = 0; k < 3; ++k)
+                if (m_positionOf[m_triangles[t][k]] != p)
+                    result.push_back(m_positionOf[m_triangles[t][k]]);
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+
+    void push_collapse(unsigned int from, unsigned int to)
+    {
+        if (m_locked[from])
+            return;
+        Collapse c;
+        c.cost = quadric_error(m_quadrics[from] + m_quadrics[to], position(to));
+        c.from = from;
+        c.to = to;
+        c.fromVersion = m_version[from];
+        c.toVersion = m_version[to];
+        m_queue.push(c);
+    }
+
+    void push_collapses(unsigned int p)
+    {
+        std::vector<unsigned int> around;
+        neighbours(p, around);
+        for (unsigned int n : around)
+        {
+            push_collapse(p, n);
+            push_collapse(n, p);
+        }
+    }
+
+    // Check the collapse and find the copy of "to" replacing each copy of "from"
+    bool is_valid(unsigned int from, unsigned int to, std::vector< std::pair<unsigned int, unsigned int> >& targets) const
+    {
+        size_t shared = 0;
+        for (unsigned int t : m_positionTriangles[from])
+            if (m_alive[t] && has_position(m_triangles[t], to))
+                ++shared;
+        if (shared == 0)
+            return false;
+
+        // Each copy must find a copy of the target in its own texture chart,
+        // and copies on a seam or a border can only slide along it
+        for (unsigned int a : m_copies[from])
+        {
+            unsigned int b = 0;
+            bool found = false, usedCopy = false;
+            for (unsigned int t : m_positionTriangles[from])
+            {
+                const glm::uvec3& tri = m_triangles[t];
+                if (!m_alive[t] || (tri.x != a && tri.y != a && tri.z != a))
+                    continue;
+                usedCopy = true;
+                for (int k = 0; k < 3 && !found; ++k)
+                {
+                    if (m_positionOf[tri[k]] == to)
+                    {
+                        b = tri[k];
+                        found = true;
+                    }
+                }
+            }
+            if (!usedCopy)
+                continue;
+            if (!found || (m_border[from] && edge_triangles(a, b) != 1))
+                return false;
+            targets.push_back(std::make_pair(a, b));
+        }
+
+        // Link condition: the only common neighbours are the opposite vertices
+        // of the shared triangles, otherwise the surface becomes non manifold
+        std::vector<unsigned int> nFrom, nTo, common;
+        neighbours(from, nFrom);
+        neighbours(to, nTo);
+        std::set_intersection(nFrom.begin(), nFrom.end(), nTo.begin(), nTo.end(), std::back_inserter(common));
+        if (common.size() * targets.size() != shared)
+            return false;
+
+        // Triangles that are kept must not flip
+        for (unsigned int t : m_positionTriangles[from])
+        {
+            const glm::uvec3& tri = m_triangles[t];
+            if (!m_alive[t] || has_position(tri, to))
+                continue;
+            glm::vec3 p[3], q[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                p[k] = m_positions[tri[k]];
+                q[k] = m_positionOf[tri[k]] == from ? position(to) : p[k];
+            }
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+            float lengths = glm::length(before) * glm::length(after);
+            if (lengths == 0.0f || glm::dot(before, after) < 0.2f * lengths)
+                return false;
+        }
+        return true;
+    }
+
+    void collapse(unsigned int from, unsigned int to, const std::vector< std::pair<unsigned int, unsigned int> >& targets)
+    {
+        for (unsigned int t : m_positionTriangles[from])
+        {
+            if (!m_alive[t])
+                continue;
+            glm::uvec3& tri = m_triangles[t];
+            if (has_position(tri, to))
+            {
+                m_alive[t] = false;
+                --m_aliveTriangles;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k)
+                for (const auto& target : targets)
+                    if (tri[k] == target.first)
+                        tri[k] = target.second;
+            m_positionTriangles[to].push_back(t);
+        }
+        m_positionTriangles[from].clear();
+        m_quadrics[to] += m_quadrics[from];
+        ++m_version[from];
+        ++m_version[to];
+
+        // Drop triangles that died from the adjacency of the target
+        std::vector<unsigned int>& triangles = m_positionTriangles[to];
+        triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+                        [this](unsigned int t) { return !m_alive[t]; }), triangles.end());
+        push_collapses(to);
+    }
+
+    const std::vector<glm::vec3>& m_positions;
+    std::vector<unsigned int> m_positionOf; // position of each vertex
+    std::vector< std::vector<unsigned int> > m_copies; // vertices of each position
+    std::vector<glm::uvec3> m_triangles;
+    std::vector<bool> m_alive;
+    std::vector<glm::dmat4> m_quadrics;
+    std::vector< std::vector<unsigned int> > m_positionTriangles;
+    std::vector<unsigned int> m_version;
+    std::vector<bool> m_locked;
+    std::vector<bool> m_border;
+    std::priority_queue<Collapse> m_queue;
+    size_t m_aliveTriangles;
+};
+
+}
+
+// Vertices sharing position and texture coordinates, with close normals, are
+// merged: exporters often split vertices on smooth surfaces, which would be
+// seen as seams and would prevent the simplification.
+static void weld_soft_copies(
+        const std::vector<glm::vec3>& positions,
+        const std::vector<glm::vec3>& normals,
+        const std::vector<glm::vec2>& texcoords,
+        const std::vector<unsigned int>& indices,
+        std::vector<unsigned int>& welded)
+{
+    std::map< std::tuple<float, float, float, float, float>, std::vector<unsigned int> > groups;
+    std::vector<unsigned int> representative(positions.size());
+    for (unsigned int v = 0; v < positions.size(); ++v)
+    {
+        glm::vec2 uv = v < texcoords.size() ? texcoords[v] : glm::vec2(0.0);
+        std::vector<unsigned int>& group = groups[std::make_tuple(positions[v].x, positions[v].y, positions[v].z, uv.x, uv.y)];
+        representative[v] = v;
+        for (unsigned int r : group)
+        {
+            if (v >= normals.size() || glm::dot(normals[r], normals[v]) > soft_normal_cosine)
+            {
+                representative[v] = r;
+                break;
+            }
+        }
+        if (representative[v] == v)
+            group.push_back(v);
+    }
+
+    welded.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+        welded[i] = representative[indices[i]];
+}
+
+void simplify_mesh(
+        const std::vector<glm::vec3>& positions,
+        const std::vector<glm::vec3>& normals,
+        const std::vector<glm::vec2>& texcoords,
+        const std::vector<unsigned int>& indices,
+        std::vector< std::vector<unsigned int> >& levels,
+        unsigned int levelCount,
+        float ratio)
+{
+    levels.clear();
+    levels.push_back(indices);
+
+    std::vector<unsigned int> welded;
+    weld_soft_copies(positions, normals, texcoords, indices, welded);
+    Simplifier simplifier(positions, welded);
+    double target = indices.size() / 3;
+    for (unsigned int level = 1; level < levelCount; ++level)
+    {
+        target *= ratio;
+        bool complete = simplifier.simplify(static_cast<size_t>(target));
+
+        // Skip a level too close to the previous one
+        if (simplifier.aliveTriangles() * 3 > 0.9 * levels.back().size())
+            break;
+        levels.push_back(std::vector<unsigned int>());
+        simplifier.get_indices(levels.back());
+        if (!complete)
+            break;
+    }
+}
@@ -106,6 +106,21 @@ ShaderProgram::ShaderProgram(
   load( vertex_file_path, fragment_file_path );
 }
 
+ShaderProgram::ShaderProgram(
+  const std::string& vertex_file_path,
+  const std::vector< std::string >& feedback_varyings )
+  : m_programId{0}, m_feedbackVaryings( feedback_varyings )
+{
+  load( vertex_file_path, std::string() );
+}
+
+ShaderProgram::ShaderProgram(
+  const std::string& compute_file_path )
+  : m_programId{0}
+{
+  loadCompute( compute_file_path );
+}
+
 ShaderProgram::~ShaderProgram()
 {
   if( glIsProgram(m_programId) )
@@ -118,8 +133,10 @@ void ShaderProgram::load(
 {
   // ids of the shaders that we will link together to form a program
   GLuint vertex_shader_id = compile_shader( vertex_file_path, GL_VERTEX_SHADER );
-  GLuint fragment_shader_id = compile_shader( fragment_file_path, GL_FRAGMENT_SHADER );
-  if( !vertex_shader_id || !fragment_shader_id )
+  // a transform feedback program has no fragment stage
+  bool has_fragment = !fragment_file_path.empty();
+  GLuint fragment_shader_id = has_fragment ? compile_shader( fragment_file_path, GL_FRAGMENT_SHADER ) : 0;
+  if( !vertex_shader_id || ( has_fragment && !fragment_shader_id ) )
     {
       LOG( error, "cannot load shader program. Program unchanged...");
       if( glIsShader( vertex_shader_id ) )
@@ -135,7 +152,18 @@ void ShaderProgram::load(
   //Create, attach, Link the program
   glcheck(m_programId = glCreateProgram());
   glcheck(glAttachShader(m_programId, vertex_shader_id));
-  glcheck(glAttachShader(m_programId, fragment_shader_id));
+  if( has_fragment )
+    {
+      glcheck(glAttachShader(m_programId, fragment_shader_id));
+    }
+  // captured outputs have to be declared before the linking stage
+  if( !m_feedbackVaryings.empty() )
+    {
+      std::vector< const GLchar* > varyings;
+      for( const std::string& varying : m_feedbackVaryings )
+        varyings.push_back( varying.c_str() );
+      glcheck(glTransformFeedbackVaryings(m_programId, varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS));
+    }
   glcheck(glLinkProgram(m_programId));
 
   // everything is ok: use this new program
@@ -164,13 +192,53 @@ void ShaderProgram::load(
   //"in" this program. The only reason to keep those shaders somewhere would be
   //to reused them in order to build another shader program.
   glDeleteShader( vertex_shader_id );
-  glDeleteShader( fragment_shader_id );
+  if( has_fragment )
+    glDeleteShader( fragment_shader_id );
+}
+
+void ShaderProgram::loadCompute(
+    const std::string& compute_file_path )
+{
+  GLuint compute_shader_id = compile_shader( compute_file_path, GL_COMPUTE_SHADER );
+  if( !compute_shader_id )
+    {
+      LOG( error, "cannot load compute shader program. Program unchanged...");
+      return;
+    }
+
+  // previous program id, to restore in case of failure
+  unsigned int previous_id = m_programId;
+
+  glcheck(m_programId = glCreateProgram());
+  glcheck(glAttachShader(m_programId, compute_shader_id));
+  glcheck(glLinkProgram(m_programId));
+
+  if( check_program_status(m_programId) )
+    {
+      if( glIsProgram( previous_id ) )
+        glcheck(glDeleteProgram( previous_id ));
+      m_computeFilename = compute_file_path;
+
+      LOG( info, "resources info for ShaderProgram "<< this << " (" << compute_file_path << ")");
+      resources_introspection();
+    }
+  else
+    {
+      LOG( warning, "shader program described by (" << compute_file_path
+           << ") is invalid. ShaderProgram " << this << " remains unchanged...");
+      glcheck(glDeleteProgram( m_programId ));
+      m_programId = previous_id;
+    }
+
+  glDeleteShader( compute_shader_id );
 }
 
 void
 ShaderProgram::reload()
 {
-  if( !m_vertexFilename.empty() && !m_fragmentFilename.empty() )
+  if( !m_computeFilename.empty() )
+    loadCompute( m_computeFilename );
+  else if( !m_vertexFilename.empty() && ( !m_fragmentFilename.empty() || !m_feedbackVaryings.empty() ) )
     load( m_vertexFilename, m_fragmentFilename );
 }
 
@@ -254,6 +322,14 @@ GLint ShaderProgram::getUniformLocation( const std::string& name ) const
   return null_location;
 }
 
+GLint ShaderProgram::getUniformLocation( const char* name ) const
+{
+  // The key keeps its capacity from one call to the next
+  static thread_local std::string key;
+  key.assign( name );
+  return getUniformLocation( key );
+}
+
 GLint ShaderProgram::getAttributeLocation( const std::string& name ) const
 {
   std::unordered_map< std::string, int >::const_iterator search = m_attributes.find( name );
@@ -263,3 +339,9 @@ GLint ShaderProgram::getAttributeLocation( const std::string& name ) const
   return null_location;
 }
 
+GLint ShaderProgram::getAttributeLocation( const char* name ) const
+{
+  static thread_local std::string key;
+  key.assign( name );
+  return getAttributeLocation( key );
+}
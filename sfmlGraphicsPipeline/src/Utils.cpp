@@ -832,7 +832,7 @@ glm::mat4 lookAtUpModel(const glm::vec3 & position, const glm::vec3 & target)
 
 void getFabric(float width, float height, int horizontal_resolution, int vertical_resolution,
     std::vector<ParticlePtr> & particles,
-    std::vector<SpringForceFieldPtr> & springs,
+    SpringNetworkForceFieldPtr & springs,
     std::vector<glm::vec3> & positions,
     std::vector<glm::uvec3> & indices,
     std::vector<glm::vec2> & tcoords,
@@ -840,7 +840,6 @@ void getFabric(float width, float height, int horizontal_resolution, int vertica
     float damping)
 {
     particles.resize(0);
-    springs.resize(0);
     positions.resize(0);
     tcoords.resize(0);
     indices.resize(0);
@@ -858,6 +857,9 @@ void getFabric(float width, float height, int horizontal_resolution, int vertica
             particles.push_back(particle);
         }
     }
+    springs = std::make_shared<SpringNetworkForceField>(particles);
+    springs->reserve(4 * horizontal_resolution * vertical_resolution);
+
     // Make springs and triangles
     for (int i = 0 ; i < horizontal_resolution ; ++i){
         for (int j = 0 ; j < vertical_resolution ; ++j){
@@ -878,35 +880,22 @@ void getFabric(float width, float height, int horizontal_resolution, int vertica
 
             // Springs
             // connect each particle to 4 neighbors such that each particle is connected to its 8 neighbors in the end
-            ParticlePtr particle = particles[index];
             // connection with top right particle
             
             if (!top_border && ! right_border){
-                ParticlePtr top_right_particle = particles[index_right_up];
-                float distance = glm::distance(particle->getPosition(), top_right_particle->getPosition());
-                SpringForceFieldPtr spring = std::make_shared<SpringForceField>(particle, top_right_particle, stiffness, distance, damping);
-                springs.push_back(spring);
+                springs->addSpring(index, index_right_up, stiffness, damping);
             }
             // connection with right particle
             if (!right_border){
-                ParticlePtr right_particle = particles[index_right];
-                float distance = glm::distance(particle->getPosition(), right_particle->getPosition());
-                SpringForceFieldPtr spring = std::make_shared<SpringForceField>(particle, right_particle, stiffness, distance, damping);
-                springs.push_back(spring);
+                springs->addSpring(index, index_right, stiffness, damping);
             }
             // connection with bottom right particle
             if (!bottom_border && !right_border){
-                ParticlePtr bottom_right_particle = particles[index_right_bottom];
-                float distance = glm::distance(particle->getPosition(), bottom_right_particle->getPosition());
-                SpringForceFieldPtr spring = std::make_shared<SpringForceField>(particle, bottom_right_particle, stiffness, distance, damping);
-                springs.push_back(spring);
+                springs->addSpring(index, index_right_bottom, stiffness, damping);
             }
             // connection with bottom particle
             if (!bottom_border){
-                ParticlePtr bottom_particle = particles[index_bottom];
-                float distance = glm::distance(particle->getPosition(), bottom_particle->getPosition());
-                SpringForceFieldPtr spring = std::make_shared<SpringForceField>(particle, bottom_particle, stiffness, distance, damping);
-                springs.push_back(spring);
+                springs->addSpring(index, index_bottom, stiffness, damping);
             }
             
             // Triangles
@@ -920,6 +909,20 @@ void getFabric(float width, float height, int horizontal_resolution, int vertica
     }
 }
 
+void getFabric(float width, float height, int horizontal_resolution, int vertical_resolution,
+    std::vector<ParticlePtr> & particles,
+    std::vector<SpringForceFieldPtr> & springs,
+    std::vector<glm::vec3> & positions,
+    std::vector<glm::uvec3> & indices,
+    std::vector<glm::vec2> & tcoords,
+    float stiffness,
+    float damping)
+{
+    SpringNetworkForceFieldPtr network;
+    getFabric(width, height, horizontal_resolution, vertical_resolution, particles, network, positions, indices, tcoords, stiffness, damping);
+    springs = network->createSpringForceFields();
+}
+
 float degToRad(float deg) {
     return deg * (M_PI / 180);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "./../include/Viewer.hpp"
 #include "./../include/gl_helper.hpp"
 #include "./../include/log.hpp"
+#include "./../include/FrameArena.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
@@ -53,7 +54,7 @@ Viewer::Viewer(float width, float height, const glm::vec4 & background_color) :
     //m_modeInformationTextDisappearanceTime{ clock::now() + g_modeInformationTextTimeout },
     //m_modeInformationText{ "Arcball Camera Activated" },
     m_applicationRunning{ true }, m_animationLoop{ false }, m_animationIsStarted{ false },
-    m_loopDuration{120}, m_simulationTime{0},
+    m_seeking{ false }, m_loopDuration{120}, m_simulationTime{0},
     m_screenshotCounter{0}, m_helpDisplayed{false}, m_helpDisplayRequest{false},
     m_lastEventHandleTime{ clock::now() },
     m_background_color{background_color}, m_initSimulationTime{0}
@@ -77,6 +78,7 @@ Viewer::Viewer(float width, float height, const glm::vec4 & background_color) :
     glcheck(glDepthFunc(GL_LESS));
     glcheck(glEnable(GL_VERTEX_PROGRAM_POINT_SIZE));
     glcheck(glEnable(GL_TEXTURE_2D));
+    m_dynamicBuffer = std::make_shared<DynamicBuffer>();
 
     m_texture.create(width, height, sf::ContextSettings{ 0 /* depth*/, 0 /*stencil*/, 4 /*anti aliasing level*/, 4 /*GL major version*/, 0 /*GL minor version*/});
     //Initialize the text engine (this SHOULD be done after initializeGL, as the text
@@ -92,6 +94,8 @@ constexpr const char * g_help_message =
         "      [F3]  Reload all managed shader program from their sources\n"
         "      [F4]  Pause/Stop the animation\n"
         "      [F5]  Reset the animation\n"
+        "    [PgDn]  Move the animation 10 seconds backward\n"
+        "    [PgUp]  Move the animation 10 seconds forward\n"
         "       [c]  Switch the camera mode between First Person / Arcball / Trackball / Space ship\n"
         "[ctrl]+[w]  Quit the application\n"
         "\n"
@@ -122,6 +126,7 @@ constexpr const char * g_help_message =
 void Viewer::draw()
 {
     glcheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    m_dynamicBuffer->beginFrame();
     float time = getTime();
     for( const ShaderProgramPtr & prog : m_programs )
     {
@@ -178,6 +183,7 @@ void Viewer::draw()
         }
         r->unbindShaderProgram();
     }
+    m_dynamicBuffer->endFrame();
 
     if (m_helpDisplayRequest && !m_helpDisplayed){
         LOG(info, g_help_message);
@@ -226,6 +232,7 @@ void Viewer::animate()
             sl->animate( getTime() );
 
         m_camera.animate( getTime() );
+        m_seeking = false;
     }
 }
 
@@ -265,6 +272,7 @@ void Viewer::resetAnimation()
 {
     m_lastSimulationTimePoint = clock::now();
     m_simulationTime = m_initSimulationTime;
+    m_seeking = true;
 }
 
 
@@ -332,6 +340,14 @@ void Viewer::keyPressedEvent(sf::Event& e)
             r->keyPressedEvent(e);
         LOG(info, "Animation reset.")
         break;
+    case sf::Keyboard::PageDown:
+        seekAnimation( getTime() - 10.0f );
+        LOG(info, "Animation moved to " << getTime() << " s.")
+        break;
+    case sf::Keyboard::PageUp:
+        seekAnimation( getTime() + 10.0f );
+        LOG(info, "Animation moved to " << getTime() << " s.")
+        break;
     case sf::Keyboard::W:
         if( e.key.control )
             m_applicationRunning = false;
@@ -626,6 +642,22 @@ bool Viewer::isRunning() const
 void Viewer::display()
 {
     m_window.display();
+
+    // Transient data of this frame is no longer used
+    FrameArena::resetAll();
+#ifdef COUNT_ALLOCATIONS
+    // Once the buffers and arenas have grown, a frame must not allocate on the heap
+    static const unsigned int warmupFrames = 120;
+    static unsigned int frame = 0;
+    static size_t lastAllocationCount = 0;
+    size_t allocations = heapAllocationCount() - lastAllocationCount;
+    if (++frame > warmupFrames && allocations > 0)
+    {
+        LOG(warning, "frame " << frame << " made " << allocations << " heap allocations after the warm-up");
+    }
+    // Do not count the allocations of the log
+    lastAllocationCount = heapAllocationCount();
+#endif
 }
 
 void Viewer::addShaderProgram( const ShaderProgramPtr & program )
@@ -644,6 +676,11 @@ Camera& Viewer::getCamera()
     return m_camera;
 }
 
+DynamicBuffer& Viewer::getDynamicBuffer()
+{
+    return *m_dynamicBuffer;
+}
+
 glm::vec3 Viewer::windowToWorld( const glm::vec3& windowCoordinate )
 {
     sf::Vector2u size = m_window.getSize();
@@ -680,6 +717,18 @@ void Viewer::setKeyboardSpeed(float speed) {
     m_keyboard.speed = speed;
 }
 
+void Viewer::seekAnimation(float time)
+{
+    m_lastSimulationTimePoint = clock::now();
+    m_simulationTime = std::max( m_initSimulationTime, time );
+    m_seeking = true;
+}
+
+bool Viewer::isSeeking() const
+{
+    return m_seeking;
+}
+
 void Viewer::setSimulationTime(float time) {
     m_simulationTime = time;
     m_initSimulationTime = time;
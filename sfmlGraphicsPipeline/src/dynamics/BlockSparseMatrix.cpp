@@ -0,0 +1,80 @@
+#include "./../../include/dynamics/BlockSparseMatrix.hpp"
+
+BlockSparseMatrix::BlockSparseMatrix()
+{}
+
+BlockSparseMatrix::~BlockSparseMatrix()
+{}
+
+void BlockSparseMatrix::reset(size_t size)
+{
+    m_diagonal.assign(size, glm::mat3(0.0f));
+    m_entries.clear();
+    m_rowStart.assign(size + 1, 0);
+    m_columns.clear();
+    m_blocks.clear();
+}
+
+void BlockSparseMatrix::addBlock(unsigned int row, unsigned int column, const glm::mat3& block)
+{
+    if (row == column)
+    {
+        m_diagonal[row] += block;
+        return;
+    }
+    Entry entry;
+    entry.row = row;
+    entry.column = column;
+    entry.block = block;
+    m_entries.push_back(entry);
+}
+
+void BlockSparseMatrix::compress()
+{
+    // Counting sort of the entries by row. Blocks at the same position are
+    // kept separate: the product sums them anyway
+    const size_t n = m_diagonal.size();
+    m_rowStart.assign(n + 1, 0);
+    for (const Entry & entry : m_entries)
+        ++m_rowStart[entry.row + 1];
+    for (size_t i = 0; i < n; ++i)
+        m_rowStart[i + 1] += m_rowStart[i];
+
+    m_columns.resize(m_entries.size());
+    m_blocks.resize(m_entries.size());
+    for (const Entry & entry : m_entries)
+    {
+        // m_rowStart[row] is used as the insertion point of the row, then restored
+        unsigned int e = m_rowStart[entry.row]++;
+        m_columns[e] = entry.column;
+        m_blocks[e] = entry.block;
+    }
+    for (size_t i = n; i > 0; --i)
+        m_rowStart[i] = m_rowStart[i - 1];
+    m_rowStart[0] = 0;
+}
+
+size_t BlockSparseMatrix::size() const
+{
+    return m_diagonal.size();
+}
+
+const glm::mat3& BlockSparseMatrix::diagonal(size_t row) const
+{
+    return m_diagonal[row];
+}
+
+void BlockSparseMatrix::multiplyAdd(float scale, const glm::vec3* x, glm::vec3* y) const
+{
+    const int n = static_cast<int>(m_diagonal.size());
+
+    // Each thread writes its own rows
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i)
+    {
+        glm::vec3 sum = m_diagonal[i] * x[i];
+        for (unsigned int e = m_rowStart[i]; e < m_rowStart[i + 1]; ++e)
+            sum += m_blocks[e] * x[m_columns[e]];
+        y[i] += scale * sum;
+    }
+}
@@ -0,0 +1,236 @@
+#include "./../../include/dynamics/ClothSelfCollision.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static unsigned int hash_cell(const glm::ivec3& cell, unsigned int mask)
+{
+    return (static_cast<unsigned int>(cell.x) * 73856093u
+          ^ static_cast<unsigned int>(cell.y) * 19349663u
+          ^ static_cast<unsigned int>(cell.z) * 83492791u) & mask;
+}
+
+ClothSelfCollision::ClothSelfCollision(SpringNetworkForceFieldPtr cloth) :
+    m_cloth(cloth), m_thickness(0), m_iterations(1), m_contactCount(0),
+    m_builtSprings(std::numeric_limits<size_t>::max())
+{
+    for (const ParticlePtr & p : m_cloth->getParticles())
+        m_restPositions.push_back(p->getPosition());
+}
+
+ClothSelfCollision::~ClothSelfCollision()
+{}
+
+void ClothSelfCollision::setThickness(float thickness)
+{
+    m_thickness = std::max(thickness, 0.0f);
+}
+
+float ClothSelfCollision::getThickness() const
+{
+    if (m_thickness > 0)
+        return m_thickness;
+    const std::vector<float> & lengths = m_cloth->getEquilibriumLengths();
+    float thickness = 0;
+    for (float length : lengths)
+    {
+        if (length > 0 && (thickness == 0 || length < thickness))
+            thickness = length;
+    }
+    return thickness;
+}
+
+void ClothSelfCollision::setIterations(unsigned int iterations)
+{
+    m_iterations = std::max(iterations, 1u);
+}
+
+unsigned int ClothSelfCollision::getIterations() const
+{
+    return m_iterations;
+}
+
+size_t ClothSelfCollision::contactCount() const
+{
+    return m_contactCount;
+}
+
+void ClothSelfCollision::build_neighbors()
+{
+    // Counting sort of the spring ends by particle
+    const size_t n = m_cloth->getParticles().size();
+    const std::vector<unsigned int> & e1 = m_cloth->getEndpoints1();
+    const std::vector<unsigned int> & e2 = m_cloth->getEndpoints2();
+    m_firstNeighbor.assign(n + 1, 0);
+    for (size_t s = 0; s < e1.size(); ++s)
+    {
+        ++m_firstNeighbor[e1[s] + 1];
+        ++m_firstNeighbor[e2[s] + 1];
+    }
+    for (size_t i = 0; i < n; ++i)
+        m_firstNeighbor[i + 1] += m_firstNeighbor[i];
+    m_neighbors.resize(m_firstNeighbor[n]);
+    std::vector<unsigned int> next(m_firstNeighbor.begin(), m_firstNeighbor.end() - 1);
+    for (size_t s = 0; s < e1.size(); ++s)
+    {
+        m_neighbors[next[e1[s]]++] = e2[s];
+        m_neighbors[next[e2[s]]++] = e1[s];
+    }
+    m_builtSprings = e1.size();
+}
+
+void ClothSelfCollision::sort_particles(const ParticleStore& store, float cellSize)
+{
+    const int n = static_cast<int>(m_slots.size());
+    const float invCellSize = 1.0f / cellSize;
+    const ParticleStore::Array< glm::vec3 > & positions = store.positions();
+    const ParticleStore::Array< glm::vec3 > & velocities = store.velocities();
+    const ParticleStore::Array< float > & inverseMasses = store.inverseMasses();
+    const ParticleStore::Array< unsigned char > & flags = store.flags();
+
+    // A power of two at least twice the number of particles
+    unsigned int bucketCount = 1;
+    while (bucketCount < 2u * n)
+        bucketCount <<= 1;
+    const unsigned int mask = bucketCount - 1;
+    const unsigned int detachedKey = bucketCount; // sorted after all buckets
+
+    m_cells.resize(n);
+    m_keys.resize(n);
+    #pragma omp parallel for schedule(static) if(n > 4096)
+    for (int i = 0; i < n; ++i)
+    {
+        unsigned int slot = m_slots[i];
+        m_cells[i] = glm::ivec3(glm::floor(positions[slot] * invCellSize));
+        m_keys[i] = (flags[slot] & ParticleStore::DETACHED) ? detachedKey : hash_cell(m_cells[i], mask);
+    }
+
+    // Counting sort of the particles by bucket
+    m_bucketStart.assign(bucketCount + 2, 0);
+    for (int i = 0; i < n; ++i)
+        ++m_bucketStart[m_keys[i] + 1];
+    for (unsigned int b = 1; b < bucketCount + 2; ++b)
+        m_bucketStart[b] += m_bucketStart[b - 1];
+    m_sorted.resize(n);
+    m_next.assign(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for (int i = 0; i < n; ++i)
+        m_sorted[m_next[m_keys[i]]++] = i;
+
+    // Copy the particles in sorted order, with a null inverse mass for the
+    // particles that do not move
+    const int active = static_cast<int>(m_bucketStart[bucketCount]);
+    m_sortedCells.resize(active);
+    m_sortedPositions.resize(active);
+    m_sortedVelocities.resize(active);
+    #pragma omp parallel for schedule(static) if(active > 4096)
+    for (int k = 0; k < active; ++k)
+    {
+        unsigned int i = m_sorted[k], slot = m_slots[i];
+        bool still = flags[slot] & (ParticleStore::FIXED | ParticleStore::SLEEPING);
+        m_sortedCells[k] = m_cells[i];
+        m_sortedPositions[k] = glm::vec4(positions[slot], still ? 0.0f : inverseMasses[slot]);
+        m_sortedVelocities[k] = velocities[slot];
+    }
+}
+
+bool ClothSelfCollision::solve(ParticleStore& store)
+{
+    const std::vector<ParticlePtr> & particles = m_cloth->getParticles();
+    for (const ParticlePtr & p : particles)
+    {
+        if (p->getStore() != &store)
+            return false;
+    }
+    m_contactCount = 0;
+    const float thickness = getThickness();
+    if (particles.size() < 2 || thickness <= 0)
+        return true;
+    if (m_cloth->springCount() != m_builtSprings)
+        build_neighbors();
+
+    m_slots.resize(particles.size());
+    for (size_t i = 0; i < particles.size(); ++i)
+        m_slots[i] = particles[i]->getStoreIndex();
+
+    const float thickness2 = thickness * thickness;
+    ParticleStore::Array< glm::vec3 > & positions = store.positions();
+    ParticleStore::Array< glm::vec3 > & velocities = store.velocities();
+    for (unsigned int iteration = 0; iteration < m_iterations; ++iteration)
+    {
+        // Cells twice as large as the thickness: the close particles are in
+        // the 8 cells around the corner of the cell closest to the particle
+        sort_particles(store, 2 * thickness);
+        const float invCellSize = 0.5f / thickness;
+        const unsigned int mask = (m_bucketStart.size() - 2) - 1;
+        const int active = static_cast<int>(m_sortedPositions.size());
+        m_positionCorrections.resize(active);
+        m_velocityCorrections.resize(active);
+        size_t contacts = 0;
+
+        #pragma omp parallel for schedule(static) reduction(+:contacts) if(active > 4096)
+        for (int k = 0; k < active; ++k)
+        {
+            const glm::vec4 p = m_sortedPositions[k];
+            const unsigned int i = m_sorted[k];
+            glm::vec3 dx(0.0f), dv(0.0f);
+            unsigned int count = 0;
+            if (p.w > 0)
+            {
+                const glm::ivec3 cell = m_sortedCells[k];
+                const glm::vec3 fraction = glm::vec3(p) * invCellSize - glm::vec3(cell);
+                const glm::ivec3 corner(fraction.x < 0.5f ? -1 : 1, fraction.y < 0.5f ? -1 : 1, fraction.z < 0.5f ? -1 : 1);
+                for (int c = 0; c < 8; ++c)
+                {
+                    const glm::ivec3 neighbor = cell + glm::ivec3(c & 1, (c >> 1) & 1, (c >> 2) & 1) * corner;
+                    const unsigned int bucket = hash_cell(neighbor, mask);
+                    for (unsigned int e = m_bucketStart[bucket]; e < m_bucketStart[bucket + 1]; ++e)
+                    {
+                        // Several cells may share a bucket
+                        if (e == static_cast<unsigned int>(k) || m_sortedCells[e] != neighbor)
+                            continue;
+                        const glm::vec4 & q = m_sortedPositions[e];
+                        glm::vec3 d = glm::vec3(p) - glm::vec3(q);
+                        float distance2 = glm::dot(d, d);
+                        if (distance2 >= thickness2)
+                            continue;
+                        // Topological neighbors are allowed to be close
+                        const unsigned int j = m_sorted[e];
+                        glm::vec3 rest = m_restPositions[i] - m_restPositions[j];
+                        if (glm::dot(rest, rest) < thickness2)
+                            continue;
+                        const unsigned int* first = m_neighbors.data() + m_firstNeighbor[i];
+                        const unsigned int* last = m_neighbors.data() + m_firstNeighbor[i + 1];
+                        if (std::find(first, last, j) != last)
+                            continue;
+
+                        float distance = std::sqrt(distance2);
+                        // Particles at the same place are separated vertically
+                        glm::vec3 normal = distance > 0 ? d / distance : glm::vec3(0, i < j ? 1 : -1, 0);
+                        float share = p.w / (p.w + q.w);
+                        dx += share * (thickness - distance) * normal;
+                        float speed = glm::dot(m_sortedVelocities[k] - m_sortedVelocities[e], normal);
+                        if (speed < 0)
+                            dv -= share * speed * normal;
+                        ++count;
+                    }
+                }
+            }
+            // The average of the corrections, so that a particle squeezed
+            // between several others does not overshoot
+            m_positionCorrections[k] = count ? dx / float(count) : dx;
+            m_velocityCorrections[k] = count ? dv / float(count) : dv;
+            contacts += count ? 1 : 0;
+        }
+
+        #pragma omp parallel for schedule(static) if(active > 4096)
+        for (int k = 0; k < active; ++k)
+        {
+            unsigned int slot = m_slots[m_sorted[k]];
+            positions[slot] += m_positionCorrections[k];
+            velocities[slot] += m_velocityCorrections[k];
+        }
+        m_contactCount = contacts;
+    }
+    return true;
+}
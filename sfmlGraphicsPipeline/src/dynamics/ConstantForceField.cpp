@@ -1,4 +1,5 @@
 #include "./../../include/dynamics/ConstantForceField.hpp"
+#include "./../../include/dynamics/ParticleStore.hpp"
 
 ConstantForceField::ConstantForceField(const std::vector<ParticlePtr>& particles, const glm::vec3& force)
 {
@@ -14,6 +15,36 @@ void ConstantForceField::do_addForce()
     }
 }
 
+bool ConstantForceField::do_addForce(const ParticleStore& store, glm::vec3* forces) const
+{
+    for(const ParticlePtr & p : m_particles)
+    {
+        if(p->getStore() != &store)
+            return false;
+    }
+    for(const ParticlePtr & p : m_particles)
+    {
+        forces[p->getStoreIndex()] += m_force*p->getMass();
+    }
+    return true;
+}
+
+bool ConstantForceField::do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const
+{
+    for(const ParticlePtr & p : m_particles)
+    {
+        if(p->getStore() != &store)
+            return false;
+    }
+    //Each particle only depends on itself
+    for(const ParticlePtr & p : m_particles)
+    {
+        unsigned int i = p->getStoreIndex();
+        couplings.push_back(std::make_pair(i, i));
+    }
+    return true;
+}
+
 const std::vector<ParticlePtr> ConstantForceField::getParticles()
 {
     return m_particles;
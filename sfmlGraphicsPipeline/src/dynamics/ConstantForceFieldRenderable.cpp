@@ -27,8 +27,8 @@ void ConstantForceFieldRenderable::update_particle_positions()
     const std::vector<ParticlePtr> & particles = m_forceField->getParticles();
     for(size_t i=0;i<particles.size();++i)
     {
-        m_positions[2*i+0] = particles[i]->getPosition();
-        m_positions[2*i+1] = particles[i]->getPosition() + 0.1f*m_forceField->getForce();
+        m_positions[2*i+0] = particles[i]->getRenderPosition();
+        m_positions[2*i+1] = particles[i]->getRenderPosition() + 0.1f*m_forceField->getForce();
         m_colors[2*i+0] = glm::vec4(1.0,0.0,0.0,1.0);
         m_colors[2*i+1] = glm::vec4(1.0,0.0,0.0,1.0);
         m_normals[2*i+0] = glm::vec3(1.0,0.0,0.0);
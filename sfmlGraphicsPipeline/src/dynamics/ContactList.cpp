@@ -0,0 +1,198 @@
+#include "./../../include/dynamics/ContactList.hpp"
+
+#include <cmath>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+ContactList::ContactList()
+{}
+
+ContactList::~ContactList()
+{}
+
+void ContactList::clear()
+{
+    m_planeContacts.clear();
+    m_particleContacts.clear();
+    m_meshContacts.clear();
+}
+
+void ContactList::reserve(size_t planeContacts, size_t particleContacts)
+{
+    m_planeContacts.reserve(planeContacts);
+    m_particleContacts.reserve(particleContacts);
+}
+
+void ContactList::detectPlaneContacts(const ParticleStore& store, const std::vector< PlanePtr >& planes)
+{
+    const ParticleStore::Array< glm::vec3 > & positions = store.positions();
+    const ParticleStore::Array< float > & radii = store.radii();
+    const ParticleStore::Array< unsigned char > & flags = store.flags();
+
+    for (unsigned int o = 0; o < planes.size(); ++o)
+    {
+        const glm::vec3 & n = planes[o]->normal();
+        const float d = planes[o]->distanceToOrigin();
+        for (unsigned int i = 0; i < store.size(); ++i)
+        {
+            // A plane collides with a particle if abs(dot(c, n) - d) <= r
+            float distance = glm::dot(positions[i], n) - d;
+            if (flags[i] || std::abs(distance) > radii[i])
+                continue;
+            ParticlePlaneContact contact;
+            contact.particle = i;
+            contact.plane = o;
+            contact.normal = distance >= 0 ? n : -n;
+            contact.depth = radii[i] - std::abs(distance);
+            m_planeContacts.push_back(contact);
+        }
+    }
+}
+
+void ContactList::detectMeshContacts(const ParticleStore& store, const std::vector< MeshColliderPtr >& meshes)
+{
+    if (meshes.empty())
+        return;
+    const glm::vec3* positions = store.positions().data();
+    const float* radii = store.radii().data();
+    const unsigned char* flags = store.flags().data();
+    const int n = store.size();
+    const unsigned int meshCount = meshes.size();
+
+    std::vector< glm::vec3 > minima(meshCount), maxima(meshCount);
+    for (unsigned int o = 0; o < meshCount; ++o)
+        meshes[o]->getBounds(minima[o], maxima[o]);
+
+    // Each thread fills its own array, then the arrays are appended in the
+    // order of the threads: the contacts are sorted by slot. All the arrays
+    // are cleared, the team may be smaller than the maximum
+    int threadCount = 1;
+#ifdef _OPENMP
+    threadCount = omp_get_max_threads();
+#endif
+    m_threadMeshContacts.resize(threadCount);
+    for (std::vector< ParticleMeshContact > & contacts : m_threadMeshContacts)
+        contacts.clear();
+    #pragma omp parallel if(n > 1000)
+    {
+        int thread = 0;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#endif
+        std::vector< ParticleMeshContact > & contacts = m_threadMeshContacts[thread];
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; ++i)
+        {
+            if (flags[i])
+                continue;
+            const glm::vec3 & c = positions[i];
+            const float r = radii[i];
+            for (unsigned int o = 0; o < meshCount; ++o)
+            {
+                if (glm::any(glm::lessThan(c + r, minima[o])) || glm::any(glm::greaterThan(c - r, maxima[o])))
+                    continue;
+                ParticleMeshContact contact;
+                if (!meshes[o]->collide(c, r, contact.normal, contact.depth))
+                    continue;
+                contact.particle = i;
+                contact.mesh = o;
+                contacts.push_back(contact);
+            }
+        }
+    }
+    for (const std::vector< ParticleMeshContact > & contacts : m_threadMeshContacts)
+        m_meshContacts.insert(m_meshContacts.end(), contacts.begin(), contacts.end());
+}
+
+void ContactList::addParticleContacts(const ParticleStore& store, const std::vector< SpatialHashBroadphase::Pair >& pairs)
+{
+    const ParticleStore::Array< glm::vec3 > & positions = store.positions();
+    const ParticleStore::Array< float > & radii = store.radii();
+
+    for (const SpatialHashBroadphase::Pair & pair : pairs)
+    {
+        glm::vec3 d = positions[pair.first] - positions[pair.second];
+        float distance = glm::length(d);
+        ParticleParticleContact contact;
+        contact.particle1 = pair.first;
+        contact.particle2 = pair.second;
+        // Particles at the same place are separated vertically
+        contact.normal = distance > 0 ? d / distance : glm::vec3(0, 1, 0);
+        contact.depth = radii[pair.first] + radii[pair.second] - distance;
+        m_particleContacts.push_back(contact);
+    }
+}
+
+void ContactList::solve(ParticleStore& store, float restitution) const
+{
+    ParticleStore::Array< glm::vec3 > & positions = store.positions();
+    ParticleStore::Array< glm::vec3 > & velocities = store.velocities();
+    const ParticleStore::Array< float > & inverseMasses = store.inverseMasses();
+    const ParticleStore::Array< float > & radii = store.radii();
+    const ParticleStore::Array< unsigned char > & flags = store.flags();
+
+    for (const ParticleParticleContact & contact : m_particleContacts)
+    {
+        unsigned int i = contact.particle1, j = contact.particle2;
+        // Fixed particles behave as if their mass was infinite
+        float w1 = (flags[i] & ParticleStore::FIXED) ? 0.0f : inverseMasses[i];
+        float w2 = (flags[j] & ParticleStore::FIXED) ? 0.0f : inverseMasses[j];
+        float w = w1 + w2;
+        if (w <= 0)
+            continue;
+        // The previous contacts may have moved the particles since the detection
+        glm::vec3 d = positions[i] - positions[j];
+        float distance = glm::length(d);
+        float depth = radii[i] + radii[j] - distance;
+        if (depth <= 0)
+            continue;
+        const glm::vec3 k = distance > 0 ? d / distance : contact.normal;
+
+        // Move each particle along the normal, the lightest one the most
+        positions[i] += (w1 / w) * depth * k;
+        positions[j] -= (w2 / w) * depth * k;
+
+        float impulse = (1.0f + restitution) * glm::dot(k, velocities[i] - velocities[j]) / w;
+        velocities[i] -= impulse * w1 * k;
+        velocities[j] += impulse * w2 * k;
+    }
+
+    for (const ParticlePlaneContact & contact : m_planeContacts)
+    {
+        unsigned int i = contact.particle;
+        if (flags[i])
+            continue;
+        const glm::vec3 & n = contact.normal;
+        positions[i] += contact.depth * n;
+        velocities[i] -= (1.0f + restitution) * glm::dot(velocities[i], n) * n;
+    }
+
+    for (const ParticleMeshContact & contact : m_meshContacts)
+    {
+        unsigned int i = contact.particle;
+        if (flags[i])
+            continue;
+        const glm::vec3 & n = contact.normal;
+        positions[i] += contact.depth * n;
+        // The normal varies along a mesh: only the velocity toward the mesh is reflected
+        float speed = glm::dot(velocities[i], n);
+        if (speed < 0)
+            velocities[i] -= (1.0f + restitution) * speed * n;
+    }
+}
+
+const std::vector< ParticlePlaneContact > & ContactList::planeContacts() const
+{
+    return m_planeContacts;
+}
+
+const std::vector< ParticleParticleContact > & ContactList::particleContacts() const
+{
+    return m_particleContacts;
+}
+
+const std::vector< ParticleMeshContact > & ContactList::meshContacts() const
+{
+    return m_meshContacts;
+}
@@ -1,4 +1,6 @@
 #include "./../../include/dynamics/DampingForceField.hpp"
+#include "./../../include/dynamics/ParticleStore.hpp"
+#include "./../../include/dynamics/BlockSparseMatrix.hpp"
 
 DampingForceField::DampingForceField(const std::vector<ParticlePtr> particles, const float damping)
 {
@@ -14,6 +16,62 @@ void DampingForceField::do_addForce()
     }
 }
 
+bool DampingForceField::do_addForce(const ParticleStore& store, glm::vec3* forces) const
+{
+    for(const ParticlePtr & p : m_particles)
+    {
+        if(p->getStore() != &store)
+            return false;
+    }
+    for(const ParticlePtr & p : m_particles)
+    {
+        size_t i = p->getStoreIndex();
+        forces[i] -= m_damping*store.velocities()[i];
+    }
+    return true;
+}
+
+bool DampingForceField::do_addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const
+{
+    for(const ParticlePtr & p : m_particles)
+    {
+        if(p->getStore() != &store)
+            return false;
+    }
+    for(const ParticlePtr & p : m_particles)
+    {
+        size_t i = p->getStoreIndex();
+        dfdv.addBlock(i, i, glm::mat3(-m_damping));
+    }
+    return true;
+}
+
+float DampingForceField::do_addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const
+{
+    for(const ParticlePtr & p : m_particles)
+    {
+        if(p->getStore() == &store)
+            damping[p->getStoreIndex()] += m_damping;
+    }
+    return 0.0f;
+}
+
+bool DampingForceField::do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const
+{
+    for(const ParticlePtr & p : m_particles)
+    {
+        if(p->getStore() != &store)
+            return false;
+    }
+    //Each particle only depends on itself
+    for(const ParticlePtr & p : m_particles)
+    {
+        unsigned int i = p->getStoreIndex();
+        couplings.push_back(std::make_pair(i, i));
+    }
+    return true;
+}
+
 const std::vector<ParticlePtr> DampingForceField::getParticles()
 {
     return m_particles;
@@ -1,19 +1,34 @@
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/norm.hpp>
 
 #include "./../../include/gl_helper.hpp"
+#include "./../../include/log.hpp"
 #include "./../../include/dynamics/DynamicSystem.hpp"
-#include "./../../include/dynamics/ParticlePlaneCollision.hpp"
-#include "./../../include/dynamics/ParticleParticleCollision.hpp"
 
 
 DynamicSystem::DynamicSystem() :
+    m_reorderInterval(0),
+    m_stepsSinceReorder(0),
     m_dt(0.1),
-    m_restitution(1.0),
-    m_handleCollisions(true)
+    m_adaptiveTimeStep(false),
+    m_minDt(1e-5),
+    m_maxDt(1.0/30.0),
+    m_courantNumber(0.9),
+    m_maxStrain(0.02),
+    m_timeStepChosen(false),
+    m_logSteps(0),
+    m_logTime(0),
+    m_logMinDt(0),
+    m_logMaxDt(0),
+    m_handleCollisions(true),
+    m_restitution(1.0)
 {}
 
 glm::vec3 DynamicSystem::gravity = glm::vec3(0.0, -9.81, 0.0);
@@ -24,9 +39,80 @@ const std::vector<ParticlePtr>& DynamicSystem::getParticles() const
     return m_particles;
 }
 
+ParticleStore& DynamicSystem::getParticleStore()
+{
+    return m_store;
+}
+
+SimulationIslands& DynamicSystem::getIslands()
+{
+    return m_islands;
+}
+
+void DynamicSystem::wakeUp()
+{
+    m_islands.wakeUp(m_store);
+}
+
+void DynamicSystem::setReorderInterval(unsigned int steps)
+{
+    m_reorderInterval = steps;
+    m_stepsSinceReorder = 0;
+}
+
+unsigned int DynamicSystem::getReorderInterval() const
+{
+    return m_reorderInterval;
+}
+
+void DynamicSystem::reorderParticles()
+{
+    const size_t n = m_store.size();
+    if(n < 2 || m_particles.size() != n)
+        return;
+    m_stepsSinceReorder = 0;
+    m_mortonOrder.sort(m_store, m_order);
+    m_store.permute(m_order);
+
+    //The slot i of the store still holds the particle m_particles[i]
+    std::vector<ParticlePtr> particles(n);
+    for(size_t k = 0; k < n; ++k)
+        particles[k] = m_particles[m_order[k]];
+    m_particles.swap(particles);
+    m_islands.permute(m_order);
+    if(m_solver)
+        m_solver->invalidateSlots();
+
+    //Compose with the reorderings not taken yet
+    if(!m_reordering.empty())
+    {
+        for(size_t k = m_reordering.size(); k < n; ++k)
+            m_reordering.push_back(k);
+        for(size_t k = 0; k < n; ++k)
+            m_order[k] = m_reordering[m_order[k]];
+    }
+    m_reordering.swap(m_order);
+}
+
+bool DynamicSystem::takeReordering(std::vector<unsigned int>& order)
+{
+    if(m_reordering.empty())
+        return false;
+    order.swap(m_reordering);
+    m_reordering.clear();
+    return true;
+}
+
 void DynamicSystem::setParticles(const std::vector<ParticlePtr> &particles)
 {
-    m_particles = particles;
+    m_store.clear();
+    m_particles.clear();
+    m_islands.invalidate();
+    m_reordering.clear();
+    for(ParticlePtr p : particles)
+    {
+        addParticle(p);
+    }
 }
 
 const std::vector<ForceFieldPtr>& DynamicSystem::getForceFields() const
@@ -50,13 +136,123 @@ void DynamicSystem::setDt(float dt)
     m_dt = dt;
 }
 
+void DynamicSystem::setAdaptiveTimeStep(bool onOff)
+{
+    m_adaptiveTimeStep = onOff;
+    m_timeStepChosen = false;
+}
+
+bool DynamicSystem::getAdaptiveTimeStep() const
+{
+    return m_adaptiveTimeStep;
+}
+
+void DynamicSystem::setTimeStepBounds(float minDt, float maxDt)
+{
+    m_minDt = std::max(0.0f, std::min(minDt, maxDt));
+    m_maxDt = std::max(minDt, maxDt);
+    m_timeStepChosen = false;
+}
+
+void DynamicSystem::setCourantNumber(float courantNumber)
+{
+    m_courantNumber = std::max(0.0f, std::min(courantNumber, 1.0f));
+    m_timeStepChosen = false;
+}
+
+void DynamicSystem::setMaxStrainPerStep(float maxStrain)
+{
+    m_maxStrain = maxStrain;
+    m_timeStepChosen = false;
+}
+
+float DynamicSystem::updateTimeStep()
+{
+    if(!m_adaptiveTimeStep || m_timeStepChosen)
+        return m_dt;
+
+    //Stiffness and damping felt by each slot, and the fastest deformation.
+    //Fields the solver integrates stably only limit the deformation
+    const int slotCount = static_cast<int>(m_store.size());
+    m_stiffnessBounds.assign(2 * slotCount, 0.0f);
+    m_dampingBounds.assign(2 * slotCount, 0.0f);
+    float strainRate = 0.0f;
+    for(const ForceFieldPtr & forceField : m_forceFields)
+    {
+        size_t offset = m_solver && m_solver->isUnconditionallyStable(*forceField) ? slotCount : 0;
+        strainRate = std::max(strainRate, forceField->addStabilityBounds(m_store,
+                              m_stiffnessBounds.data() + offset, m_dampingBounds.data() + offset));
+    }
+
+    //The fastest mode of a slot has a pulsation omega^2 = K / m and a damping
+    //rate gamma = C / m. The semi-implicit Euler integration is stable for
+    //dt <= 2 / omega * (sqrt(1 + zeta^2) - zeta), where zeta = gamma / (2 omega)
+    const float* stiffness = m_stiffnessBounds.data();
+    const float* damping = m_dampingBounds.data();
+    const float* inverseMasses = m_store.inverseMasses().data();
+    const unsigned char* flags = m_store.flags().data();
+    float dt = m_maxDt;
+    #pragma omp parallel for reduction(min:dt) schedule(static) if(slotCount > 4096)
+    for(int i = 0; i < slotCount; ++i)
+    {
+        if(flags[i])
+            continue;
+        float omega = std::sqrt(inverseMasses[i] * stiffness[i]);
+        float gamma = inverseMasses[i] * damping[i];
+        float limit = dt;
+        if(omega > 0)
+        {
+            float zeta = gamma / (2.0f * omega);
+            limit = 2.0f / omega * (std::sqrt(1.0f + zeta * zeta) - zeta);
+        }
+        else if(gamma > 0)
+        {
+            limit = 2.0f / gamma;
+        }
+        dt = std::min(dt, m_courantNumber * limit);
+    }
+    if(strainRate > 0)
+        dt = std::min(dt, m_maxStrain / strainRate);
+
+    //Grow smoothly, as the limits are estimated at the start of the step
+    dt = std::min(dt, 1.5f * m_dt);
+    m_dt = std::max(m_minDt, std::min(dt, m_maxDt));
+    m_timeStepChosen = true;
+    return m_dt;
+}
+
+void DynamicSystem::logTimeStep()
+{
+    if(m_logSteps == 0)
+    {
+        m_logMinDt = m_dt;
+        m_logMaxDt = m_dt;
+    }
+    ++m_logSteps;
+    m_logTime += m_dt;
+    m_logMinDt = std::min(m_logMinDt, m_dt);
+    m_logMaxDt = std::max(m_logMaxDt, m_dt);
+    if(m_logTime >= 1.0f)
+    {
+        LOG(info, "adaptive time step: " << m_logSteps << " steps in " << m_logTime << " s, dt in ["
+            << m_logMinDt << ", " << m_logMaxDt << "], mean " << m_logTime / m_logSteps);
+        m_logSteps = 0;
+        m_logTime = 0;
+    }
+}
+
 DynamicSystem::~DynamicSystem() {}
 
 void DynamicSystem::clear()
 {
+    m_store.clear();
     m_particles.clear();
     m_forceFields.clear();
     m_planeObstacles.clear();
+    m_meshObstacles.clear();
+    m_selfCollisions.clear();
+    m_islands.invalidate();
+    m_reordering.clear();
 }
 
 bool DynamicSystem::getCollisionDetection()
@@ -71,7 +267,18 @@ void DynamicSystem::setCollisionsDetection(bool onOff)
 
 void DynamicSystem::addParticle(ParticlePtr p)
 {
+    //A particle is only added once: its slot in the store matches its index
+    if(p->getStore() == &m_store)
+        return;
+    //A particle added before, then attached elsewhere, still owns its detached
+    //slot here: adding it again would list it twice
+    if(m_store.detachedCount() > 0 && std::find(m_particles.begin(), m_particles.end(), p) != m_particles.end())
+    {
+        LOG(warning, "the particle was already added to this system before being attached elsewhere, it is not added again");
+        return;
+    }
     m_particles.push_back(p);
+    m_store.attach(*p);
 }
 
 void DynamicSystem::addForceField(ForceFieldPtr forceField)
@@ -84,6 +291,16 @@ void DynamicSystem::addPlaneObstacle(PlanePtr planeObstacle)
     m_planeObstacles.push_back(planeObstacle);
 }
 
+void DynamicSystem::addMeshObstacle(MeshColliderPtr meshObstacle)
+{
+    m_meshObstacles.push_back(meshObstacle);
+}
+
+void DynamicSystem::addSelfCollision(ClothSelfCollisionPtr selfCollision)
+{
+    m_selfCollisions.push_back(selfCollision);
+}
+
 SolverPtr DynamicSystem::getSolver()
 {
     return m_solver;
@@ -96,59 +313,144 @@ void DynamicSystem::setSolver(SolverPtr solver)
 
 void DynamicSystem::detectCollisions()
 {
+    //Contacts are stored in arrays reused from one step to the next
+    m_contacts.clear();
+
     //Detect particle plane collisions
-    for(ParticlePtr p : m_particles)
+    m_contacts.detectPlaneContacts(m_store, m_planeObstacles);
+
+    //Detect particle mesh collisions, through the hierarchy of each mesh
+    m_contacts.detectMeshContacts(m_store, m_meshObstacles);
+
+    //Detect particle particle collisions: the broadphase only returns the
+    //overlapping pairs, instead of testing all of them
+    m_broadphase.findPairs(m_store, m_pairs);
+    m_contacts.addParticleContacts(m_store, m_pairs);
+}
+
+void DynamicSystem::solveCollisions()
+{
+    m_contacts.solve(m_store, m_restitution);
+    m_contacts.clear();
+}
+
+void DynamicSystem::accumulateForces()
+{
+    m_store.clearForces();
+    const int slotCount = static_cast<int>(m_store.size());
+    glm::vec3* storeForces = m_store.forces().data();
+
+    //Each island writes the forces of its own slots directly in the store
+    const std::vector<unsigned int> & islands = m_islands.activeIslands();
+    const std::vector< std::vector<unsigned int> > & islandFields = m_islands.islandForceFields();
+    std::vector<int> islandFallbacks;
+    #pragma omp parallel if(islands.size() > 1)
+    #pragma omp single
+    for(unsigned int island : islands)
     {
-        for(PlanePtr o : m_planeObstacles)
+        #pragma omp task firstprivate(island)
+        for(unsigned int f : islandFields[island])
         {
-            if(testParticlePlane(p, o))
+            if(m_solver && m_solver->convertsForceField(*m_forceFields[f]))
+                continue;
+            if(!m_forceFields[f]->addForce(m_store, storeForces))
             {
-                ParticlePlaneCollisionPtr c = std::make_shared<ParticlePlaneCollision>(p,o,m_restitution);
-                m_collisions.push_back(c);
+                #pragma omp critical
+                islandFallbacks.push_back(f);
             }
         }
     }
+    for(int f : islandFallbacks)
+        m_forceFields[f]->addForce();
+
+    //Fields shared by several islands, acting on an awake particle
+    const std::vector<unsigned int> & shared = m_islands.sharedForceFields();
+    const int fieldCount = static_cast<int>(shared.size());
+    if(fieldCount == 0)
+        return;
 
-    //Detect particle particle collisions
-    for(size_t i=0; i<m_particles.size(); ++i)
+    int maxThreads = 1;
+#ifdef _OPENMP
+    maxThreads = omp_get_max_threads();
+#endif
+    //Thread 0 adds its forces directly to the store, the other threads to
+    //their own buffer, summed at the end
+    m_threadForces.resize(maxThreads - 1);
+    //The team may be smaller than maxThreads: clear every list, so that the
+    //lists of the threads that do not run are not replayed
+    m_threadFallbacks.resize(maxThreads);
+    for(std::vector<int> & threadFallbacks : m_threadFallbacks)
+        threadFallbacks.clear();
+
+    #pragma omp parallel
     {
-        for(size_t j=i; j<m_particles.size(); ++j)
+        int thread = 0, threadCount = 1;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+        threadCount = omp_get_num_threads();
+#endif
+        glm::vec3* forces = storeForces;
+        if(thread > 0)
+        {
+            m_threadForces[thread-1].assign(slotCount, glm::vec3(0.0,0.0,0.0));
+            forces = m_threadForces[thread-1].data();
+        }
+        std::vector<int> & fallbacks = m_threadFallbacks[thread];
+
+        //Static schedule: the forces are summed in the same order at each step
+        #pragma omp for schedule(static)
+        for(int s = 0; s < fieldCount; ++s)
+        {
+            //Fields converted by the solver, e.g. into constraints, add no force
+            const int f = shared[s];
+            if(m_solver && m_solver->convertsForceField(*m_forceFields[f]))
+                continue;
+            if(!m_forceFields[f]->addForce(m_store, forces))
+                fallbacks.push_back(f);
+        }
+
+        if(threadCount > 1)
         {
-            ParticlePtr p1 = m_particles[i];
-            ParticlePtr p2 = m_particles[j];
-            if(testParticleParticle(p1,p2))
+            #pragma omp for schedule(static)
+            for(int i = 0; i < slotCount; ++i)
             {
-                ParticleParticleCollisionPtr c = std::make_shared<ParticleParticleCollision>(p1,p2,m_restitution);
-                m_collisions.push_back(c);
+                for(int t = 0; t < threadCount-1; ++t)
+                    storeForces[i] += m_threadForces[t][i];
             }
         }
-    }
-}
 
-void DynamicSystem::solveCollisions()
-{
-    while(!m_collisions.empty())
-    {
-        CollisionPtr collision = m_collisions.back();
-        collision->solveCollision();
-        m_collisions.pop_back();
+        //Fields that do not support force buffers write through the particles
+        #pragma omp single
+        for(const std::vector<int> & threadFallbacks : m_threadFallbacks)
+        {
+            for(int f : threadFallbacks)
+                m_forceFields[f]->addForce();
+        }
     }
 }
 
 void DynamicSystem::computeSimulationStep()
 {
+    //Choose the time step, if the caller did not
+    updateTimeStep();
+
+    //Sort the particles along a Z-order curve from time to time
+    if(m_reorderInterval > 0 && ++m_stepsSinceReorder >= m_reorderInterval)
+        reorderParticles();
+
+    //Group the particles into islands, and skip the sleeping ones
+    m_islands.update(m_store, m_forceFields);
+
     //Compute particle's force
-    for(ParticlePtr p : m_particles)
-    {
-        p->setForce(glm::vec3(0.0,0.0,0.0));
-    }
-    for(ForceFieldPtr f : m_forceFields)
-    {
-        f->addForce();
-    }
+    accumulateForces();
 
     //Integrate position and velocity of particles
-    m_solver->solve(m_dt, m_particles);
+    m_solver->solve(m_dt, m_store, m_particles, m_forceFields);
+
+    //Keep the cloths from going through themselves, before the obstacles push
+    //them. A cloth whose particles are not in the system is ignored
+    for(ClothSelfCollisionPtr & selfCollision : m_selfCollisions)
+        selfCollision->solve(m_store);
 
     //Detect and resolve collisions
     if(m_handleCollisions)
@@ -156,6 +458,19 @@ void DynamicSystem::computeSimulationStep()
         detectCollisions();
         solveCollisions();
     }
+    else
+    {
+        m_pairs.clear();
+    }
+
+    //Put the islands at rest to sleep, unless they touch an awake one
+    m_islands.updateSleep(m_store, m_pairs, m_dt);
+
+    if(m_adaptiveTimeStep)
+    {
+        logTimeStep();
+        m_timeStepChosen = false;
+    }
 }
 
 const float DynamicSystem::getRestitution()
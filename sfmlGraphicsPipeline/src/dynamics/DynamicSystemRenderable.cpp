@@ -1,6 +1,7 @@
 #include <cmath>
 #include <iostream>
 #include <map>
+#include <algorithm>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/random.hpp>
@@ -13,7 +14,9 @@ DynamicSystemRenderable::~DynamicSystemRenderable()
 {}
 
 DynamicSystemRenderable::DynamicSystemRenderable(DynamicSystemPtr system) :
-    HierarchicalRenderable(nullptr), m_lastUpdateTime( 0 )
+    HierarchicalRenderable(nullptr), m_lastUpdateTime( 0 ), m_accumulator( 0 ),
+    m_maxStepsPerFrame( 8 ), m_interpolation( true ), m_stateTime( 0 ), m_started( false ),
+    m_checkpointInterval( 0.5 )
 {
     m_system = system;
 }
@@ -23,13 +26,119 @@ void DynamicSystemRenderable::do_draw()
 
 void DynamicSystemRenderable::do_animate(float time )
 {
-    if( time - m_lastUpdateTime >= m_system->getDt() )
+    ParticleStore & store = m_system->getParticleStore();
+    if( !m_started )
     {
-        //Dynamic system step
-        m_system->computeSimulationStep();
-        m_lastUpdateTime = time;
+        m_started = true;
+        m_lastUpdateTime = m_stateTime = time;
+        if( m_checkpointInterval > 0 )
+            m_checkpoints.capture( m_stateTime, *m_system );
     }
 
+    float elapsed = time - m_lastUpdateTime;
+    m_lastUpdateTime = time;
+    //The animation was restarted, looped or moved: long frames are not seeks,
+    //they stay limited to m_maxStepsPerFrame
+    if( elapsed < 0 || ( m_viewer && m_viewer->isSeeking() ) )
+    {
+        seek( time );
+    }
+    else
+    {
+        m_accumulator += elapsed;
+        unsigned int steps = 0;
+        while( m_accumulator >= m_system->updateTimeStep() && steps < m_maxStepsPerFrame )
+        {
+            step();
+            ++steps;
+        }
+        //Drop the time that could not be simulated during this frame
+        float dt = m_system->updateTimeStep();
+        if( m_accumulator >= dt )
+            m_accumulator = std::fmod( m_accumulator, dt );
+    }
+
+    if( m_interpolation )
+        store.interpolatePositions( m_accumulator / m_system->updateTimeStep() );
+}
+
+void DynamicSystemRenderable::step()
+{
+    //The time step of this step, which varies in adaptive mode
+    float dt = m_system->updateTimeStep();
+    m_system->getParticleStore().savePreviousPositions();
+    m_system->computeSimulationStep();
+    //The snapshots follow the particles moved to other slots
+    if( m_system->takeReordering( m_reordering ) )
+        m_checkpoints.permute( m_reordering );
+    m_accumulator -= dt;
+    m_stateTime += dt;
+
+    if( m_checkpointInterval > 0 && m_stateTime >= m_checkpoints.latestTime() + m_checkpointInterval )
+        m_checkpoints.capture( m_stateTime, *m_system );
+}
+
+void DynamicSystemRenderable::seek(float time)
+{
+    //Restore the latest checkpoint before the time, unless the current state is closer
+    bool forward = time >= m_stateTime;
+    float checkpointTime = m_checkpointInterval > 0 ? m_checkpoints.latestTimeBefore( time ) : -1;
+    if( checkpointTime >= 0 && ( !forward || checkpointTime > m_stateTime )
+        && m_checkpoints.restore( time, *m_system, checkpointTime ) )
+    {
+        m_stateTime = checkpointTime;
+        m_system->wakeUp();
+    }
+    else if( !forward )
+    {
+        //No checkpoint: the simulation goes on from its current state
+        m_stateTime = time;
+    }
+
+    //Simulate the remaining time, without limit of steps
+    m_accumulator = time - m_stateTime;
+    while( m_accumulator >= m_system->updateTimeStep() )
+        step();
+    m_system->getParticleStore().savePreviousPositions();
+}
+
+void DynamicSystemRenderable::setCheckpointInterval(float interval)
+{
+    m_checkpointInterval = std::max( 0.0f, interval );
+    if( m_checkpointInterval == 0 )
+        m_checkpoints.clear();
+}
+
+float DynamicSystemRenderable::getCheckpointInterval() const
+{
+    return m_checkpointInterval;
+}
+
+SimulationCheckpoints& DynamicSystemRenderable::getCheckpoints()
+{
+    return m_checkpoints;
+}
+
+void DynamicSystemRenderable::setMaxStepsPerFrame(unsigned int steps)
+{
+    m_maxStepsPerFrame = std::max( 1u, steps );
+}
+
+unsigned int DynamicSystemRenderable::getMaxStepsPerFrame() const
+{
+    return m_maxStepsPerFrame;
+}
+
+void DynamicSystemRenderable::setInterpolation(bool onOff)
+{
+    m_interpolation = onOff;
+    if( !m_interpolation )
+        m_system->getParticleStore().stopInterpolation();
+}
+
+bool DynamicSystemRenderable::getInterpolation() const
+{
+    return m_interpolation;
 }
 
 void DynamicSystemRenderable::setDynamicSystem(const DynamicSystemPtr &system)
@@ -39,6 +148,15 @@ void DynamicSystemRenderable::setDynamicSystem(const DynamicSystemPtr &system)
 
 void DynamicSystemRenderable::do_keyPressedEvent(sf::Event &e)
 {
+    //Toggling the collisions and tilting change the future of the simulation,
+    //other keys (camera, viewer) leave the checkpoints valid
+    if( e.key.code == sf::Keyboard::A || e.key.code == sf::Keyboard::T )
+        m_checkpoints.discardAfter( m_stateTime );
+    //Sleeping particles would not react to the changes. Other keys must not
+    //wake them up: held camera keys repeat at each frame
+    if( e.key.code == sf::Keyboard::A || e.key.code == sf::Keyboard::T || e.key.code == sf::Keyboard::F5 )
+        m_system->wakeUp();
+
     if(e.key.code == sf::Keyboard::A ) //Toggle collision detection
     {
         m_system->setCollisionsDetection( !m_system->getCollisionDetection() );
@@ -53,6 +171,10 @@ void DynamicSystemRenderable::do_keyPressedEvent(sf::Event &e)
             pos += glm::ballRand(1.0f);
             p->setPosition(pos);
         }
+        //Draw the new positions now, even if the animation is paused
+        m_system->getParticleStore().savePreviousPositions();
+        if( m_interpolation )
+            m_system->getParticleStore().interpolatePositions( 1 );
     }
     else if( e.key.code == sf::Keyboard::F5 ) //Reset the simulation
     {
@@ -60,7 +182,10 @@ void DynamicSystemRenderable::do_keyPressedEvent(sf::Event &e)
         {
             p->restart();
         }
-        m_lastUpdateTime = 0;
+        m_system->getParticleStore().savePreviousPositions();
+        if( m_interpolation )
+            m_system->getParticleStore().interpolatePositions( 1 );
+        m_accumulator = 0;
     }
     else //Propagate events to the children
     {
@@ -14,7 +14,7 @@ void EulerExplicitSolver::do_solve(const float& dt, std::vector<ParticlePtr>& pa
 {
     for(ParticlePtr p : particles)
     {
-        if(!p->isFixed())
+        if(!p->isFixed() && !p->isSleeping())
         {
             //TODO: Implement explicit euler solver
             //Functions to use:
@@ -29,3 +29,8 @@ void EulerExplicitSolver::do_solve(const float& dt, std::vector<ParticlePtr>& pa
         }
     }
 }
+
+void EulerExplicitSolver::do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles)
+{
+    store.integrateExplicitEuler(dt);
+}
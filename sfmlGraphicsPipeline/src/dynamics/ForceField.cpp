@@ -8,3 +8,44 @@ void ForceField::addForce()
 {
   do_addForce();
 }
+
+bool ForceField::addForce(const ParticleStore& store, glm::vec3* forces) const
+{
+  return do_addForce(store, forces);
+}
+
+bool ForceField::do_addForce(const ParticleStore& store, glm::vec3* forces) const
+{
+  return false;
+}
+
+
+bool ForceField::addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const
+{
+  return do_addJacobians(store, dfdx, dfdv);
+}
+
+bool ForceField::do_addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const
+{
+  return false;
+}
+
+float ForceField::addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const
+{
+  return do_addStabilityBounds(store, stiffness, damping);
+}
+
+float ForceField::do_addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const
+{
+  return 0.0f;
+}
+
+bool ForceField::addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const
+{
+  return do_addCouplings(store, couplings);
+}
+
+bool ForceField::do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const
+{
+  return false;
+}
\ No newline at end of file
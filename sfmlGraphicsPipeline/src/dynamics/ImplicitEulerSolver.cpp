@@ -0,0 +1,185 @@
+#include "./../../include/dynamics/ImplicitEulerSolver.hpp"
+
+ImplicitEulerSolver::ImplicitEulerSolver(int maxIterations, float tolerance) :
+    m_maxIterations(maxIterations),
+    m_tolerance(tolerance),
+    m_lastIterationCount(0)
+{}
+
+ImplicitEulerSolver::~ImplicitEulerSolver()
+{}
+
+int ImplicitEulerSolver::getMaxIterations() const
+{
+    return m_maxIterations;
+}
+
+void ImplicitEulerSolver::setMaxIterations(int maxIterations)
+{
+    m_maxIterations = maxIterations;
+}
+
+float ImplicitEulerSolver::getTolerance() const
+{
+    return m_tolerance;
+}
+
+void ImplicitEulerSolver::setTolerance(float tolerance)
+{
+    m_tolerance = tolerance;
+}
+
+int ImplicitEulerSolver::getLastIterationCount() const
+{
+    return m_lastIterationCount;
+}
+
+void ImplicitEulerSolver::do_solve(const float& dt, std::vector<ParticlePtr>& particles)
+{
+    //Without force fields there are no Jacobians: this is a semi-implicit Euler step
+    for(ParticlePtr p : particles)
+    {
+        if(!p->isFixed() && !p->isSleeping())
+        {
+            p->setVelocity(p->getVelocity() + (dt / p->getMass()) * p->getForce());
+            p->setPosition(p->getPosition() + dt * p->getVelocity());
+        }
+    }
+    m_lastIterationCount = 0;
+}
+
+void ImplicitEulerSolver::do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles)
+{
+    do_solve(dt, store, particles, std::vector<ForceFieldPtr>());
+}
+
+bool ImplicitEulerSolver::do_isUnconditionallyStable(const ForceField& forceField) const
+{
+    //Fields with Jacobians are integrated implicitly. The other ones do not
+    //bound their stiffness anyway
+    return true;
+}
+
+void ImplicitEulerSolver::filter(glm::vec3* x) const
+{
+    const int n = static_cast<int>(m_moving.size());
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < n; ++i)
+    {
+        if(!m_moving[i])
+            x[i] = glm::vec3(0.0f);
+    }
+}
+
+void ImplicitEulerSolver::multiply(float dt, const glm::vec3* x, glm::vec3* y) const
+{
+    const int n = static_cast<int>(m_masses.size());
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < n; ++i)
+        y[i] = m_masses[i] * x[i];
+    m_dfdv.multiplyAdd(-dt, x, y);
+    m_dfdx.multiplyAdd(-dt * dt, x, y);
+    filter(y);
+}
+
+static float dot(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b)
+{
+    const int n = static_cast<int>(a.size());
+    float sum = 0.0f;
+    #pragma omp parallel for schedule(static) reduction(+:sum)
+    for(int i = 0; i < n; ++i)
+        sum += glm::dot(a[i], b[i]);
+    return sum;
+}
+
+void ImplicitEulerSolver::do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles,
+                                   const std::vector<ForceFieldPtr>& forceFields)
+{
+    const int n = static_cast<int>(store.size());
+    m_lastIterationCount = 0;
+    if(n == 0)
+        return;
+    const ParticleStore::Array<float> & inverseMasses = store.inverseMasses();
+    const ParticleStore::Array<unsigned char> & flags = store.flags();
+    ParticleStore::Array<glm::vec3> & positions = store.positions();
+    ParticleStore::Array<glm::vec3> & velocities = store.velocities();
+    const ParticleStore::Array<glm::vec3> & forces = store.forces();
+
+    //Assemble the Jacobians
+    m_dfdx.reset(n);
+    m_dfdv.reset(n);
+    for(const ForceFieldPtr & forceField : forceFields)
+        forceField->addJacobians(store, m_dfdx, m_dfdv);
+    m_dfdx.compress();
+    m_dfdv.compress();
+
+    //Fixed and detached particles, and those of infinite mass, do not move
+    m_masses.resize(n);
+    m_moving.resize(n);
+    m_preconditioner.resize(n);
+    for(int i = 0; i < n; ++i)
+    {
+        m_moving[i] = !flags[i] && inverseMasses[i] > 0.0f;
+        m_masses[i] = m_moving[i] ? 1.0f / inverseMasses[i] : 0.0f;
+        glm::mat3 diagonal = glm::mat3(m_masses[i]) - dt * m_dfdv.diagonal(i) - dt * dt * m_dfdx.diagonal(i);
+        m_preconditioner[i] = m_moving[i] ? glm::inverse(diagonal) : glm::mat3(0.0f);
+    }
+
+    //Right hand side: dt * (f + dt * df/dx * v)
+    m_r.assign(n, glm::vec3(0.0f));
+    m_dfdx.multiplyAdd(dt, velocities.data(), m_r.data());
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < n; ++i)
+        m_r[i] = dt * (forces[i] + m_r[i]);
+    filter(m_r.data());
+
+    //Preconditioned conjugate gradient, starting from dv = 0
+    m_dv.assign(n, glm::vec3(0.0f));
+    m_z.resize(n);
+    m_q.resize(n);
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < n; ++i)
+        m_z[i] = m_preconditioner[i] * m_r[i];
+    m_p = m_z;
+    float rz = dot(m_r, m_z);
+    const float threshold = m_tolerance * m_tolerance * dot(m_r, m_r);
+
+    while(m_lastIterationCount < m_maxIterations && rz > 0.0f)
+    {
+        multiply(dt, m_p.data(), m_q.data());
+        float pq = dot(m_p, m_q);
+        if(pq <= 0.0f)
+            break;
+        float alpha = rz / pq;
+        #pragma omp parallel for schedule(static)
+        for(int i = 0; i < n; ++i)
+        {
+            m_dv[i] += alpha * m_p[i];
+            m_r[i] -= alpha * m_q[i];
+        }
+        ++m_lastIterationCount;
+        if(dot(m_r, m_r) <= threshold)
+            break;
+
+        #pragma omp parallel for schedule(static)
+        for(int i = 0; i < n; ++i)
+            m_z[i] = m_preconditioner[i] * m_r[i];
+        float rzNext = dot(m_r, m_z);
+        float beta = rzNext / rz;
+        rz = rzNext;
+        #pragma omp parallel for schedule(static)
+        for(int i = 0; i < n; ++i)
+            m_p[i] = m_z[i] + beta * m_p[i];
+    }
+
+    //Update the velocities, then the positions with the new velocities
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < n; ++i)
+    {
+        if(m_moving[i])
+        {
+            velocities[i] += m_dv[i];
+            positions[i] += dt * velocities[i];
+        }
+    }
+}
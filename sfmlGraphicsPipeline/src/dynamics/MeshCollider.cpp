@@ -0,0 +1,383 @@
+#include "./../../include/dynamics/MeshCollider.hpp"
+#include "./../../include/MeshRenderable.hpp"
+#include "./../../include/log.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <glm/gtx/norm.hpp>
+
+// Number of bins of the SAH along the split axis
+static const int BIN_COUNT = 16;
+// Largest number of triangles of a leaf
+static const unsigned int MAX_LEAF_SIZE = 8;
+// Depth after which the nodes are split in two halves, which bounds the depth
+// of the hierarchy, and the size of the stack of the queries
+static const unsigned int MAX_SAH_DEPTH = 40;
+static const unsigned int STACK_SIZE = 64;
+
+MeshCollider::MeshCollider(const MeshRenderable& mesh, const glm::mat4& transform) :
+    m_transform(transform), m_twoSided(false)
+{
+    std::vector<unsigned int> indices;
+    if (mesh.isIndexed())
+        indices = mesh.indices();
+    build(mesh.positions(), indices);
+}
+
+MeshCollider::MeshCollider(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+                           const glm::mat4& transform) :
+    m_transform(transform), m_twoSided(false)
+{
+    build(positions, indices);
+}
+
+MeshCollider::~MeshCollider()
+{}
+
+// Half of the area of a box, enough to compare areas
+static float half_area(const glm::vec3& min, const glm::vec3& max)
+{
+    glm::vec3 e = glm::max(max - min, glm::vec3(0.0f));
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+void MeshCollider::build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices)
+{
+    size_t indexCount = indices.empty() ? positions.size() : indices.size();
+    std::vector<glm::vec3> triangles;
+    triangles.reserve(indexCount - indexCount % 3);
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        unsigned int v[3] = { (unsigned int)i, (unsigned int)i + 1, (unsigned int)i + 2 };
+        if (!indices.empty())
+        {
+            v[0] = indices[i];
+            v[1] = indices[i + 1];
+            v[2] = indices[i + 2];
+        }
+        if (v[0] >= positions.size() || v[1] >= positions.size() || v[2] >= positions.size())
+            continue;
+        for (int k = 0; k < 3; ++k)
+            triangles.push_back(positions[v[k]]);
+    }
+    const unsigned int count = triangles.size() / 3;
+    m_nodes.clear();
+    m_localVertices.clear();
+    m_vertices.clear();
+    if (count == 0)
+    {
+        LOG(warning, "the mesh collider has no triangle");
+        return;
+    }
+
+    // The hierarchy is built in the space of the particles
+    std::vector<glm::vec3> minima(count), maxima(count), centroids(count);
+    for (unsigned int t = 0; t < count; ++t)
+    {
+        glm::vec3 a = glm::vec3(m_transform * glm::vec4(triangles[3 * t], 1.0));
+        glm::vec3 b = glm::vec3(m_transform * glm::vec4(triangles[3 * t + 1], 1.0));
+        glm::vec3 c = glm::vec3(m_transform * glm::vec4(triangles[3 * t + 2], 1.0));
+        minima[t] = glm::min(a, glm::min(b, c));
+        maxima[t] = glm::max(a, glm::max(b, c));
+        centroids[t] = (a + b + c) / 3.0f;
+    }
+
+    std::vector<unsigned int> order(count);
+    std::iota(order.begin(), order.end(), 0u);
+    m_nodes.reserve(2 * count);
+    Node root;
+    root.first = 0;
+    root.count = count;
+    m_nodes.push_back(root);
+
+    // Split the nodes depth first, with their depth
+    std::vector< std::pair<unsigned int, unsigned int> > stack(1, std::make_pair(0u, 0u));
+    while (!stack.empty())
+    {
+        unsigned int node = stack.back().first, depth = stack.back().second;
+        stack.pop_back();
+        Node & n = m_nodes[node];
+        n.min = glm::vec3(std::numeric_limits<float>::max());
+        n.max = glm::vec3(-std::numeric_limits<float>::max());
+        glm::vec3 centroidMin = n.min, centroidMax = n.max;
+        for (unsigned int k = n.first; k < n.first + n.count; ++k)
+        {
+            n.min = glm::min(n.min, minima[order[k]]);
+            n.max = glm::max(n.max, maxima[order[k]]);
+            centroidMin = glm::min(centroidMin, centroids[order[k]]);
+            centroidMax = glm::max(centroidMax, centroids[order[k]]);
+        }
+        if (n.count <= 2)
+            continue;
+
+        glm::vec3 extent = centroidMax - centroidMin;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        unsigned int first = n.first, end = n.first + n.count;
+        unsigned int middle = first;
+        if (extent[axis] > 0 && depth < MAX_SAH_DEPTH)
+        {
+            // Bins of the centroids along the axis
+            float scale = BIN_COUNT / extent[axis];
+            unsigned int binCounts[BIN_COUNT] = {};
+            glm::vec3 binMin[BIN_COUNT], binMax[BIN_COUNT];
+            std::fill(binMin, binMin + BIN_COUNT, glm::vec3(std::numeric_limits<float>::max()));
+            std::fill(binMax, binMax + BIN_COUNT, glm::vec3(-std::numeric_limits<float>::max()));
+            for (unsigned int k = first; k < end; ++k)
+            {
+                unsigned int t = order[k];
+                int bin = std::min(BIN_COUNT - 1, int((centroids[t][axis] - centroidMin[axis]) * scale));
+                ++binCounts[bin];
+                binMin[bin] = glm::min(binMin[bin], minima[t]);
+                binMax[bin] = glm::max(binMax[bin], maxima[t]);
+            }
+            // Cost of the splits after each bin, from the areas of both sides
+            float leftCost[BIN_COUNT - 1];
+            glm::vec3 boxMin(std::numeric_limits<float>::max()), boxMax(-std::numeric_limits<float>::max());
+            unsigned int leftCount = 0;
+            for (int b = 0; b < BIN_COUNT - 1; ++b)
+            {
+                leftCount += binCounts[b];
+                boxMin = glm::min(boxMin, binMin[b]);
+                boxMax = glm::max(boxMax, binMax[b]);
+                leftCost[b] = leftCount ? leftCount * half_area(boxMin, boxMax) : 0.0f;
+            }
+            boxMin = glm::vec3(std::numeric_limits<float>::max());
+            boxMax = glm::vec3(-std::numeric_limits<float>::max());
+            unsigned int rightCount = 0;
+            int bestBin = -1;
+            float bestCost = std::numeric_limits<float>::max();
+            for (int b = BIN_COUNT - 1; b > 0; --b)
+            {
+                rightCount += binCounts[b];
+                boxMin = glm::min(boxMin, binMin[b]);
+                boxMax = glm::max(boxMax, binMax[b]);
+                float cost = leftCost[b - 1] + (rightCount ? rightCount * half_area(boxMin, boxMax) : 0.0f);
+                if (rightCount > 0 && rightCount < n.count && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestBin = b;
+                }
+            }
+            // A small leaf is cheaper than a split that does not reduce the areas
+            if (bestBin < 0 || (n.count <= MAX_LEAF_SIZE && bestCost >= n.count * half_area(n.min, n.max)))
+                continue;
+            middle = std::partition(order.begin() + first, order.begin() + end, [&](unsigned int t)
+            {
+                return std::min(BIN_COUNT - 1, int((centroids[t][axis] - centroidMin[axis]) * scale)) < bestBin;
+            }) - order.begin();
+        }
+        else if (n.count > MAX_LEAF_SIZE)
+        {
+            // All the centroids are at the same place, or the hierarchy is
+            // deep: split in two halves
+            middle = first + n.count / 2;
+            std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + end,
+                [&](unsigned int t1, unsigned int t2) { return centroids[t1][axis] < centroids[t2][axis]; });
+        }
+        if (middle == first || middle == end)
+            continue;
+
+        Node left, right;
+        left.first = first;
+        left.count = middle - first;
+        right.first = middle;
+        right.count = end - middle;
+        unsigned int child = m_nodes.size();
+        n.first = child;
+        n.count = 0;
+        // n is invalidated by push_back
+        m_nodes.push_back(left);
+        m_nodes.push_back(right);
+        stack.push_back(std::make_pair(child + 1, depth + 1));
+        stack.push_back(std::make_pair(child, depth + 1));
+    }
+
+    // The vertices of the triangles, in the order of the leaves
+    m_localVertices.resize(3 * count);
+    for (unsigned int k = 0; k < count; ++k)
+    {
+        for (int v = 0; v < 3; ++v)
+            m_localVertices[3 * k + v] = triangles[3 * order[k] + v];
+    }
+    m_vertices.resize(3 * count);
+    for (size_t v = 0; v < m_vertices.size(); ++v)
+        m_vertices[v] = glm::vec3(m_transform * glm::vec4(m_localVertices[v], 1.0));
+}
+
+void MeshCollider::setTransform(const glm::mat4& transform)
+{
+    if (transform == m_transform)
+        return;
+    m_transform = transform;
+    refit();
+}
+
+const glm::mat4& MeshCollider::getTransform() const
+{
+    return m_transform;
+}
+
+void MeshCollider::setTwoSided(bool twoSided)
+{
+    m_twoSided = twoSided;
+}
+
+bool MeshCollider::isTwoSided() const
+{
+    return m_twoSided;
+}
+
+void MeshCollider::refit()
+{
+    const int vertexCount = m_vertices.size();
+    const glm::mat4 transform = m_transform;
+    #pragma omp parallel for schedule(static) if(vertexCount > 30000)
+    for (int v = 0; v < vertexCount; ++v)
+        m_vertices[v] = glm::vec3(transform * glm::vec4(m_localVertices[v], 1.0));
+
+    // The children are stored after their parent
+    for (size_t i = m_nodes.size(); i-- > 0;)
+    {
+        Node & n = m_nodes[i];
+        if (n.count > 0)
+        {
+            n.min = glm::vec3(std::numeric_limits<float>::max());
+            n.max = glm::vec3(-std::numeric_limits<float>::max());
+            for (unsigned int v = 3 * n.first; v < 3 * (n.first + n.count); ++v)
+            {
+                n.min = glm::min(n.min, m_vertices[v]);
+                n.max = glm::max(n.max, m_vertices[v]);
+            }
+        }
+        else
+        {
+            n.min = glm::min(m_nodes[n.first].min, m_nodes[n.first + 1].min);
+            n.max = glm::max(m_nodes[n.first].max, m_nodes[n.first + 1].max);
+        }
+    }
+}
+
+// Squared distance from a point to a box, 0 inside
+static inline float box_distance2(const glm::vec3& p, const glm::vec3& min, const glm::vec3& max)
+{
+    glm::vec3 d = glm::max(min - p, glm::max(p - max, glm::vec3(0.0f)));
+    return glm::dot(d, d);
+}
+
+// Closest point of a triangle to a point, from the Voronoi regions of its
+// vertices and edges (Ericson, Real-Time Collision Detection, 5.1.5)
+static glm::vec3 closest_point_on_triangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+        return a;
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
+        return b;
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        return a + d1 / (d1 - d3) * ab;
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+        return c;
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        return a + d2 / (d2 - d6) * ac;
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+    float denominator = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+bool MeshCollider::collide(const glm::vec3& center, float radius, glm::vec3& normal, float& depth) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    // Closest triangle closer than the radius, the nearest child first
+    float best = radius * radius;
+    int bestTriangle = -1;
+    glm::vec3 bestPoint;
+    unsigned int stack[STACK_SIZE];
+    unsigned int size = 0;
+    if (box_distance2(center, m_nodes[0].min, m_nodes[0].max) <= best)
+        stack[size++] = 0;
+    while (size > 0)
+    {
+        const Node & n = m_nodes[stack[--size]];
+        if (box_distance2(center, n.min, n.max) > best)
+            continue;
+        if (n.count > 0)
+        {
+            for (unsigned int t = n.first; t < n.first + n.count; ++t)
+            {
+                const glm::vec3* v = &m_vertices[3 * t];
+                glm::vec3 point = closest_point_on_triangle(center, v[0], v[1], v[2]);
+                float distance = glm::length2(center - point);
+                if (distance < best)
+                {
+                    best = distance;
+                    bestTriangle = t;
+                    bestPoint = point;
+                }
+            }
+            continue;
+        }
+        float d1 = box_distance2(center, m_nodes[n.first].min, m_nodes[n.first].max);
+        float d2 = box_distance2(center, m_nodes[n.first + 1].min, m_nodes[n.first + 1].max);
+        unsigned int nearest = d1 <= d2 ? n.first : n.first + 1;
+        float nearestDistance = std::min(d1, d2), farthestDistance = std::max(d1, d2);
+        if (farthestDistance <= best)
+            stack[size++] = nearest == n.first ? n.first + 1 : n.first;
+        if (nearestDistance <= best)
+            stack[size++] = nearest;
+    }
+    if (bestTriangle < 0)
+        return false;
+
+    const glm::vec3* v = &m_vertices[3 * bestTriangle];
+    glm::vec3 faceNormal = glm::cross(v[1] - v[0], v[2] - v[0]);
+    float faceLength = glm::length(faceNormal);
+    faceNormal = faceLength > 0 ? faceNormal / faceLength : glm::vec3(0, 1, 0);
+    glm::vec3 d = center - bestPoint;
+    float distance = std::sqrt(best);
+    if (!m_twoSided && glm::dot(d, faceNormal) < 0)
+    {
+        // The center is behind the mesh
+        normal = faceNormal;
+        depth = radius + distance;
+    }
+    else
+    {
+        normal = distance > std::numeric_limits<float>::epsilon() ? d / distance : faceNormal;
+        depth = radius - distance;
+    }
+    return true;
+}
+
+void MeshCollider::getBounds(glm::vec3& min, glm::vec3& max) const
+{
+    if (m_nodes.empty())
+    {
+        min = glm::vec3(std::numeric_limits<float>::max());
+        max = glm::vec3(-std::numeric_limits<float>::max());
+        return;
+    }
+    min = m_nodes[0].min;
+    max = m_nodes[0].max;
+}
+
+size_t MeshCollider::triangleCount() const
+{
+    return m_vertices.size() / 3;
+}
+
+size_t MeshCollider::nodeCount() const
+{
+    return m_nodes.size();
+}
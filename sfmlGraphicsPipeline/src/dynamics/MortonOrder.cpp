@@ -0,0 +1,136 @@
+#include "./../../include/dynamics/MortonOrder.hpp"
+
+#include <algorithm>
+#include <limits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Number of cells along each axis: 10 bits per coordinate
+static const unsigned int GRID_BITS = 10;
+// Key of the detached slots, after all the 30 bit codes
+static const uint32_t DETACHED_KEY = 1u << (3 * GRID_BITS);
+
+// Insert two zeros between the 10 lowest bits of a coordinate
+static uint32_t spread_bits(uint32_t x)
+{
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+static uint32_t morton_code(const glm::uvec3& cell)
+{
+    return spread_bits(cell.x) | (spread_bits(cell.y) << 1) | (spread_bits(cell.z) << 2);
+}
+
+MortonOrder::MortonOrder() :
+    m_cellSize(0)
+{}
+
+MortonOrder::~MortonOrder()
+{}
+
+void MortonOrder::setCellSize(float size)
+{
+    m_cellSize = std::max(size, 0.0f);
+}
+
+float MortonOrder::getCellSize() const
+{
+    return m_cellSize;
+}
+
+void MortonOrder::sort(const ParticleStore& store, std::vector< unsigned int >& order)
+{
+    const int n = static_cast<int>(store.size());
+    const glm::vec3* positions = store.positions().data();
+    const unsigned char* flags = store.flags().data();
+    order.resize(n);
+
+    // Bounding box of the attached particles
+    glm::vec3 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+    for (int i = 0; i < n; ++i)
+    {
+        if (flags[i] & ParticleStore::DETACHED)
+            continue;
+        min = glm::min(min, positions[i]);
+        max = glm::max(max, positions[i]);
+    }
+    const float extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+    const float cellSize = std::max(m_cellSize, extent / (1u << GRID_BITS));
+    const float invCellSize = cellSize > 0 ? 1.0f / cellSize : 0.0f;
+    const float lastCell = float((1u << GRID_BITS) - 1);
+
+    m_keys.resize(n);
+    #pragma omp parallel for schedule(static) if(n > 30000)
+    for (int i = 0; i < n; ++i)
+    {
+        order[i] = i;
+        if (flags[i] & ParticleStore::DETACHED)
+        {
+            m_keys[i] = DETACHED_KEY;
+            continue;
+        }
+        glm::vec3 cell = glm::min(glm::floor((positions[i] - min) * invCellSize), glm::vec3(lastCell));
+        m_keys[i] = morton_code(glm::uvec3(cell));
+    }
+
+    // Least significant digit radix sort: each thread counts the digits of a
+    // contiguous chunk, then writes its elements after the ones of the
+    // previous digits and of the previous threads, which keeps the sort stable
+    int threadCount = 1;
+#ifdef _OPENMP
+    threadCount = n > 30000 ? omp_get_max_threads() : 1;
+#endif
+    m_sortedKeys.resize(n);
+    m_sortedOrder.resize(n);
+    m_histograms.resize(256 * threadCount);
+    for (unsigned int shift = 0; shift < 32; shift += 8)
+    {
+        if ((DETACHED_KEY >> shift) == 0)
+            break;
+        std::fill(m_histograms.begin(), m_histograms.end(), 0);
+        #pragma omp parallel num_threads(threadCount)
+        {
+            // The team may be smaller than requested: chunk by its actual size
+            int thread = 0, teamSize = 1;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+            teamSize = omp_get_num_threads();
+#endif
+            const int begin = static_cast<long long>(n) * thread / teamSize;
+            const int end = static_cast<long long>(n) * (thread + 1) / teamSize;
+            unsigned int* histogram = &m_histograms[256 * thread];
+            for (int k = begin; k < end; ++k)
+                ++histogram[(m_keys[k] >> shift) & 0xff];
+
+            #pragma omp barrier
+            #pragma omp single
+            {
+                unsigned int offset = 0;
+                for (int digit = 0; digit < 256; ++digit)
+                {
+                    for (int t = 0; t < teamSize; ++t)
+                    {
+                        unsigned int count = m_histograms[256 * t + digit];
+                        m_histograms[256 * t + digit] = offset;
+                        offset += count;
+                    }
+                }
+            }
+
+            for (int k = begin; k < end; ++k)
+            {
+                unsigned int e = histogram[(m_keys[k] >> shift) & 0xff]++;
+                m_sortedKeys[e] = m_keys[k];
+                m_sortedOrder[e] = order[k];
+            }
+        }
+        m_keys.swap(m_sortedKeys);
+        order.swap(m_sortedOrder);
+    }
+}
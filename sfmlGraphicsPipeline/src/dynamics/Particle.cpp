@@ -1,23 +1,41 @@
 #include "./../../include/dynamics/Particle.hpp"
+#include "./../../include/dynamics/ParticleStore.hpp"
 
 void Particle::setRadius(const float &radius)
 {
-    m_radius = radius;
+    if (m_store)
+        m_store->m_radii[m_index] = radius;
+    else
+        m_radius = radius;
 }
 
 
 bool Particle::isFixed() const
 {
+    if (m_store)
+        return m_store->m_flags[m_index] & ParticleStore::FIXED;
     return m_isFixed;
 }
 
+bool Particle::isSleeping() const
+{
+    return m_store && (m_store->m_flags[m_index] & ParticleStore::SLEEPING);
+}
+
 void Particle::setFixed(bool isFixed)
 {
-    m_isFixed = isFixed;
+    if (m_store)
+    {
+        unsigned char & flags = m_store->m_flags[m_index];
+        flags = isFixed ? (flags | ParticleStore::FIXED) : (flags & ~ParticleStore::FIXED);
+    }
+    else
+        m_isFixed = isFixed;
 }
 
 Particle::Particle(const glm::vec3 &position, const glm::vec3 &velocity, const float &mass, const float &radius)
-    : m_initialPosition( position ), m_initialVelocity( velocity ),
+    : m_store(nullptr), m_index(0),
+      m_initialPosition( position ), m_initialVelocity( velocity ),
         m_position(position),
       m_velocity(velocity),
       m_force(glm::vec3(0.0,0.0,0.0)),
@@ -26,22 +44,30 @@ Particle::Particle(const glm::vec3 &position, const glm::vec3 &velocity, const f
 {}
 
 Particle::~Particle()
-{}
+{
+    if (m_store)
+        m_store->release(m_index);
+}
 
 
 const glm::vec3 & Particle::getPosition() const
 {
-    return m_position;
+    return m_store ? m_store->m_positions[m_index] : m_position;
+}
+
+const glm::vec3 & Particle::getRenderPosition() const
+{
+    return m_store ? m_store->renderPositions()[m_index] : m_position;
 }
 
 const glm::vec3 & Particle::getVelocity() const
 {
-    return m_velocity;
+    return m_store ? m_store->m_velocities[m_index] : m_velocity;
 }
 
 const glm::vec3 & Particle::getForce() const
 {
-    return m_force;
+    return m_store ? m_store->m_forces[m_index] : m_force;
 }
 
 float Particle::getMass() const
@@ -51,43 +77,53 @@ float Particle::getMass() const
 
 float Particle::getRadius() const
 {
-    return m_radius;
+    return m_store ? m_store->m_radii[m_index] : m_radius;
 }
 
 void Particle::setPosition(const glm::vec3 &pos)
 {
-    m_position = pos;
+    (m_store ? m_store->m_positions[m_index] : m_position) = pos;
 }
 
 void Particle::setVelocity(const glm::vec3 &vel)
 {	
-    m_velocity = vel;
+    (m_store ? m_store->m_velocities[m_index] : m_velocity) = vel;
 }
 
 void Particle::setForce(const glm::vec3 &force)
 {
-    m_force = force;
+    (m_store ? m_store->m_forces[m_index] : m_force) = force;
 }
 
 void Particle::incrPosition(const glm::vec3 &pos)
 {
-    m_position += pos;
+    (m_store ? m_store->m_positions[m_index] : m_position) += pos;
 }
 
 void Particle::incrVelocity(const glm::vec3 &vel)
 {
-    m_velocity += vel;
+    (m_store ? m_store->m_velocities[m_index] : m_velocity) += vel;
 }
 
 void Particle::incrForce(const glm::vec3& force)
 {
-    m_force +=force;
+    (m_store ? m_store->m_forces[m_index] : m_force) += force;
 }
 
 void Particle::restart()
 {
-  m_position = m_initialPosition;
-  m_velocity = m_initialVelocity;
+  setPosition(m_initialPosition);
+  setVelocity(m_initialVelocity);
+}
+
+ParticleStore* Particle::getStore() const
+{
+    return m_store;
+}
+
+size_t Particle::getStoreIndex() const
+{
+    return m_index;
 }
 
 std::ostream& operator<<(std::ostream& os, const ParticlePtr& p)
@@ -2,6 +2,7 @@
  *     Author: T.Delame (tdelame@gmail.com)
  */
 #include "../../include/dynamics/ParticleListRenderable.hpp"
+#include "../../include/Viewer.hpp"
 #include <glm/gtc/type_ptr.hpp>
 
 ParticleListRenderable::~ParticleListRenderable()
@@ -10,12 +11,13 @@ ParticleListRenderable::~ParticleListRenderable()
     glcheck(glDeleteBuffers(1, &m_cBuffer));
     glcheck(glDeleteBuffers(1, &m_nBuffer));
     glcheck(glDeleteBuffers(1, &m_iBuffer));
-    glcheck(glDeleteBuffers(1, &m_idBuffer));
+    glcheck(glDeleteBuffers(1, &m_qBuffer));
 }
 
 ParticleListRenderable::ParticleListRenderable(ShaderProgramPtr program, std::vector<ParticlePtr>& particles, unsigned int strips, unsigned int slices) :
     HierarchicalRenderable( program ),
-    m_particles(particles), m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_idBuffer(0)
+    m_particles(particles), m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_idBuffer(0), m_idOffset(0),
+    m_qBuffer(0), m_impostors(false)
 {   
     std::vector<glm::uvec3> uvec3_indices;
     getUnitIndexedSphere(m_positions, m_normals, uvec3_indices, strips, slices);
@@ -35,6 +37,11 @@ ParticleListRenderable::ParticleListRenderable(ShaderProgramPtr program, std::ve
 void ParticleListRenderable::do_draw()
 {  
     update_instances_data_buffer();
+    if (m_impostors)
+    {
+        draw_impostors();
+        return;
+    }
     int positionLocation = m_shaderProgram->getAttributeLocation("vPosition");
     int colorLocation = m_shaderProgram->getAttributeLocation("vColor");
     int normalLocation = m_shaderProgram->getAttributeLocation("vNormal");
@@ -76,7 +83,7 @@ void ParticleListRenderable::do_draw()
     {
         glcheck(glEnableVertexAttribArray(instanceDataLocation));
         glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_idBuffer));
-        glcheck(glVertexAttribPointer(instanceDataLocation, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0));
+        glcheck(glVertexAttribPointer(instanceDataLocation, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)m_idOffset));
         glVertexAttribDivisor(instanceDataLocation, 1);
     }
 
@@ -107,12 +114,58 @@ void ParticleListRenderable::do_draw()
     }
 }
 
+void ParticleListRenderable::setImpostorMode(bool impostors)
+{
+    m_impostors = impostors;
+}
+
+// One quad per particle: 4 vertices instead of the hundreds of the sphere
+void ParticleListRenderable::draw_impostors()
+{
+    int cornerLocation = m_shaderProgram->getAttributeLocation("vPosition");
+    int modelLocation = m_shaderProgram->getUniformLocation("modelMat");
+    int instanceDataLocation = m_shaderProgram->getAttributeLocation("instanceData");
+
+    if(modelLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(getModelMatrix())));
+    }
+
+    if(cornerLocation != ShaderProgram::null_location)
+    {
+        glcheck(glEnableVertexAttribArray(cornerLocation));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_qBuffer));
+        glcheck(glVertexAttribPointer(cornerLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)0));
+    }
+
+    if ( instanceDataLocation != ShaderProgram::null_location )
+    {
+        glcheck(glEnableVertexAttribArray(instanceDataLocation));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_idBuffer));
+        glcheck(glVertexAttribPointer(instanceDataLocation, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)m_idOffset));
+        glVertexAttribDivisor(instanceDataLocation, 1);
+    }
+
+    glcheck(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_particles.size()));
+
+    if(cornerLocation != ShaderProgram::null_location)
+    {
+        glcheck(glDisableVertexAttribArray(cornerLocation));
+    }
+
+    if(instanceDataLocation != ShaderProgram::null_location)
+    {
+        glcheck(glDisableVertexAttribArray(instanceDataLocation));
+        glVertexAttribDivisor(instanceDataLocation, 0);
+    }
+}
+
 void ParticleListRenderable::genbuffers(){
     glGenBuffers(1, &m_pBuffer); //vertices
     glGenBuffers(1, &m_cBuffer); //colors
     glGenBuffers(1, &m_nBuffer); //normals
     glGenBuffers(1, &m_iBuffer); //indices
-    glGenBuffers(1, &m_idBuffer); //instance data
+    glGenBuffers(1, &m_qBuffer); //impostor quad
 }
 
 void ParticleListRenderable::update_all_buffers(){
@@ -120,6 +173,7 @@ void ParticleListRenderable::update_all_buffers(){
     update_normals_buffer();
     update_colors_buffer();
     update_indices_buffer();
+    update_quad_buffer();
     update_instances_data_buffer();
 }
 
@@ -129,7 +183,7 @@ void ParticleListRenderable::update_positions_buffer(){
 }
 
 void ParticleListRenderable::update_normals_buffer(){
-    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_pBuffer));
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_nBuffer));
     glcheck(glBufferData(GL_ARRAY_BUFFER, m_normals.size()*sizeof(glm::vec3), m_normals.data(), GL_STATIC_DRAW));
 }
 
@@ -143,10 +197,23 @@ void ParticleListRenderable::update_indices_buffer(){
     glcheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size()*sizeof(unsigned int), m_indices.data(), GL_STATIC_DRAW));
 }
 
+void ParticleListRenderable::update_quad_buffer(){
+    const glm::vec2 corners[4] = { glm::vec2(-1,-1), glm::vec2(1,-1), glm::vec2(-1,1), glm::vec2(1,1) };
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_qBuffer));
+    glcheck(glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW));
+}
+
 void ParticleListRenderable::update_instances_data_buffer(){
-    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_idBuffer));
-    std::vector<glm::vec4> instances_data(m_particles.size());
+    // Without viewer (at construction), nothing is drawn yet
+    if (!m_viewer)
+        return;
+    // Write the instance data directly in the viewer's ring buffer
+    DynamicBuffer & buffer = m_viewer->getDynamicBuffer();
+    DynamicBuffer::Allocation allocation = buffer.allocate(m_particles.size()*sizeof(glm::vec4));
+    glm::vec4 * instances_data = static_cast<glm::vec4*>(allocation.data);
     for (std::size_t i=0u; i<m_particles.size(); ++i)
-        instances_data[i] = glm::vec4(m_particles[i]->getPosition(), m_particles[i]->getRadius());
-    glcheck(glBufferData(GL_ARRAY_BUFFER, instances_data.size()*sizeof(glm::vec4), instances_data.data(), GL_STREAM_DRAW));
+        instances_data[i] = glm::vec4(m_particles[i]->getRenderPosition(), m_particles[i]->getRadius());
+    buffer.flush(allocation);
+    m_idBuffer = buffer.bufferId();
+    m_idOffset = allocation.offset;
 }
\ No newline at end of file
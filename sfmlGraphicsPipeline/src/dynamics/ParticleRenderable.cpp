@@ -30,7 +30,7 @@ void ParticleRenderable::do_draw()
 {
     //Update the parent and local transform matrix to position the geometric data according to the particle's data.
     const float& pRadius = m_particle->getRadius();
-    const glm::vec3& pPosition = m_particle->getPosition();
+    const glm::vec3& pPosition = m_particle->getRenderPosition();
     glm::mat4 scale = glm::scale(glm::mat4(1.0), glm::vec3(pRadius));
     glm::mat4 translate = glm::translate(glm::mat4(1.0), glm::vec3(pPosition));
     setLocalTransform(translate*scale);
@@ -0,0 +1,192 @@
+#include "./../../include/dynamics/ParticleStore.hpp"
+#include "./../../include/dynamics/Particle.hpp"
+
+#include <algorithm>
+
+// Last version given to the slots of a store
+static unsigned long long last_slot_version = 0;
+
+ParticleStore::ParticleStore() :
+    m_detachedCount(0), m_slotVersion(++last_slot_version), m_interpolating(false)
+{}
+
+ParticleStore::~ParticleStore()
+{
+    clear();
+}
+
+void ParticleStore::attach(Particle& particle)
+{
+    if (particle.m_store == this)
+        return;
+    if (particle.m_store)
+        particle.m_store->detach(particle);
+
+    m_positions.push_back(particle.m_position);
+    m_velocities.push_back(particle.m_velocity);
+    m_forces.push_back(particle.m_force);
+    m_inverseMasses.push_back(particle.m_mass > 0 ? 1.0f / particle.m_mass : 0.0f);
+    m_radii.push_back(particle.m_radius);
+    m_flags.push_back(particle.m_isFixed ? FIXED : 0);
+    m_handles.push_back(&particle);
+    m_previousPositions.push_back(particle.m_position);
+    m_renderPositions.push_back(particle.m_position);
+
+    particle.m_store = this;
+    particle.m_index = m_handles.size() - 1;
+    m_slotVersion = ++last_slot_version;
+}
+
+void ParticleStore::detach(Particle& particle)
+{
+    if (particle.m_store != this)
+        return;
+    size_t i = particle.m_index;
+    particle.m_position = m_positions[i];
+    particle.m_velocity = m_velocities[i];
+    particle.m_force = m_forces[i];
+    particle.m_radius = m_radii[i];
+    particle.m_isFixed = m_flags[i] & FIXED;
+    particle.m_store = nullptr;
+    particle.m_index = 0;
+    release(i);
+}
+
+void ParticleStore::release(size_t index)
+{
+    m_handles[index] = nullptr;
+    m_flags[index] = DETACHED;
+    ++m_detachedCount;
+    m_slotVersion = ++last_slot_version;
+    m_velocities[index] = glm::vec3(0);
+}
+
+void ParticleStore::clear()
+{
+    for (Particle* particle : m_handles)
+    {
+        if (particle)
+            detach(*particle);
+    }
+    m_positions.clear();
+    m_velocities.clear();
+    m_forces.clear();
+    m_inverseMasses.clear();
+    m_radii.clear();
+    m_flags.clear();
+    m_handles.clear();
+    m_detachedCount = 0;
+    m_slotVersion = ++last_slot_version;
+    m_previousPositions.clear();
+    m_renderPositions.clear();
+}
+
+size_t ParticleStore::size() const
+{
+    return m_handles.size();
+}
+
+size_t ParticleStore::detachedCount() const
+{
+    return m_detachedCount;
+}
+
+unsigned long long ParticleStore::slotVersion() const
+{
+    return m_slotVersion;
+}
+
+// Gather the elements of an array in a new order
+template< typename T >
+static void permute_array(ParticleStore::Array< T >& array, const std::vector< unsigned int >& order)
+{
+    const int n = static_cast<int>(order.size());
+    ParticleStore::Array< T > permuted(n);
+    #pragma omp parallel for schedule(static) if(n > 30000)
+    for (int k = 0; k < n; ++k)
+        permuted[k] = array[order[k]];
+    array.swap(permuted);
+}
+
+void ParticleStore::permute(const std::vector< unsigned int >& order)
+{
+    if (order.size() != m_handles.size())
+        return;
+    m_slotVersion = ++last_slot_version;
+    permute_array(m_positions, order);
+    permute_array(m_velocities, order);
+    permute_array(m_forces, order);
+    permute_array(m_inverseMasses, order);
+    permute_array(m_radii, order);
+    permute_array(m_flags, order);
+    permute_array(m_previousPositions, order);
+    permute_array(m_renderPositions, order);
+
+    std::vector< Particle* > handles(m_handles.size());
+    for (size_t k = 0; k < order.size(); ++k)
+    {
+        handles[k] = m_handles[order[k]];
+        if (handles[k])
+            handles[k]->m_index = k;
+    }
+    m_handles.swap(handles);
+}
+
+void ParticleStore::clearForces()
+{
+    std::fill(m_forces.begin(), m_forces.end(), glm::vec3(0));
+}
+
+void ParticleStore::savePreviousPositions()
+{
+    std::copy(m_positions.begin(), m_positions.end(), m_previousPositions.begin());
+}
+
+void ParticleStore::interpolatePositions(float alpha)
+{
+    const int n = static_cast<int>(m_handles.size());
+    m_interpolating = true;
+    if (n == 0)
+        return;
+    const float* __restrict__ previous = &m_previousPositions[0][0];
+    const float* __restrict__ current = &m_positions[0][0];
+    float* __restrict__ render = &m_renderPositions[0][0];
+
+    #pragma omp simd
+    for (int i = 0; i < 3*n; ++i)
+        render[i] = previous[i] + alpha * (current[i] - previous[i]);
+}
+
+void ParticleStore::stopInterpolation()
+{
+    m_interpolating = false;
+}
+
+void ParticleStore::integrateExplicitEuler(float dt)
+{
+    // Work on raw float arrays: glm::vec3 is three packed floats, and the
+    // compiler vectorizes these loops without aliasing concerns
+    const int n = static_cast<int>(m_handles.size());
+    if (n == 0)
+        return;
+    float* __restrict__ x = &m_positions[0][0];
+    float* __restrict__ v = &m_velocities[0][0];
+    const float* __restrict__ f = &m_forces[0][0];
+    const float* __restrict__ invMass = m_inverseMasses.data();
+    const unsigned char* __restrict__ flags = m_flags.data();
+
+    #pragma omp simd
+    for (int i = 0; i < n; ++i)
+    {
+        // Zero for fixed and detached particles, which do not move
+        float moving = flags[i] ? 0.0f : 1.0f;
+        float dv = moving * dt * invMass[i];
+        float dx = moving * dt;
+        v[3*i+0] += dv * f[3*i+0];
+        v[3*i+1] += dv * f[3*i+1];
+        v[3*i+2] += dv * f[3*i+2];
+        x[3*i+0] += dx * v[3*i+0];
+        x[3*i+1] += dx * v[3*i+1];
+        x[3*i+2] += dx * v[3*i+2];
+    }
+}
@@ -0,0 +1,365 @@
+#include "./../../include/dynamics/SimulationCheckpoints.hpp"
+#include "./../../include/dynamics/DynamicSystem.hpp"
+#include "./../../include/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// Header of the checkpoint files
+static const char checkpoint_magic[4] = {'C', 'K', 'P', 'T'};
+static const uint32_t checkpoint_version = 1;
+
+SimulationCheckpoints::SimulationCheckpoints(size_t capacity, unsigned int keyframeInterval) :
+    m_capacity(std::max<size_t>(1, capacity)), m_keyframeInterval(std::max(1u, keyframeInterval))
+{}
+
+// Words of a store: positions, velocities, then flags
+static void store_to_words(const ParticleStore& store, std::vector<uint32_t>& words)
+{
+    const size_t n = store.size();
+    words.resize(7 * n);
+    if (n == 0)
+        return;
+    std::memcpy(&words[0], &store.positions()[0][0], 3 * n * sizeof(uint32_t));
+    std::memcpy(&words[3 * n], &store.velocities()[0][0], 3 * n * sizeof(uint32_t));
+    for (size_t i = 0; i < n; ++i)
+        words[6 * n + i] = store.flags()[i];
+}
+
+void SimulationCheckpoints::capture(float time, DynamicSystem& system)
+{
+    discardAfter(time);
+    if (!m_checkpoints.empty() && m_checkpoints.back().time == time)
+        return;
+
+    const ParticleStore& store = system.getParticleStore();
+    store_to_words(store, m_words);
+
+    Checkpoint checkpoint;
+    checkpoint.time = time;
+    checkpoint.dt = system.getDt();
+    checkpoint.slotCount = store.size();
+    // Start a new chain every m_keyframeInterval snapshots, or when the store changed
+    size_t chainLength = 0;
+    for (auto it = m_checkpoints.rbegin(); it != m_checkpoints.rend() && !it->keyframe; ++it)
+        ++chainLength;
+    checkpoint.keyframe = m_checkpoints.empty() || chainLength + 1 >= m_keyframeInterval
+        || m_checkpoints.back().slotCount != checkpoint.slotCount;
+
+    if (checkpoint.keyframe)
+    {
+        encode_words(m_words, checkpoint.data);
+    }
+    else
+    {
+        m_delta.resize(m_words.size());
+        for (size_t i = 0; i < m_words.size(); ++i)
+            m_delta[i] = m_words[i] ^ m_latest[i];
+        encode_words(m_delta, checkpoint.data);
+    }
+    m_checkpoints.push_back(std::move(checkpoint));
+    m_latest.swap(m_words);
+
+    // Drop the oldest chains, so that the first snapshot is always a keyframe
+    while (m_checkpoints.size() > m_capacity)
+    {
+        m_checkpoints.pop_front();
+        while (!m_checkpoints.empty() && !m_checkpoints.front().keyframe)
+            m_checkpoints.pop_front();
+    }
+}
+
+bool SimulationCheckpoints::restore(float time, DynamicSystem& system, float& checkpointTime) const
+{
+    // Latest snapshot at or before the time
+    auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), time,
+        [](float t, const Checkpoint& c) { return t < c.time; });
+    if (it == m_checkpoints.begin())
+        return false;
+    const size_t index = (it - m_checkpoints.begin()) - 1;
+    const Checkpoint& checkpoint = m_checkpoints[index];
+
+    ParticleStore& store = system.getParticleStore();
+    const size_t n = store.size();
+    if (checkpoint.slotCount != n)
+    {
+        LOG(warning, "cannot restore the checkpoint at " << checkpoint.time << " s: the system has "
+            << n << " particles instead of " << checkpoint.slotCount);
+        return false;
+    }
+
+    std::vector<uint32_t> words;
+    decode(index, words);
+    if (n > 0)
+    {
+        std::memcpy(&store.positions()[0][0], &words[0], 3 * n * sizeof(uint32_t));
+        std::memcpy(&store.velocities()[0][0], &words[3 * n], 3 * n * sizeof(uint32_t));
+    }
+    // Slots detached since the capture stay detached
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned char & flags = store.flags()[i];
+        if (!(flags & ParticleStore::DETACHED))
+            flags = words[6 * n + i] & ~ParticleStore::DETACHED;
+    }
+    system.setDt(checkpoint.dt);
+    checkpointTime = checkpoint.time;
+    return true;
+}
+
+void SimulationCheckpoints::decode(size_t index, std::vector<uint32_t>& words) const
+{
+    size_t first = index;
+    while (!m_checkpoints[first].keyframe)
+        --first;
+    decode_words(m_checkpoints[first].data, words);
+    for (size_t i = first + 1; i <= index; ++i)
+    {
+        decode_words(m_checkpoints[i].data, m_delta);
+        for (size_t w = 0; w < words.size(); ++w)
+            words[w] ^= m_delta[w];
+    }
+}
+
+void SimulationCheckpoints::discardAfter(float time)
+{
+    if (m_checkpoints.empty() || m_checkpoints.back().time <= time)
+        return;
+    while (!m_checkpoints.empty() && m_checkpoints.back().time > time)
+        m_checkpoints.pop_back();
+    if (m_checkpoints.empty())
+        m_latest.clear();
+    else
+        decode(m_checkpoints.size() - 1, m_latest);
+}
+
+void SimulationCheckpoints::permute(const std::vector<unsigned int>& order)
+{
+    const size_t n = order.size();
+    std::vector<uint32_t> words, permuted, previous;
+    for (Checkpoint& checkpoint : m_checkpoints)
+    {
+        // Decode the chain as it goes, the deltas applying to the previous state
+        if (checkpoint.keyframe)
+        {
+            decode_words(checkpoint.data, words);
+        }
+        else
+        {
+            decode_words(checkpoint.data, m_delta);
+            for (size_t w = 0; w < words.size(); ++w)
+                words[w] ^= m_delta[w];
+        }
+        if (checkpoint.slotCount != n)
+            continue;
+
+        // Positions and velocities are 3 words per slot, flags 1 word
+        permuted.resize(words.size());
+        for (size_t k = 0; k < n; ++k)
+        {
+            for (size_t c = 0; c < 3; ++c)
+            {
+                permuted[3 * k + c] = words[3 * order[k] + c];
+                permuted[3 * (n + k) + c] = words[3 * (n + order[k]) + c];
+            }
+            permuted[6 * n + k] = words[6 * n + order[k]];
+        }
+        if (checkpoint.keyframe)
+        {
+            encode_words(permuted, checkpoint.data);
+        }
+        else
+        {
+            m_delta.resize(permuted.size());
+            for (size_t w = 0; w < permuted.size(); ++w)
+                m_delta[w] = permuted[w] ^ previous[w];
+            encode_words(m_delta, checkpoint.data);
+        }
+        previous.swap(permuted);
+    }
+    if (!m_checkpoints.empty() && m_checkpoints.back().slotCount == n)
+        m_latest = previous;
+}
+
+void SimulationCheckpoints::clear()
+{
+    m_checkpoints.clear();
+    m_latest.clear();
+}
+
+size_t SimulationCheckpoints::size() const
+{
+    return m_checkpoints.size();
+}
+
+float SimulationCheckpoints::latestTime() const
+{
+    return m_checkpoints.empty() ? -1.0f : m_checkpoints.back().time;
+}
+
+float SimulationCheckpoints::latestTimeBefore(float time) const
+{
+    auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), time,
+        [](float t, const Checkpoint& c) { return t < c.time; });
+    return it == m_checkpoints.begin() ? -1.0f : (it - 1)->time;
+}
+
+size_t SimulationCheckpoints::memoryUsage() const
+{
+    size_t bytes = 0;
+    for (const Checkpoint& checkpoint : m_checkpoints)
+        bytes += checkpoint.data.size();
+    return bytes;
+}
+
+void SimulationCheckpoints::encode_words(const std::vector<uint32_t>& words, std::vector<unsigned char>& data)
+{
+    // The bytes of rank b of all the words, for b = 0..3, then a zero byte
+    // followed by a count encodes a run of 1 to 256 zeros
+    data.clear();
+    data.reserve(words.size());
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(words.data());
+    for (size_t b = 0; b < sizeof(uint32_t); ++b)
+    {
+        size_t w = 0;
+        while (w < words.size())
+        {
+            unsigned char byte = bytes[sizeof(uint32_t) * w + b];
+            if (byte != 0)
+            {
+                data.push_back(byte);
+                ++w;
+                continue;
+            }
+            size_t run = 1;
+            while (run < 256 && w + run < words.size() && bytes[sizeof(uint32_t) * (w + run) + b] == 0)
+                ++run;
+            data.push_back(0);
+            data.push_back(static_cast<unsigned char>(run - 1));
+            w += run;
+        }
+    }
+}
+
+bool SimulationCheckpoints::decode_words(const std::vector<unsigned char>& data, std::vector<uint32_t>& words)
+{
+    // The number of words is the number of decoded bytes divided by 4
+    size_t byteCount = 0;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        if (data[i] != 0)
+            ++byteCount;
+        else if (++i < data.size())
+            byteCount += data[i] + 1;
+        else
+            return false; // run without its count
+    }
+    if (byteCount % sizeof(uint32_t) != 0)
+        return false;
+    const size_t wordCount = byteCount / sizeof(uint32_t);
+    words.resize(wordCount);
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(words.data());
+    size_t b = 0, w = 0;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        size_t run = 1;
+        unsigned char byte = data[i];
+        if (byte == 0)
+            run = data[++i] + 1;
+        for (size_t r = 0; r < run; ++r)
+        {
+            bytes[sizeof(uint32_t) * w + b] = byte;
+            if (++w == wordCount)
+            {
+                w = 0;
+                ++b;
+            }
+        }
+    }
+    return true;
+}
+
+bool SimulationCheckpoints::save(const std::string& filename) const
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        LOG(error, "cannot write the checkpoints in " << filename);
+        return false;
+    }
+    uint32_t count = m_checkpoints.size();
+    file.write(checkpoint_magic, sizeof(checkpoint_magic));
+    file.write(reinterpret_cast<const char*>(&checkpoint_version), sizeof(checkpoint_version));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const Checkpoint& checkpoint : m_checkpoints)
+    {
+        unsigned char keyframe = checkpoint.keyframe;
+        uint32_t size = checkpoint.data.size();
+        file.write(reinterpret_cast<const char*>(&checkpoint.time), sizeof(checkpoint.time));
+        file.write(reinterpret_cast<const char*>(&checkpoint.dt), sizeof(checkpoint.dt));
+        file.write(reinterpret_cast<const char*>(&keyframe), sizeof(keyframe));
+        file.write(reinterpret_cast<const char*>(&checkpoint.slotCount), sizeof(checkpoint.slotCount));
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(checkpoint.data.data()), size);
+    }
+    return bool(file);
+}
+
+bool SimulationCheckpoints::load(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!file || std::memcmp(magic, checkpoint_magic, sizeof(magic)) != 0 || version != checkpoint_version)
+    {
+        LOG(error, "cannot read the checkpoints of " << filename);
+        return false;
+    }
+
+    std::deque<Checkpoint> checkpoints;
+    for (uint32_t c = 0; c < count; ++c)
+    {
+        Checkpoint checkpoint;
+        unsigned char keyframe = 0;
+        uint32_t size = 0;
+        file.read(reinterpret_cast<char*>(&checkpoint.time), sizeof(checkpoint.time));
+        file.read(reinterpret_cast<char*>(&checkpoint.dt), sizeof(checkpoint.dt));
+        file.read(reinterpret_cast<char*>(&keyframe), sizeof(keyframe));
+        file.read(reinterpret_cast<char*>(&checkpoint.slotCount), sizeof(checkpoint.slotCount));
+        file.read(reinterpret_cast<char*>(&size), sizeof(size));
+        checkpoint.keyframe = keyframe;
+        checkpoint.data.resize(size);
+        file.read(reinterpret_cast<char*>(checkpoint.data.data()), size);
+        if (!file || (checkpoints.empty() && !checkpoint.keyframe))
+        {
+            LOG(error, "the checkpoint file " << filename << " is corrupted");
+            return false;
+        }
+        checkpoints.push_back(std::move(checkpoint));
+    }
+
+    // Every snapshot must decode to the words of its particles, and the
+    // deltas of a chain must have the size of its keyframe
+    std::vector<uint32_t> words;
+    for (size_t c = 0; c < checkpoints.size(); ++c)
+    {
+        const Checkpoint& checkpoint = checkpoints[c];
+        if (!decode_words(checkpoint.data, words) || words.size() != 7 * size_t(checkpoint.slotCount)
+            || (!checkpoint.keyframe && checkpoint.slotCount != checkpoints[c - 1].slotCount))
+        {
+            LOG(error, "the checkpoint file " << filename << " is corrupted");
+            return false;
+        }
+    }
+
+    m_checkpoints.swap(checkpoints);
+    if (m_checkpoints.empty())
+        m_latest.clear();
+    else
+        decode(m_checkpoints.size() - 1, m_latest);
+    return true;
+}
@@ -0,0 +1,364 @@
+#include "./../../include/dynamics/SimulationIslands.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <glm/gtx/norm.hpp>
+
+SimulationIslands::SimulationIslands() :
+    m_enabled(true), m_dirty(true), m_sleepSpeed(0.05f), m_sleepDelay(1.0f),
+    m_builtSlots(0), m_sleepingCount(0)
+{}
+
+SimulationIslands::~SimulationIslands()
+{}
+
+void SimulationIslands::setEnabled(bool onOff)
+{
+    m_enabled = onOff;
+    m_dirty = true;
+}
+
+bool SimulationIslands::isEnabled() const
+{
+    return m_enabled;
+}
+
+void SimulationIslands::setSleepThreshold(float speed, float delay)
+{
+    m_sleepSpeed = std::max(0.0f, speed);
+    m_sleepDelay = std::max(0.0f, delay);
+}
+
+void SimulationIslands::invalidate()
+{
+    m_dirty = true;
+}
+
+void SimulationIslands::permute(const std::vector<unsigned int>& order)
+{
+    const size_t n = order.size();
+    if (m_dirty || m_slotIsland.size() != n)
+    {
+        m_dirty = true;
+        return;
+    }
+    std::vector<int> slotIsland(n);
+    std::vector<unsigned int> newSlots(n);
+    for (size_t k = 0; k < n; ++k)
+    {
+        slotIsland[k] = m_slotIsland[order[k]];
+        newSlots[order[k]] = k;
+    }
+    m_slotIsland.swap(slotIsland);
+    for (unsigned int & slot : m_islandSlots)
+        slot = newSlots[slot];
+    // The slots of each island stay sorted, for the loops over them
+    for (size_t k = 0; k + 1 < m_firstSlot.size(); ++k)
+        std::sort(m_islandSlots.begin() + m_firstSlot[k], m_islandSlots.begin() + m_firstSlot[k + 1]);
+    m_startPositions.clear();
+}
+
+size_t SimulationIslands::islandCount() const
+{
+    return m_quietTime.size();
+}
+
+size_t SimulationIslands::sleepingIslandCount() const
+{
+    return m_sleepingCount;
+}
+
+const std::vector<unsigned int>& SimulationIslands::activeIslands() const
+{
+    return m_activeIslands;
+}
+
+const std::vector< std::vector<unsigned int> >& SimulationIslands::islandForceFields() const
+{
+    return m_islandFields;
+}
+
+const std::vector<unsigned int>& SimulationIslands::sharedForceFields() const
+{
+    return m_sharedFields;
+}
+
+// Root of an element, halving the path on the way
+static unsigned int find_root(std::vector<unsigned int>& parents, unsigned int i)
+{
+    while (parents[i] != i)
+    {
+        parents[i] = parents[parents[i]];
+        i = parents[i];
+    }
+    return i;
+}
+
+static void merge(std::vector<unsigned int>& parents, unsigned int i, unsigned int j)
+{
+    i = find_root(parents, i);
+    j = find_root(parents, j);
+    // The smallest index is the root: the islands are numbered in slot order
+    if (i < j)
+        parents[j] = i;
+    else if (j < i)
+        parents[i] = j;
+}
+
+void SimulationIslands::rebuild(ParticleStore& store, const std::vector<ForceFieldPtr>& forceFields)
+{
+    const size_t n = store.size();
+    const size_t fieldCount = forceFields.size();
+    ParticleStore::Array<unsigned char> & flags = store.flags();
+
+    // Couplings of all the fields: a field whose couplings are unknown may
+    // couple all the particles
+    m_couplings.clear();
+    std::vector<size_t> fieldEnd(fieldCount);
+    bool unknown = false;
+    for (size_t f = 0; f < fieldCount; ++f)
+    {
+        size_t begin = m_couplings.size();
+        if (!forceFields[f]->addCouplings(store, m_couplings))
+        {
+            m_couplings.resize(begin);
+            unknown = true;
+        }
+        fieldEnd[f] = m_couplings.size();
+    }
+
+    m_parents.resize(n);
+    std::iota(m_parents.begin(), m_parents.end(), 0u);
+    for (const Pair & coupling : m_couplings)
+    {
+        if (coupling.first != coupling.second && coupling.first < n && coupling.second < n)
+            merge(m_parents, coupling.first, coupling.second);
+    }
+    unsigned int first = std::numeric_limits<unsigned int>::max();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (flags[i] & ParticleStore::DETACHED)
+            continue;
+        if (unknown && first != std::numeric_limits<unsigned int>::max())
+            merge(m_parents, first, i);
+        first = std::min<unsigned int>(first, i);
+    }
+
+    // Number the islands, and sort their slots with a counting sort
+    m_slotIsland.assign(n, -1);
+    int islandCount = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (flags[i] & ParticleStore::DETACHED)
+            continue;
+        unsigned int root = find_root(m_parents, i);
+        m_slotIsland[i] = root == i ? islandCount++ : m_slotIsland[root];
+    }
+    m_firstSlot.assign(islandCount + 1, 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (m_slotIsland[i] >= 0)
+            ++m_firstSlot[m_slotIsland[i] + 1];
+    }
+    for (int k = 0; k < islandCount; ++k)
+        m_firstSlot[k + 1] += m_firstSlot[k];
+    m_islandSlots.resize(m_firstSlot[islandCount]);
+    std::vector<unsigned int> next(m_firstSlot.begin(), m_firstSlot.end() - 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (m_slotIsland[i] >= 0)
+            m_islandSlots[next[m_slotIsland[i]]++] = i;
+    }
+
+    // A field is local to an island if all its couplings are in it. Otherwise,
+    // it is shared and the islands it acts on are listed once each
+    m_fieldIsland.assign(fieldCount, -1);
+    m_islandFields.assign(islandCount, std::vector<unsigned int>());
+    m_firstFieldIsland.assign(fieldCount + 1, 0);
+    m_fieldIslands.clear();
+    std::vector<unsigned int> lastField(islandCount, std::numeric_limits<unsigned int>::max());
+    for (size_t f = 0; f < fieldCount; ++f)
+    {
+        size_t begin = f == 0 ? 0 : fieldEnd[f - 1];
+        size_t listBegin = m_fieldIslands.size();
+        for (size_t c = begin; c < fieldEnd[f]; ++c)
+        {
+            const unsigned int slots[2] = { m_couplings[c].first, m_couplings[c].second };
+            for (unsigned int slot : slots)
+            {
+                int island = slot < n ? m_slotIsland[slot] : -1;
+                if (island >= 0 && lastField[island] != f)
+                {
+                    lastField[island] = f;
+                    m_fieldIslands.push_back(island);
+                }
+            }
+        }
+        if (unknown && islandCount > 0)
+        {
+            // All the slots are in the first island
+            m_fieldIslands.resize(listBegin);
+            m_fieldIslands.push_back(0);
+        }
+        if (m_fieldIslands.size() == listBegin + 1)
+        {
+            m_fieldIsland[f] = m_fieldIslands.back();
+            m_islandFields[m_fieldIslands.back()].push_back(f);
+            m_fieldIslands.pop_back();
+        }
+        m_firstFieldIsland[f + 1] = m_fieldIslands.size();
+    }
+
+    // The new islands are awake
+    for (size_t i = 0; i < n; ++i)
+        flags[i] &= ~ParticleStore::SLEEPING;
+    m_quietTime.assign(islandCount, 0.0f);
+    m_sleeping.assign(islandCount, 0);
+    m_sleepingCount = 0;
+
+    m_builtFields.resize(fieldCount);
+    for (size_t f = 0; f < fieldCount; ++f)
+        m_builtFields[f] = forceFields[f].get();
+    m_builtSlots = n;
+    m_dirty = false;
+}
+
+void SimulationIslands::update(ParticleStore& store, const std::vector<ForceFieldPtr>& forceFields)
+{
+    const size_t fieldCount = forceFields.size();
+    m_activeIslands.clear();
+    m_sharedFields.clear();
+    if (!m_enabled)
+    {
+        if (m_sleepingCount > 0)
+            wakeUp(store);
+        m_islandFields.clear();
+        m_quietTime.clear();
+        for (size_t f = 0; f < fieldCount; ++f)
+            m_sharedFields.push_back(f);
+        return;
+    }
+
+    bool changed = m_dirty || store.size() != m_builtSlots || fieldCount != m_builtFields.size();
+    for (size_t f = 0; f < fieldCount && !changed; ++f)
+        changed = forceFields[f].get() != m_builtFields[f];
+    if (changed)
+        rebuild(store, forceFields);
+
+    for (size_t k = 0; k < m_islandFields.size(); ++k)
+    {
+        if (!m_sleeping[k] && !m_islandFields[k].empty())
+            m_activeIslands.push_back(k);
+    }
+    for (size_t f = 0; f < fieldCount; ++f)
+    {
+        if (m_fieldIsland[f] >= 0)
+            continue;
+        // A shared field is skipped only if all the islands it acts on sleep
+        bool awake = m_firstFieldIsland[f] == m_firstFieldIsland[f + 1];
+        for (unsigned int e = m_firstFieldIsland[f]; e < m_firstFieldIsland[f + 1] && !awake; ++e)
+            awake = !m_sleeping[m_fieldIslands[e]];
+        if (awake)
+            m_sharedFields.push_back(f);
+    }
+
+    // Positions at the start of the step, to measure the displacements
+    m_startPositions.assign(store.positions().begin(), store.positions().end());
+}
+
+void SimulationIslands::updateSleep(ParticleStore& store, const std::vector<Pair>& contacts, float dt)
+{
+    const int islandCount = static_cast<int>(m_quietTime.size());
+    if (!m_enabled || islandCount == 0 || m_startPositions.size() != store.size())
+        return;
+
+    // Largest squared displacement of the particles of each awake island
+    const glm::vec3* positions = store.positions().data();
+    const glm::vec3* startPositions = m_startPositions.data();
+    m_displacements.assign(islandCount, 0.0f);
+    #pragma omp parallel for schedule(dynamic, 64) if(islandCount > 64)
+    for (int k = 0; k < islandCount; ++k)
+    {
+        if (m_sleeping[k])
+            continue;
+        float displacement = 0.0f;
+        for (unsigned int s = m_firstSlot[k]; s < m_firstSlot[k + 1]; ++s)
+        {
+            unsigned int i = m_islandSlots[s];
+            displacement = std::max(displacement, glm::length2(positions[i] - startPositions[i]));
+        }
+        m_displacements[k] = displacement;
+    }
+    const float limit = m_sleepSpeed * dt * m_sleepSpeed * dt;
+    for (int k = 0; k < islandCount; ++k)
+    {
+        if (!m_sleeping[k])
+            m_quietTime[k] = m_displacements[k] > limit ? 0.0f : m_quietTime[k] + dt;
+    }
+
+    // Islands in contact form a group, that sleeps if all its islands are
+    // quiet. Fixed particles do not join islands
+    const unsigned char* flags = store.flags().data();
+    m_parents.resize(islandCount);
+    std::iota(m_parents.begin(), m_parents.end(), 0u);
+    for (const Pair & contact : contacts)
+    {
+        if ((flags[contact.first] | flags[contact.second]) & (ParticleStore::FIXED | ParticleStore::DETACHED))
+            continue;
+        int a = m_slotIsland[contact.first], b = m_slotIsland[contact.second];
+        if (a >= 0 && b >= 0)
+            merge(m_parents, a, b);
+    }
+    m_quietGroups.assign(islandCount, 1);
+    for (int k = 0; k < islandCount; ++k)
+    {
+        if (m_quietTime[k] < m_sleepDelay)
+            m_quietGroups[find_root(m_parents, k)] = 0;
+    }
+    for (int k = 0; k < islandCount; ++k)
+    {
+        bool sleeping = m_quietGroups[find_root(m_parents, k)];
+        if (sleeping == bool(m_sleeping[k]))
+            continue;
+        setSleeping(store, k, sleeping);
+        // An island woken up by its group waits again before sleeping
+        if (!sleeping)
+            m_quietTime[k] = 0.0f;
+    }
+}
+
+void SimulationIslands::setSleeping(ParticleStore& store, unsigned int island, bool sleeping)
+{
+    ParticleStore::Array<unsigned char> & flags = store.flags();
+    ParticleStore::Array<glm::vec3> & velocities = store.velocities();
+    for (unsigned int s = m_firstSlot[island]; s < m_firstSlot[island + 1]; ++s)
+    {
+        unsigned int i = m_islandSlots[s];
+        if (sleeping)
+        {
+            flags[i] |= ParticleStore::SLEEPING;
+            velocities[i] = glm::vec3(0.0f);
+        }
+        else
+        {
+            flags[i] &= ~ParticleStore::SLEEPING;
+        }
+    }
+    m_sleeping[island] = sleeping;
+    if (sleeping)
+        ++m_sleepingCount;
+    else
+        --m_sleepingCount;
+}
+
+void SimulationIslands::wakeUp(ParticleStore& store)
+{
+    ParticleStore::Array<unsigned char> & flags = store.flags();
+    for (size_t i = 0; i < flags.size(); ++i)
+        flags[i] &= ~ParticleStore::SLEEPING;
+    std::fill(m_sleeping.begin(), m_sleeping.end(), 0);
+    std::fill(m_quietTime.begin(), m_quietTime.end(), 0.0f);
+    m_sleepingCount = 0;
+    m_dirty = true;
+}
@@ -0,0 +1,216 @@
+#include "./../../include/dynamics/SnowfallRenderable.hpp"
+#include "./../../include/gl_helper.hpp"
+#include "./../../include/log.hpp"
+#include "./../../include/Utils.hpp"
+#include "./../../include/Viewer.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// State of a flake, as it is stored in the state buffers
+struct FlakeState
+{
+    glm::vec4 position; // xyz: position, w: age in seconds (negative if never emitted)
+    glm::vec4 params; // x: speed factor, y: size factor, z: phase, w: lifetime
+};
+
+SnowfallRenderable::~SnowfallRenderable()
+{
+    glcheck(glDeleteBuffers(2, m_stateBuffers));
+}
+
+SnowfallRenderable::SnowfallRenderable(ShaderProgramPtr program, unsigned int flakeCount) :
+    Renderable(program),
+    m_current(0), m_flakeCount(flakeCount), m_emitted(float(flakeCount)),
+    m_lastUpdateTime(0), m_step(0),
+    m_halfExtent(40, 20, 40), m_groundHeight(0), m_fallSpeed(1.5f),
+    m_wind(0.3f, 0, 0.1f), m_turbulence(0.4f), m_flakeSize(0.05f),
+    m_color(1.0f, 1.0f, 1.0f, 1.0f), m_emissionRate(0)
+{
+    m_updateProgram = std::make_shared<ShaderProgram>(
+        "../../sfmlGraphicsPipeline/shaders/snowfallUpdateVertex.glsl",
+        std::vector< std::string >{ "outPosition", "outParams" });
+
+    // Flakes are emitted by the update shader: only their constant parameters
+    // are initialized here, on the CPU, once
+    std::vector< FlakeState > flakes(m_flakeCount);
+    for (FlakeState & flake : flakes)
+    {
+        flake.position = glm::vec4(0, 0, 0, -1);
+        flake.params = glm::vec4(random(0.7, 1.3), random(0.6, 1.4), random(0.0, 2*M_PI), random(20.0, 40.0));
+    }
+
+    glcheck(glGenBuffers(2, m_stateBuffers));
+    for (unsigned int buffer : m_stateBuffers)
+    {
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+        glcheck(glBufferData(GL_ARRAY_BUFFER, flakes.size()*sizeof(FlakeState), flakes.data(), GL_DYNAMIC_COPY));
+    }
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void SnowfallRenderable::setVolume(const glm::vec3& halfExtent)
+{
+    m_halfExtent = halfExtent;
+}
+
+void SnowfallRenderable::setGroundHeight(float height)
+{
+    m_groundHeight = height;
+}
+
+void SnowfallRenderable::setFallSpeed(float speed)
+{
+    m_fallSpeed = speed;
+}
+
+void SnowfallRenderable::setWind(const glm::vec3& wind)
+{
+    m_wind = wind;
+}
+
+void SnowfallRenderable::setTurbulence(float turbulence)
+{
+    m_turbulence = turbulence;
+}
+
+void SnowfallRenderable::setFlakeSize(float size)
+{
+    m_flakeSize = size;
+}
+
+void SnowfallRenderable::setColor(const glm::vec4& color)
+{
+    m_color = color;
+}
+
+void SnowfallRenderable::setEmissionRate(float rate)
+{
+    m_emissionRate = rate;
+    m_emitted = rate > 0 ? std::min(m_emitted, 0.0f) : float(m_flakeCount);
+}
+
+unsigned int SnowfallRenderable::flakeCount() const
+{
+    return m_flakeCount;
+}
+
+unsigned int SnowfallRenderable::emittedCount() const
+{
+    return std::min(m_flakeCount, static_cast<unsigned int>(m_emitted));
+}
+
+void SnowfallRenderable::bind_state_attributes(const ShaderProgram& program, unsigned int buffer)
+{
+    int positionLocation = program.getAttributeLocation("vPosition");
+    int paramsLocation = program.getAttributeLocation("vParams");
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+    if (positionLocation != ShaderProgram::null_location)
+    {
+        glcheck(glEnableVertexAttribArray(positionLocation));
+        glcheck(glVertexAttribPointer(positionLocation, 4, GL_FLOAT, GL_FALSE, sizeof(FlakeState), (void*)offsetof(FlakeState, position)));
+    }
+    if (paramsLocation != ShaderProgram::null_location)
+    {
+        glcheck(glEnableVertexAttribArray(paramsLocation));
+        glcheck(glVertexAttribPointer(paramsLocation, 4, GL_FLOAT, GL_FALSE, sizeof(FlakeState), (void*)offsetof(FlakeState, params)));
+    }
+}
+
+void SnowfallRenderable::unbind_state_attributes(const ShaderProgram& program)
+{
+    int positionLocation = program.getAttributeLocation("vPosition");
+    int paramsLocation = program.getAttributeLocation("vParams");
+    if (positionLocation != ShaderProgram::null_location)
+    {
+        glcheck(glDisableVertexAttribArray(positionLocation));
+    }
+    if (paramsLocation != ShaderProgram::null_location)
+    {
+        glcheck(glDisableVertexAttribArray(paramsLocation));
+    }
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+// One step of the simulation: the update shader reads the current state buffer
+// and writes the next state in the other one, then the buffers are swapped.
+void SnowfallRenderable::do_animate(float time)
+{
+    float dt = time - m_lastUpdateTime;
+    m_lastUpdateTime = time;
+    // The animation was reset or looped
+    if (dt <= 0)
+        return;
+    // Avoid a burst after a pause of the application
+    dt = std::min(dt, 0.1f);
+
+    if (m_emissionRate > 0)
+        m_emitted = std::min(float(m_flakeCount), m_emitted + m_emissionRate * dt);
+    GLsizei active = emittedCount();
+    if (active == 0)
+        return;
+
+    glm::vec3 camera = m_viewer ? m_viewer->getCamera().getPosition() : glm::vec3(0);
+
+    const ShaderProgram & program = *m_updateProgram;
+    m_updateProgram->bind();
+    glcheck(glUniform1f(program.getUniformLocation("dt"), dt));
+    glcheck(glUniform1f(program.getUniformLocation("time"), time));
+    glcheck(glUniform1ui(program.getUniformLocation("seed"), m_step));
+    glcheck(glUniform3fv(program.getUniformLocation("cameraPosition"), 1, glm::value_ptr(camera)));
+    glcheck(glUniform3fv(program.getUniformLocation("halfExtent"), 1, glm::value_ptr(m_halfExtent)));
+    glcheck(glUniform1f(program.getUniformLocation("groundHeight"), m_groundHeight));
+    glcheck(glUniform1f(program.getUniformLocation("fallSpeed"), m_fallSpeed));
+    glcheck(glUniform3fv(program.getUniformLocation("wind"), 1, glm::value_ptr(m_wind)));
+    glcheck(glUniform1f(program.getUniformLocation("turbulence"), m_turbulence));
+    glcheck(glUniform1i(program.getUniformLocation("fillVolume"), m_emissionRate > 0 ? 0 : 1));
+
+    bind_state_attributes(program, m_stateBuffers[m_current]);
+    glcheck(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_stateBuffers[1 - m_current]));
+    glcheck(glEnable(GL_RASTERIZER_DISCARD));
+    glcheck(glBeginTransformFeedback(GL_POINTS));
+    glcheck(glDrawArrays(GL_POINTS, 0, active));
+    glcheck(glEndTransformFeedback());
+    glcheck(glDisable(GL_RASTERIZER_DISCARD));
+    glcheck(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0));
+    unbind_state_attributes(program);
+    ShaderProgram::unbind();
+
+    m_current = 1 - m_current;
+    ++m_step;
+}
+
+void SnowfallRenderable::do_draw()
+{
+    GLsizei active = emittedCount();
+    if (active == 0 || !m_viewer)
+        return;
+
+    // Scale from a world size at unit distance to a size in pixels
+    GLint viewport[4];
+    glcheck(glGetIntegerv(GL_VIEWPORT, viewport));
+    float pointScale = 0.5f * viewport[3] * m_viewer->getCamera().projectionMatrix()[1][1];
+
+    int pointScaleLocation = m_shaderProgram->getUniformLocation("pointScale");
+    int sizeLocation = m_shaderProgram->getUniformLocation("flakeSize");
+    int colorLocation = m_shaderProgram->getUniformLocation("snowColor");
+    if (pointScaleLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniform1f(pointScaleLocation, pointScale));
+    }
+    if (sizeLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniform1f(sizeLocation, m_flakeSize));
+    }
+    if (colorLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniform4fv(colorLocation, 1, glm::value_ptr(m_color)));
+    }
+
+    bind_state_attributes(*m_shaderProgram, m_stateBuffers[m_current]);
+    glcheck(glDrawArrays(GL_POINTS, 0, active));
+    unbind_state_attributes(*m_shaderProgram);
+}
@@ -4,3 +4,54 @@ void Solver::solve( const float& dt, std::vector<ParticlePtr>& particles )
 {
   do_solve( dt, particles );
 }
+
+void Solver::solve( const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles )
+{
+  do_solve( dt, store, particles );
+}
+
+void Solver::solve( const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles,
+                    const std::vector<ForceFieldPtr>& forceFields )
+{
+  do_solve( dt, store, particles, forceFields );
+}
+
+bool Solver::convertsForceField( const ForceField& forceField ) const
+{
+  return do_convertsForceField( forceField );
+}
+
+void Solver::do_solve( const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles )
+{
+  do_solve( dt, particles );
+}
+
+void Solver::do_solve( const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles,
+                       const std::vector<ForceFieldPtr>& forceFields )
+{
+  do_solve( dt, store, particles );
+}
+
+bool Solver::do_convertsForceField( const ForceField& forceField ) const
+{
+  return false;
+}
+
+bool Solver::isUnconditionallyStable( const ForceField& forceField ) const
+{
+  return do_isUnconditionallyStable( forceField );
+}
+
+bool Solver::do_isUnconditionallyStable( const ForceField& forceField ) const
+{
+  return false;
+}
+
+void Solver::invalidateSlots()
+{
+  do_invalidateSlots();
+}
+
+void Solver::do_invalidateSlots()
+{
+}
@@ -0,0 +1,175 @@
+#include "./../../include/dynamics/SpatialHashBroadphase.hpp"
+
+#include <algorithm>
+#include <cmath>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static unsigned int hash_cell(const glm::ivec3& cell, unsigned int mask)
+{
+    return (static_cast<unsigned int>(cell.x) * 73856093u
+          ^ static_cast<unsigned int>(cell.y) * 19349663u
+          ^ static_cast<unsigned int>(cell.z) * 83492791u) & mask;
+}
+
+// The cell itself, then the 13 neighbors after it in lexicographic order
+static const glm::ivec3 half_stencil[14] =
+{
+    glm::ivec3( 0, 0, 0), glm::ivec3( 1, 0, 0),
+    glm::ivec3(-1, 1, 0), glm::ivec3( 0, 1, 0), glm::ivec3( 1, 1, 0),
+    glm::ivec3(-1,-1, 1), glm::ivec3( 0,-1, 1), glm::ivec3( 1,-1, 1),
+    glm::ivec3(-1, 0, 1), glm::ivec3( 0, 0, 1), glm::ivec3( 1, 0, 1),
+    glm::ivec3(-1, 1, 1), glm::ivec3( 0, 1, 1), glm::ivec3( 1, 1, 1)
+};
+
+SpatialHashBroadphase::SpatialHashBroadphase() :
+    m_cellSize(0)
+{}
+
+SpatialHashBroadphase::~SpatialHashBroadphase()
+{}
+
+void SpatialHashBroadphase::setCellSize(float size)
+{
+    m_cellSize = std::max(size, 0.0f);
+}
+
+float SpatialHashBroadphase::getCellSize() const
+{
+    return m_cellSize;
+}
+
+void SpatialHashBroadphase::findPairs(const ParticleStore& store, std::vector< Pair >& pairs)
+{
+    pairs.clear();
+    const int n = static_cast<int>(store.size());
+    if (n < 2)
+        return;
+
+    const ParticleStore::Array< glm::vec3 > & positions = store.positions();
+    const ParticleStore::Array< float > & radii = store.radii();
+    const ParticleStore::Array< unsigned char > & flags = store.flags();
+
+    float maxRadius = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (!(flags[i] & ParticleStore::DETACHED))
+            maxRadius = std::max(maxRadius, radii[i]);
+    }
+    float cellSize = std::max(m_cellSize, 2 * maxRadius);
+    if (cellSize <= 0)
+        return;
+    float invCellSize = 1.0f / cellSize;
+
+    // A power of two at least twice the number of particles
+    unsigned int bucketCount = 1;
+    while (bucketCount < 2u * n)
+        bucketCount <<= 1;
+    const unsigned int mask = bucketCount - 1;
+    const unsigned int detachedKey = bucketCount; // sorted after all buckets
+
+    m_cells.resize(n);
+    m_keys.resize(n);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i)
+    {
+        m_cells[i] = glm::ivec3(glm::floor(positions[i] * invCellSize));
+        m_keys[i] = (flags[i] & ParticleStore::DETACHED) ? detachedKey : hash_cell(m_cells[i], mask);
+    }
+
+    // Counting sort of the slots by bucket
+    m_bucketStart.assign(bucketCount + 2, 0);
+    for (int i = 0; i < n; ++i)
+        ++m_bucketStart[m_keys[i] + 1];
+    for (unsigned int b = 1; b < bucketCount + 2; ++b)
+        m_bucketStart[b] += m_bucketStart[b - 1];
+    m_sorted.resize(n);
+    m_next.assign(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for (int i = 0; i < n; ++i)
+        m_sorted[m_next[m_keys[i]]++] = i;
+    const int active = static_cast<int>(m_bucketStart[bucketCount]);
+
+    // Copy the particles in sorted order: the particles of a bucket are then
+    // contiguous in memory. The radius is stored in the w coordinate, and a
+    // negative radius marks particles that do not move: fixed or sleeping.
+    m_sortedCells.resize(active);
+    m_sortedSpheres.resize(active);
+    int moving = 0;
+    #pragma omp parallel for schedule(static) reduction(+:moving)
+    for (int k = 0; k < active; ++k)
+    {
+        unsigned int i = m_sorted[k];
+        m_sortedCells[k] = m_cells[i];
+        bool still = flags[i] & (ParticleStore::FIXED | ParticleStore::SLEEPING);
+        m_sortedSpheres[k] = glm::vec4(positions[i], still ? -radii[i] - 1.0f : radii[i]);
+        moving += still ? 0 : 1;
+    }
+    // When most particles do not move, only the moving ones query their
+    // neighbors, in the 27 cells around them: the pairs of moving particles
+    // are still found once, in the half stencil
+    const bool movingQueries = 2 * moving < active;
+
+    int threadCount = 1;
+#ifdef _OPENMP
+    threadCount = omp_get_max_threads();
+#endif
+    m_threadPairs.resize(threadCount);
+    #pragma omp parallel
+    {
+        int thread = 0;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#endif
+        std::vector< Pair > & found = m_threadPairs[thread];
+        found.clear();
+
+        // Each pair is found once: in the cell of the particle, only the
+        // particles sorted after it are tested, and only the 13 neighbor
+        // cells "after" this cell are visited.
+        #pragma omp for schedule(static)
+        for (int k = 0; k < active; ++k)
+        {
+            const glm::ivec3 cell = m_sortedCells[k];
+            const glm::vec4 sphere = m_sortedSpheres[k];
+            const bool fixed = sphere.w < 0;
+            if (fixed && movingQueries)
+                continue;
+            const float radius = fixed ? -sphere.w - 1.0f : sphere.w;
+            const int stencilSize = movingQueries ? 27 : 14;
+            for (int s = 0; s < stencilSize; ++s)
+            {
+                // The other 13 neighbors are the opposite of the half stencil
+                const bool half = s < 14;
+                glm::ivec3 neighbor = half ? cell + half_stencil[s] : cell - half_stencil[s - 13];
+                unsigned int bucket = hash_cell(neighbor, mask);
+                unsigned int e = s == 0 && !movingQueries ? k + 1 : m_bucketStart[bucket];
+                for (; e < m_bucketStart[bucket + 1]; ++e)
+                {
+                    // Several cells may share a bucket
+                    if (m_sortedCells[e] != neighbor)
+                        continue;
+                    const glm::vec4 & other = m_sortedSpheres[e];
+                    if (fixed && other.w < 0)
+                        continue;
+                    if (movingQueries && other.w >= 0 && (!half || (s == 0 && e <= static_cast<unsigned int>(k))))
+                        continue;
+                    glm::vec3 d = glm::vec3(other) - glm::vec3(sphere);
+                    float r = radius + (other.w < 0 ? -other.w - 1.0f : other.w);
+                    if (glm::dot(d, d) < r * r)
+                    {
+                        unsigned int i = m_sorted[k], j = m_sorted[e];
+                        found.push_back(i < j ? Pair(i, j) : Pair(j, i));
+                    }
+                }
+            }
+        }
+    }
+
+    size_t total = 0;
+    for (const std::vector< Pair > & found : m_threadPairs)
+        total += found.size();
+    pairs.reserve(total);
+    for (const std::vector< Pair > & found : m_threadPairs)
+        pairs.insert(pairs.end(), found.begin(), found.end());
+}
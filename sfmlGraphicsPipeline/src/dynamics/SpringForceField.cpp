@@ -1,4 +1,9 @@
 #include "./../../include/dynamics/SpringForceField.hpp"
+#include "./../../include/dynamics/ParticleStore.hpp"
+#include "./../../include/dynamics/BlockSparseMatrix.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 SpringForceField::SpringForceField(const ParticlePtr p1, const ParticlePtr p2, float stiffness, float equilibriumLength, float damping) :
     m_p1(p1),
@@ -38,6 +43,101 @@ void SpringForceField::do_addForce()
     }
 }
 
+bool SpringForceField::do_addForce(const ParticleStore& store, glm::vec3* forces) const
+{
+    if(m_p1->getStore() != &store || m_p2->getStore() != &store)
+        return false;
+    size_t i1 = m_p1->getStoreIndex();
+    size_t i2 = m_p2->getStoreIndex();
+
+    //Same damped spring as above, reading the store directly
+    glm::vec3 displacement = store.positions()[i1] - store.positions()[i2];
+    float pos_norm = glm::length(displacement);
+    if(pos_norm > std::numeric_limits<float>::epsilon())
+    {
+        glm::vec3 direction = displacement / pos_norm;
+        float relative_speed = glm::dot(store.velocities()[i1] - store.velocities()[i2], direction);
+        glm::vec3 total = (-m_stiffness * (pos_norm - m_equilibriumLength) - m_damping * relative_speed) * direction;
+        forces[i1] += total;
+        forces[i2] -= total;
+    }
+    return true;
+}
+
+bool SpringForceField::do_addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const
+{
+    if(m_p1->getStore() != &store || m_p2->getStore() != &store)
+        return false;
+    size_t i1 = m_p1->getStoreIndex();
+    size_t i2 = m_p2->getStoreIndex();
+    addSpringJacobians(i1, i2, store.positions()[i1] - store.positions()[i2],
+                       m_stiffness, m_equilibriumLength, m_damping, dfdx, dfdv);
+    return true;
+}
+
+float SpringForceField::do_addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const
+{
+    if(m_p1->getStore() != &store || m_p2->getStore() != &store)
+        return 0.0f;
+    return addSpringStabilityBounds(m_p1->getStoreIndex(), m_p2->getStoreIndex(), store,
+                                    m_stiffness, m_equilibriumLength, m_damping, stiffness, damping);
+}
+
+bool SpringForceField::do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const
+{
+    if(m_p1->getStore() != &store || m_p2->getStore() != &store)
+        return false;
+    couplings.push_back(std::make_pair(m_p1->getStoreIndex(), m_p2->getStoreIndex()));
+    return true;
+}
+
+float SpringForceField::addSpringStabilityBounds(unsigned int i1, unsigned int i2, const ParticleStore& store,
+        float stiffness, float equilibriumLength, float damping,
+        float* stiffnessBounds, float* dampingBounds)
+{
+    //Each row of the Jacobian holds a diagonal and an off-diagonal block,
+    //both of norm at most the stiffness (resp. the damping)
+    stiffnessBounds[i1] += 2.0f * stiffness;
+    stiffnessBounds[i2] += 2.0f * stiffness;
+    dampingBounds[i1] += 2.0f * damping;
+    dampingBounds[i2] += 2.0f * damping;
+
+    if(equilibriumLength <= std::numeric_limits<float>::epsilon())
+        return 0.0f;
+    glm::vec3 displacement = store.positions()[i1] - store.positions()[i2];
+    float length = glm::length(displacement);
+    if(length <= std::numeric_limits<float>::epsilon())
+        return 0.0f;
+    float speed = glm::dot(store.velocities()[i1] - store.velocities()[i2], displacement) / length;
+    return std::abs(speed) / equilibriumLength;
+}
+
+void SpringForceField::addSpringJacobians(unsigned int i1, unsigned int i2, const glm::vec3& displacement,
+        float stiffness, float equilibriumLength, float damping,
+        BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv)
+{
+    float length = glm::length(displacement);
+    if(length <= std::numeric_limits<float>::epsilon())
+        return;
+    glm::vec3 direction = displacement / length;
+    glm::mat3 projection = glm::outerProduct(direction, direction);
+
+    //Derivatives of the force on the first particle with respect to its own
+    //position and velocity. The position derivative of the damping is neglected
+    float transverse = std::max(0.0f, 1.0f - equilibriumLength / length);
+    glm::mat3 kx = -stiffness * (projection + transverse * (glm::mat3(1.0f) - projection));
+    glm::mat3 kv = -damping * projection;
+
+    dfdx.addBlock(i1, i1, kx);
+    dfdx.addBlock(i2, i2, kx);
+    dfdx.addBlock(i1, i2, -kx);
+    dfdx.addBlock(i2, i1, -kx);
+    dfdv.addBlock(i1, i1, kv);
+    dfdv.addBlock(i2, i2, kv);
+    dfdv.addBlock(i1, i2, -kv);
+    dfdv.addBlock(i2, i1, -kv);
+}
+
 ParticlePtr SpringForceField::getParticle1() const
 {
     return m_p1;
@@ -47,3 +147,18 @@ ParticlePtr SpringForceField::getParticle2() const
 {
     return m_p2;
 }
+
+float SpringForceField::getStiffness() const
+{
+    return m_stiffness;
+}
+
+float SpringForceField::getEquilibriumLength() const
+{
+    return m_equilibriumLength;
+}
+
+float SpringForceField::getDamping() const
+{
+    return m_damping;
+}
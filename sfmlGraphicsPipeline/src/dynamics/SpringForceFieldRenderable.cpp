@@ -15,8 +15,8 @@ SpringForceFieldRenderable::SpringForceFieldRenderable(ShaderProgramPtr shaderPr
 {
     m_mode = GL_LINES;
     //Create geometric data
-    m_positions = {m_springForceField->getParticle1()->getPosition(),
-                   m_springForceField->getParticle2()->getPosition()};
+    m_positions = {m_springForceField->getParticle1()->getRenderPosition(),
+                   m_springForceField->getParticle2()->getRenderPosition()};
     m_colors.resize(2, glm::vec4(0,0,1,1));
     m_normals.resize(2, glm::vec3(1,0,0));
 
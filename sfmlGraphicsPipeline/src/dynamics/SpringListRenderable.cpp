@@ -1,6 +1,7 @@
 #include "./../../include/dynamics/SpringListRenderable.hpp"
 #include "../../include/log.hpp"
 #include "../../include/gl_helper.hpp"
+#include "../../include/Viewer.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <GL/glew.h>
@@ -9,35 +10,53 @@ SpringListRenderable::~SpringListRenderable()
 {}
 
 SpringListRenderable::SpringListRenderable(ShaderProgramPtr shaderProgram, const std::vector <SpringForceFieldPtr>& springForceFields) :
-    MeshRenderable(shaderProgram, false),
-    m_springForceFields(springForceFields)
+    MeshRenderable(shaderProgram, false)
+{
+    m_endpoints.reserve(2*springForceFields.size());
+    for (const SpringForceFieldPtr & spring : springForceFields){
+        m_endpoints.push_back(spring->getParticle1());
+        m_endpoints.push_back(spring->getParticle2());
+    }
+    init_spring_geometry();
+}
+
+SpringListRenderable::SpringListRenderable(ShaderProgramPtr shaderProgram, const SpringNetworkForceFieldPtr& springNetwork) :
+    MeshRenderable(shaderProgram, false)
+{
+    const std::vector<ParticlePtr> & particles = springNetwork->getParticles();
+    m_endpoints.reserve(2*springNetwork->springCount());
+    for (size_t s = 0; s < springNetwork->springCount(); ++s){
+        m_endpoints.push_back(particles[springNetwork->getEndpoints1()[s]]);
+        m_endpoints.push_back(particles[springNetwork->getEndpoints2()[s]]);
+    }
+    init_spring_geometry();
+}
+
+void SpringListRenderable::init_spring_geometry()
 {
     m_mode = GL_LINES;
     //Create geometric data
-    size_t springNumber =  m_springForceFields.size();
-    m_positions.resize(2*springNumber);
-    m_colors.resize(2*springNumber, glm::vec4(0.0,0.0,1.0,1.0));
-    m_normals.resize(2*springNumber, glm::vec3(1.0,1.0,1.0));
+    m_positions.resize(m_endpoints.size());
+    m_colors.resize(m_endpoints.size(), glm::vec4(0.0,0.0,1.0,1.0));
+    m_normals.resize(m_endpoints.size(), glm::vec3(1.0,1.0,1.0));
 
-    update_spring_positions();
+    for (size_t i = 0; i < m_endpoints.size(); ++i)
+        m_positions[i] = m_endpoints[i]->getRenderPosition();
 
     update_all_buffers();
 }
 
-void SpringListRenderable::update_spring_positions(){
-    size_t i = 0;
-    for (const SpringForceFieldPtr & spring : m_springForceFields){
-        m_positions[2*i+0] = spring->getParticle1()->getPosition();
-        m_positions[2*i+1] = spring->getParticle2()->getPosition();
-        ++i;
-    }
-}
-
 void SpringListRenderable::do_draw()
 {
-    //Update vertices positions from particle's positions
-    update_spring_positions();
-    update_positions_buffer();
+    //Write vertices positions from particle's positions in the viewer's ring buffer
+    DynamicBuffer & buffer = m_viewer->getDynamicBuffer();
+    DynamicBuffer::Allocation allocation = buffer.allocate(m_positions.size() * sizeof(glm::vec3));
+    glm::vec3 * positions = static_cast<glm::vec3*>(allocation.data);
+    for (const ParticlePtr & particle : m_endpoints)
+        *positions++ = particle->getRenderPosition();
+    buffer.flush(allocation);
+    m_positionBuffer = buffer.bufferId();
+    m_positionOffset = allocation.offset;
 
     glLineWidth(3.0);
     MeshRenderable::do_draw();
@@ -0,0 +1,251 @@
+#include "./../../include/dynamics/SpringNetworkForceField.hpp"
+#include "./../../include/dynamics/ParticleStore.hpp"
+#include "./../../include/dynamics/BlockSparseMatrix.hpp"
+
+#include <algorithm>
+#include <limits>
+
+SpringNetworkForceField::SpringNetworkForceField(const std::vector<ParticlePtr>& particles) :
+    m_particles(particles),
+    m_adjacencyDirty(true),
+    m_slotStore(nullptr), m_slotVersion(0)
+{}
+
+SpringNetworkForceField::~SpringNetworkForceField()
+{}
+
+size_t SpringNetworkForceField::addSpring(unsigned int particle1, unsigned int particle2,
+        float stiffness, float equilibriumLength, float damping)
+{
+    m_endpoints1.push_back(particle1);
+    m_endpoints2.push_back(particle2);
+    m_stiffnesses.push_back(stiffness);
+    m_equilibriumLengths.push_back(equilibriumLength);
+    m_dampings.push_back(damping);
+    m_adjacencyDirty = true;
+    return m_endpoints1.size() - 1;
+}
+
+size_t SpringNetworkForceField::addSpring(unsigned int particle1, unsigned int particle2,
+        float stiffness, float damping)
+{
+    float distance = glm::distance(m_particles[particle1]->getPosition(), m_particles[particle2]->getPosition());
+    return addSpring(particle1, particle2, stiffness, distance, damping);
+}
+
+void SpringNetworkForceField::reserve(size_t springCount)
+{
+    m_endpoints1.reserve(springCount);
+    m_endpoints2.reserve(springCount);
+    m_stiffnesses.reserve(springCount);
+    m_equilibriumLengths.reserve(springCount);
+    m_dampings.reserve(springCount);
+}
+
+size_t SpringNetworkForceField::springCount() const
+{
+    return m_endpoints1.size();
+}
+
+const std::vector<ParticlePtr>& SpringNetworkForceField::getParticles() const
+{
+    return m_particles;
+}
+
+const std::vector<unsigned int>& SpringNetworkForceField::getEndpoints1() const
+{
+    return m_endpoints1;
+}
+
+const std::vector<unsigned int>& SpringNetworkForceField::getEndpoints2() const
+{
+    return m_endpoints2;
+}
+
+const std::vector<float>& SpringNetworkForceField::getStiffnesses() const
+{
+    return m_stiffnesses;
+}
+
+const std::vector<float>& SpringNetworkForceField::getEquilibriumLengths() const
+{
+    return m_equilibriumLengths;
+}
+
+const std::vector<float>& SpringNetworkForceField::getDampings() const
+{
+    return m_dampings;
+}
+
+std::vector<SpringForceFieldPtr> SpringNetworkForceField::createSpringForceFields() const
+{
+    std::vector<SpringForceFieldPtr> springs;
+    springs.reserve(springCount());
+    for(size_t s = 0; s < springCount(); ++s)
+    {
+        springs.push_back(std::make_shared<SpringForceField>(m_particles[m_endpoints1[s]], m_particles[m_endpoints2[s]],
+                                                             m_stiffnesses[s], m_equilibriumLengths[s], m_dampings[s]));
+    }
+    return springs;
+}
+
+bool SpringNetworkForceField::update_slots(const ParticleStore& store) const
+{
+    if(m_slotStore == &store && m_slotVersion == store.slotVersion())
+        return true;
+    // The particles are only looked up when the slots of the store changed
+    m_slotStore = nullptr;
+    m_slots.resize(m_particles.size());
+    for(size_t i = 0; i < m_particles.size(); ++i)
+    {
+        if(m_particles[i]->getStore() != &store)
+            return false;
+        m_slots[i] = m_particles[i]->getStoreIndex();
+    }
+    m_slotStore = &store;
+    m_slotVersion = store.slotVersion();
+    return true;
+}
+
+void SpringNetworkForceField::build_adjacency() const
+{
+    // Counting sort of the spring ends by particle
+    const size_t n = m_particles.size();
+    m_firstSpring.assign(n + 1, 0);
+    for(size_t s = 0; s < springCount(); ++s)
+    {
+        ++m_firstSpring[m_endpoints1[s] + 1];
+        ++m_firstSpring[m_endpoints2[s] + 1];
+    }
+    for(size_t i = 0; i < n; ++i)
+        m_firstSpring[i + 1] += m_firstSpring[i];
+
+    m_adjacency.resize(2 * springCount());
+    std::vector<unsigned int> next(m_firstSpring.begin(), m_firstSpring.end() - 1);
+    for(unsigned int s = 0; s < springCount(); ++s)
+    {
+        m_adjacency[next[m_endpoints1[s]]++] = 2 * s;
+        m_adjacency[next[m_endpoints2[s]]++] = 2 * s + 1;
+    }
+    m_adjacencyDirty = false;
+}
+
+// Force applied by each spring to its first end point, from m_positions and m_velocities
+void SpringNetworkForceField::compute_spring_forces() const
+{
+    const int count = static_cast<int>(springCount());
+    m_springForces.resize(count);
+    const unsigned int * e1 = m_endpoints1.data();
+    const unsigned int * e2 = m_endpoints2.data();
+    const glm::vec3 * x = m_positions.data();
+    const glm::vec3 * v = m_velocities.data();
+    glm::vec3 * forces = m_springForces.data();
+
+    // Each spring writes its own force: the chunks of the threads are vectorized
+    #pragma omp parallel for simd schedule(static) if(count > 4096)
+    for(int s = 0; s < count; ++s)
+    {
+        glm::vec3 displacement = x[e1[s]] - x[e2[s]];
+        float length = glm::length(displacement);
+        // No force if the displacement is not measurable
+        float invLength = length > std::numeric_limits<float>::epsilon() ? 1.0f / length : 0.0f;
+        glm::vec3 direction = displacement * invLength;
+        float speed = glm::dot(v[e1[s]] - v[e2[s]], direction);
+        forces[s] = (-m_stiffnesses[s] * (length - m_equilibriumLengths[s]) - m_dampings[s] * speed) * direction;
+    }
+}
+
+glm::vec3 SpringNetworkForceField::particle_force(unsigned int particle) const
+{
+    glm::vec3 force(0.0f);
+    for(unsigned int e = m_firstSpring[particle]; e < m_firstSpring[particle + 1]; ++e)
+    {
+        unsigned int end = m_adjacency[e];
+        if(end & 1)
+            force -= m_springForces[end >> 1];
+        else
+            force += m_springForces[end >> 1];
+    }
+    return force;
+}
+
+void SpringNetworkForceField::do_addForce()
+{
+    if(m_adjacencyDirty)
+        build_adjacency();
+    const size_t n = m_particles.size();
+    m_positions.resize(n);
+    m_velocities.resize(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        m_positions[i] = m_particles[i]->getPosition();
+        m_velocities[i] = m_particles[i]->getVelocity();
+    }
+    compute_spring_forces();
+    for(size_t i = 0; i < n; ++i)
+        m_particles[i]->incrForce(particle_force(i));
+}
+
+bool SpringNetworkForceField::do_addForce(const ParticleStore& store, glm::vec3* forces) const
+{
+    if(!update_slots(store))
+        return false;
+    if(m_adjacencyDirty)
+        build_adjacency();
+    const int n = static_cast<int>(m_particles.size());
+    m_positions.resize(n);
+    m_velocities.resize(n);
+    #pragma omp parallel for schedule(static) if(n > 4096)
+    for(int i = 0; i < n; ++i)
+    {
+        m_positions[i] = store.positions()[m_slots[i]];
+        m_velocities[i] = store.velocities()[m_slots[i]];
+    }
+    compute_spring_forces();
+    // Each particle gathers the forces of its springs into its own slot
+    #pragma omp parallel for schedule(static) if(n > 4096)
+    for(int i = 0; i < n; ++i)
+        forces[m_slots[i]] += particle_force(i);
+    return true;
+}
+
+bool SpringNetworkForceField::do_addJacobians(const ParticleStore& store, BlockSparseMatrix& dfdx, BlockSparseMatrix& dfdv) const
+{
+    if(!update_slots(store))
+        return false;
+    for(size_t s = 0; s < springCount(); ++s)
+    {
+        unsigned int i1 = m_slots[m_endpoints1[s]];
+        unsigned int i2 = m_slots[m_endpoints2[s]];
+        SpringForceField::addSpringJacobians(i1, i2, store.positions()[i1] - store.positions()[i2],
+                                             m_stiffnesses[s], m_equilibriumLengths[s], m_dampings[s], dfdx, dfdv);
+    }
+    return true;
+}
+
+float SpringNetworkForceField::do_addStabilityBounds(const ParticleStore& store, float* stiffness, float* damping) const
+{
+    if(!update_slots(store))
+        return 0.0f;
+    float strainRate = 0.0f;
+    for(size_t s = 0; s < springCount(); ++s)
+    {
+        unsigned int i1 = m_slots[m_endpoints1[s]];
+        unsigned int i2 = m_slots[m_endpoints2[s]];
+        strainRate = std::max(strainRate, SpringForceField::addSpringStabilityBounds(i1, i2, store,
+                              m_stiffnesses[s], m_equilibriumLengths[s], m_dampings[s], stiffness, damping));
+    }
+    return strainRate;
+}
+
+bool SpringNetworkForceField::do_addCouplings(const ParticleStore& store, std::vector< std::pair<unsigned int, unsigned int> >& couplings) const
+{
+    if(!update_slots(store))
+        return false;
+    couplings.reserve(couplings.size() + springCount());
+    for(size_t s = 0; s < springCount(); ++s)
+    {
+        couplings.push_back(std::make_pair(m_slots[m_endpoints1[s]], m_slots[m_endpoints2[s]]));
+    }
+    return true;
+}
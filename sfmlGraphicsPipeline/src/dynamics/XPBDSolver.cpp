@@ -0,0 +1,393 @@
+#include "./../../include/dynamics/XPBDSolver.hpp"
+#include "./../../include/dynamics/SpringForceField.hpp"
+#include "./../../include/dynamics/SpringNetworkForceField.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+
+// Constraints that could not get one of the 64 parallel colors are projected by a single thread
+static const unsigned int SERIAL_COLOR = 64;
+
+XPBDSolver::XPBDSolver(int iterations, int substeps) :
+    m_iterations(iterations),
+    m_substeps(substeps),
+    m_particleCollisions(false),
+    m_convertedSpringCount(0),
+    m_builtSlotCount(0),
+    m_dirty(true)
+{}
+
+XPBDSolver::~XPBDSolver()
+{}
+
+int XPBDSolver::getIterations() const
+{
+    return m_iterations;
+}
+
+void XPBDSolver::setIterations(int iterations)
+{
+    m_iterations = iterations;
+}
+
+int XPBDSolver::getSubsteps() const
+{
+    return m_substeps;
+}
+
+void XPBDSolver::setSubsteps(int substeps)
+{
+    m_substeps = std::max(1, substeps);
+}
+
+void XPBDSolver::addDistanceConstraint(ParticlePtr p1, ParticlePtr p2, float compliance, float damping)
+{
+    UserConstraint constraint;
+    constraint.p1 = p1;
+    constraint.p2 = p2;
+    constraint.restLength = glm::distance(p1->getPosition(), p2->getPosition());
+    constraint.compliance = compliance;
+    constraint.damping = damping;
+    m_userConstraints.push_back(constraint);
+    m_dirty = true;
+}
+
+void XPBDSolver::addBendingConstraints(const std::vector<ParticlePtr>& particles,
+                                       const std::vector<glm::uvec3>& triangles, float compliance)
+{
+    // Find the two triangles of each edge, with the vertex opposite to the edge
+    std::map< std::pair<unsigned int, unsigned int>, unsigned int > opposites;
+    for(const glm::uvec3 & triangle : triangles)
+    {
+        for(int e = 0; e < 3; ++e)
+        {
+            unsigned int a = triangle[e], b = triangle[(e+1)%3], opposite = triangle[(e+2)%3];
+            std::pair<unsigned int, unsigned int> edge(std::min(a,b), std::max(a,b));
+            std::map< std::pair<unsigned int, unsigned int>, unsigned int >::iterator it = opposites.find(edge);
+            if(it == opposites.end())
+                opposites[edge] = opposite;
+            else if(it->second != opposite)
+                addDistanceConstraint(particles[it->second], particles[opposite], compliance);
+        }
+    }
+}
+
+void XPBDSolver::addPlaneObstacle(PlanePtr plane)
+{
+    m_planeObstacles.push_back(plane);
+}
+
+void XPBDSolver::setParticleCollisions(bool onOff)
+{
+    m_particleCollisions = onOff;
+}
+
+bool XPBDSolver::getParticleCollisions() const
+{
+    return m_particleCollisions;
+}
+
+void XPBDSolver::clear()
+{
+    m_userConstraints.clear();
+    m_planeObstacles.clear();
+    m_dirty = true;
+}
+
+size_t XPBDSolver::getColorCount() const
+{
+    return m_colorStart.empty() ? 0 : m_colorStart.size() - 2;
+}
+
+bool XPBDSolver::do_convertsForceField(const ForceField& forceField) const
+{
+    return dynamic_cast<const SpringForceField*>(&forceField)
+        || dynamic_cast<const SpringNetworkForceField*>(&forceField);
+}
+
+bool XPBDSolver::do_isUnconditionallyStable(const ForceField& forceField) const
+{
+    //Springs become compliant constraints, stable for any time step
+    return do_convertsForceField(forceField);
+}
+
+void XPBDSolver::do_invalidateSlots()
+{
+    //The constraints are built on slots
+    m_dirty = true;
+}
+
+void XPBDSolver::build_constraints(const ParticleStore& store, const std::vector<ForceFieldPtr>& forceFields)
+{
+    m_slots1.clear();
+    m_slots2.clear();
+    m_restLengths.clear();
+    m_compliances.clear();
+    m_dampings.clear();
+
+    // A constraint is kept only if its two particles are in the store
+    struct Adder
+    {
+        XPBDSolver& solver;
+        const ParticleStore& store;
+        void operator()(const Particle& p1, const Particle& p2, float restLength, float compliance, float damping)
+        {
+            if(p1.getStore() != &store || p2.getStore() != &store)
+                return;
+            solver.m_slots1.push_back(p1.getStoreIndex());
+            solver.m_slots2.push_back(p2.getStoreIndex());
+            solver.m_restLengths.push_back(restLength);
+            solver.m_compliances.push_back(compliance);
+            solver.m_dampings.push_back(damping);
+        }
+    } add = { *this, store };
+
+    // Springs become distance constraints whose compliance is the inverse of their stiffness
+    for(const ForceFieldPtr & forceField : forceFields)
+    {
+        if(const SpringNetworkForceField* network = dynamic_cast<const SpringNetworkForceField*>(forceField.get()))
+        {
+            const std::vector<ParticlePtr> & particles = network->getParticles();
+            for(size_t s = 0; s < network->springCount(); ++s)
+            {
+                add(*particles[network->getEndpoints1()[s]], *particles[network->getEndpoints2()[s]],
+                    network->getEquilibriumLengths()[s], 1.0f / network->getStiffnesses()[s], network->getDampings()[s]);
+            }
+        }
+        else if(const SpringForceField* spring = dynamic_cast<const SpringForceField*>(forceField.get()))
+        {
+            add(*spring->getParticle1(), *spring->getParticle2(),
+                spring->getEquilibriumLength(), 1.0f / spring->getStiffness(), spring->getDamping());
+        }
+    }
+    for(const UserConstraint & constraint : m_userConstraints)
+        add(*constraint.p1, *constraint.p2, constraint.restLength, constraint.compliance, constraint.damping);
+
+    color_constraints(store.size());
+    m_lambdas.assign(m_slots1.size(), 0.0f);
+    m_builtSlotCount = store.size();
+    m_dirty = false;
+}
+
+void XPBDSolver::color_constraints(size_t slotCount)
+{
+    // Greedy coloring: each constraint takes the first color used by none of
+    // the constraints already colored on its two particles
+    const size_t count = m_slots1.size();
+    std::vector<uint64_t> usedColors(slotCount, 0);
+    std::vector<unsigned int> colors(count);
+    std::vector<unsigned int> colorSizes(SERIAL_COLOR + 1, 0);
+    for(size_t c = 0; c < count; ++c)
+    {
+        uint64_t used = usedColors[m_slots1[c]] | usedColors[m_slots2[c]];
+        unsigned int color = 0;
+        while(color < SERIAL_COLOR && (used >> color) & 1)
+            ++color;
+        if(color < SERIAL_COLOR)
+        {
+            usedColors[m_slots1[c]] |= uint64_t(1) << color;
+            usedColors[m_slots2[c]] |= uint64_t(1) << color;
+        }
+        colors[c] = color;
+        ++colorSizes[color];
+    }
+
+    // Sort the constraints by color. The range after the last color holds the
+    // constraints of the serial color, possibly none
+    unsigned int colorCount = 0;
+    while(colorCount < SERIAL_COLOR && colorSizes[colorCount] > 0)
+        ++colorCount;
+    m_colorStart.assign(colorCount + 2, 0);
+    for(unsigned int color = 0; color < colorCount; ++color)
+        m_colorStart[color + 1] = m_colorStart[color] + colorSizes[color];
+    m_colorStart[colorCount + 1] = m_colorStart[colorCount] + colorSizes[SERIAL_COLOR];
+
+    std::vector<unsigned int> next(m_colorStart.begin(), m_colorStart.end() - 1);
+    std::vector<unsigned int> order(count);
+    for(size_t c = 0; c < count; ++c)
+        order[next[colors[c] == SERIAL_COLOR ? colorCount : colors[c]]++] = c;
+
+    std::vector<unsigned int> slots1(count), slots2(count);
+    std::vector<float> restLengths(count), compliances(count), dampings(count);
+    for(size_t c = 0; c < count; ++c)
+    {
+        slots1[c] = m_slots1[order[c]];
+        slots2[c] = m_slots2[order[c]];
+        restLengths[c] = m_restLengths[order[c]];
+        compliances[c] = m_compliances[order[c]];
+        dampings[c] = m_dampings[order[c]];
+    }
+    m_slots1.swap(slots1);
+    m_slots2.swap(slots2);
+    m_restLengths.swap(restLengths);
+    m_compliances.swap(compliances);
+    m_dampings.swap(dampings);
+}
+
+void XPBDSolver::project_distance_constraint(size_t c, float h, glm::vec3* x, const float* w)
+{
+    unsigned int i = m_slots1[c], j = m_slots2[c];
+    float wSum = w[i] + w[j];
+    if(wSum <= 0.0f)
+        return;
+    glm::vec3 d = x[i] - x[j];
+    float length = glm::length(d);
+    if(length <= std::numeric_limits<float>::epsilon())
+        return;
+    glm::vec3 n = d / length;
+
+    float constraint = length - m_restLengths[c];
+    float alpha = m_compliances[c] / (h * h);
+    // Damping of the constraint, along its gradient
+    float gamma = m_compliances[c] * m_dampings[c] / h;
+    float speed = glm::dot(n, (x[i] - m_previous[i]) - (x[j] - m_previous[j]));
+
+    float dLambda = (-constraint - alpha * m_lambdas[c] - gamma * speed) / ((1.0f + gamma) * wSum + alpha);
+    m_lambdas[c] += dLambda;
+    x[i] += w[i] * dLambda * n;
+    x[j] -= w[j] * dLambda * n;
+}
+
+void XPBDSolver::project_collisions(glm::vec3* x, const float* w, const float* radii)
+{
+    const size_t n = m_inverseMasses.size();
+    for(const PlanePtr & plane : m_planeObstacles)
+    {
+        const glm::vec3 & normal = plane->normal();
+        const float d = plane->distanceToOrigin();
+        for(size_t i = 0; i < n; ++i)
+        {
+            if(w[i] <= 0.0f)
+                continue;
+            // The particle stays on the side of the plane it started the step from
+            float side = glm::dot(m_previous[i], normal) - d >= 0.0f ? 1.0f : -1.0f;
+            float penetration = radii[i] - side * (glm::dot(x[i], normal) - d);
+            if(penetration > 0.0f)
+                x[i] += side * penetration * normal;
+        }
+    }
+
+    for(const SpatialHashBroadphase::Pair & pair : m_pairs)
+    {
+        unsigned int i = pair.first, j = pair.second;
+        float wSum = w[i] + w[j];
+        glm::vec3 d = x[i] - x[j];
+        float length = glm::length(d);
+        float penetration = radii[i] + radii[j] - length;
+        if(wSum <= 0.0f || penetration <= 0.0f)
+            continue;
+        // Particles at the same place are separated vertically
+        glm::vec3 normal = length > 0.0f ? d / length : glm::vec3(0, 1, 0);
+        x[i] += (w[i] / wSum) * penetration * normal;
+        x[j] -= (w[j] / wSum) * penetration * normal;
+    }
+}
+
+void XPBDSolver::do_solve(const float& dt, std::vector<ParticlePtr>& particles)
+{
+    //Without a store there are no constraints: this is a semi-implicit Euler step
+    for(ParticlePtr p : particles)
+    {
+        if(!p->isFixed() && !p->isSleeping())
+        {
+            p->setVelocity(p->getVelocity() + (dt / p->getMass()) * p->getForce());
+            p->setPosition(p->getPosition() + dt * p->getVelocity());
+        }
+    }
+}
+
+void XPBDSolver::do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles)
+{
+    do_solve(dt, store, particles, std::vector<ForceFieldPtr>());
+}
+
+void XPBDSolver::do_solve(const float& dt, ParticleStore& store, std::vector<ParticlePtr>& particles,
+                          const std::vector<ForceFieldPtr>& forceFields)
+{
+    const int n = static_cast<int>(store.size());
+    if(n == 0)
+        return;
+
+    //Rebuild the constraints when the converted force fields or the particles change
+    size_t springCount = 0;
+    m_candidateFields.clear();
+    for(const ForceFieldPtr & forceField : forceFields)
+    {
+        if(const SpringNetworkForceField* network = dynamic_cast<const SpringNetworkForceField*>(forceField.get()))
+            springCount += network->springCount();
+        else if(!dynamic_cast<const SpringForceField*>(forceField.get()))
+            continue;
+        m_candidateFields.push_back(forceField.get());
+    }
+    if(m_dirty || m_candidateFields != m_convertedFields || springCount != m_convertedSpringCount
+       || m_builtSlotCount != store.size())
+    {
+        m_convertedFields.swap(m_candidateFields);
+        m_convertedSpringCount = springCount;
+        build_constraints(store, forceFields);
+    }
+
+    glm::vec3* x = store.positions().data();
+    glm::vec3* v = store.velocities().data();
+    const glm::vec3* f = store.forces().data();
+    const float* radii = store.radii().data();
+    const ParticleStore::Array<unsigned char> & flags = store.flags();
+
+    //Fixed and detached particles behave as if their mass was infinite
+    m_inverseMasses.resize(n);
+    for(int i = 0; i < n; ++i)
+        m_inverseMasses[i] = flags[i] ? 0.0f : store.inverseMasses()[i];
+    const float* w = m_inverseMasses.data();
+    m_previous.resize(n);
+
+    const float h = dt / m_substeps;
+    const int colorCount = static_cast<int>(getColorCount());
+    for(int substep = 0; substep < m_substeps; ++substep)
+    {
+        //Predict the positions from the external forces
+        #pragma omp parallel for schedule(static)
+        for(int i = 0; i < n; ++i)
+        {
+            m_previous[i] = x[i];
+            if(w[i] > 0.0f)
+            {
+                v[i] += h * w[i] * f[i];
+                x[i] += h * v[i];
+            }
+        }
+        std::fill(m_lambdas.begin(), m_lambdas.end(), 0.0f);
+        if(m_particleCollisions)
+            m_broadphase.findPairs(store, m_pairs);
+        else
+            m_pairs.clear();
+
+        //Gauss-Seidel iterations, parallel within each color
+        #pragma omp parallel
+        for(int iteration = 0; iteration < m_iterations; ++iteration)
+        {
+            for(int color = 0; color < colorCount; ++color)
+            {
+                #pragma omp for schedule(static)
+                for(int c = m_colorStart[color]; c < static_cast<int>(m_colorStart[color + 1]); ++c)
+                    project_distance_constraint(c, h, x, w);
+            }
+            #pragma omp single
+            {
+                for(unsigned int c = m_colorStart[colorCount]; c < m_colorStart[colorCount + 1]; ++c)
+                    project_distance_constraint(c, h, x, w);
+                project_collisions(x, w, radii);
+            }
+        }
+
+        //Deduce the velocities from the displacements
+        #pragma omp parallel for schedule(static)
+        for(int i = 0; i < n; ++i)
+        {
+            if(w[i] > 0.0f)
+                v[i] = (x[i] - m_previous[i]) / h;
+        }
+    }
+}
@@ -1,10 +1,22 @@
 #include "./../../include/lighting/Light.hpp"
 #include "./../../include/log.hpp"
 #include <glm/gtc/type_ptr.hpp>
+#include <cstring>
 
 // Let's give the lights the same "forward direction" as our camera
 glm::vec3 Light::base_forward = glm::vec3(0, 0, -1);
 
+// Name of the uniform of a light member, valid until the end of the frame
+static const char* member(const char* identifier, const char* field)
+{
+    size_t identifier_length = std::strlen(identifier);
+    size_t field_length = std::strlen(field);
+    char* name = static_cast<char*>(FrameArena::local().allocate(identifier_length + field_length + 1, 1));
+    std::memcpy(name, identifier, identifier_length);
+    std::memcpy(name + identifier_length, field, field_length + 1);
+    return name;
+}
+
 bool Light::sendToGPU(const ShaderProgramPtr& program, const LightPtr & light)
 {
     if (program==nullptr || light==nullptr)
@@ -12,22 +24,22 @@ bool Light::sendToGPU(const ShaderProgramPtr& program, const LightPtr & light)
     return light->sendToGPU(program, light->lightName());
 }
 
-bool Light::sendToGPU(const ShaderProgramPtr& program, const std::string & identifier) const
+bool Light::sendToGPU(const ShaderProgramPtr& program, const char* identifier) const
 {
     bool success = true;
     int location = ShaderProgram::null_location;
 
-    location = program->getUniformLocation(identifier+".ambient");
+    location = program->getUniformLocation(member(identifier, ".ambient"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform3fv(location, 1, glm::value_ptr(m_ambient)));
     }else { success = false; }
 
-    location = program->getUniformLocation(identifier+".diffuse");
+    location = program->getUniformLocation(member(identifier, ".diffuse"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform3fv(location, 1, glm::value_ptr(m_diffuse)));
     }else { success = false; }
 
-    location = program->getUniformLocation(identifier+".specular");
+    location = program->getUniformLocation(member(identifier, ".specular"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform3fv(location, 1, glm::value_ptr(m_specular)));
     }else { success = false; }
@@ -35,12 +47,12 @@ bool Light::sendToGPU(const ShaderProgramPtr& program, const std::string & ident
     return success;
 }
 
-bool DirectionalLight::sendToGPU(const ShaderProgramPtr& program, const std::string & identifier) const
+bool DirectionalLight::sendToGPU(const ShaderProgramPtr& program, const char* identifier) const
 {
     bool success = Light::sendToGPU(program, identifier);
     int location = ShaderProgram::null_location;
     
-    location = program->getUniformLocation(identifier+".direction");
+    location = program->getUniformLocation(member(identifier, ".direction"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform3fv(location, 1, glm::value_ptr(m_direction)));
     }else { success = false; }
@@ -48,28 +60,28 @@ bool DirectionalLight::sendToGPU(const ShaderProgramPtr& program, const std::str
     return success;
 }
 
-bool PointLight::sendToGPU(const ShaderProgramPtr& program, const std::string & identifier) const
+bool PointLight::sendToGPU(const ShaderProgramPtr& program, const char* identifier) const
 {
     
     bool success = Light::sendToGPU(program, identifier);
     int location = ShaderProgram::null_location;
 
-    location = program->getUniformLocation(identifier+".position");
+    location = program->getUniformLocation(member(identifier, ".position"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform3fv(location, 1, glm::value_ptr(m_position)));
     }else { success = false; }
         
-    location = program->getUniformLocation(identifier+".constant");
+    location = program->getUniformLocation(member(identifier, ".constant"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform1f(location, m_constant));
     }else { success = false; }
         
-    location = program->getUniformLocation(identifier+".linear");
+    location = program->getUniformLocation(member(identifier, ".linear"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform1f(location, m_linear));
     }else { success = false; }
 
-    location = program->getUniformLocation(identifier+".quadratic");
+    location = program->getUniformLocation(member(identifier, ".quadratic"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform1f(location, m_quadratic));
     }else { success = false; }
@@ -77,22 +89,22 @@ bool PointLight::sendToGPU(const ShaderProgramPtr& program, const std::string &
     return success;
 }
 
-bool SpotLight::sendToGPU(const ShaderProgramPtr& program, const std::string & identifier) const
+bool SpotLight::sendToGPU(const ShaderProgramPtr& program, const char* identifier) const
 {
     bool success = PointLight::sendToGPU(program, identifier);
     int location = ShaderProgram::null_location;
 
-    location = program->getUniformLocation(identifier+".spotDirection");
+    location = program->getUniformLocation(member(identifier, ".spotDirection"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform3fv(location, 1, glm::value_ptr(m_spotDirection)));
     }else { success = false; }
 
-    location = program->getUniformLocation(identifier+".innerCutOff");
+    location = program->getUniformLocation(member(identifier, ".innerCutOff"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform1f(location, m_innerCutOff));
     }else { success = false; }
 
-    location = program->getUniformLocation(identifier+".outerCutOff");
+    location = program->getUniformLocation(member(identifier, ".outerCutOff"));
     if(location!=ShaderProgram::null_location){
         glcheck(glUniform1f(location, m_outerCutOff));
     }else { success = false; }
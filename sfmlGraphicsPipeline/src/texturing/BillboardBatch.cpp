@@ -0,0 +1,341 @@
+#include "./../../include/texturing/BillboardBatch.hpp"
+#include "./../../include/gl_helper.hpp"
+#include "./../../include/log.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <GL/glew.h>
+#include <SFML/Graphics/Image.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+BillboardBatch::~BillboardBatch()
+{
+    glcheck(glDeleteBuffers(1, &m_qBuffer));
+    glcheck(glDeleteBuffers(1, &m_instanceBuffer));
+    glcheck(glDeleteTextures(1, &m_texId));
+}
+
+BillboardBatch::BillboardBatch(ShaderProgramPtr program, const std::vector< std::string > & texture_filenames) :
+    Renderable(program),
+    m_nextId(0), m_layerCount(0),
+    m_qBuffer(0), m_instanceBuffer(0), m_texId(0),
+    m_bufferCapacity(0), m_dirtyBegin(0), m_dirtyEnd(0)
+{
+    // Load all layers in one block of memory, resampled to the first image size
+    std::vector< sf::Uint8 > pixels;
+    unsigned int width = 1, height = 1;
+    for (const std::string & filename : texture_filenames)
+    {
+        sf::Image image;
+        if (!image.loadFromFile(filename))
+        {
+            LOG(warning, "billboard texture " << filename << " could not be loaded, layer " << m_layerCount << " is white");
+            image.create(1, 1, sf::Color::White);
+        }
+        image.flipVertically(); // sfml inverts the v axis... put the image in OpenGL convention: lower left corner is (0,0)
+        if (m_layerCount == 0)
+        {
+            width = image.getSize().x;
+            height = image.getSize().y;
+        }
+        else if (image.getSize().x != width || image.getSize().y != height)
+        {
+            LOG(warning, "billboard texture " << filename << " is resampled to " << width << "x" << height);
+        }
+
+        size_t offset = pixels.size();
+        pixels.resize(offset + 4 * width * height);
+        const sf::Uint8 * source = image.getPixelsPtr();
+        for (unsigned int y = 0; y < height; ++y)
+        {
+            unsigned int sy = y * image.getSize().y / height;
+            for (unsigned int x = 0; x < width; ++x)
+            {
+                unsigned int sx = x * image.getSize().x / width;
+                std::copy(source + 4 * (sy * image.getSize().x + sx),
+                          source + 4 * (sy * image.getSize().x + sx) + 4,
+                          pixels.begin() + offset + 4 * (y * width + x));
+            }
+        }
+        ++m_layerCount;
+    }
+    if (m_layerCount == 0)
+    {
+        LOG(warning, "billboard batch without texture, billboards are white");
+        pixels.assign(4, 255);
+        m_layerCount = 1;
+    }
+
+    glcheck(glGenTextures(1, &m_texId));
+    glcheck(glBindTexture(GL_TEXTURE_2D_ARRAY, m_texId));
+    glcheck(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    glcheck(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    glcheck(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    glcheck(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    glcheck(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, m_layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, (const GLvoid*)pixels.data()));
+    // Distant billboards are small on screen: mipmaps avoid aliasing
+    glcheck(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
+    glcheck(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+    // Quad shared by all billboards, drawn as a triangle strip
+    std::array<glm::vec2, 4> corners = {
+        glm::vec2(-0.5,-0.5),
+        glm::vec2( 0.5,-0.5),
+        glm::vec2(-0.5, 0.5),
+        glm::vec2( 0.5, 0.5),
+    };
+    glcheck(glGenBuffers(1, &m_qBuffer));
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_qBuffer));
+    glcheck(glBufferData(GL_ARRAY_BUFFER, corners.size()*sizeof(glm::vec2), corners.data(), GL_STATIC_DRAW));
+    glcheck(glGenBuffers(1, &m_instanceBuffer));
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+unsigned int BillboardBatch::addBillboard(const glm::vec3 & position, const glm::vec2 & size,
+                                          unsigned int layer, const glm::vec4 & tint)
+{
+    if (layer >= m_layerCount)
+    {
+        LOG(warning, "billboard layer " << layer << " out of the " << m_layerCount << " layers of the batch");
+    }
+    Billboard billboard;
+    billboard.position = position;
+    billboard.size = size;
+    billboard.layer = float(layer);
+    billboard.tint = tint;
+
+    unsigned int id = m_nextId++;
+    m_idSlots[id] = m_billboards.size();
+    m_slotIds.push_back(id);
+    m_billboards.push_back(billboard);
+    markDirty(m_billboards.size() - 1);
+    return id;
+}
+
+bool BillboardBatch::removeBillboard(unsigned int id)
+{
+    auto it = m_idSlots.find(id);
+    if (it == m_idSlots.end())
+    {
+        LOG(warning, "no billboard with id " << id << " to remove");
+        return false;
+    }
+
+    // Move the last billboard in the freed slot to keep the buffer packed
+    size_t slot = it->second;
+    size_t last = m_billboards.size() - 1;
+    if (slot != last)
+    {
+        m_billboards[slot] = m_billboards[last];
+        m_slotIds[slot] = m_slotIds[last];
+        // Streamed billboards have no identifier to remap
+        if (m_slotIds[slot] != ~0u)
+            m_idSlots[m_slotIds[slot]] = slot;
+        markDirty(slot);
+    }
+    m_billboards.pop_back();
+    m_slotIds.pop_back();
+    m_idSlots.erase(id);
+    m_dirtyEnd = std::min(m_dirtyEnd, m_billboards.size());
+    if (m_dirtyBegin >= m_dirtyEnd)
+        m_dirtyBegin = m_dirtyEnd = 0;
+    return true;
+}
+
+void BillboardBatch::setBillboardPosition(unsigned int id, const glm::vec3 & position)
+{
+    size_t slot = slotOf(id);
+    if (slot == m_billboards.size())
+    {
+        LOG(warning, "no billboard with id " << id << " to move");
+        return;
+    }
+    m_billboards[slot].position = position;
+    markDirty(slot);
+}
+
+void BillboardBatch::setBillboardSize(unsigned int id, const glm::vec2 & size)
+{
+    size_t slot = slotOf(id);
+    if (slot == m_billboards.size())
+    {
+        LOG(warning, "no billboard with id " << id << " to resize");
+        return;
+    }
+    m_billboards[slot].size = size;
+    markDirty(slot);
+}
+
+void BillboardBatch::setBillboardLayer(unsigned int id, unsigned int layer)
+{
+    size_t slot = slotOf(id);
+    if (slot == m_billboards.size())
+    {
+        LOG(warning, "no billboard with id " << id << " to change the layer of");
+        return;
+    }
+    m_billboards[slot].layer = float(layer);
+    markDirty(slot);
+}
+
+void BillboardBatch::setBillboardTint(unsigned int id, const glm::vec4 & tint)
+{
+    size_t slot = slotOf(id);
+    if (slot == m_billboards.size())
+    {
+        LOG(warning, "no billboard with id " << id << " to tint");
+        return;
+    }
+    m_billboards[slot].tint = tint;
+    markDirty(slot);
+}
+
+void BillboardBatch::streamBillboards(const std::vector< Billboard > & billboards)
+{
+    m_billboards = billboards;
+    // Streamed billboards have no identifier, only those added later do
+    m_slotIds.assign(m_billboards.size(), ~0u);
+    m_idSlots.clear();
+    m_dirtyBegin = 0;
+    m_dirtyEnd = m_billboards.size();
+}
+
+size_t BillboardBatch::billboardCount() const
+{
+    return m_billboards.size();
+}
+
+size_t BillboardBatch::layerCount() const
+{
+    return m_layerCount;
+}
+
+void BillboardBatch::clearBillboards()
+{
+    m_billboards.clear();
+    m_slotIds.clear();
+    m_idSlots.clear();
+    m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+size_t BillboardBatch::slotOf(unsigned int id) const
+{
+    auto it = m_idSlots.find(id);
+    return it == m_idSlots.end() ? m_billboards.size() : it->second;
+}
+
+void BillboardBatch::markDirty(size_t slot)
+{
+    if (m_dirtyBegin >= m_dirtyEnd)
+    {
+        m_dirtyBegin = slot;
+        m_dirtyEnd = slot + 1;
+    }
+    else
+    {
+        m_dirtyBegin = std::min(m_dirtyBegin, slot);
+        m_dirtyEnd = std::max(m_dirtyEnd, slot + 1);
+    }
+}
+
+void BillboardBatch::update_instances_buffer()
+{
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer));
+    if (m_billboards.size() > m_bufferCapacity)
+    {
+        // Grow geometrically so that adding billboards one by one stays cheap
+        m_bufferCapacity = std::max(m_billboards.size(), 2 * m_bufferCapacity);
+        glcheck(glBufferData(GL_ARRAY_BUFFER, m_bufferCapacity * sizeof(Billboard), nullptr, GL_STREAM_DRAW));
+        m_dirtyBegin = 0;
+        m_dirtyEnd = m_billboards.size();
+    }
+    else if (2 * (m_dirtyEnd - m_dirtyBegin) > m_billboards.size())
+    {
+        // Most of the buffer changes: orphan it rather than waiting for the
+        // GPU to finish reading it, then send everything
+        glcheck(glBufferData(GL_ARRAY_BUFFER, m_bufferCapacity * sizeof(Billboard), nullptr, GL_STREAM_DRAW));
+        m_dirtyBegin = 0;
+        m_dirtyEnd = m_billboards.size();
+    }
+    // Only send the range of billboards modified since the last draw
+    if (m_dirtyBegin < m_dirtyEnd)
+    {
+        glcheck(glBufferSubData(GL_ARRAY_BUFFER, m_dirtyBegin * sizeof(Billboard),
+                                (m_dirtyEnd - m_dirtyBegin) * sizeof(Billboard),
+                                m_billboards.data() + m_dirtyBegin));
+    }
+    m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+void BillboardBatch::do_draw()
+{
+    if (m_billboards.empty())
+        return;
+
+    update_instances_buffer();
+
+    int cornerLocation = m_shaderProgram->getAttributeLocation("vPosition");
+    int positionLocation = m_shaderProgram->getAttributeLocation("instancePosition");
+    int sizeLocation = m_shaderProgram->getAttributeLocation("instanceSize");
+    int layerLocation = m_shaderProgram->getAttributeLocation("instanceLayer");
+    int tintLocation = m_shaderProgram->getAttributeLocation("instanceTint");
+    int modelLocation = m_shaderProgram->getUniformLocation("modelMat");
+    int texSamplerLocation = m_shaderProgram->getUniformLocation("texSampler");
+    const GLsizei stride = sizeof(Billboard);
+
+    if (modelLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(getModelMatrix())));
+    }
+    glcheck(glActiveTexture(GL_TEXTURE0));
+    glcheck(glBindTexture(GL_TEXTURE_2D_ARRAY, m_texId));
+    if (texSamplerLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniform1i(texSamplerLocation, 0));
+    }
+
+    if (cornerLocation != ShaderProgram::null_location)
+    {
+        glcheck(glEnableVertexAttribArray(cornerLocation));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_qBuffer));
+        glcheck(glVertexAttribPointer(cornerLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)0));
+    }
+
+    // Per-billboard attributes, interleaved in the instance buffer
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer));
+    const int locations[4] = { positionLocation, sizeLocation, layerLocation, tintLocation };
+    const int sizes[4] = { 3, 2, 1, 4 };
+    const size_t offsets[4] = {
+        offsetof(Billboard, position),
+        offsetof(Billboard, size),
+        offsetof(Billboard, layer),
+        offsetof(Billboard, tint),
+    };
+    for (int a = 0; a < 4; ++a)
+    {
+        if (locations[a] != ShaderProgram::null_location)
+        {
+            glcheck(glEnableVertexAttribArray(locations[a]));
+            glcheck(glVertexAttribPointer(locations[a], sizes[a], GL_FLOAT, GL_FALSE, stride, (void*)offsets[a]));
+            glcheck(glVertexAttribDivisor(locations[a], 1));
+        }
+    }
+
+    glcheck(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_billboards.size()));
+
+    // Release attributes, divisors are part of the global state
+    if (cornerLocation != ShaderProgram::null_location)
+    {
+        glcheck(glDisableVertexAttribArray(cornerLocation));
+    }
+    for (int a = 0; a < 4; ++a)
+    {
+        if (locations[a] != ShaderProgram::null_location)
+        {
+            glcheck(glVertexAttribDivisor(locations[a], 0));
+            glcheck(glDisableVertexAttribArray(locations[a]));
+        }
+    }
+    glcheck(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+}
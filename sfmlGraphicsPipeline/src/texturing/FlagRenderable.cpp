@@ -1,6 +1,9 @@
 #include "./../../include/texturing/FlagRenderable.hpp"
 #include "./../../include/gl_helper.hpp"
 #include "./../../include/Utils.hpp"
+#include "./../../include/Viewer.hpp"
+
+#include <algorithm>
 
 FlagRenderable::~FlagRenderable()
 {}
@@ -12,7 +15,8 @@ FlagRenderable::FlagRenderable(ShaderProgramPtr program,
     TexturedMeshRenderable(program, true)
 {
     std::vector<glm::uvec3> indices;
-    getFabric(width, height, horizontal_resolution, vertical_resolution, m_particles, m_springs, m_positions, indices, m_tcoords, stiffness, damping);
+    getFabric(width, height, horizontal_resolution, vertical_resolution, m_particles, m_springNetwork, m_positions, indices, m_tcoords, stiffness, damping);
+    m_selfCollision = std::make_shared<ClothSelfCollision>(m_springNetwork);
     for (int j = 0 ; j < vertical_resolution ; ++j){
         // fixing first and last column of the flag
         m_particles[j]->setFixed(true);
@@ -28,23 +32,59 @@ FlagRenderable::FlagRenderable(ShaderProgramPtr program,
     m_original_tcoords = m_tcoords;
     m_image.flipVertically();
 
+    m_normalUpdater = std::make_shared<MeshNormalUpdater>(m_indices, m_positions.size());
+    m_normals.resize(m_positions.size());
+    m_normalUpdater->update(m_positions.data(), m_normals.data());
     update_all_buffers();
 }
 
 void FlagRenderable::do_draw()
 {
-    // Update the vertex positions
-    for (int i = 0 ; i < m_particles.size() ; ++i)
-        m_positions[i] = m_particles[i]->getPosition();
-    update_positions_buffer();
+    // Gather the positions on the CPU: mapped memory is slow to read back.
+    // Only the normals around the particles that moved are recomputed: the
+    // fixed and sleeping ones keep their normals from the previous frame
+    m_movedVertices.clear();
+    for (size_t i = 0 ; i < m_particles.size() ; ++i)
+    {
+        const glm::vec3 & position = m_particles[i]->getRenderPosition();
+        if (position != m_positions[i])
+        {
+            m_positions[i] = position;
+            m_movedVertices.push_back(i);
+        }
+    }
+    m_normalUpdater->setDirty(m_movedVertices);
+    m_normalUpdater->update(m_positions.data(), m_normals.data());
+
+    // Write the vertex positions and normals directly in the viewer's ring
+    // buffer, in a single block: a second allocation could make the buffer
+    // grow, and the first block would then be lost
+    const size_t size = m_positions.size() * sizeof(glm::vec3);
+    DynamicBuffer & buffer = m_viewer->getDynamicBuffer();
+    DynamicBuffer::Allocation allocation = buffer.allocate(2 * size);
+    glm::vec3* data = static_cast<glm::vec3*>(allocation.data);
+    std::copy(m_positions.begin(), m_positions.end(), data);
+    std::copy(m_normals.begin(), m_normals.end(), data + m_positions.size());
+    buffer.flush(allocation);
+    m_positionBuffer = m_normalBuffer = buffer.bufferId();
+    m_positionOffset = allocation.offset;
+    m_normalOffset = allocation.offset + size;
 
-    // Draw the 
+    // Draw the flag
     TexturedMeshRenderable::do_draw();
 }
 
 std::vector<ParticlePtr> & FlagRenderable::getParticles(){
     return m_particles;
 }
+SpringNetworkForceFieldPtr FlagRenderable::getSpringNetwork(){
+    return m_springNetwork;
+}
 const std::vector<SpringForceFieldPtr> & FlagRenderable::getSprings(){
+    if (m_springs.empty())
+        m_springs = m_springNetwork->createSpringForceFields();
     return m_springs;
+}
+ClothSelfCollisionPtr FlagRenderable::getSelfCollision(){
+    return m_selfCollision;
 }
\ No newline at end of file
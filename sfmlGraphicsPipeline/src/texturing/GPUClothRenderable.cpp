@@ -0,0 +1,244 @@
+#include "./../../include/texturing/GPUClothRenderable.hpp"
+#include "./../../include/gl_helper.hpp"
+#include "./../../include/log.hpp"
+#include "./../../include/Utils.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <GL/glew.h>
+#include <algorithm>
+#include <vector>
+
+// Number of invocations of a work group, as declared in the compute shaders
+static const unsigned int WORK_GROUP_SIZE = 256;
+// Number of Lagrange multipliers stored by each particle, see clothConstraintCompute.glsl
+static const unsigned int LAMBDAS_PER_PARTICLE = 6;
+
+bool GPUClothRenderable::isSupported()
+{
+    return GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object);
+}
+
+GPUClothRenderable::~GPUClothRenderable()
+{
+    glcheck(glDeleteBuffers(BUFFER_COUNT, m_buffers));
+}
+
+GPUClothRenderable::GPUClothRenderable(ShaderProgramPtr program,
+    float width, float height,
+    int horizontal_resolution, int vertical_resolution,
+    float stiffness, float damping, const std::string & texture_filename) :
+    TexturedMeshRenderable(program, true),
+    m_current(POSITIONS_A),
+    m_resolution(horizontal_resolution, vertical_resolution),
+    m_spacing(width / (horizontal_resolution - 1), height / (vertical_resolution - 1)),
+    m_lastUpdateTime(0),
+    m_mode(XPBD), m_substeps(4), m_iterations(10), m_relaxation(0.5f),
+    m_stiffness(stiffness), m_damping(damping), m_bendingStiffness(stiffness / 100),
+    m_gravity(0.0, -9.81, 0.0), m_wind(0.0), m_airDamping(0.0)
+{
+    if (!isSupported())
+        LOG(warning, "compute shaders are not supported (OpenGL 4.3 is needed): the cloth will not move");
+
+    // Same grid as getFabric(), without Particle objects nor springs
+    const size_t count = horizontal_resolution * vertical_resolution;
+    std::vector< glm::vec4 > state(count);
+    std::vector< glm::uvec3 > indices;
+    m_positions.resize(count);
+    m_tcoords.resize(count);
+    for (int i = 0 ; i < horizontal_resolution ; ++i){
+        for (int j = 0 ; j < vertical_resolution ; ++j){
+            size_t index = i * vertical_resolution + j;
+            glm::vec2 uv = glm::vec2((float)i/(horizontal_resolution-1), (float)j/(vertical_resolution-1));
+            m_tcoords[index] = uv;
+            m_positions[index] = glm::vec3(uv.x * width, uv.y * height, 0.0);
+            // The inverse mass is stored in w: the first and last columns are fixed
+            bool fixed = i == 0 || i == horizontal_resolution - 1;
+            state[index] = glm::vec4(m_positions[index], fixed ? 0.0f : 1.0f);
+
+            if (i == horizontal_resolution - 1 || j == vertical_resolution - 1)
+                continue;
+            int index_right = (i+1) * vertical_resolution + j;
+            int index_bottom = i * vertical_resolution + j + 1;
+            int index_right_bottom = (i+1) * vertical_resolution + j + 1;
+            indices.push_back(glm::uvec3(index, index_right_bottom, index_bottom));
+            indices.push_back(glm::uvec3(index, index_right, index_right_bottom));
+        }
+    }
+    unpack(indices, m_indices);
+
+    m_image.loadFromFile(texture_filename);
+    m_original_tcoords = m_tcoords;
+    m_image.flipVertically();
+    update_all_buffers();
+
+    // Initial state of the storage buffers
+    glcheck(glGenBuffers(BUFFER_COUNT, m_buffers));
+    const std::vector< glm::vec4 > zeros(count, glm::vec4(0.0f));
+    const std::vector< glm::vec4 > normals(count, glm::vec4(0.0f, 0.0f, 1.0f, 0.0f));
+    const std::vector< float > lambdas(LAMBDAS_PER_PARTICLE * count, 0.0f);
+    const void* data[BUFFER_COUNT] = { state.data(), state.data(), state.data(), zeros.data(), normals.data(), lambdas.data(), lambdas.data() };
+    for (int b = 0; b < BUFFER_COUNT; ++b)
+    {
+        size_t size = (b == LAMBDAS_A || b == LAMBDAS_B) ? lambdas.size() * sizeof(float) : count * sizeof(glm::vec4);
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_buffers[b]));
+        glcheck(glBufferData(GL_ARRAY_BUFFER, size, data[b], GL_DYNAMIC_COPY));
+    }
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    if (isSupported())
+    {
+        m_predictProgram = std::make_shared<ShaderProgram>("../../sfmlGraphicsPipeline/shaders/clothPredictCompute.glsl");
+        m_constraintProgram = std::make_shared<ShaderProgram>("../../sfmlGraphicsPipeline/shaders/clothConstraintCompute.glsl");
+        m_finishProgram = std::make_shared<ShaderProgram>("../../sfmlGraphicsPipeline/shaders/clothFinishCompute.glsl");
+    }
+}
+
+void GPUClothRenderable::setMode(Mode mode)
+{
+    m_mode = mode;
+}
+
+GPUClothRenderable::Mode GPUClothRenderable::getMode() const
+{
+    return m_mode;
+}
+
+void GPUClothRenderable::setSubsteps(int substeps)
+{
+    m_substeps = std::max(1, substeps);
+}
+
+void GPUClothRenderable::setIterations(int iterations)
+{
+    m_iterations = std::max(0, iterations);
+}
+
+void GPUClothRenderable::setRelaxation(float relaxation)
+{
+    m_relaxation = relaxation;
+}
+
+void GPUClothRenderable::setBendingStiffness(float stiffness)
+{
+    m_bendingStiffness = stiffness;
+}
+
+void GPUClothRenderable::setGravity(const glm::vec3& gravity)
+{
+    m_gravity = gravity;
+}
+
+void GPUClothRenderable::setWind(const glm::vec3& wind)
+{
+    m_wind = wind;
+}
+
+void GPUClothRenderable::setAirDamping(float damping)
+{
+    m_airDamping = damping;
+}
+
+size_t GPUClothRenderable::particleCount() const
+{
+    return m_positions.size();
+}
+
+void GPUClothRenderable::dispatch(ShaderProgram& program)
+{
+    GLuint count = m_positions.size();
+    glcheck(glUniform1ui(program.getUniformLocation("particleCount"), count));
+    glcheck(glUniform2iv(program.getUniformLocation("resolution"), 1, glm::value_ptr(m_resolution)));
+    glcheck(glDispatchCompute((count + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE, 1, 1));
+    // The next pass reads what this one wrote
+    glcheck(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+}
+
+void GPUClothRenderable::do_animate(float time)
+{
+    TexturedMeshRenderable::do_animate(time);
+
+    float dt = time - m_lastUpdateTime;
+    m_lastUpdateTime = time;
+    // The animation was reset or looped, or compute shaders are not available
+    if (dt <= 0 || !m_predictProgram)
+        return;
+    // Avoid a burst after a pause of the application
+    dt = std::min(dt, 0.05f) / m_substeps;
+
+    glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_buffers[PREVIOUS]));
+    glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_buffers[VELOCITIES]));
+    glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_buffers[NORMALS]));
+
+    for (int substep = 0; substep < m_substeps; ++substep)
+    {
+        // Predict the positions, from the current buffer to the other one
+        ShaderProgram & predict = *m_predictProgram;
+        predict.bind();
+        glcheck(glUniform2fv(predict.getUniformLocation("spacing"), 1, glm::value_ptr(m_spacing)));
+        glcheck(glUniform1f(predict.getUniformLocation("dt"), dt));
+        glcheck(glUniform3fv(predict.getUniformLocation("gravity"), 1, glm::value_ptr(m_gravity)));
+        glcheck(glUniform3fv(predict.getUniformLocation("wind"), 1, glm::value_ptr(m_wind)));
+        glcheck(glUniform1f(predict.getUniformLocation("airDamping"), m_airDamping));
+        glcheck(glUniform1i(predict.getUniformLocation("springForces"), m_mode == SPRINGS ? 1 : 0));
+        glcheck(glUniform1f(predict.getUniformLocation("stiffness"), m_stiffness));
+        glcheck(glUniform1f(predict.getUniformLocation("damping"), m_damping));
+        glcheck(glUniform1f(predict.getUniformLocation("bendingStiffness"), m_bendingStiffness));
+        glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffers[m_current]));
+        glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_buffers[POSITIONS_A + POSITIONS_B - m_current]));
+        glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_buffers[LAMBDAS_A]));
+        glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_buffers[LAMBDAS_B]));
+        dispatch(predict);
+        m_current = POSITIONS_A + POSITIONS_B - m_current;
+
+        // Jacobi iterations over the constraints, ping-ponging the positions and the multipliers
+        if (m_mode == XPBD && m_iterations > 0)
+        {
+            ShaderProgram & constraint = *m_constraintProgram;
+            constraint.bind();
+            glcheck(glUniform2fv(constraint.getUniformLocation("spacing"), 1, glm::value_ptr(m_spacing)));
+            glcheck(glUniform1f(constraint.getUniformLocation("dt"), dt));
+            glcheck(glUniform1f(constraint.getUniformLocation("compliance"), 1.0f / m_stiffness));
+            glcheck(glUniform1f(constraint.getUniformLocation("damping"), m_damping));
+            glcheck(glUniform1f(constraint.getUniformLocation("bendingCompliance"), 1.0f / m_bendingStiffness));
+            glcheck(glUniform1f(constraint.getUniformLocation("relaxation"), m_relaxation));
+            unsigned int lambdas = LAMBDAS_A;
+            for (int iteration = 0; iteration < m_iterations; ++iteration)
+            {
+                glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffers[m_current]));
+                glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_buffers[POSITIONS_A + POSITIONS_B - m_current]));
+                glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_buffers[lambdas]));
+                glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_buffers[LAMBDAS_A + LAMBDAS_B - lambdas]));
+                dispatch(constraint);
+                m_current = POSITIONS_A + POSITIONS_B - m_current;
+                lambdas = LAMBDAS_A + LAMBDAS_B - lambdas;
+            }
+        }
+
+        // Velocities and normals from the final positions
+        ShaderProgram & finish = *m_finishProgram;
+        finish.bind();
+        glcheck(glUniform1f(finish.getUniformLocation("dt"), dt));
+        glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffers[m_current]));
+        dispatch(finish);
+    }
+
+    for (unsigned int binding = 0; binding <= 6; ++binding)
+    {
+        glcheck(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0));
+    }
+    ShaderProgram::unbind();
+    // The vertex stage reads the positions and normals written above
+    glcheck(glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT));
+}
+
+void GPUClothRenderable::do_draw()
+{
+    // Read the positions and the normals in the storage buffers, as vec4
+    m_positionBuffer = m_buffers[m_current];
+    m_positionOffset = 0;
+    m_positionStride = sizeof(glm::vec4);
+    m_normalBuffer = m_buffers[NORMALS];
+    m_normalStride = sizeof(glm::vec4);
+
+    TexturedMeshRenderable::do_draw();
+}
@@ -0,0 +1,407 @@
+#include "./../../include/texturing/ImpostorRenderable.hpp"
+#include "./../../include/gl_helper.hpp"
+#include "./../../include/log.hpp"
+#include "./../../include/Viewer.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <GL/glew.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// Relative margin around the distance threshold, to avoid instances switching
+// back and forth between their mesh and their impostor.
+static const float impostor_hysteresis = 0.05f;
+
+static float sign_not_zero(float v)
+{
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Octahedral mapping of a direction to [-1,1]^2, the upper hemisphere (y > 0)
+// being the inner diamond. Must match octDecode() in impostorVertex.glsl.
+static glm::vec3 oct_decode(const glm::vec2 & o)
+{
+    glm::vec3 v(o.x, 1.0f - std::abs(o.x) - std::abs(o.y), o.y);
+    if (v.y < 0.0f)
+    {
+        float x = v.x;
+        v.x = (1.0f - std::abs(v.z)) * sign_not_zero(x);
+        v.z = (1.0f - std::abs(x)) * sign_not_zero(v.z);
+    }
+    return glm::normalize(v);
+}
+
+ImpostorRenderable::~ImpostorRenderable()
+{
+    glcheck(glDeleteTextures(1, &m_colorTexId));
+    glcheck(glDeleteTextures(1, &m_normalTexId));
+    glcheck(glDeleteBuffers(1, &m_qBuffer));
+    glcheck(glDeleteBuffers(1, &m_idBuffer));
+}
+
+ImpostorRenderable::ImpostorRenderable(ShaderProgramPtr program,
+                                       InstancedMeshRenderablePtr meshes,
+                                       float distance,
+                                       unsigned int viewsPerSide,
+                                       unsigned int viewResolution) :
+    HierarchicalRenderable(program),
+    m_meshes(meshes), m_distance(distance), m_viewsPerSide(viewsPerSide),
+    m_boundingRadius(0.0f), m_nextId(0), m_impostorCount(0),
+    m_colorTexId(0), m_normalTexId(0), m_qBuffer(0), m_idBuffer(0)
+{
+    // Bounding sphere of the mesh, in object space
+    const std::vector< glm::vec3 > & positions = m_meshes->positions();
+    glm::vec3 aabbMin(positions.empty() ? glm::vec3(0) : positions[0]), aabbMax(aabbMin);
+    for (const glm::vec3 & p : positions)
+    {
+        aabbMin = glm::min(aabbMin, p);
+        aabbMax = glm::max(aabbMax, p);
+    }
+    m_boundingCenter = 0.5f * (aabbMin + aabbMax);
+    for (const glm::vec3 & p : positions)
+        m_boundingRadius = std::max(m_boundingRadius, glm::length(p - m_boundingCenter));
+
+    std::array<glm::vec2, 4> corners = {
+        glm::vec2(-1,-1),
+        glm::vec2( 1,-1),
+        glm::vec2(-1, 1),
+        glm::vec2( 1, 1),
+    };
+    glcheck(glGenBuffers(1, &m_qBuffer));
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_qBuffer));
+    glcheck(glBufferData(GL_ARRAY_BUFFER, corners.size()*sizeof(glm::vec2), corners.data(), GL_STATIC_DRAW));
+    glcheck(glGenBuffers(1, &m_idBuffer));
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    bake(viewsPerSide, viewResolution);
+}
+
+void ImpostorRenderable::bake(unsigned int viewsPerSide, unsigned int viewResolution)
+{
+    unsigned int size = viewsPerSide * viewResolution;
+
+    // Remember the state changed by the bake
+    GLint previousFramebuffer, viewport[4];
+    GLfloat clearColor[4];
+    glcheck(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer));
+    glcheck(glGetIntegerv(GL_VIEWPORT, viewport));
+    glcheck(glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor));
+
+    // Color and normal atlases, rendered at once
+    unsigned int textures[2];
+    glcheck(glGenTextures(2, textures));
+    m_colorTexId = textures[0];
+    m_normalTexId = textures[1];
+    for (unsigned int texId : textures)
+    {
+        glcheck(glBindTexture(GL_TEXTURE_2D, texId));
+        glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        glcheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    }
+
+    unsigned int framebuffer, depthBuffer;
+    glcheck(glGenFramebuffers(1, &framebuffer));
+    glcheck(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+    glcheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexId, 0));
+    glcheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normalTexId, 0));
+    glcheck(glGenRenderbuffers(1, &depthBuffer));
+    glcheck(glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer));
+    glcheck(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size));
+    glcheck(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer));
+    GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glcheck(glDrawBuffers(2, drawBuffers));
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG(error, "impostor framebuffer is incomplete, impostors will not be visible");
+    }
+    else
+    {
+        ShaderProgram program(
+            "../../sfmlGraphicsPipeline/shaders/impostorBakeVertex.glsl",
+            "../../sfmlGraphicsPipeline/shaders/impostorBakeFragment.glsl");
+        program.bind();
+
+        // Temporary copy of the mesh on the GPU
+        const std::vector< glm::vec3 > & positions = m_meshes->positions();
+        const std::vector< glm::vec3 > & normals = m_meshes->normals();
+        const std::vector< glm::vec2 > & tcoords = m_meshes->tcoords();
+        std::vector< unsigned int > indices = m_meshes->indices();
+        if (!m_meshes->isIndexed())
+        {
+            indices.resize(positions.size());
+            for (unsigned int i = 0; i < indices.size(); ++i)
+                indices[i] = i;
+        }
+        unsigned int buffers[4], texId;
+        glcheck(glGenBuffers(4, buffers));
+        glcheck(glGenTextures(1, &texId));
+
+        int positionLocation = program.getAttributeLocation("vPosition");
+        int normalLocation = program.getAttributeLocation("vNormal");
+        int texcoordLocation = program.getAttributeLocation("vTexCoord");
+        if (positionLocation != ShaderProgram::null_location)
+        {
+            glcheck(glBindBuffer(GL_ARRAY_BUFFER, buffers[0]));
+            glcheck(glBufferData(GL_ARRAY_BUFFER, positions.size()*sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW));
+            glcheck(glEnableVertexAttribArray(positionLocation));
+            glcheck(glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+        }
+        if (normalLocation != ShaderProgram::null_location)
+        {
+            glcheck(glBindBuffer(GL_ARRAY_BUFFER, buffers[1]));
+            glcheck(glBufferData(GL_ARRAY_BUFFER, normals.size()*sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW));
+            glcheck(glEnableVertexAttribArray(normalLocation));
+            glcheck(glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+        }
+        if (texcoordLocation != ShaderProgram::null_location)
+        {
+            glcheck(glBindBuffer(GL_ARRAY_BUFFER, buffers[2]));
+            glcheck(glBufferData(GL_ARRAY_BUFFER, tcoords.size()*sizeof(glm::vec2), tcoords.data(), GL_STATIC_DRAW));
+            glcheck(glEnableVertexAttribArray(texcoordLocation));
+            glcheck(glVertexAttribPointer(texcoordLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)0));
+        }
+        glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[3]));
+        glcheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(unsigned int), indices.data(), GL_STATIC_DRAW));
+
+        const sf::Image & image = m_meshes->image();
+        glcheck(glActiveTexture(GL_TEXTURE0));
+        glcheck(glBindTexture(GL_TEXTURE_2D, texId));
+        glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        glcheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.getSize().x, image.getSize().y, 0, GL_RGBA, GL_UNSIGNED_BYTE, (const GLvoid*)image.getPixelsPtr()));
+        glcheck(glUniform1i(program.getUniformLocation("texSampler"), 0));
+
+        glcheck(glClearColor(0, 0, 0, 0));
+        glcheck(glViewport(0, 0, size, size));
+        glcheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+        // One orthographic view per cell, looking at the mesh from the
+        // direction given by the octahedral mapping of the cell center
+        float r = std::max(m_boundingRadius, 1e-6f);
+        glm::mat4 projection = glm::ortho(-r, r, -r, r, r, 3.0f * r);
+        glcheck(glUniformMatrix4fv(program.getUniformLocation("projMat"), 1, GL_FALSE, glm::value_ptr(projection)));
+        int viewLocation = program.getUniformLocation("viewMat");
+        for (unsigned int j = 0; j < viewsPerSide; ++j)
+        {
+            for (unsigned int i = 0; i < viewsPerSide; ++i)
+            {
+                glm::vec2 o = (glm::vec2(i, j) + 0.5f) / float(viewsPerSide) * 2.0f - 1.0f;
+                glm::vec3 direction = oct_decode(o);
+                glm::vec3 up = std::abs(direction.y) > 0.999f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+                glm::mat4 view = glm::lookAt(m_boundingCenter + 2.0f * r * direction, m_boundingCenter, up);
+                glcheck(glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view)));
+                glcheck(glViewport(i * viewResolution, j * viewResolution, viewResolution, viewResolution));
+                glcheck(glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, (void*)0));
+            }
+        }
+
+        if (positionLocation != ShaderProgram::null_location)
+        {
+            glcheck(glDisableVertexAttribArray(positionLocation));
+        }
+        if (normalLocation != ShaderProgram::null_location)
+        {
+            glcheck(glDisableVertexAttribArray(normalLocation));
+        }
+        if (texcoordLocation != ShaderProgram::null_location)
+        {
+            glcheck(glDisableVertexAttribArray(texcoordLocation));
+        }
+        glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+        glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+        glcheck(glDeleteBuffers(4, buffers));
+        glcheck(glDeleteTextures(1, &texId));
+        ShaderProgram::unbind();
+        LOG(info, "impostor atlas of " << viewsPerSide * viewsPerSide << " views baked (" << size << "x" << size << ")");
+    }
+
+    glcheck(glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer));
+    glcheck(glDeleteRenderbuffers(1, &depthBuffer));
+    glcheck(glDeleteFramebuffers(1, &framebuffer));
+    glcheck(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+    glcheck(glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+}
+
+void ImpostorRenderable::update_instance(Instance & instance, const glm::mat4 & transform)
+{
+    glm::mat3 linear(transform);
+    float scale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+    instance.transform = transform;
+    instance.sphere = glm::vec4(glm::vec3(transform * glm::vec4(m_boundingCenter, 1.0f)), m_boundingRadius * scale);
+    instance.rotation = glm::inverse(linear) * scale;
+}
+
+unsigned int ImpostorRenderable::addInstance(const glm::mat4 & transform)
+{
+    unsigned int id = m_nextId++;
+    Instance & instance = m_instances[id];
+    update_instance(instance, transform);
+    // Instances start as meshes, the partition is updated at the next draw
+    instance.far = false;
+    instance.nearId = m_meshes->addInstance(transform);
+    return id;
+}
+
+bool ImpostorRenderable::removeInstance(unsigned int id)
+{
+    auto it = m_instances.find(id);
+    if (it == m_instances.end())
+    {
+        LOG(warning, "no impostor instance with id " << id << " to remove");
+        return false;
+    }
+    if (!it->second.far)
+        m_meshes->removeInstance(it->second.nearId);
+    m_instances.erase(it);
+    return true;
+}
+
+void ImpostorRenderable::setInstanceTransform(unsigned int id, const glm::mat4 & transform)
+{
+    auto it = m_instances.find(id);
+    if (it == m_instances.end())
+    {
+        LOG(warning, "no impostor instance with id " << id << " to transform");
+        return;
+    }
+    update_instance(it->second, transform);
+    if (!it->second.far)
+        m_meshes->setInstanceTransform(it->second.nearId, transform);
+}
+
+void ImpostorRenderable::setDistance(float distance)
+{
+    m_distance = distance;
+}
+
+size_t ImpostorRenderable::instanceCount() const
+{
+    return m_instances.size();
+}
+
+size_t ImpostorRenderable::impostorCount() const
+{
+    return m_impostorCount;
+}
+
+// Move instances between the instanced mesh and the impostors. The mesh may
+// already have been drawn for this frame: a change only shows at the next one.
+void ImpostorRenderable::update_partition(ArenaVector< ImpostorData > & impostors)
+{
+    glm::vec3 camera = m_viewer->getCamera().getPosition();
+    glm::mat4 model = getModelMatrix();
+    for (auto & entry : m_instances)
+    {
+        Instance & instance = entry.second;
+        float distance = glm::length(glm::vec3(model * glm::vec4(glm::vec3(instance.sphere), 1.0f)) - camera);
+        bool far = distance > m_distance * (instance.far ? 1.0f - impostor_hysteresis : 1.0f + impostor_hysteresis);
+        if (far && !instance.far)
+            m_meshes->removeInstance(instance.nearId);
+        else if (!far && instance.far)
+            instance.nearId = m_meshes->addInstance(instance.transform);
+        instance.far = far;
+
+        if (far)
+        {
+            ImpostorData data;
+            data.sphere = instance.sphere;
+            data.rotation = instance.rotation;
+            impostors.push_back(data);
+        }
+    }
+}
+
+void ImpostorRenderable::do_draw()
+{
+    if (!m_viewer)
+        return;
+    // The far instances of this frame are gathered in the frame arena
+    ArenaVector< ImpostorData > impostors;
+    impostors.reserve(m_instances.size());
+    update_partition(impostors);
+    m_impostorCount = impostors.size();
+    if (impostors.empty())
+        return;
+
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_idBuffer));
+    glcheck(glBufferData(GL_ARRAY_BUFFER, impostors.size()*sizeof(ImpostorData), impostors.data(), GL_STREAM_DRAW));
+
+    Material::sendToGPU(m_shaderProgram, m_meshes->getMaterial());
+
+    int cornerLocation = m_shaderProgram->getAttributeLocation("vPosition");
+    int sphereLocation = m_shaderProgram->getAttributeLocation("instanceSphere");
+    int rotationLocation = m_shaderProgram->getAttributeLocation("instanceRotation");
+    int modelLocation = m_shaderProgram->getUniformLocation("modelMat");
+    int viewsLocation = m_shaderProgram->getUniformLocation("viewsPerSide");
+    int colorSamplerLocation = m_shaderProgram->getUniformLocation("colorSampler");
+    int normalSamplerLocation = m_shaderProgram->getUniformLocation("normalSampler");
+
+    if (modelLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(getModelMatrix())));
+    }
+    if (viewsLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniform1f(viewsLocation, float(m_viewsPerSide)));
+    }
+    glcheck(glActiveTexture(GL_TEXTURE0));
+    glcheck(glBindTexture(GL_TEXTURE_2D, m_colorTexId));
+    glcheck(glUniform1i(colorSamplerLocation, 0));
+    glcheck(glActiveTexture(GL_TEXTURE1));
+    glcheck(glBindTexture(GL_TEXTURE_2D, m_normalTexId));
+    glcheck(glUniform1i(normalSamplerLocation, 1));
+
+    if (cornerLocation != ShaderProgram::null_location)
+    {
+        glcheck(glEnableVertexAttribArray(cornerLocation));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_qBuffer));
+        glcheck(glVertexAttribPointer(cornerLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)0));
+    }
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_idBuffer));
+    if (sphereLocation != ShaderProgram::null_location)
+    {
+        glcheck(glEnableVertexAttribArray(sphereLocation));
+        glcheck(glVertexAttribPointer(sphereLocation, 4, GL_FLOAT, GL_FALSE, sizeof(ImpostorData), (void*)offsetof(ImpostorData, sphere)));
+        glcheck(glVertexAttribDivisor(sphereLocation, 1));
+    }
+    if (rotationLocation != ShaderProgram::null_location)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            glcheck(glEnableVertexAttribArray(rotationLocation + c));
+            glcheck(glVertexAttribPointer(rotationLocation + c, 3, GL_FLOAT, GL_FALSE, sizeof(ImpostorData),
+                                          (void*)(offsetof(ImpostorData, rotation) + c * sizeof(glm::vec3))));
+            glcheck(glVertexAttribDivisor(rotationLocation + c, 1));
+        }
+    }
+
+    glcheck(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, impostors.size()));
+
+    if (cornerLocation != ShaderProgram::null_location)
+    {
+        glcheck(glDisableVertexAttribArray(cornerLocation));
+    }
+    if (sphereLocation != ShaderProgram::null_location)
+    {
+        glcheck(glVertexAttribDivisor(sphereLocation, 0));
+        glcheck(glDisableVertexAttribArray(sphereLocation));
+    }
+    if (rotationLocation != ShaderProgram::null_location)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            glcheck(glVertexAttribDivisor(rotationLocation + c, 0));
+            glcheck(glDisableVertexAttribArray(rotationLocation + c));
+        }
+    }
+    glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+    glcheck(glActiveTexture(GL_TEXTURE0));
+    glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+}
@@ -0,0 +1,238 @@
+#include "./../../include/texturing/InstancedMeshRenderable.hpp"
+#include "./../../include/gl_helper.hpp"
+#include "./../../include/log.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <GL/glew.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+InstancedMeshRenderable::~InstancedMeshRenderable()
+{
+    glcheck(glDeleteBuffers(1, &m_instanceBuffer));
+}
+
+InstancedMeshRenderable::InstancedMeshRenderable(
+    ShaderProgramPtr program,
+    const std::string & mesh_filename,
+    const MaterialPtr & material,
+    const std::string & texture_filename) :
+    TexturedLightedMeshRenderable(program, mesh_filename, material, texture_filename),
+    m_nextId(0), m_instanceBuffer(0), m_bufferCapacity(0), m_dirtyBegin(0), m_dirtyEnd(0)
+{
+    glcheck(glGenBuffers(1, &m_instanceBuffer));
+    m_instanceCount = 0;
+}
+
+unsigned int InstancedMeshRenderable::addInstance(const glm::mat4 & transform, const glm::vec4 & color)
+{
+    InstanceData data;
+    data.model = transform;
+    data.nit = glm::transpose(glm::inverse(glm::mat3(transform)));
+    data.color = color;
+
+    unsigned int id = m_nextId++;
+    m_idSlots[id] = m_instances.size();
+    m_slotIds.push_back(id);
+    m_instances.push_back(data);
+    markDirty(m_instances.size() - 1);
+    return id;
+}
+
+bool InstancedMeshRenderable::removeInstance(unsigned int id)
+{
+    auto it = m_idSlots.find(id);
+    if (it == m_idSlots.end())
+    {
+        LOG(warning, "no instance with id " << id << " to remove");
+        return false;
+    }
+
+    // Move the last instance in the freed slot to keep the buffer packed
+    size_t slot = it->second;
+    size_t last = m_instances.size() - 1;
+    if (slot != last)
+    {
+        m_instances[slot] = m_instances[last];
+        m_slotIds[slot] = m_slotIds[last];
+        m_idSlots[m_slotIds[slot]] = slot;
+        markDirty(slot);
+    }
+    m_instances.pop_back();
+    m_slotIds.pop_back();
+    m_idSlots.erase(id);
+    m_dirtyEnd = std::min(m_dirtyEnd, m_instances.size());
+    if (m_dirtyBegin >= m_dirtyEnd)
+        m_dirtyBegin = m_dirtyEnd = 0;
+    return true;
+}
+
+void InstancedMeshRenderable::setInstanceTransform(unsigned int id, const glm::mat4 & transform)
+{
+    size_t slot = slotOf(id);
+    if (slot == m_instances.size())
+    {
+        LOG(warning, "no instance with id " << id << " to transform");
+        return;
+    }
+    m_instances[slot].model = transform;
+    m_instances[slot].nit = glm::transpose(glm::inverse(glm::mat3(transform)));
+    markDirty(slot);
+}
+
+void InstancedMeshRenderable::setInstanceColor(unsigned int id, const glm::vec4 & color)
+{
+    size_t slot = slotOf(id);
+    if (slot == m_instances.size())
+    {
+        LOG(warning, "no instance with id " << id << " to color");
+        return;
+    }
+    m_instances[slot].color = color;
+    markDirty(slot);
+}
+
+const glm::mat4 & InstancedMeshRenderable::getInstanceTransform(unsigned int id) const
+{
+    size_t slot = slotOf(id);
+    assert(slot != m_instances.size());
+    return m_instances[slot].model;
+}
+
+const glm::vec4 & InstancedMeshRenderable::getInstanceColor(unsigned int id) const
+{
+    size_t slot = slotOf(id);
+    assert(slot != m_instances.size());
+    return m_instances[slot].color;
+}
+
+bool InstancedMeshRenderable::hasInstance(unsigned int id) const
+{
+    return m_idSlots.count(id) != 0;
+}
+
+size_t InstancedMeshRenderable::instanceCount() const
+{
+    return m_instances.size();
+}
+
+void InstancedMeshRenderable::clearInstances()
+{
+    m_instances.clear();
+    m_slotIds.clear();
+    m_idSlots.clear();
+    m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+size_t InstancedMeshRenderable::slotOf(unsigned int id) const
+{
+    auto it = m_idSlots.find(id);
+    return it == m_idSlots.end() ? m_instances.size() : it->second;
+}
+
+void InstancedMeshRenderable::markDirty(size_t slot)
+{
+    if (m_dirtyBegin >= m_dirtyEnd)
+    {
+        m_dirtyBegin = slot;
+        m_dirtyEnd = slot + 1;
+    }
+    else
+    {
+        m_dirtyBegin = std::min(m_dirtyBegin, slot);
+        m_dirtyEnd = std::max(m_dirtyEnd, slot + 1);
+    }
+}
+
+void InstancedMeshRenderable::update_instances_buffer()
+{
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer));
+    if (m_instances.size() > m_bufferCapacity)
+    {
+        // Grow geometrically so that adding instances one by one stays cheap
+        m_bufferCapacity = std::max(m_instances.size(), 2 * m_bufferCapacity);
+        glcheck(glBufferData(GL_ARRAY_BUFFER, m_bufferCapacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW));
+        m_dirtyBegin = 0;
+        m_dirtyEnd = m_instances.size();
+    }
+    // Only send the range of instances modified since the last draw
+    if (m_dirtyBegin < m_dirtyEnd)
+    {
+        glcheck(glBufferSubData(GL_ARRAY_BUFFER, m_dirtyBegin * sizeof(InstanceData),
+                                (m_dirtyEnd - m_dirtyBegin) * sizeof(InstanceData),
+                                m_instances.data() + m_dirtyBegin));
+    }
+    m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+// Per-instance attributes are set here, the rest of the pipeline (material,
+// texture, mesh attributes) is the one of TexturedLightedMeshRenderable.
+void InstancedMeshRenderable::do_draw()
+{
+    if (m_instances.empty())
+        return;
+
+    update_instances_buffer();
+
+    int modelLocation = m_shaderProgram->getAttributeLocation("instanceModel");
+    int nitLocation = m_shaderProgram->getAttributeLocation("instanceNIT");
+    int colorLocation = m_shaderProgram->getAttributeLocation("instanceColor");
+    const GLsizei stride = sizeof(InstanceData);
+
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer));
+    // A matrix attribute uses one location per column
+    if (modelLocation != ShaderProgram::null_location)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            glcheck(glEnableVertexAttribArray(modelLocation + c));
+            glcheck(glVertexAttribPointer(modelLocation + c, 4, GL_FLOAT, GL_FALSE, stride,
+                                          (void*)(offsetof(InstanceData, model) + c * sizeof(glm::vec4))));
+            glcheck(glVertexAttribDivisor(modelLocation + c, 1));
+        }
+    }
+    if (nitLocation != ShaderProgram::null_location)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            glcheck(glEnableVertexAttribArray(nitLocation + c));
+            glcheck(glVertexAttribPointer(nitLocation + c, 3, GL_FLOAT, GL_FALSE, stride,
+                                          (void*)(offsetof(InstanceData, nit) + c * sizeof(glm::vec3))));
+            glcheck(glVertexAttribDivisor(nitLocation + c, 1));
+        }
+    }
+    if (colorLocation != ShaderProgram::null_location)
+    {
+        glcheck(glEnableVertexAttribArray(colorLocation));
+        glcheck(glVertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, stride,
+                                      (void*)offsetof(InstanceData, color)));
+        glcheck(glVertexAttribDivisor(colorLocation, 1));
+    }
+
+    m_instanceCount = m_instances.size();
+    TexturedLightedMeshRenderable::do_draw();
+
+    // Release instance attributes, divisors are part of the global state
+    if (modelLocation != ShaderProgram::null_location)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            glcheck(glVertexAttribDivisor(modelLocation + c, 0));
+            glcheck(glDisableVertexAttribArray(modelLocation + c));
+        }
+    }
+    if (nitLocation != ShaderProgram::null_location)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            glcheck(glVertexAttribDivisor(nitLocation + c, 0));
+            glcheck(glDisableVertexAttribArray(nitLocation + c));
+        }
+    }
+    if (colorLocation != ShaderProgram::null_location)
+    {
+        glcheck(glVertexAttribDivisor(colorLocation, 0));
+        glcheck(glDisableVertexAttribArray(colorLocation));
+    }
+}
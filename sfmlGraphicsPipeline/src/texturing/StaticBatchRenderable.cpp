@@ -0,0 +1,412 @@
+#include "./../../include/texturing/StaticBatchRenderable.hpp"
+#include "./../../include/gl_helper.hpp"
+#include "./../../include/log.hpp"
+#include "./../../include/Viewer.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <tuple>
+
+// Cheap hash of the pixels (FNV-1a), only used to avoid comparing whole images
+static size_t image_hash(const sf::Image & image)
+{
+    size_t size = 4 * image.getSize().x * image.getSize().y;
+    const sf::Uint8 * pixels = image.getPixelsPtr();
+    size_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ pixels[i]) * 1099511628211ULL;
+    return hash;
+}
+
+static bool same_image(const sf::Image & a, const sf::Image & b)
+{
+    if (a.getSize() != b.getSize())
+        return false;
+    size_t size = 4 * a.getSize().x * a.getSize().y;
+    return size == 0 || std::memcmp(a.getPixelsPtr(), b.getPixelsPtr(), size) == 0;
+}
+
+std::vector< StaticBatchRenderablePtr > StaticBatchRenderable::freeze(
+    const std::vector< TexturedLightedMeshRenderablePtr > & renderables,
+    float chunkSize)
+{
+    struct Group
+    {
+        TexturedLightedMeshRenderablePtr first;
+        size_t hash;
+        std::vector< TexturedLightedMeshRenderablePtr > members;
+    };
+    std::vector< Group > groups;
+
+    for (const TexturedLightedMeshRenderablePtr & r : renderables)
+    {
+        size_t hash = image_hash(r->image());
+        auto group = std::find_if(groups.begin(), groups.end(), [&](const Group & g) {
+            return g.first->getShaderProgram() == r->getShaderProgram()
+                && g.first->getMaterial() == r->getMaterial()
+                && g.first->getWrapOption() == r->getWrapOption()
+                && g.hash == hash
+                && same_image(g.first->image(), r->image());
+        });
+        if (group == groups.end())
+        {
+            Group g;
+            g.first = r;
+            g.hash = hash;
+            groups.push_back(g);
+            group = groups.end() - 1;
+        }
+        group->members.push_back(r);
+    }
+
+    std::vector< StaticBatchRenderablePtr > batches;
+    for (const Group & g : groups)
+    {
+        batches.push_back(std::make_shared<StaticBatchRenderable>(
+            g.first->getShaderProgram(), g.first->getMaterial(), g.first->image(),
+            g.first->getWrapOption(), g.members, chunkSize));
+    }
+    LOG(info, "froze " << renderables.size() << " static renderables into " << batches.size() << " batches");
+    return batches;
+}
+
+StaticBatchRenderable::~StaticBatchRenderable()
+{
+    glcheck(glDeleteBuffers(1, &m_pBuffer));
+    glcheck(glDeleteBuffers(1, &m_nBuffer));
+    glcheck(glDeleteBuffers(1, &m_tBuffer));
+    glcheck(glDeleteBuffers(1, &m_iBuffer));
+    glcheck(glDeleteTextures(1, &m_texId));
+}
+
+StaticBatchRenderable::StaticBatchRenderable(
+    ShaderProgramPtr program,
+    const MaterialPtr & material,
+    const sf::Image & image,
+    unsigned int wrapOption,
+    const std::vector< TexturedLightedMeshRenderablePtr > & renderables,
+    float chunkSize) :
+    HierarchicalRenderable(program),
+    m_sources(renderables), m_material(material), m_image(image),
+    m_culling(true), m_lastDrawCallCount(0),
+    m_pBuffer(0), m_nBuffer(0), m_tBuffer(0), m_iBuffer(0), m_texId(0)
+{
+    // Pre-transform every source to world space
+    std::vector< glm::uvec3 > triangles;
+    std::vector< unsigned int > sources;
+    for (size_t s = 0; s < m_sources.size(); ++s)
+    {
+        const TexturedLightedMeshRenderablePtr & r = m_sources[s];
+        glm::mat4 model = r->computeTotalGlobalTransform() * r->getLocalTransform();
+        glm::mat3 nit = glm::transpose(glm::inverse(glm::mat3(model)));
+        unsigned int base = m_positions.size();
+
+        const std::vector< glm::vec3 > & positions = r->positions();
+        const std::vector< glm::vec3 > & normals = r->normals();
+        const std::vector< glm::vec2 > & tcoords = r->tcoords();
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            m_positions.push_back(glm::vec3(model * glm::vec4(positions[i], 1.0f)));
+            m_normals.push_back(i < normals.size() ? glm::normalize(nit * normals[i]) : glm::vec3(0, 0, 1));
+            m_tcoords.push_back(i < tcoords.size() ? tcoords[i] : glm::vec2(0.0));
+        }
+
+        if (r->isIndexed())
+        {
+            const std::vector< unsigned int > & indices = r->indices();
+            for (size_t i = 0; i + 2 < indices.size(); i += 3)
+                triangles.push_back(glm::uvec3(indices[i], indices[i+1], indices[i+2]) + base);
+        }
+        else
+        {
+            for (unsigned int i = 0; i + 2 < positions.size(); i += 3)
+                triangles.push_back(glm::uvec3(i, i+1, i+2) + base);
+        }
+        sources.resize(triangles.size(), s);
+    }
+
+    // Sort the triangles into the chunks of a regular grid, by centroid
+    typedef std::tuple<int, int, int> Cell;
+    std::map< Cell, std::vector< unsigned int > > cells;
+    for (unsigned int t = 0; t < triangles.size(); ++t)
+    {
+        glm::vec3 c = (m_positions[triangles[t].x] + m_positions[triangles[t].y] + m_positions[triangles[t].z]) / 3.0f;
+        glm::ivec3 cell = glm::ivec3(glm::floor(c / chunkSize));
+        cells[Cell(cell.x, cell.y, cell.z)].push_back(t);
+    }
+
+    for (const auto & cell : cells)
+    {
+        Chunk chunk;
+        chunk.firstIndex = m_indices.size();
+        chunk.indexCount = 3 * cell.second.size();
+        chunk.aabbMin = glm::vec3(std::numeric_limits<float>::max());
+        chunk.aabbMax = glm::vec3(-std::numeric_limits<float>::max());
+        for (unsigned int t : cell.second)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                m_indices.push_back(triangles[t][k]);
+                chunk.aabbMin = glm::min(chunk.aabbMin, m_positions[triangles[t][k]]);
+                chunk.aabbMax = glm::max(chunk.aabbMax, m_positions[triangles[t][k]]);
+            }
+            m_triangleSources.push_back(sources[t]);
+        }
+        m_chunks.push_back(chunk);
+    }
+
+    LOG(info, "static batch of " << m_sources.size() << " renderables: "
+        << triangles.size() << " triangles in " << m_chunks.size() << " chunks");
+
+    gen_buffers();
+    update_buffers();
+    update_texture(wrapOption);
+}
+
+void StaticBatchRenderable::gen_buffers()
+{
+    glcheck(glGenBuffers(1, &m_pBuffer)); //vertices
+    glcheck(glGenBuffers(1, &m_nBuffer)); //normals
+    glcheck(glGenBuffers(1, &m_tBuffer)); //texture coordinates
+    glcheck(glGenBuffers(1, &m_iBuffer)); //indices
+    glcheck(glGenTextures(1, &m_texId));
+}
+
+void StaticBatchRenderable::update_buffers()
+{
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_pBuffer));
+    glcheck(glBufferData(GL_ARRAY_BUFFER, m_positions.size()*sizeof(glm::vec3), m_positions.data(), GL_STATIC_DRAW));
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_nBuffer));
+    glcheck(glBufferData(GL_ARRAY_BUFFER, m_normals.size()*sizeof(glm::vec3), m_normals.data(), GL_STATIC_DRAW));
+    glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_tBuffer));
+    glcheck(glBufferData(GL_ARRAY_BUFFER, m_tcoords.size()*sizeof(glm::vec2), m_tcoords.data(), GL_STATIC_DRAW));
+    glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iBuffer));
+    glcheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size()*sizeof(unsigned int), m_indices.data(), GL_STATIC_DRAW));
+    glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+}
+
+// Same wrap modes as TexturedMeshRenderable. The texture coordinates are
+// already scaled since they are copied from the sources.
+void StaticBatchRenderable::update_texture(unsigned int wrapOption)
+{
+    GLint wrap = GL_CLAMP_TO_EDGE;
+    if (wrapOption == 1)
+        wrap = GL_REPEAT;
+    else if (wrapOption == 2)
+        wrap = GL_MIRRORED_REPEAT;
+    else if (wrapOption == 4)
+        wrap = GL_CLAMP_TO_BORDER;
+
+    glcheck(glBindTexture(GL_TEXTURE_2D, m_texId));
+    glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap));
+    glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap));
+    if (wrapOption == 4)
+    {
+        float borderColor[] = { 0.7f, 0.6f, 0.8f, 1.0f };
+        glcheck(glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor));
+    }
+    glcheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, m_image.getSize().x, m_image.getSize().y, 0, GL_RGBA, GL_UNSIGNED_BYTE, (const GLvoid*)m_image.getPixelsPtr()));
+    glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+// Test a box against the 6 planes of the frustum of the matrix m (Gribb & Hartmann).
+// Returns false only if the box is fully outside one of the planes.
+static bool box_in_frustum(const glm::mat4 & m, const glm::vec3 & aabbMin, const glm::vec3 & aabbMax)
+{
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    for (int p = 0; p < 6; ++p)
+    {
+        glm::vec4 plane = (p % 2 == 0) ? rows[3] + rows[p / 2] : rows[3] - rows[p / 2];
+        // Corner of the box the farthest along the plane normal
+        glm::vec3 corner(plane.x > 0 ? aabbMax.x : aabbMin.x,
+                         plane.y > 0 ? aabbMax.y : aabbMin.y,
+                         plane.z > 0 ? aabbMax.z : aabbMin.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+            return false;
+    }
+    return true;
+}
+
+void StaticBatchRenderable::do_draw()
+{
+    //Send material uniform to GPU
+    Material::sendToGPU(m_shaderProgram, m_material);
+
+    int positionLocation = m_shaderProgram->getAttributeLocation("vPosition");
+    int normalLocation = m_shaderProgram->getAttributeLocation("vNormal");
+    int texcoordLocation = m_shaderProgram->getAttributeLocation("vTexCoord");
+    int colorLocation = m_shaderProgram->getAttributeLocation("vColor");
+    int texsamplerLocation = m_shaderProgram->getUniformLocation("texSampler");
+    int modelLocation = m_shaderProgram->getUniformLocation("modelMat");
+    int nitLocation = m_shaderProgram->getUniformLocation("NIT");
+
+    // Vertices are already in world space, only the transformation of the batch remains
+    if(modelLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(getModelMatrix())));
+    }
+    if(nitLocation != ShaderProgram::null_location)
+    {
+        glcheck(glUniformMatrix3fv(nitLocation, 1, GL_FALSE,
+            glm::value_ptr(glm::transpose(glm::inverse(glm::mat3(getModelMatrix()))))));
+    }
+
+    if(positionLocation != ShaderProgram::null_location)
+    {
+        glcheck(glEnableVertexAttribArray(positionLocation));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_pBuffer));
+        glcheck(glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+    }
+    if(normalLocation != ShaderProgram::null_location)
+    {
+        glcheck(glEnableVertexAttribArray(normalLocation));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_nBuffer));
+        glcheck(glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+    }
+    if(texcoordLocation != ShaderProgram::null_location)
+    {
+        glcheck(glActiveTexture(GL_TEXTURE0));
+        glcheck(glBindTexture(GL_TEXTURE_2D, m_texId));
+        glcheck(glUniform1i(texsamplerLocation, 0));
+        glcheck(glEnableVertexAttribArray(texcoordLocation));
+        glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_tBuffer));
+        glcheck(glVertexAttribPointer(texcoordLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)0));
+    }
+    if(colorLocation != ShaderProgram::null_location)
+    {
+        // No color array: the tint of the texture is white
+        glcheck(glVertexAttrib4f(colorLocation, 1.0f, 1.0f, 1.0f, 1.0f));
+    }
+
+    // Chunks are contiguous in the index buffer: consecutive visible chunks
+    // are drawn with a single call.
+    bool culling = m_culling && m_viewer;
+    glm::mat4 mvp;
+    if (culling)
+        mvp = m_viewer->getCamera().projectionMatrix() * m_viewer->getCamera().viewMatrix() * getModelMatrix();
+
+    glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iBuffer));
+    m_lastDrawCallCount = 0;
+    size_t first = 0, count = 0;
+    for (size_t c = 0; c <= m_chunks.size(); ++c)
+    {
+        bool visible = c < m_chunks.size()
+            && (!culling || box_in_frustum(mvp, m_chunks[c].aabbMin, m_chunks[c].aabbMax));
+        if (visible && count == 0)
+            first = m_chunks[c].firstIndex;
+        if (visible)
+            count += m_chunks[c].indexCount;
+        else if (count != 0)
+        {
+            glcheck(glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void*)(first * sizeof(unsigned int))));
+            ++m_lastDrawCallCount;
+            count = 0;
+        }
+    }
+    glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+
+    if(positionLocation != ShaderProgram::null_location)
+    {
+        glcheck(glDisableVertexAttribArray(positionLocation));
+    }
+    if(normalLocation != ShaderProgram::null_location)
+    {
+        glcheck(glDisableVertexAttribArray(normalLocation));
+    }
+    if(texcoordLocation != ShaderProgram::null_location)
+    {
+        glcheck(glDisableVertexAttribArray(texcoordLocation));
+    }
+    glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+// Slab test of a ray against a box, returns the entry distance or a negative value
+static float ray_box(const glm::vec3 & origin, const glm::vec3 & invDirection,
+                     const glm::vec3 & aabbMin, const glm::vec3 & aabbMax)
+{
+    glm::vec3 t0 = (aabbMin - origin) * invDirection;
+    glm::vec3 t1 = (aabbMax - origin) * invDirection;
+    glm::vec3 tmin = glm::min(t0, t1), tmax = glm::max(t0, t1);
+    float enter = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.0f));
+    float exit = std::min(std::min(tmax.x, tmax.y), tmax.z);
+    return enter <= exit ? enter : -1.0f;
+}
+
+// Moller-Trumbore ray/triangle intersection, returns the hit distance or a negative value
+static float ray_triangle(const glm::vec3 & origin, const glm::vec3 & direction,
+                          const glm::vec3 & a, const glm::vec3 & b, const glm::vec3 & c)
+{
+    glm::vec3 e1 = b - a, e2 = c - a;
+    glm::vec3 p = glm::cross(direction, e2);
+    float det = glm::dot(e1, p);
+    if (std::abs(det) < 1e-12f)
+        return -1.0f;
+    float invDet = 1.0f / det;
+    glm::vec3 s = origin - a;
+    float u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f)
+        return -1.0f;
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+        return -1.0f;
+    return glm::dot(e2, q) * invDet;
+}
+
+TexturedLightedMeshRenderablePtr StaticBatchRenderable::pick(const glm::vec3 & origin, const glm::vec3 & direction, float & distance) const
+{
+    // Work in the space of the merged vertices
+    glm::mat4 inverseModel = glm::inverse(getModelMatrix());
+    glm::vec3 o = glm::vec3(inverseModel * glm::vec4(origin, 1.0f));
+    glm::vec3 d = glm::vec3(inverseModel * glm::vec4(direction, 0.0f));
+    glm::vec3 invD = 1.0f / d;
+
+    TexturedLightedMeshRenderablePtr hit;
+    distance = std::numeric_limits<float>::max();
+    for (const Chunk & chunk : m_chunks)
+    {
+        float enter = ray_box(o, invD, chunk.aabbMin, chunk.aabbMax);
+        if (enter < 0.0f || enter > distance)
+            continue;
+        for (unsigned int i = chunk.firstIndex; i < chunk.firstIndex + chunk.indexCount; i += 3)
+        {
+            float t = ray_triangle(o, d, m_positions[m_indices[i]], m_positions[m_indices[i+1]], m_positions[m_indices[i+2]]);
+            if (t >= 0.0f && t < distance)
+            {
+                distance = t;
+                hit = m_sources[m_triangleSources[i / 3]];
+            }
+        }
+    }
+    return hit;
+}
+
+const std::vector< TexturedLightedMeshRenderablePtr > & StaticBatchRenderable::getSources() const
+{
+    return m_sources;
+}
+
+size_t StaticBatchRenderable::chunkCount() const
+{
+    return m_chunks.size();
+}
+
+size_t StaticBatchRenderable::lastDrawCallCount() const
+{
+    return m_lastDrawCallCount;
+}
+
+void StaticBatchRenderable::setCulling(bool culling)
+{
+    m_culling = culling;
+}
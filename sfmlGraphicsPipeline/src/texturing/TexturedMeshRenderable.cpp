@@ -31,7 +31,7 @@ TexturedMeshRenderable::TexturedMeshRenderable(
     ShaderProgramPtr program,
     const std::string & mesh_filename,
     const std::string & texture_filename) :
-    MeshRenderable(program, mesh_filename), // Should initialize m_tcoords trought read_obj...
+    MeshRenderable(program, mesh_filename, glm::vec4(1.0,1.0,1.0,1.0)), // Should initialize m_tcoords trought read_obj...
     m_tBuffer(0), m_texId(0), m_wrap_option(0), m_filter_option(0)
 {
     std::cout << m_tpath[0];
@@ -259,6 +259,10 @@ void TexturedMeshRenderable::setWrapOption(int id) {
     updateTextureOption();
 }
 
+unsigned int TexturedMeshRenderable::getWrapOption() const {
+    return m_wrap_option;
+}
+
 void TexturedMeshRenderable::setImage(std::string img) {
     m_image.loadFromFile(img);
     m_image.flipVertically();